@@ -0,0 +1,644 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * lexgen reads the quoted terminals of the olang EBNF and generates the
+ * tables used by the lexer (src/lexer_tables.h):
+ *
+ * - a 256-entry character class table;
+ * - a DFA recognizing the operators and punctuation;
+ * - a perfect hash table for the keywords.
+ *
+ * Only the terminals the lexer has a token kind for are part of the tables,
+ * the others are listed in the generated header.
+ *
+ * usage: lexgen <olang.ebnf>
+ */
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LEXGEN_MAX_TERMINALS 128
+#define LEXGEN_MAX_TERMINAL_SIZE 16
+#define LEXGEN_MAX_STATES 64
+#define LEXGEN_MAX_COLUMNS 64
+#define LEXGEN_MAX_KEYWORD_TABLE_SIZE 256
+
+typedef struct lexgen_token
+{
+    char *spelling;
+    char *kind;
+} lexgen_token_t;
+
+// Token kinds known by the lexer, indexed by the terminal spelling.
+static lexgen_token_t lexgen_tokens[] = {
+    { "fn", "TOKEN_FN" },
+    { "return", "TOKEN_RETURN" },
+    { "if", "TOKEN_IF" },
+    { "else", "TOKEN_ELSE" },
+    { "while", "TOKEN_WHILE" },
+    { "var", "TOKEN_VAR" },
+    { "extern", "TOKEN_EXTERN" },
+    { "==", "TOKEN_CMP_EQ" },
+    { "!=", "TOKEN_CMP_NEQ" },
+    { "<=", "TOKEN_CMP_LEQ" },
+    { ">=", "TOKEN_CMP_GEQ" },
+    { "||", "TOKEN_LOGICAL_OR" },
+    { "&&", "TOKEN_LOGICAL_AND" },
+    { "<<", "TOKEN_BITWISE_LSHIFT" },
+    { ">>", "TOKEN_BITWISE_RSHIFT" },
+    { "!", "TOKEN_BANG" },
+    { ">", "TOKEN_GT" },
+    { "<", "TOKEN_LT" },
+    { "%", "TOKEN_PERCENT" },
+    { "&", "TOKEN_AND" },
+    { "|", "TOKEN_PIPE" },
+    { "^", "TOKEN_CIRCUMFLEX" },
+    { "=", "TOKEN_EQ" },
+    { "+", "TOKEN_PLUS" },
+    { "-", "TOKEN_DASH" },
+    { "/", "TOKEN_SLASH" },
+    { "*", "TOKEN_STAR" },
+    { "~", "TOKEN_TILDE" },
+    { "(", "TOKEN_OPAREN" },
+    { ")", "TOKEN_CPAREN" },
+    { ":", "TOKEN_COLON" },
+    { ",", "TOKEN_COMMA" },
+    { "{", "TOKEN_OCURLY" },
+    { "}", "TOKEN_CCURLY" },
+};
+
+typedef struct lexgen_terminal
+{
+    char spelling[LEXGEN_MAX_TERMINAL_SIZE];
+    char *kind;
+} lexgen_terminal_t;
+
+typedef struct lexgen
+{
+    lexgen_terminal_t keywords[LEXGEN_MAX_TERMINALS];
+    size_t keywords_size;
+
+    lexgen_terminal_t operators[LEXGEN_MAX_TERMINALS];
+    size_t operators_size;
+
+    char skipped[LEXGEN_MAX_TERMINALS][LEXGEN_MAX_TERMINAL_SIZE];
+    size_t skipped_size;
+
+    // Operator DFA, state 0 is the start state and a 0 transition means
+    // there is no transition.
+    uint8_t columns[256];
+    size_t columns_size;
+    uint8_t dfa[LEXGEN_MAX_STATES][LEXGEN_MAX_COLUMNS];
+    char *accept[LEXGEN_MAX_STATES];
+    size_t states_size;
+
+    // Keyword perfect hash.
+    uint32_t hash_m1;
+    uint32_t hash_m2;
+    size_t keyword_table_size;
+    lexgen_terminal_t *keyword_table[LEXGEN_MAX_KEYWORD_TABLE_SIZE];
+} lexgen_t;
+
+static char *
+lexgen_read_file(char *filepath);
+
+static void
+lexgen_collect_terminals(lexgen_t *gen, char *ebnf);
+
+static void
+lexgen_add_terminal(lexgen_t *gen, char *spelling);
+
+static char *
+lexgen_token_kind(char *spelling);
+
+static bool
+lexgen_is_alpha(char c);
+
+static void
+lexgen_build_dfa(lexgen_t *gen);
+
+static void
+lexgen_add_operator(lexgen_t *gen, char *spelling, char *kind);
+
+static void
+lexgen_build_keyword_hash(lexgen_t *gen);
+
+static uint32_t
+lexgen_keyword_slot(lexgen_t *gen, char *spelling);
+
+static void
+lexgen_emit(lexgen_t *gen, FILE *out);
+
+static void
+lexgen_emit_char(FILE *out, int c);
+
+int
+main(int argc, char **argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <olang.ebnf>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    static lexgen_t gen = { 0 };
+
+    char *ebnf = lexgen_read_file(argv[1]);
+
+    lexgen_collect_terminals(&gen, ebnf);
+    lexgen_build_dfa(&gen);
+    lexgen_build_keyword_hash(&gen);
+    lexgen_emit(&gen, stdout);
+
+    free(ebnf);
+
+    return EXIT_SUCCESS;
+}
+
+static char *
+lexgen_read_file(char *filepath)
+{
+    FILE *stream = fopen(filepath, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "error: %s: %s\n", filepath, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    fseek(stream, 0, SEEK_END);
+    long size = ftell(stream);
+    fseek(stream, 0, SEEK_SET);
+
+    char *content = malloc(size + 1);
+    assert(content);
+
+    if (fread(content, 1, size, stream) != (size_t)size) {
+        fprintf(stderr, "error: %s: could not read file\n", filepath);
+        exit(EXIT_FAILURE);
+    }
+    content[size] = 0;
+
+    fclose(stream);
+
+    return content;
+}
+
+static void
+lexgen_collect_terminals(lexgen_t *gen, char *ebnf)
+{
+    char *c = ebnf;
+
+    while (*c != 0) {
+        // Comments: (* ... *)
+        if (c[0] == '(' && c[1] == '*') {
+            char *end = strstr(c + 2, "*)");
+            c = end == NULL ? c + strlen(c) : end + 2;
+            continue;
+        }
+
+        // Regular expressions: #'...' are character classes, not terminals.
+        if (c[0] == '#' && c[1] == '\'') {
+            char *end = strchr(c + 2, '\'');
+            c = end == NULL ? c + strlen(c) : end + 1;
+            continue;
+        }
+
+        if (c[0] == '\'') {
+            char *end = strchr(c + 1, '\'');
+            if (end == NULL) {
+                fprintf(stderr, "error: unterminated terminal\n");
+                exit(EXIT_FAILURE);
+            }
+
+            size_t size = end - c - 1;
+            if (size == 0 || size >= LEXGEN_MAX_TERMINAL_SIZE) {
+                fprintf(stderr, "error: invalid terminal size: %zu\n", size);
+                exit(EXIT_FAILURE);
+            }
+
+            char spelling[LEXGEN_MAX_TERMINAL_SIZE] = { 0 };
+            memcpy(spelling, c + 1, size);
+            lexgen_add_terminal(gen, spelling);
+
+            c = end + 1;
+            continue;
+        }
+
+        ++c;
+    }
+}
+
+static void
+lexgen_add_terminal(lexgen_t *gen, char *spelling)
+{
+    for (size_t i = 0; i < gen->keywords_size; ++i) {
+        if (strcmp(gen->keywords[i].spelling, spelling) == 0) {
+            return;
+        }
+    }
+    for (size_t i = 0; i < gen->operators_size; ++i) {
+        if (strcmp(gen->operators[i].spelling, spelling) == 0) {
+            return;
+        }
+    }
+    for (size_t i = 0; i < gen->skipped_size; ++i) {
+        if (strcmp(gen->skipped[i], spelling) == 0) {
+            return;
+        }
+    }
+
+    char *kind = lexgen_token_kind(spelling);
+
+    if (kind == NULL) {
+        assert(gen->skipped_size < LEXGEN_MAX_TERMINALS);
+        strcpy(gen->skipped[gen->skipped_size++], spelling);
+        return;
+    }
+
+    lexgen_terminal_t *terminal;
+    if (lexgen_is_alpha(spelling[0])) {
+        assert(gen->keywords_size < LEXGEN_MAX_TERMINALS);
+        terminal = &gen->keywords[gen->keywords_size++];
+    } else {
+        assert(gen->operators_size < LEXGEN_MAX_TERMINALS);
+        terminal = &gen->operators[gen->operators_size++];
+    }
+
+    strcpy(terminal->spelling, spelling);
+    terminal->kind = kind;
+}
+
+static char *
+lexgen_token_kind(char *spelling)
+{
+    size_t size = sizeof(lexgen_tokens) / sizeof(lexgen_tokens[0]);
+    for (size_t i = 0; i < size; ++i) {
+        if (strcmp(lexgen_tokens[i].spelling, spelling) == 0) {
+            return lexgen_tokens[i].kind;
+        }
+    }
+    return NULL;
+}
+
+static bool
+lexgen_is_alpha(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static void
+lexgen_build_dfa(lexgen_t *gen)
+{
+    gen->states_size = 1;
+
+    for (size_t i = 0; i < gen->operators_size; ++i) {
+        lexgen_add_operator(
+            gen, gen->operators[i].spelling, gen->operators[i].kind);
+    }
+
+    // Line feeds are tokens, the grammar only has them as a character class.
+    lexgen_add_operator(gen, "\n", "TOKEN_LF");
+}
+
+static void
+lexgen_add_operator(lexgen_t *gen, char *spelling, char *kind)
+{
+    size_t state = 0;
+
+    for (char *c = spelling; *c != 0; ++c) {
+        uint8_t byte = (uint8_t)*c;
+
+        if (gen->columns[byte] == 0) {
+            assert(gen->columns_size + 1 < LEXGEN_MAX_COLUMNS);
+            // Column 0 is never used so a 0 in the column table means the
+            // char is not part of any operator.
+            gen->columns[byte] = (uint8_t)++gen->columns_size;
+        }
+
+        uint8_t column = gen->columns[byte];
+
+        if (gen->dfa[state][column] == 0) {
+            assert(gen->states_size < LEXGEN_MAX_STATES);
+            gen->dfa[state][column] = (uint8_t)gen->states_size++;
+        }
+
+        state = gen->dfa[state][column];
+    }
+
+    gen->accept[state] = kind;
+}
+
+static void
+lexgen_build_keyword_hash(lexgen_t *gen)
+{
+    size_t size = 1;
+    while (size < gen->keywords_size) {
+        size *= 2;
+    }
+
+    for (; size <= LEXGEN_MAX_KEYWORD_TABLE_SIZE; size *= 2) {
+        gen->keyword_table_size = size;
+
+        for (uint32_t m1 = 1; m1 < 256; ++m1) {
+            for (uint32_t m2 = 1; m2 < 256; ++m2) {
+                gen->hash_m1 = m1;
+                gen->hash_m2 = m2;
+                memset(gen->keyword_table, 0, sizeof(gen->keyword_table));
+
+                bool collision = false;
+                for (size_t i = 0; i < gen->keywords_size && !collision; ++i) {
+                    lexgen_terminal_t *keyword = &gen->keywords[i];
+                    uint32_t slot = lexgen_keyword_slot(gen, keyword->spelling);
+
+                    collision = gen->keyword_table[slot] != NULL;
+                    gen->keyword_table[slot] = keyword;
+                }
+
+                if (!collision) {
+                    return;
+                }
+            }
+        }
+    }
+
+    fprintf(stderr, "error: could not find a perfect hash for the keywords\n");
+    exit(EXIT_FAILURE);
+}
+
+static uint32_t
+lexgen_keyword_slot(lexgen_t *gen, char *spelling)
+{
+    size_t size = strlen(spelling);
+    uint32_t first = (uint8_t)spelling[0];
+    uint32_t last = (uint8_t)spelling[size - 1];
+
+    // Must match lexer_keyword_slot in the generated header.
+    return (first * gen->hash_m1 + last * gen->hash_m2 + (uint32_t)size) &
+           (uint32_t)(gen->keyword_table_size - 1);
+}
+
+static void
+lexgen_emit(lexgen_t *gen, FILE *out)
+{
+    fprintf(out,
+            "/*\n"
+            " * Copyright (C) 2024 olang maintainers\n"
+            " *\n"
+            " * This program is free software: you can redistribute it and/or "
+            "modify\n"
+            " * it under the terms of the GNU General Public License as "
+            "published by\n"
+            " * the Free Software Foundation, either version 3 of the License, "
+            "or\n"
+            " * (at your option) any later version.\n"
+            " *\n"
+            " * This program is distributed in the hope that it will be "
+            "useful,\n"
+            " * but WITHOUT ANY WARRANTY; without even the implied warranty "
+            "of\n"
+            " * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the\n"
+            " * GNU General Public License for more details.\n"
+            " *\n"
+            " * You should have received a copy of the GNU General Public "
+            "License\n"
+            " * along with this program.  If not, see "
+            "<https://www.gnu.org/licenses/>.\n"
+            " */\n"
+            "\n"
+            "/*\n"
+            " * Generated by contrib/lexgen/lexgen.c from "
+            "docs/info/olang.ebnf, do not\n"
+            " * edit.  Run `make lexer-tables` to regenerate it.\n");
+
+    if (gen->skipped_size > 0) {
+        fprintf(out,
+                " *\n"
+                " * Terminals without a token kind (not part of the tables):\n"
+                " *");
+        size_t column = 2;
+        for (size_t i = 0; i < gen->skipped_size; ++i) {
+            size_t size = strlen(gen->skipped[i]) + 3;
+            if (column + size > 78) {
+                fprintf(out, "\n *");
+                column = 2;
+            }
+            fprintf(out, " '%s'", gen->skipped[i]);
+            column += size;
+        }
+        fprintf(out, "\n");
+    }
+
+    fprintf(out,
+            " */\n"
+            "#ifndef LEXER_TABLES_H\n"
+            "#define LEXER_TABLES_H\n"
+            "\n"
+            "#include \"lexer.h\"\n"
+            "\n"
+            "#include <stddef.h>\n"
+            "#include <stdint.h>\n"
+            "\n");
+
+    fprintf(out,
+            "typedef enum lexer_char_class\n"
+            "{\n"
+            "    LEXER_CC_OTHER,\n"
+            "    LEXER_CC_SPACE,\n"
+            "    LEXER_CC_ALPHA,\n"
+            "    LEXER_CC_DIGIT,\n"
+            "    LEXER_CC_HASH,\n"
+            "    // Chars starting an operator, see lexer_op_dfa.\n"
+            "    LEXER_CC_OP,\n"
+            "} lexer_char_class_t;\n"
+            "\n");
+
+    fprintf(out,
+            "#define LEXER_OP_STATES %zu\n"
+            "#define LEXER_OP_COLUMNS %zu\n"
+            "#define LEXER_KEYWORD_TABLE_SIZE %zu\n"
+            "#define LEXER_KEYWORD_HASH_M1 %u\n"
+            "#define LEXER_KEYWORD_HASH_M2 %u\n"
+            "\n",
+            gen->states_size,
+            gen->columns_size + 1,
+            gen->keyword_table_size,
+            gen->hash_m1,
+            gen->hash_m2);
+
+    // Character classes.  They follow what the lexer does rather than the
+    // grammar: '\v', '\f' and '\r' are skipped as white spaces and '\n' is a
+    // token.
+    fprintf(out,
+            "// clang-format off\n"
+            "static const uint8_t lexer_char_class[256] = {\n");
+    for (int c = 0; c < 256; ++c) {
+        char *cls = NULL;
+        if (c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\r') {
+            cls = "LEXER_CC_SPACE";
+        } else if (lexgen_is_alpha((char)c)) {
+            cls = "LEXER_CC_ALPHA";
+        } else if (c >= '0' && c <= '9') {
+            cls = "LEXER_CC_DIGIT";
+        } else if (c == '#') {
+            cls = "LEXER_CC_HASH";
+        } else if (gen->columns[c] != 0) {
+            cls = "LEXER_CC_OP";
+        }
+
+        if (cls != NULL) {
+            fprintf(out, "    [");
+            lexgen_emit_char(out, c);
+            fprintf(out, "] = %s,\n", cls);
+        }
+    }
+    fprintf(out, "};\n\n");
+
+    // Operator DFA columns.
+    fprintf(out,
+            "// Column of each char in lexer_op_dfa, 0 is not an operator "
+            "char.\n"
+            "static const uint8_t lexer_op_column[256] = {\n");
+    for (int c = 0; c < 256; ++c) {
+        if (gen->columns[c] != 0) {
+            fprintf(out, "    [");
+            lexgen_emit_char(out, c);
+            fprintf(out, "] = %u,\n", gen->columns[c]);
+        }
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out,
+            "// Operator DFA, state 0 is the start state and a 0 transition "
+            "means there is\n"
+            "// no transition.\n"
+            "static const uint8_t lexer_op_dfa[LEXER_OP_STATES]"
+            "[LEXER_OP_COLUMNS] = {\n");
+    for (size_t state = 0; state < gen->states_size; ++state) {
+        int line_size = fprintf(out, "    [%zu] = {", state);
+        bool first = true;
+        for (size_t column = 1; column <= gen->columns_size; ++column) {
+            if (gen->dfa[state][column] == 0) {
+                continue;
+            }
+
+            char item[32];
+            int item_size = snprintf(item,
+                                     sizeof(item),
+                                     "[%zu] = %u",
+                                     column,
+                                     gen->dfa[state][column]);
+
+            if (!first) {
+                line_size += fprintf(out, ",");
+            }
+
+            if (line_size + item_size + 1 > 78) {
+                fprintf(out, "\n       ");
+                line_size = 7;
+            }
+
+            line_size += fprintf(out, " %s", item);
+            first = false;
+        }
+        fprintf(out, first ? " 0 },\n" : " },\n");
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out,
+            "// Token kind of each accepting state, TOKEN_UNKNOWN means the "
+            "state does not\n"
+            "// accept.\n"
+            "static const uint8_t lexer_op_accept[LEXER_OP_STATES] = {\n");
+    for (size_t state = 0; state < gen->states_size; ++state) {
+        if (gen->accept[state] != NULL) {
+            fprintf(out, "    [%zu] = %s,\n", state, gen->accept[state]);
+        }
+    }
+    fprintf(out, "};\n\n");
+
+    // Keywords.
+    fprintf(out,
+            "typedef struct lexer_keyword\n"
+            "{\n"
+            "    const char *chars;\n"
+            "    size_t size;\n"
+            "    token_kind_t kind;\n"
+            "} lexer_keyword_t;\n"
+            "\n"
+            "static const lexer_keyword_t "
+            "lexer_keywords[LEXER_KEYWORD_TABLE_SIZE] = {\n");
+    for (size_t slot = 0; slot < gen->keyword_table_size; ++slot) {
+        lexgen_terminal_t *keyword = gen->keyword_table[slot];
+        if (keyword != NULL) {
+            fprintf(out,
+                    "    [%zu] = { \"%s\", %zu, %s },\n",
+                    slot,
+                    keyword->spelling,
+                    strlen(keyword->spelling),
+                    keyword->kind);
+        }
+    }
+    fprintf(out, "};\n// clang-format on\n\n");
+
+    fprintf(out,
+            "static uint32_t\n"
+            "lexer_keyword_slot(const char *chars, size_t size)\n"
+            "{\n"
+            "    uint32_t first = (uint8_t)chars[0];\n"
+            "    uint32_t last = (uint8_t)chars[size - 1];\n"
+            "    return (first * LEXER_KEYWORD_HASH_M1 + last * "
+            "LEXER_KEYWORD_HASH_M2 +\n"
+            "            (uint32_t)size) &\n"
+            "           (LEXER_KEYWORD_TABLE_SIZE - 1);\n"
+            "}\n"
+            "\n"
+            "#endif /* LEXER_TABLES_H */\n");
+}
+
+static void
+lexgen_emit_char(FILE *out, int c)
+{
+    switch (c) {
+        case '\t':
+            fprintf(out, "'\\t'");
+            return;
+        case '\n':
+            fprintf(out, "'\\n'");
+            return;
+        case '\v':
+            fprintf(out, "'\\v'");
+            return;
+        case '\f':
+            fprintf(out, "'\\f'");
+            return;
+        case '\r':
+            fprintf(out, "'\\r'");
+            return;
+        case '\'':
+            fprintf(out, "'\\''");
+            return;
+        case '\\':
+            fprintf(out, "'\\\\'");
+            return;
+        default:
+            fprintf(out, "'%c'", c);
+            return;
+    }
+}
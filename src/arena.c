@@ -14,31 +14,60 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
+#define _DEFAULT_SOURCE
 #include "arena.h"
+#include <assert.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define ARENA_BLOCK_HEADER_SIZE                                                \
+    ((sizeof(arena_block_t) + ARENA_ALIGNMENT_BYTES_MASK) &                    \
+     ~(size_t)ARENA_ALIGNMENT_BYTES_MASK)
+
+static arena_block_t *
+arena_block_new(size_t size);
+
+static void
+arena_block_free(arena_block_t *block);
+
+static void
+arena_use_block(arena_t *arena, arena_block_t *block);
+
+static void *
+arena_alloc_slow(arena_t *arena, size_t bytes);
 
 arena_t
 arena_new(size_t size)
 {
-    arena_t arena;
-    arena.offset = 0;
-    arena.region = malloc(sizeof(uint8_t) * size);
-    arena.size = size;
+    arena_t arena = { 0 };
+    arena.head = arena_block_new(size);
+    arena_use_block(&arena, arena.head);
     return arena;
 }
 
-static uint8_t
-arena_padding(size_t bytes);
-
 void *
 arena_alloc(arena_t *arena, size_t bytes)
 {
-    if ((arena->offset + bytes) > arena->size) {
-        return NULL;
+    return arena_alloc_aligned(arena, bytes, ARENA_ALIGNMENT_BYTES);
+}
+
+void *
+arena_alloc_aligned(arena_t *arena, size_t bytes, size_t alignment)
+{
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    assert(alignment <= ARENA_ALIGNMENT_BYTES);
+
+    size_t offset = (arena->offset + alignment - 1) & ~(alignment - 1);
+
+    if (offset > arena->size || bytes > arena->size - offset) {
+        return arena_alloc_slow(arena, bytes);
     }
-    void *pointer = arena->region + arena->offset;
-    arena->offset += bytes + arena_padding(bytes);
+
+    void *pointer = arena->region + offset;
+    arena->offset = offset + bytes;
 
     return pointer;
 }
@@ -46,18 +75,191 @@ arena_alloc(arena_t *arena, size_t bytes)
 void
 arena_release(arena_t *arena)
 {
-    arena->offset = 0;
+    arena_use_block(arena, arena->head);
 }
 
 void
 arena_free(arena_t *arena)
 {
-    arena->size = 0;
-    free(arena->region);
+    arena_block_t *block = arena->head;
+
+    while (block != NULL) {
+        arena_block_t *next = block->next;
+        arena_block_free(block);
+        block = next;
+    }
+
+    *arena = (arena_t){ 0 };
+}
+
+void
+arena_merge(arena_t *arena, arena_t *other)
+{
+    assert(arena);
+    assert(other);
+
+    if (other->head == NULL) {
+        return;
+    }
+
+    // Blocks past the current one hold nothing yet.
+    arena_block_t *spare = other->current->next;
+    while (spare != NULL) {
+        arena_block_t *next = spare->next;
+        arena_block_free(spare);
+        spare = next;
+    }
+
+    arena_block_t *first = other->head;
+    arena_block_t *last = other->current;
+
+    if (arena->head == arena->current) {
+        last->next = arena->head;
+        arena->head = first;
+    } else {
+        arena_block_t *prev = arena->head;
+        while (prev->next != arena->current) {
+            prev = prev->next;
+        }
+        prev->next = first;
+        last->next = arena->current;
+    }
+
+    *other = (arena_t){ 0 };
+}
+
+arena_mark_t
+arena_mark(arena_t *arena)
+{
+    return (arena_mark_t){
+        .block = arena->current,
+        .offset = arena->offset,
+    };
+}
+
+void
+arena_rewind(arena_t *arena, arena_mark_t mark)
+{
+    assert(mark.block);
+
+    // Blocks after the mark are kept in the chain so the next allocations can
+    // reuse them.
+    arena_use_block(arena, mark.block);
+    arena->offset = mark.offset;
 }
 
-static uint8_t
-arena_padding(size_t bytes)
+arena_temp_t
+arena_temp_begin(arena_t *arena)
 {
-    return (ARENA_ALIGNMENT_BYTES - bytes) & ARENA_ALIGNMENT_BYTES_MASK;
+    assert(arena);
+
+    return (arena_temp_t){
+        .arena = arena,
+        .mark = arena_mark(arena),
+    };
+}
+
+void
+arena_temp_end(arena_temp_t temp)
+{
+    arena_rewind(temp.arena, temp.mark);
+}
+
+static void *
+arena_alloc_slow(arena_t *arena, size_t bytes)
+{
+    // Blocks left behind by arena_release are reused before asking the system
+    // for more memory.
+    arena_block_t *block = arena->current->next;
+    while (block != NULL && block->size < bytes) {
+        block = block->next;
+    }
+
+    if (block == NULL) {
+        size_t size = arena->current->size * 2;
+        if (size > ARENA_MAX_BLOCK_BYTES) {
+            size = ARENA_MAX_BLOCK_BYTES;
+        }
+        if (size < bytes) {
+            size = bytes;
+        }
+
+        block = arena_block_new(size);
+
+        arena_block_t *tail = arena->current;
+        while (tail->next != NULL) {
+            tail = tail->next;
+        }
+        tail->next = block;
+    }
+
+    arena_use_block(arena, block);
+
+    void *pointer = arena->region;
+    arena->offset = bytes;
+
+    return pointer;
+}
+
+static void
+arena_use_block(arena_t *arena, arena_block_t *block)
+{
+    arena->current = block;
+    arena->region = block->region;
+    arena->size = block->size;
+    arena->offset = 0;
+}
+
+static arena_block_t *
+arena_block_new(size_t size)
+{
+    size_t total_size = ARENA_BLOCK_HEADER_SIZE + size;
+    arena_block_t *block = NULL;
+    int mapped = 0;
+
+    if (total_size >= ARENA_HUGE_PAGE_BYTES) {
+        total_size = (total_size + ARENA_HUGE_PAGE_BYTES - 1) &
+                     ~(size_t)(ARENA_HUGE_PAGE_BYTES - 1);
+
+        void *pointer = mmap(NULL,
+                             total_size,
+                             PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS,
+                             -1,
+                             0);
+
+        if (pointer != MAP_FAILED) {
+#ifdef MADV_HUGEPAGE
+            madvise(pointer, total_size, MADV_HUGEPAGE);
+#endif
+            block = (arena_block_t *)pointer;
+            mapped = 1;
+        }
+    } else {
+        block = (arena_block_t *)malloc(total_size);
+    }
+
+    if (block == NULL) {
+        fprintf(stderr,
+                "[FATAL] Out of memory: arena_block_new: %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    block->next = NULL;
+    block->size = total_size - ARENA_BLOCK_HEADER_SIZE;
+    block->mapped = mapped;
+    block->region = (uint8_t *)block + ARENA_BLOCK_HEADER_SIZE;
+
+    return block;
+}
+
+static void
+arena_block_free(arena_block_t *block)
+{
+    if (block->mapped) {
+        munmap(block, ARENA_BLOCK_HEADER_SIZE + block->size);
+        return;
+    }
+    free(block);
 }
@@ -22,23 +22,93 @@
 #define ARENA_ALIGNMENT_BYTES 16
 #define ARENA_ALIGNMENT_BYTES_MASK (ARENA_ALIGNMENT_BYTES - 1)
 
+// Blocks grow geometrically up to this size, larger requests get a block of
+// their own.
+#define ARENA_MAX_BLOCK_BYTES (64 * 1024 * 1024)
+
+// Blocks of at least this size are backed by transparent huge pages when the
+// platform supports it.
+#define ARENA_HUGE_PAGE_BYTES (2 * 1024 * 1024)
+
+typedef struct arena_block arena_block_t;
+
+typedef struct arena_block
+{
+    arena_block_t *next;
+    size_t size;
+    int mapped;
+    uint8_t *region;
+} arena_block_t;
+
+/**
+ * The arena is a chain of blocks.  Allocation bumps the offset of the current
+ * block and only falls back to the slow path (moving to the next block or
+ * allocating a new one) when the current block is exhausted.
+ */
 typedef struct arena
 {
     size_t offset;
     size_t size;
     uint8_t *region;
+    arena_block_t *head;
+    arena_block_t *current;
 } arena_t;
 
+typedef struct arena_mark
+{
+    arena_block_t *block;
+    size_t offset;
+} arena_mark_t;
+
+/**
+ * A temporary arena borrows the tail of another arena, everything allocated
+ * after arena_temp_begin is given back by arena_temp_end.  Temporary arenas
+ * can be nested as long as they are ended in the reverse order they were
+ * started.
+ */
+typedef struct arena_temp
+{
+    arena_t *arena;
+    arena_mark_t mark;
+} arena_temp_t;
+
 arena_t
 arena_new(size_t size);
 
 void *
 arena_alloc(arena_t *arena, size_t size);
 
+/**
+ * Allocates with a smaller alignment than ARENA_ALIGNMENT_BYTES, so small
+ * objects allocated back to back are packed instead of padded.
+ */
+void *
+arena_alloc_aligned(arena_t *arena, size_t size, size_t alignment);
+
 void
 arena_release(arena_t *arena);
 
 void
 arena_free(arena_t *arena);
 
+/**
+ * Moves the blocks of other into arena, what was allocated from other lives
+ * until arena is released.  The blocks are placed before the current block
+ * of arena, so its next allocations never reuse them.  other is left empty.
+ */
+void
+arena_merge(arena_t *arena, arena_t *other);
+
+arena_mark_t
+arena_mark(arena_t *arena);
+
+void
+arena_rewind(arena_t *arena, arena_mark_t mark);
+
+arena_temp_t
+arena_temp_begin(arena_t *arena);
+
+void
+arena_temp_end(arena_temp_t temp);
+
 #endif
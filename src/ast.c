@@ -14,7 +14,6 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
-
 #include <assert.h>
 #include <stdint.h>
 
@@ -22,19 +21,27 @@
 #include "ast.h"
 #include "string_view.h"
 
+static ast_node_t *
+ast_new_node(arena_t *arena,
+             ast_node_kind_t kind,
+             token_loc_t loc,
+             size_t size);
+
 ast_node_t *
-ast_new_translation_unit(arena_t *arena)
+ast_new_translation_unit(arena_t *arena,
+                         ast_node_t **decls,
+                         uint32_t decls_size)
 {
-    ast_node_t *node = (ast_node_t *)arena_alloc(arena, sizeof(ast_node_t));
-    assert(node);
-
-    node->kind = AST_NODE_TRANSLATION_UNIT;
-    ast_translation_unit_t *translation_unit = &node->as_translation_unit;
+    assert(arena);
+    assert(decls || decls_size == 0);
 
-    translation_unit->decls = (list_t *)arena_alloc(arena, sizeof(list_t));
-    assert(translation_unit->decls);
+    ast_node_t *node = ast_new_node(arena,
+                                    AST_NODE_TRANSLATION_UNIT,
+                                    (token_loc_t){ 0 },
+                                    sizeof(ast_translation_unit_t));
 
-    list_init(translation_unit->decls, arena);
+    node->as_translation_unit.decls = decls;
+    node->as_translation_unit.decls_size = decls_size;
 
     return node;
 }
@@ -42,21 +49,18 @@ ast_new_translation_unit(arena_t *arena)
 ast_node_t *
 ast_new_node_fn_def(arena_t *arena,
                     token_loc_t loc,
-                    string_view_t id,
-                    list_t *params,
+                    atom_t *id,
+                    ast_fn_param_t **params,
+                    uint32_t params_size,
                     type_t *return_type,
                     bool _extern,
                     ast_node_t *block)
 {
     assert(arena);
-    assert(params);
-
-    ast_node_t *node_fn_def =
-        (ast_node_t *)arena_alloc(arena, sizeof(ast_node_t));
-    assert(node_fn_def);
+    assert(params || params_size == 0);
 
-    node_fn_def->kind = AST_NODE_FN_DEF;
-    node_fn_def->loc = loc;
+    ast_node_t *node_fn_def = ast_new_node(
+        arena, AST_NODE_FN_DEF, loc, sizeof(ast_fn_definition_t));
     ast_fn_definition_t *fn_def = &node_fn_def->as_fn_def;
 
     fn_def->id = id;
@@ -64,6 +68,10 @@ ast_new_node_fn_def(arena_t *arena,
     fn_def->_extern = _extern;
     fn_def->block = block;
     fn_def->params = params;
+    fn_def->params_size = params_size;
+    fn_def->slot_offsets = NULL;
+    fn_def->slots_size = 0;
+    fn_def->frame_size = 0;
 
     return node_fn_def;
 }
@@ -71,22 +79,21 @@ ast_new_node_fn_def(arena_t *arena,
 ast_node_t *
 ast_new_node_fn_call(arena_t *arena,
                      token_loc_t loc,
-                     string_view_t id,
-                     list_t *args)
+                     atom_t *id,
+                     ast_node_t **args,
+                     uint32_t args_size)
 {
     assert(arena);
-    assert(args);
+    assert(args || args_size == 0);
 
     ast_node_t *node_fn_call =
-        (ast_node_t *)arena_alloc(arena, sizeof(ast_node_t));
-    assert(node_fn_call);
-
-    node_fn_call->kind = AST_NODE_FN_CALL;
-    node_fn_call->loc = loc;
+        ast_new_node(arena, AST_NODE_FN_CALL, loc, sizeof(ast_fn_call_t));
     ast_fn_call_t *fn_call = &node_fn_call->as_fn_call;
 
     fn_call->id = id;
     fn_call->args = args;
+    fn_call->args_size = args_size;
+    fn_call->symbol = NULL;
 
     return node_fn_call;
 }
@@ -94,21 +101,18 @@ ast_new_node_fn_call(arena_t *arena,
 ast_node_t *
 ast_new_node_var_def(arena_t *arena,
                      token_loc_t loc,
-                     string_view_t id,
+                     atom_t *id,
                      type_t *type,
                      ast_node_t *value)
 {
-    ast_node_t *node_var_def =
-        (ast_node_t *)arena_alloc(arena, sizeof(ast_node_t));
-    assert(node_var_def);
-
-    node_var_def->kind = AST_NODE_VAR_DEF;
-    node_var_def->loc = loc;
+    ast_node_t *node_var_def = ast_new_node(
+        arena, AST_NODE_VAR_DEF, loc, sizeof(ast_var_definition_t));
     ast_var_definition_t *var_def = &node_var_def->as_var_def;
 
     var_def->id = id;
     var_def->type = type;
     var_def->value = value;
+    var_def->symbol = NULL;
 
     return node_var_def;
 }
@@ -121,11 +125,8 @@ ast_new_node_bin_op(arena_t *arena,
                     ast_node_t *rhs)
 {
     ast_node_t *node_bin_op =
-        (ast_node_t *)arena_alloc(arena, sizeof(ast_node_t));
-    assert(node_bin_op);
+        ast_new_node(arena, AST_NODE_BINARY_OP, loc, sizeof(ast_binary_op_t));
 
-    node_bin_op->kind = AST_NODE_BINARY_OP;
-    node_bin_op->loc = loc;
     node_bin_op->as_bin_op.kind = kind;
     node_bin_op->as_bin_op.lhs = lhs;
     node_bin_op->as_bin_op.rhs = rhs;
@@ -140,11 +141,8 @@ ast_new_node_unary_op(arena_t *arena,
                       ast_node_t *expr)
 {
     ast_node_t *node_unary_op =
-        (ast_node_t *)arena_alloc(arena, sizeof(ast_node_t));
-    assert(node_unary_op);
+        ast_new_node(arena, AST_NODE_UNARY_OP, loc, sizeof(ast_unary_op_t));
 
-    node_unary_op->kind = AST_NODE_UNARY_OP;
-    node_unary_op->loc = loc;
     node_unary_op->as_unary_op.kind = kind;
     node_unary_op->as_unary_op.expr = expr;
 
@@ -155,11 +153,8 @@ ast_node_t *
 ast_new_node_literal_u32(arena_t *arena, token_loc_t loc, uint32_t value)
 {
     ast_node_t *node_literal =
-        (ast_node_t *)arena_alloc(arena, sizeof(ast_node_t));
-    assert(node_literal);
+        ast_new_node(arena, AST_NODE_LITERAL, loc, sizeof(ast_literal_t));
 
-    node_literal->kind = AST_NODE_LITERAL;
-    node_literal->loc = loc;
     node_literal->as_literal.kind = AST_LITERAL_U32;
     node_literal->as_literal.as_u32 = value;
 
@@ -167,14 +162,39 @@ ast_new_node_literal_u32(arena_t *arena, token_loc_t loc, uint32_t value)
 }
 
 ast_node_t *
-ast_new_node_ref(arena_t *arena, token_loc_t loc, string_view_t id)
+ast_new_node_literal_u64(arena_t *arena, token_loc_t loc, uint64_t value)
 {
-    ast_node_t *node_ref = (ast_node_t *)arena_alloc(arena, sizeof(ast_node_t));
-    assert(node_ref);
+    ast_node_t *node_literal =
+        ast_new_node(arena, AST_NODE_LITERAL, loc, sizeof(ast_literal_t));
+
+    node_literal->as_literal.kind = AST_LITERAL_U64;
+    node_literal->as_literal.as_u64 = value;
+
+    return node_literal;
+}
+
+uint64_t
+ast_literal_value(ast_literal_t *literal)
+{
+    switch (literal->kind) {
+        case AST_LITERAL_U32:
+            return literal->as_u32;
+        case AST_LITERAL_U64:
+            return literal->as_u64;
+    }
+
+    assert(0 && "unsupported literal kind");
+    return 0;
+}
+
+ast_node_t *
+ast_new_node_ref(arena_t *arena, token_loc_t loc, atom_t *id)
+{
+    ast_node_t *node_ref =
+        ast_new_node(arena, AST_NODE_REF, loc, sizeof(ast_ref_t));
 
-    node_ref->kind = AST_NODE_REF;
-    node_ref->loc = loc;
     node_ref->as_ref.id = id;
+    node_ref->as_ref.symbol = NULL;
 
     return node_ref;
 }
@@ -182,12 +202,9 @@ ast_new_node_ref(arena_t *arena, token_loc_t loc, string_view_t id)
 ast_node_t *
 ast_new_node_return_stmt(arena_t *arena, token_loc_t loc, ast_node_t *expr)
 {
-    ast_node_t *node_return_stmt =
-        (ast_node_t *)arena_alloc(arena, sizeof(ast_node_t));
-    assert(node_return_stmt);
+    ast_node_t *node_return_stmt = ast_new_node(
+        arena, AST_NODE_RETURN_STMT, loc, sizeof(ast_return_stmt_t));
 
-    node_return_stmt->kind = AST_NODE_RETURN_STMT;
-    node_return_stmt->loc = loc;
     node_return_stmt->as_return_stmt.expr = expr;
 
     return node_return_stmt;
@@ -200,11 +217,9 @@ ast_new_node_if_stmt(arena_t *arena,
                      ast_node_t *then,
                      ast_node_t *_else)
 {
-    ast_node_t *node_if_stmt = arena_alloc(arena, sizeof(ast_node_t));
-    assert(node_if_stmt);
+    ast_node_t *node_if_stmt =
+        ast_new_node(arena, AST_NODE_IF_STMT, loc, sizeof(ast_if_stmt_t));
 
-    node_if_stmt->kind = AST_NODE_IF_STMT;
-    node_if_stmt->loc = loc;
     node_if_stmt->as_if_stmt.cond = cond;
     node_if_stmt->as_if_stmt.then = then;
     node_if_stmt->as_if_stmt._else = _else;
@@ -218,11 +233,9 @@ ast_new_node_while_stmt(arena_t *arena,
                         ast_node_t *cond,
                         ast_node_t *then)
 {
-    ast_node_t *node_while_stmt = arena_alloc(arena, sizeof(ast_node_t));
-    assert(node_while_stmt);
+    ast_node_t *node_while_stmt = ast_new_node(
+        arena, AST_NODE_WHILE_STMT, loc, sizeof(ast_while_stmt_t));
 
-    node_while_stmt->kind = AST_NODE_WHILE_STMT;
-    node_while_stmt->loc = loc;
     node_while_stmt->as_while_stmt.cond = cond;
     node_while_stmt->as_while_stmt.then = then;
 
@@ -230,31 +243,127 @@ ast_new_node_while_stmt(arena_t *arena,
 }
 
 ast_node_t *
-ast_new_node_block(arena_t *arena)
+ast_new_node_block(arena_t *arena,
+                   token_loc_t loc,
+                   ast_node_t **nodes,
+                   uint32_t nodes_size)
 {
-    ast_node_t *node_block =
-        (ast_node_t *)arena_alloc(arena, sizeof(ast_node_t));
-    assert(node_block);
-
-    node_block->kind = AST_NODE_BLOCK;
+    assert(nodes || nodes_size == 0);
 
-    node_block->as_block.nodes = (list_t *)arena_alloc(arena, sizeof(list_t));
-    assert(node_block->as_block.nodes);
+    ast_node_t *node_block =
+        ast_new_node(arena, AST_NODE_BLOCK, loc, sizeof(ast_block_t));
 
-    list_init(node_block->as_block.nodes, arena);
+    node_block->as_block.nodes = nodes;
+    node_block->as_block.nodes_size = nodes_size;
 
     return node_block;
 }
 
 ast_fn_param_t *
-ast_new_fn_param(arena_t *arena, string_view_t id, type_t *type)
+ast_new_fn_param(arena_t *arena, atom_t *id, type_t *type)
 {
-    ast_fn_param_t *fn_param =
-        (ast_fn_param_t *)arena_alloc(arena, sizeof(ast_fn_param_t));
+    ast_fn_param_t *fn_param = (ast_fn_param_t *)arena_alloc_aligned(
+        arena, sizeof(ast_fn_param_t), _Alignof(ast_fn_param_t));
     assert(fn_param);
 
     fn_param->id = id;
     fn_param->type = type;
+    fn_param->symbol = NULL;
 
     return fn_param;
 }
+
+uint32_t
+ast_node_children_size(ast_node_t *node)
+{
+    assert(node);
+
+    switch (node->kind) {
+        case AST_NODE_TRANSLATION_UNIT:
+            return node->as_translation_unit.decls_size;
+        case AST_NODE_BLOCK:
+            return node->as_block.nodes_size;
+        case AST_NODE_FN_DEF:
+            return node->as_fn_def.block != NULL;
+        case AST_NODE_FN_CALL:
+            return node->as_fn_call.args_size;
+        case AST_NODE_VAR_DEF:
+            return node->as_var_def.value != NULL;
+        case AST_NODE_BINARY_OP:
+            return 2;
+        case AST_NODE_UNARY_OP:
+            return 1;
+        case AST_NODE_RETURN_STMT:
+            return node->as_return_stmt.expr != NULL;
+        case AST_NODE_IF_STMT:
+            return node->as_if_stmt._else != NULL ? 3 : 2;
+        case AST_NODE_WHILE_STMT:
+            return 2;
+        case AST_NODE_LITERAL:
+        case AST_NODE_REF:
+        case AST_NODE_UNKNOWN:
+            return 0;
+    }
+    assert(0 && "unknown node kind");
+    return 0;
+}
+
+ast_node_t *
+ast_node_child(ast_node_t *node, uint32_t index)
+{
+    assert(node);
+
+    switch (node->kind) {
+        case AST_NODE_TRANSLATION_UNIT:
+            return node->as_translation_unit.decls[index];
+        case AST_NODE_BLOCK:
+            return node->as_block.nodes[index];
+        case AST_NODE_FN_DEF:
+            return node->as_fn_def.block;
+        case AST_NODE_FN_CALL:
+            return node->as_fn_call.args[index];
+        case AST_NODE_VAR_DEF:
+            return node->as_var_def.value;
+        case AST_NODE_BINARY_OP:
+            return index == 0 ? node->as_bin_op.lhs : node->as_bin_op.rhs;
+        case AST_NODE_UNARY_OP:
+            return node->as_unary_op.expr;
+        case AST_NODE_RETURN_STMT:
+            return node->as_return_stmt.expr;
+        case AST_NODE_IF_STMT: {
+            ast_if_stmt_t *if_stmt = &node->as_if_stmt;
+            if (index == 0) {
+                return if_stmt->cond;
+            }
+            return index == 1 ? if_stmt->then : if_stmt->_else;
+        }
+        case AST_NODE_WHILE_STMT:
+            return index == 0 ? node->as_while_stmt.cond
+                              : node->as_while_stmt.then;
+        case AST_NODE_LITERAL:
+        case AST_NODE_REF:
+        case AST_NODE_UNKNOWN:
+            break;
+    }
+    assert(0 && "node has no children");
+    return NULL;
+}
+
+static ast_node_t *
+ast_new_node(arena_t *arena,
+             ast_node_kind_t kind,
+             token_loc_t loc,
+             size_t size)
+{
+    assert(arena);
+
+    ast_node_t *node = (ast_node_t *)arena_alloc_aligned(
+        arena, size, _Alignof(ast_node_t));
+    assert(node);
+
+    node->kind = kind;
+    node->loc = loc;
+    node->type = NULL;
+
+    return node;
+}
@@ -20,8 +20,8 @@
 #include <stdint.h>
 
 #include "arena.h"
+#include "interner.h"
 #include "lexer.h"
-#include "list.h"
 #include "scope.h"
 #include "string_view.h"
 #include "type.h"
@@ -49,57 +49,77 @@ typedef struct ast_node_meta
 {
     ast_node_kind_t kind;
     token_loc_t loc;
+    // Resolved type of an expression node, set by the checker. Statements
+    // and declarations keep it NULL.
+    type_t *type;
 } ast_node_meta_t;
 
+// Nodes are allocated with the size of their own kind's struct rather than
+// sizeof(ast_node_t), so a node must only be accessed through the union
+// member matching its kind and never copied as a whole ast_node_t.
+//
+// Children lists are exact-size contiguous arrays, the counts are placed
+// right after the meta where they fill what would otherwise be padding.
+
 typedef struct ast_block
 {
     ast_node_meta_t meta;
-    list_t *nodes;
+    uint32_t nodes_size;
+    ast_node_t **nodes;
 } ast_block_t;
 
 typedef struct ast_translation_unit
 {
     ast_node_meta_t meta;
-    list_t *decls;
+    uint32_t decls_size;
+    ast_node_t **decls;
 } ast_translation_unit_t;
 
 typedef struct ast_fn_param
 {
-    string_view_t id;
+    atom_t *id;
     type_t *type;
+    symbol_t *symbol;
 } ast_fn_param_t;
 
 typedef struct ast_fn_definition
 {
     ast_node_meta_t meta;
-    string_view_t id;
-    list_t *params;
+    uint32_t params_size;
+    atom_t *id;
+    ast_fn_param_t **params;
     type_t *return_type;
-    bool _extern;
     ast_node_t *block;
-    scope_t *scope;
+    // Frame layout assigned by the checker: the offset below the frame base
+    // of every parameter and local, indexed by their symbol's slot.
+    uint32_t *slot_offsets;
+    uint32_t slots_size;
+    uint32_t frame_size;
+    bool _extern;
 } ast_fn_definition_t;
 
 typedef struct ast_fn_call
 {
     ast_node_meta_t meta;
-    string_view_t id;
-    list_t *args;
-    scope_t *scope;
+    uint32_t args_size;
+    atom_t *id;
+    ast_node_t **args;
+    symbol_t *symbol;
 } ast_fn_call_t;
 
 typedef struct ast_var_definition
 {
     ast_node_meta_t meta;
-    string_view_t id;
+    atom_t *id;
     type_t *type;
     ast_node_t *value;
-    scope_t *scope;
+    symbol_t *symbol;
 } ast_var_definition_t;
 
 typedef enum
 {
-    AST_LITERAL_U32
+    AST_LITERAL_U32,
+    AST_LITERAL_U64
 } ast_literal_kind_t;
 
 typedef struct ast_literal
@@ -109,14 +129,15 @@ typedef struct ast_literal
     union
     {
         uint32_t as_u32;
+        uint64_t as_u64;
     };
 } ast_literal_t;
 
 typedef struct ast_ref
 {
     ast_node_meta_t meta;
-    string_view_t id;
-    scope_t *scope;
+    atom_t *id;
+    symbol_t *symbol;
 } ast_ref_t;
 
 typedef enum ast_binary_op_kind
@@ -202,6 +223,7 @@ typedef union ast_node
     {
         ast_node_kind_t kind;
         token_loc_t loc;
+        type_t *type;
     };
     ast_translation_unit_t as_translation_unit;
     ast_fn_definition_t as_fn_def;
@@ -219,13 +241,16 @@ typedef union ast_node
 } ast_node_t;
 
 ast_node_t *
-ast_new_translation_unit(arena_t *arena);
+ast_new_translation_unit(arena_t *arena,
+                         ast_node_t **decls,
+                         uint32_t decls_size);
 
 ast_node_t *
 ast_new_node_fn_def(arena_t *arena,
                     token_loc_t loc,
-                    string_view_t id,
-                    list_t *params,
+                    atom_t *id,
+                    ast_fn_param_t **params,
+                    uint32_t params_size,
                     type_t *return_type,
                     bool _extern,
                     ast_node_t *block);
@@ -233,13 +258,14 @@ ast_new_node_fn_def(arena_t *arena,
 ast_node_t *
 ast_new_node_fn_call(arena_t *arena,
                      token_loc_t loc,
-                     string_view_t id,
-                     list_t *args);
+                     atom_t *id,
+                     ast_node_t **args,
+                     uint32_t args_size);
 
 ast_node_t *
 ast_new_node_var_def(arena_t *arena,
                      token_loc_t loc,
-                     string_view_t id,
+                     atom_t *id,
                      type_t *type,
                      ast_node_t *value);
 
@@ -260,7 +286,13 @@ ast_node_t *
 ast_new_node_literal_u32(arena_t *arena, token_loc_t loc, uint32_t value);
 
 ast_node_t *
-ast_new_node_ref(arena_t *arena, token_loc_t loc, string_view_t id);
+ast_new_node_literal_u64(arena_t *arena, token_loc_t loc, uint64_t value);
+
+uint64_t
+ast_literal_value(ast_literal_t *literal);
+
+ast_node_t *
+ast_new_node_ref(arena_t *arena, token_loc_t loc, atom_t *id);
 
 ast_node_t *
 ast_new_node_var_assign_stmt(arena_t *arena,
@@ -285,9 +317,26 @@ ast_new_node_while_stmt(arena_t *arena,
                         ast_node_t *then);
 
 ast_node_t *
-ast_new_node_block(arena_t *arena);
+ast_new_node_block(arena_t *arena,
+                   token_loc_t loc,
+                   ast_node_t **nodes,
+                   uint32_t nodes_size);
 
 ast_fn_param_t *
-ast_new_fn_param(arena_t *arena, string_view_t id, type_t *type);
+ast_new_fn_param(arena_t *arena, atom_t *id, type_t *type);
+
+/**
+ * Number of child nodes of node.  Absent optional children (the else of an if,
+ * the initializer of a var, the body of an extern fn) are not counted, so the
+ * children are always indexed densely and are never NULL.
+ */
+uint32_t
+ast_node_children_size(ast_node_t *node);
+
+/**
+ * The index-th child of node, in source order.
+ */
+ast_node_t *
+ast_node_child(ast_node_t *node, uint32_t index);
 
 #endif /* AST_H */
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast_visitor.h"
+
+#define AST_VISITOR_INITIAL_FRAMES 64
+
+static void
+ast_visitor_enter(ast_visitor_t *visitor, ast_node_t *node);
+
+static void
+ast_visitor_leave(ast_visitor_t *visitor);
+
+void
+ast_visitor_init(ast_visitor_t *visitor)
+{
+    assert(visitor);
+
+    visitor->pre = NULL;
+    visitor->enter_child = NULL;
+    visitor->leave_child = NULL;
+    visitor->post = NULL;
+    visitor->frames = NULL;
+    visitor->frames_size = 0;
+    visitor->frames_capacity = 0;
+}
+
+void
+ast_visitor_walk(ast_visitor_t *visitor, ast_node_t *root)
+{
+    assert(visitor);
+    assert(root);
+    assert(visitor->frames_size == 0 && "walks cannot be nested");
+
+    ast_visitor_enter(visitor, root);
+
+    while (visitor->frames_size > 0) {
+        ast_visit_frame_t *frame = &visitor->frames[visitor->frames_size - 1];
+
+        if (frame->child == frame->children_size) {
+            if (visitor->post != NULL) {
+                visitor->post(visitor, frame);
+            }
+            ast_visitor_leave(visitor);
+            continue;
+        }
+
+        if (visitor->enter_child != NULL &&
+            !visitor->enter_child(visitor, frame)) {
+            frame->child++;
+            continue;
+        }
+
+        ast_visitor_enter(visitor, ast_node_child(frame->node, frame->child));
+    }
+
+    free(visitor->frames);
+    visitor->frames = NULL;
+    visitor->frames_capacity = 0;
+}
+
+ast_visit_frame_t *
+ast_visitor_parent(ast_visitor_t *visitor)
+{
+    assert(visitor);
+
+    if (visitor->frames_size < 2) {
+        return NULL;
+    }
+    return &visitor->frames[visitor->frames_size - 2];
+}
+
+static void
+ast_visitor_enter(ast_visitor_t *visitor, ast_node_t *node)
+{
+    if (visitor->frames_size == visitor->frames_capacity) {
+        size_t capacity = visitor->frames_capacity == 0
+                              ? AST_VISITOR_INITIAL_FRAMES
+                              : visitor->frames_capacity * 2;
+
+        ast_visit_frame_t *frames = (ast_visit_frame_t *)realloc(
+            visitor->frames, capacity * sizeof(ast_visit_frame_t));
+        if (frames == NULL) {
+            fprintf(stderr,
+                    "[FATAL] Out of memory: ast_visitor_enter: %s\n",
+                    strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+
+        visitor->frames = frames;
+        visitor->frames_capacity = capacity;
+    }
+
+    ast_visit_frame_t *frame = &visitor->frames[visitor->frames_size++];
+    frame->node = node;
+    frame->child = 0;
+    frame->children_size = ast_node_children_size(node);
+    frame->data = 0;
+
+    if (visitor->pre != NULL && !visitor->pre(visitor, frame)) {
+        ast_visitor_leave(visitor);
+        return;
+    }
+
+    // Leaves are done with right away, sparing a trip through the walk loop.
+    if (frame->children_size == 0) {
+        if (visitor->post != NULL) {
+            visitor->post(visitor, frame);
+        }
+        ast_visitor_leave(visitor);
+    }
+}
+
+/**
+ * Pops the frame on top of the stack and moves its parent on to the next
+ * child.
+ */
+static void
+ast_visitor_leave(ast_visitor_t *visitor)
+{
+    if (--visitor->frames_size == 0) {
+        return;
+    }
+
+    ast_visit_frame_t *parent = &visitor->frames[visitor->frames_size - 1];
+    if (visitor->leave_child != NULL) {
+        visitor->leave_child(visitor, parent);
+    }
+    parent->child++;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef AST_VISITOR_H
+#define AST_VISITOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ast.h"
+
+typedef struct ast_visitor ast_visitor_t;
+
+/**
+ * A node on the path from the root to the node being visited.
+ */
+typedef struct ast_visit_frame
+{
+    ast_node_t *node;
+    // Index of the child being visited, once the children are reached.
+    uint32_t child;
+    uint32_t children_size;
+    // Free for the pass to carry state from pre to post, starts zeroed.
+    uintptr_t data;
+} ast_visit_frame_t;
+
+/**
+ * Depth-first walk over an AST driven by an explicit stack of frames, so
+ * arbitrarily deep trees never grow the C stack.  A pass embeds the visitor
+ * as the first member of its own state and fills in the callbacks it needs,
+ * any of them may be NULL:
+ *
+ *   pre          before the children of a node; returning false skips the
+ *                children and post.
+ *   enter_child  before frame->child is visited; returning false skips it,
+ *                leave_child included.
+ *   leave_child  after frame->child was visited.
+ *   post         after all the children of a node.
+ *
+ * Frames point into the stack, which moves as it grows: they are only valid
+ * until the callback they were given to returns.  The stack is grown in place
+ * on the heap and freed once the walk is over, so passes need not keep dead
+ * copies of it around in their arenas.
+ */
+typedef struct ast_visitor
+{
+    bool (*pre)(ast_visitor_t *visitor, ast_visit_frame_t *frame);
+    bool (*enter_child)(ast_visitor_t *visitor, ast_visit_frame_t *frame);
+    void (*leave_child)(ast_visitor_t *visitor, ast_visit_frame_t *frame);
+    void (*post)(ast_visitor_t *visitor, ast_visit_frame_t *frame);
+
+    ast_visit_frame_t *frames;
+    size_t frames_size;
+    size_t frames_capacity;
+} ast_visitor_t;
+
+void
+ast_visitor_init(ast_visitor_t *visitor);
+
+void
+ast_visitor_walk(ast_visitor_t *visitor, ast_node_t *root);
+
+/**
+ * Frame of the parent of the node being visited, NULL for the root.
+ */
+ast_visit_frame_t *
+ast_visitor_parent(ast_visitor_t *visitor);
+
+#endif /* AST_VISITOR_H */
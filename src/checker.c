@@ -18,10 +18,51 @@
 #include "scope.h"
 #include <assert.h>
 #include <errno.h>
+#include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
+
+#define CHECKER_SCRATCH_ARENA_CAPACITY (16 * 1024)
+#define CHECKER_FRAME_INITIAL_SLOTS 16
+
+/**
+ * What a block restores on its way out, carried from pre to post.
+ */
+typedef struct checker_block
+{
+    // Offset of the innermost enclosing local, sibling blocks reuse the
+    // frame space below it.
+    uint32_t frame_offset;
+    // Whether the block pushed a scope of its own.
+    bool scoped;
+} checker_block_t;
+
+static bool
+checker_pre(ast_visitor_t *visitor, ast_visit_frame_t *frame);
+
+static void
+checker_post(ast_visitor_t *visitor, ast_visit_frame_t *frame);
+
+static void
+check_expr(checker_t *checker, ast_node_t *expr);
+
+static void
+check_literal_context(checker_t *checker, ast_node_t *expr, type_t *expected);
+
+static symbol_t *
+checker_resolve(scope_t *scope, atom_t *id, token_loc_t loc);
+
+static void
+checker_frame_begin(checker_t *checker);
+
+static void
+checker_frame_alloc(checker_t *checker, symbol_t *symbol);
 
 static void
-populate_scope(checker_t *checker, scope_t *scope, ast_node_t *ast);
+checker_frame_end(checker_t *checker, ast_fn_definition_t *fn_def);
+
+static void
+checker_error(token_loc_t loc, const char *fmt, ...);
 
 checker_t *
 checker_new(arena_t *arena)
@@ -36,58 +77,22 @@ checker_new(arena_t *arena)
         exit(EXIT_FAILURE);
     }
     checker->arena = arena;
-    return checker;
-}
+    type_table_init(&checker->types, arena);
 
-static type_t
-type_from_id(string_view_t id)
-{
-    type_t type = { 0 };
-    type.id = id;
-    if (string_view_eq_to_cstr(id, "u8")) {
-        type.kind = TYPE_PRIMITIVE;
-        type.as_primitive.size = 1;
-        type.as_primitive.kind = TYPE_U8;
-        return type;
-    }
-    if (string_view_eq_to_cstr(id, "u16")) {
-        type.kind = TYPE_PRIMITIVE;
-        type.as_primitive.size = 2;
-        type.as_primitive.kind = TYPE_U16;
-        return type;
-    }
-    if (string_view_eq_to_cstr(id, "u32")) {
-        type.kind = TYPE_PRIMITIVE;
-        type.as_primitive.size = 4;
-        type.as_primitive.kind = TYPE_U32;
-        return type;
-    }
-    if (string_view_eq_to_cstr(id, "u64")) {
-        type.kind = TYPE_PRIMITIVE;
-        type.as_primitive.size = 8;
-        type.as_primitive.kind = TYPE_U64;
-        return type;
-    }
-
-    // FIXME: handle user defined types
-    assert(0 && "unknown type");
+    return checker;
 }
 
 /**
  * transform unknown types into actual types
  */
-static void
-type_resolve(type_t *type)
+static type_t *
+type_resolve(checker_t *checker, type_t *type)
 {
-    switch (type->kind) {
-        case TYPE_UNKNOWN:
-            *type = type_from_id(type->as_unknown.id);
-            break;
-        case TYPE_PTR:
-            type_resolve(type->as_ptr.type);
-        case TYPE_PRIMITIVE:
-            break;
-    }
+    type_t *resolved = type_table_resolve(&checker->types, type);
+
+    // FIXME: handle user defined types
+    assert(resolved && "unknown type");
+    return resolved;
 }
 
 void
@@ -95,147 +100,510 @@ checker_check(checker_t *checker, ast_node_t *ast)
 {
     assert(checker);
     assert(ast);
-
-    scope_t *scope = scope_new(checker->arena);
-    populate_scope(checker, scope, ast);
-
-    // TODO: traverse the ast tree to verify semantics
+    assert(ast->kind == AST_NODE_TRANSLATION_UNIT);
+
+    // Scopes are only needed while checking, the symbols they hold are the
+    // only part of them the AST keeps.
+    checker->scratch = arena_new(CHECKER_SCRATCH_ARENA_CAPACITY);
+    checker->scope = scope_new(&checker->scratch);
+    checker->fn_def = NULL;
+
+    // Scopes are populated on the way down and expressions are typed on the
+    // way up, once their operands are.
+    ast_visitor_init(&checker->visitor);
+    checker->visitor.pre = checker_pre;
+    checker->visitor.post = checker_post;
+    ast_visitor_walk(&checker->visitor, ast);
+
+    arena_free(&checker->scratch);
 }
 
-static void
-populate_scope(checker_t *checker, scope_t *scope, ast_node_t *ast)
+static bool
+checker_pre(ast_visitor_t *visitor, ast_visit_frame_t *frame)
 {
-    assert(checker);
-    assert(scope);
+    checker_t *checker = (checker_t *)visitor;
+    ast_node_t *ast = frame->node;
 
     switch (ast->kind) {
         case AST_NODE_TRANSLATION_UNIT: {
-            list_item_t *item = list_head(ast->as_translation_unit.decls);
-
-            while (item != NULL) {
-                populate_scope(checker, scope, (ast_node_t *)item->value);
-                item = list_next(item);
+            ast_translation_unit_t *translation_unit =
+                &ast->as_translation_unit;
+
+            // Functions are declared up front so calls resolve regardless of
+            // the order the definitions appear in.
+            for (size_t i = 0; i < translation_unit->decls_size; ++i) {
+                ast_node_t *decl = translation_unit->decls[i];
+                if (decl->kind != AST_NODE_FN_DEF) {
+                    continue;
+                }
+
+                ast_fn_definition_t *fn_def = &decl->as_fn_def;
+
+                fn_def->return_type =
+                    type_resolve(checker, fn_def->return_type);
+                symbol_t *symbol = symbol_new(
+                    checker->arena, fn_def->id, fn_def->return_type);
+                scope_insert(checker->scope, symbol);
             }
-            return;
+            return true;
         }
 
         case AST_NODE_FN_DEF: {
             ast_fn_definition_t *fn_def = &ast->as_fn_def;
-            fn_def->scope = scope_push(scope);
+            checker->fn_def = fn_def;
 
-            type_resolve(fn_def->return_type);
-            symbol_t *symbol =
-                symbol_new(checker->arena, fn_def->id, fn_def->return_type);
-            scope_insert(scope, symbol);
+            // The scopes of a function are rewound along with its frame.
+            checker->fn_temp = arena_temp_begin(&checker->scratch);
+            checker->scope = scope_push_in(checker->scope, &checker->scratch);
+            checker_frame_begin(checker);
 
-            list_item_t *item = list_head(fn_def->params);
+            for (size_t i = 0; i < fn_def->params_size; ++i) {
+                ast_fn_param_t *param = fn_def->params[i];
 
-            while (item != NULL) {
-                ast_fn_param_t *param = (ast_fn_param_t *)item->value;
-
-                type_resolve(param->type);
-                symbol_t *symbol =
+                param->type = type_resolve(checker, param->type);
+                param->symbol =
                     symbol_new(checker->arena, param->id, param->type);
-                scope_insert(fn_def->scope, symbol);
-
-                item = list_next(item);
+                scope_insert(checker->scope, param->symbol);
+                checker_frame_alloc(checker, param->symbol);
             }
-
-            if (ast->as_fn_def.block != NULL) {
-                populate_scope(checker, fn_def->scope, ast->as_fn_def.block);
-            }
-            return;
+            return true;
         }
 
         case AST_NODE_FN_CALL: {
-            ast->as_fn_call.scope = scope;
+            ast_fn_call_t *fn_call = &ast->as_fn_call;
+            fn_call->symbol =
+                checker_resolve(checker->scope, fn_call->id, ast->loc);
+            return true;
+        }
 
-            list_item_t *item = list_head(ast->as_fn_call.args);
+        case AST_NODE_REF: {
+            ast_ref_t *ref = &ast->as_ref;
+            ref->symbol = checker_resolve(checker->scope, ref->id, ast->loc);
+            return true;
+        }
 
-            while (item != NULL) {
-                populate_scope(checker, scope, (ast_node_t *)item->value);
-                item = list_next(item);
+        case AST_NODE_BLOCK: {
+            ast_block_t *block = &ast->as_block;
+
+            // Only blocks declaring variables get a scope of their own, the
+            // others resolve straight into the enclosing one.
+            bool scoped = false;
+            for (size_t i = 0; i < block->nodes_size; ++i) {
+                if (block->nodes[i]->kind == AST_NODE_VAR_DEF) {
+                    checker->scope = scope_push(checker->scope);
+                    scoped = true;
+                    break;
+                }
             }
 
-            return;
+            // Locals of sibling blocks are never alive at the same time, so
+            // they share the frame space below the enclosing locals.
+            checker_block_t *saved = (checker_block_t *)arena_alloc(
+                &checker->scratch, sizeof(checker_block_t));
+            if (saved == NULL) {
+                fprintf(stderr,
+                        "[FATAL] Out of memory: checker_pre: %s\n",
+                        strerror(errno));
+                exit(EXIT_FAILURE);
+            }
+            saved->frame_offset = checker->frame_offset;
+            saved->scoped = scoped;
+
+            frame->data = (uintptr_t)saved;
+            return true;
         }
 
-        case AST_NODE_IF_STMT: {
-            populate_scope(checker, scope, ast->as_if_stmt.cond);
-            populate_scope(checker, scope, ast->as_if_stmt.then);
+        case AST_NODE_BINARY_OP: {
+            ast_binary_op_t *bin_op = &ast->as_bin_op;
+            if (bin_op->kind != AST_BINOP_ASSIGN) {
+                return true;
+            }
+
+            ast_node_t *lhs = bin_op->lhs;
+            bool assignable = lhs->kind == AST_NODE_REF ||
+                              (lhs->kind == AST_NODE_UNARY_OP &&
+                               lhs->as_unary_op.kind == AST_UNARY_DEREFERENCE);
 
-            if (ast->as_if_stmt._else) {
-                populate_scope(checker, scope, ast->as_if_stmt._else);
+            if (!assignable) {
+                checker_error(lhs->loc, "expression is not assignable");
             }
+            return true;
+        }
 
-            return;
+        case AST_NODE_UNARY_OP: {
+            ast_unary_op_t *unary_op = &ast->as_unary_op;
+
+            if (unary_op->kind == AST_UNARY_ADDRESSOF &&
+                unary_op->expr->kind != AST_NODE_REF) {
+                checker_error(unary_op->expr->loc,
+                              "cannot take the address of expression");
+            }
+            return true;
         }
 
-        case AST_NODE_WHILE_STMT: {
-            populate_scope(checker, scope, ast->as_while_stmt.cond);
-            populate_scope(checker, scope, ast->as_while_stmt.then);
+        default:
+            return true;
+    }
+}
 
+static void
+checker_post(ast_visitor_t *visitor, ast_visit_frame_t *frame)
+{
+    checker_t *checker = (checker_t *)visitor;
+    ast_node_t *ast = frame->node;
+
+    switch (ast->kind) {
+        case AST_NODE_FN_DEF: {
+            checker_frame_end(checker, checker->fn_def);
+            checker->scope = scope_pop(checker->scope);
+            arena_temp_end(checker->fn_temp);
+
+            checker->fn_def = NULL;
             return;
         }
 
-        case AST_NODE_BINARY_OP: {
-            ast_binary_op_t bin_op = ast->as_bin_op;
+        case AST_NODE_BLOCK: {
+            checker_block_t *saved = (checker_block_t *)frame->data;
+            checker->frame_offset = saved->frame_offset;
 
-            populate_scope(checker, scope, bin_op.lhs);
-            populate_scope(checker, scope, bin_op.rhs);
+            if (saved->scoped) {
+                checker->scope = scope_pop(checker->scope);
+            }
             return;
         }
 
-        case AST_NODE_UNARY_OP: {
-            ast_unary_op_t unary_op = ast->as_unary_op;
+        case AST_NODE_VAR_DEF: {
+            ast_var_definition_t *var_def = &ast->as_var_def;
+
+            var_def->type = type_resolve(checker, var_def->type);
+            if (var_def->value != NULL) {
+                check_literal_context(checker, var_def->value, var_def->type);
+            }
 
-            populate_scope(checker, scope, unary_op.expr);
+            // The initializer is resolved before the variable is declared, so
+            // `var x: u32 = x` refers to an outer x, never to itself.
+            var_def->symbol =
+                symbol_new(checker->arena, var_def->id, var_def->type);
+            scope_insert(checker->scope, var_def->symbol);
+            checker_frame_alloc(checker, var_def->symbol);
             return;
         }
 
         case AST_NODE_RETURN_STMT: {
-            ast_return_stmt_t return_stmt = ast->as_return_stmt;
+            ast_return_stmt_t *return_stmt = &ast->as_return_stmt;
 
-            populate_scope(checker, scope, return_stmt.expr);
+            if (return_stmt->expr != NULL) {
+                check_literal_context(checker,
+                                      return_stmt->expr,
+                                      checker->fn_def->return_type);
+            }
             return;
         }
 
-        case AST_NODE_BLOCK: {
-            ast_block_t block = ast->as_block;
-            scope = scope_push(scope);
+        case AST_NODE_TRANSLATION_UNIT:
+        case AST_NODE_IF_STMT:
+        case AST_NODE_WHILE_STMT:
+        case AST_NODE_UNKNOWN:
+            return;
 
-            list_item_t *item = list_head(block.nodes);
+        default:
+            check_expr(checker, ast);
+            return;
+    }
+}
 
-            while (item != NULL) {
-                populate_scope(checker, scope, (ast_node_t *)item->value);
-                item = list_next(item);
-            }
+static void
+checker_frame_begin(checker_t *checker)
+{
+    checker->frame_slots_size = 0;
+    checker->frame_slots_capacity = CHECKER_FRAME_INITIAL_SLOTS;
+    checker->frame_offsets = (uint32_t *)arena_alloc(
+        &checker->scratch, checker->frame_slots_capacity * sizeof(uint32_t));
+    if (checker->frame_offsets == NULL) {
+        fprintf(stderr,
+                "[FATAL] Out of memory: checker_frame_begin: %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    checker->frame_offset = 0;
+    checker->frame_size = 0;
+}
 
-            return;
+/**
+ * Gives the symbol the next slot of the current function and places it right
+ * below the innermost local, aligned to its type.
+ */
+static void
+checker_frame_alloc(checker_t *checker, symbol_t *symbol)
+{
+    if (checker->frame_slots_size == checker->frame_slots_capacity) {
+        uint32_t capacity = checker->frame_slots_capacity * 2;
+        uint32_t *offsets = (uint32_t *)arena_alloc(
+            &checker->scratch, capacity * sizeof(uint32_t));
+        if (offsets == NULL) {
+            fprintf(stderr,
+                    "[FATAL] Out of memory: checker_frame_alloc: %s\n",
+                    strerror(errno));
+            exit(EXIT_FAILURE);
         }
+        memcpy(offsets,
+               checker->frame_offsets,
+               checker->frame_slots_size * sizeof(uint32_t));
 
-        case AST_NODE_VAR_DEF: {
-            string_view_t id = ast->as_var_def.id;
+        checker->frame_offsets = offsets;
+        checker->frame_slots_capacity = capacity;
+    }
 
-            type_resolve(ast->as_var_def.type);
+    type_t *type = symbol->type;
+    uint32_t offset = checker->frame_offset + type->size;
+    offset = (offset + type->alignment - 1) / type->alignment * type->alignment;
 
-            symbol_t *symbol =
-                symbol_new(checker->arena, id, ast->as_var_def.type);
+    symbol->slot = checker->frame_slots_size++;
+    checker->frame_offsets[symbol->slot] = offset;
+    checker->frame_offset = offset;
 
-            scope_insert(scope, symbol);
-            ast->as_var_def.scope = scope;
+    if (offset > checker->frame_size) {
+        checker->frame_size = offset;
+    }
+}
 
-            populate_scope(checker, scope, ast->as_var_def.value);
-            return;
+static void
+checker_frame_end(checker_t *checker, ast_fn_definition_t *fn_def)
+{
+    size_t size = checker->frame_slots_size * sizeof(uint32_t);
+    fn_def->slot_offsets = (uint32_t *)arena_alloc(checker->arena, size);
+    if (fn_def->slot_offsets == NULL) {
+        fprintf(stderr,
+                "[FATAL] Out of memory: checker_frame_end: %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    memcpy(fn_def->slot_offsets, checker->frame_offsets, size);
+
+    fn_def->slots_size = checker->frame_slots_size;
+    // Keeps the stack pointer 16 bytes aligned.
+    fn_def->frame_size = (checker->frame_size + 15) & ~UINT32_C(15);
+}
+
+static symbol_t *
+checker_resolve(scope_t *scope, atom_t *id, token_loc_t loc)
+{
+    symbol_t *symbol = scope_lookup(scope, id);
+    if (symbol == NULL) {
+        checker_error(loc, "'" SV_FMT "' undeclared", SV_ARG(id->str));
+    }
+    return symbol;
+}
+
+/**
+ * Widens u8 and u16 to u32, the narrowest width arithmetic is carried out in.
+ * Besides sparing backends 8 and 16 bit partial register writes, it keeps
+ * every value zero-extended to its full register.
+ */
+static type_t *
+type_promote(checker_t *checker, type_t *type)
+{
+    if (type->kind == TYPE_PRIMITIVE && type->size < 4) {
+        return checker->types.primitives[TYPE_U32];
+    }
+    return type;
+}
+
+/**
+ * Type both operands of a binary operation are implicitly widened to.
+ */
+static type_t *
+type_common(checker_t *checker, type_t *lhs, type_t *rhs)
+{
+    lhs = type_promote(checker, lhs);
+    rhs = type_promote(checker, rhs);
+
+    return rhs->size > lhs->size ? rhs : lhs;
+}
+
+/**
+ * Types expr from the types of its operands, which are typed first.  Integer
+ * literals start out as u32 and are narrowed by check_literal_context once
+ * the type their context converts them to is known.
+ */
+static void
+check_expr(checker_t *checker, ast_node_t *expr)
+{
+    type_t *type = NULL;
+
+    switch (expr->kind) {
+        case AST_NODE_LITERAL: {
+            type = expr->as_literal.kind == AST_LITERAL_U64
+                       ? checker->types.primitives[TYPE_U64]
+                       : checker->types.primitives[TYPE_U32];
+            break;
         }
 
         case AST_NODE_REF: {
-            ast->as_ref.scope = scope;
-            return;
+            type = expr->as_ref.symbol->type;
+            break;
         }
 
-        case AST_NODE_LITERAL:
-        case AST_NODE_UNKNOWN:
-            return;
+        case AST_NODE_FN_CALL: {
+            type = expr->as_fn_call.symbol->type;
+            break;
+        }
+
+        case AST_NODE_BINARY_OP: {
+            ast_binary_op_t *bin_op = &expr->as_bin_op;
+            ast_node_t *lhs = bin_op->lhs;
+            ast_node_t *rhs = bin_op->rhs;
+
+            switch (bin_op->kind) {
+                case AST_BINOP_ASSIGN: {
+                    type = lhs->type;
+                    check_literal_context(checker, rhs, type);
+                    break;
+                }
+
+                case AST_BINOP_LOGICAL_AND:
+                case AST_BINOP_LOGICAL_OR: {
+                    type = checker->types.primitives[TYPE_U32];
+                    break;
+                }
+
+                case AST_BINOP_BITWISE_LSHIFT:
+                case AST_BINOP_BITWISE_RSHIFT: {
+                    type = type_promote(checker, lhs->type);
+                    break;
+                }
+
+                default: {
+                    // A literal operand takes the type of the other operand.
+                    if (lhs->kind == AST_NODE_LITERAL &&
+                        rhs->kind != AST_NODE_LITERAL) {
+                        check_literal_context(checker, lhs, rhs->type);
+                    } else {
+                        check_literal_context(checker, rhs, lhs->type);
+                    }
+
+                    type = type_common(checker, lhs->type, rhs->type);
+                    break;
+                }
+            }
+            break;
+        }
+
+        case AST_NODE_UNARY_OP: {
+            ast_unary_op_t *unary_op = &expr->as_unary_op;
+            type_t *operand_type = unary_op->expr->type;
+
+            switch (unary_op->kind) {
+                case AST_UNARY_BITWISE_NOT:
+                case AST_UNARY_NEGATIVE:
+                case AST_UNARY_POSITIVE: {
+                    if (operand_type->kind != TYPE_PRIMITIVE) {
+                        checker_error(unary_op->expr->loc,
+                                      "invalid operand of non-integer type '"
+                                      SV_FMT "'",
+                                      SV_ARG(operand_type->id));
+                    }
+
+                    type = type_promote(checker, operand_type);
+                    break;
+                }
+
+                case AST_UNARY_LOGICAL_NOT: {
+                    // Like the logical binary operations, yields 0 or 1.
+                    type = checker->types.primitives[TYPE_U32];
+                    break;
+                }
+
+                case AST_UNARY_ADDRESSOF: {
+                    // Only refs get this far, see checker_pre.
+                    unary_op->expr->as_ref.symbol->address_taken = true;
+                    type = type_table_ptr(&checker->types, operand_type);
+                    break;
+                }
+
+                case AST_UNARY_DEREFERENCE: {
+                    if (operand_type->kind != TYPE_PTR) {
+                        checker_error(
+                            unary_op->expr->loc,
+                            "cannot dereference non-pointer type '" SV_FMT "'",
+                            SV_ARG(operand_type->id));
+                    }
+
+                    type = operand_type->as_ptr.type;
+                    break;
+                }
+
+                default: {
+                    assert(0 && "unsupported unary operation");
+                }
+            }
+            break;
+        }
+
+        default: {
+            assert(0 && "unsupported expression");
+        }
     }
+
+    assert(type);
+    expr->type = type;
+}
+
+/**
+ * Gives the integer literal at expr, also when under bitwise nots, negations
+ * or unary pluses, the type its context converts it to when the value fits
+ * in it.
+ */
+static void
+check_literal_context(checker_t *checker, ast_node_t *expr, type_t *expected)
+{
+    if (expected == NULL || expected->kind != TYPE_PRIMITIVE) {
+        return;
+    }
+
+    ast_node_t *literal = expr;
+    while (literal->kind == AST_NODE_UNARY_OP &&
+           (literal->as_unary_op.kind == AST_UNARY_BITWISE_NOT ||
+            literal->as_unary_op.kind == AST_UNARY_NEGATIVE ||
+            literal->as_unary_op.kind == AST_UNARY_POSITIVE)) {
+        literal = literal->as_unary_op.expr;
+    }
+
+    if (literal->kind != AST_NODE_LITERAL) {
+        return;
+    }
+
+    size_t bits = expected->size * 8;
+    uint64_t value = ast_literal_value(&literal->as_literal);
+    if (bits < 64 && value >= (UINT64_C(1) << bits)) {
+        return;
+    }
+
+    literal->type = expected;
+
+    type_t *promoted = type_promote(checker, expected);
+    for (ast_node_t *it = expr; it != literal; it = it->as_unary_op.expr) {
+        it->type = promoted;
+    }
+}
+
+static void
+checker_error(token_loc_t loc, const char *fmt, ...)
+{
+    fprintf(stderr,
+            "%s:%lu:%lu: error: ",
+            token_loc_to_filepath(loc),
+            token_loc_to_lineno(loc),
+            token_loc_to_colno(loc));
+
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+
+    fprintf(stderr, "\n");
+    fprintf(stderr, SV_FMT "\n", SV_ARG(token_loc_to_line(loc)));
+    fprintf(stderr, "%*s\n", (int)token_loc_to_colno(loc), "^");
+
+    exit(EXIT_FAILURE);
 }
@@ -19,10 +19,27 @@
 
 #include "arena.h"
 #include "ast.h"
+#include "ast_visitor.h"
 
 typedef struct checker
 {
+    // The whole translation unit is checked in a single walk.
+    ast_visitor_t visitor;
     arena_t *arena;
+    // Scopes, and per-function data rewound once the function is laid out.
+    arena_t scratch;
+    type_table_t types;
+    // Innermost scope and function of the node being visited.
+    scope_t *scope;
+    ast_fn_definition_t *fn_def;
+    arena_temp_t fn_temp;
+    // Frame of the function being populated: offsets by slot, the offset of
+    // the innermost local so far and the deepest one seen.
+    uint32_t *frame_offsets;
+    uint32_t frame_slots_size;
+    uint32_t frame_slots_capacity;
+    uint32_t frame_offset;
+    uint32_t frame_size;
 } checker_t;
 
 checker_t *
@@ -49,6 +49,8 @@ cli_parse_args(int argc, char **argv)
             opts.options |= CLI_OPT_DUMP_TOKENS;
         } else if (strcmp(arg, "--dump-ast") == 0) {
             opts.options |= CLI_OPT_DUMP_AST;
+        } else if (strcmp(arg, "--dump-ir") == 0) {
+            opts.options |= CLI_OPT_DUMP_IR;
         } else if (strcmp(arg, "--save-temps") == 0) {
             opts.options |= CLI_OPT_SAVE_TEMPS;
         } else if (strcmp(arg, "-o") == 0) {
@@ -68,7 +70,7 @@ cli_parse_args(int argc, char **argv)
     }
 
     if (opts.options & CLI_OPT_OUTPUT || opts.options & CLI_OPT_DUMP_TOKENS ||
-        opts.options & CLI_OPT_DUMP_AST) {
+        opts.options & CLI_OPT_DUMP_AST || opts.options & CLI_OPT_DUMP_IR) {
         return opts;
     }
 
@@ -151,6 +153,7 @@ cli_print_usage(FILE *stream, char *compiler_path)
         "Options:\n"
         "  --dump-tokens    Display lexer token stream\n"
         "  --dump-ast       Display ast tree to stdout\n"
+        "  --dump-ir        Display the SSA intermediate representation\n"
         "  --arch <arch>    Binary arch: default to x86_64 (x86_64 | aarch64)\n"
         "  --sysroot <dir>  System root dir where the GNU Assembler and GNU "
         "Linker are located: default to '/'\n"
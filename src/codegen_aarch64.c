@@ -17,9 +17,9 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "codegen_aarch64.h"
-#include "list.h"
 
 #define SYS_exit (93)
 
@@ -41,6 +41,12 @@ codegen_aarch64_emit_start_entrypoint(FILE *out);
 static void
 codegen_aarch64_emit_function(FILE *out, ast_fn_definition_t *fn);
 
+static uint32_t
+codegen_aarch64_exit_code(ast_fn_definition_t *fn);
+
+static void
+codegen_aarch64_unsupported(token_loc_t loc);
+
 void
 codegen_aarch64_emit_translation_unit(FILE *out, ast_node_t *node)
 {
@@ -49,23 +55,23 @@ codegen_aarch64_emit_translation_unit(FILE *out, ast_node_t *node)
     assert(node->kind == AST_NODE_TRANSLATION_UNIT);
     ast_translation_unit_t translation_unit = node->as_translation_unit;
 
-    list_item_t *item = list_head(translation_unit.decls);
-
     bool main_found = false;
 
-    while (item != NULL) {
-        ast_node_t *decl = (ast_node_t *)item->value;
+    for (size_t i = 0; i < translation_unit.decls_size; ++i) {
+        ast_node_t *decl = translation_unit.decls[i];
 
         if (decl->kind == AST_NODE_FN_DEF) {
-            ast_fn_definition_t fn = decl->as_fn_def;
-            codegen_aarch64_emit_function(out, &fn);
-
-            main_found = main_found || string_view_eq_to_cstr(fn.id, "main");
+            ast_fn_definition_t *fn = &decl->as_fn_def;
+            if (fn->_extern) {
+                continue;
+            }
+            codegen_aarch64_emit_function(out, fn);
+
+            main_found =
+                main_found || string_view_eq_to_cstr(fn->id->str, "main");
         } else {
             assert(0 && "translation unit only supports function declarations");
         }
-
-        item = list_next(item);
     }
 
     assert(main_found && "main function is required.");
@@ -85,26 +91,59 @@ codegen_aarch64_emit_start_entrypoint(FILE *out)
 
 static void
 codegen_aarch64_emit_function(FILE *out, ast_fn_definition_t *fn)
+{
+    uint32_t exit_code = codegen_aarch64_exit_code(fn);
+
+    fprintf(out, "" SV_FMT ":\n", SV_ARG(fn->id->str));
+    fprintf(out, "    mov x0, #%d\n", exit_code);
+    fprintf(out, "    ret\n");
+}
+
+/**
+ * Unlike x86_64, aarch64 is still lowered straight from the AST and only
+ * supports functions made of a single `return` of an integer literal, which
+ * is what this returns.  Anything else is reported as unsupported.
+ */
+static uint32_t
+codegen_aarch64_exit_code(ast_fn_definition_t *fn)
 {
     ast_node_t *block_node = fn->block;
+    if (block_node == NULL) {
+        codegen_aarch64_unsupported(fn->meta.loc);
+    }
+
     assert(block_node->kind == AST_NODE_BLOCK);
-    ast_block_t block = block_node->as_block;
+    ast_block_t *block = &block_node->as_block;
+    if (block->nodes_size != 1) {
+        codegen_aarch64_unsupported(block_node->loc);
+    }
+
+    ast_node_t *return_node = block->nodes[0];
+    if (return_node->kind != AST_NODE_RETURN_STMT) {
+        codegen_aarch64_unsupported(return_node->loc);
+    }
 
-    assert(list_size(block.nodes) == 1);
+    ast_node_t *literal_node = return_node->as_return_stmt.expr;
+    if (literal_node == NULL || literal_node->kind != AST_NODE_LITERAL ||
+        literal_node->as_literal.kind != AST_LITERAL_U32) {
+        codegen_aarch64_unsupported(return_node->loc);
+    }
 
-    list_item_t *nodes_item = list_get(block.nodes, 0);
-    ast_node_t *return_node = nodes_item->value;
-    assert(return_node->kind == AST_NODE_RETURN_STMT);
-    ast_return_stmt_t return_stmt = return_node->as_return_stmt;
+    return literal_node->as_literal.as_u32;
+}
 
-    ast_node_t *literal_node = return_stmt.expr;
-    assert(literal_node->kind == AST_NODE_LITERAL);
-    ast_literal_t literal_u32 = literal_node->as_literal;
+static void
+codegen_aarch64_unsupported(token_loc_t loc)
+{
+    fprintf(stderr,
+            "%s:%lu:%lu: error: unsupported on aarch64, which only compiles "
+            "functions returning an integer literal\n",
+            token_loc_to_filepath(loc),
+            token_loc_to_lineno(loc),
+            token_loc_to_colno(loc));
 
-    assert(literal_u32.kind == AST_LITERAL_U32);
-    uint32_t exit_code = literal_u32.as_u32;
+    fprintf(stderr, SV_FMT "\n", SV_ARG(token_loc_to_line(loc)));
+    fprintf(stderr, "%*s\n", (int)token_loc_to_colno(loc), "^");
 
-    fprintf(out, "" SV_FMT ":\n", SV_ARG(fn->id));
-    fprintf(out, "    mov x0, #%d\n", exit_code);
-    fprintf(out, "    ret\n");
+    exit(EXIT_FAILURE);
 }
@@ -15,16 +15,16 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "codegen_x86_64.h"
-#include "list.h"
-#include "map.h"
-#include "scope.h"
 
 #define SYS_exit (60)
-#define PTR_HEX_CSTR_SIZE (16 + 1)
 
 // The call instruction pushes EIP into stack so the first 8 bytes from stack
 // must be preserved else the ret instruction will jump to nowere.
@@ -61,904 +61,943 @@ static int x86_call_args[X86_CALL_ARG_SIZE] = { REG_DEST_IDX, REG_SRC_IDX,
                                                 REG_DATA,     REG_R10,
                                                 REG_R8,       REG_R9 };
 
+#define CODEGEN_X86_64_SCRATCH_ARENA_CAPACITY (16 * 1024)
+
 static void
-codegen_x86_64_emit_function(codegen_x86_64_t *codegen,
-                             ast_fn_definition_t *fn);
+codegen_x86_64_emit_function(codegen_x86_64_t *codegen, ir_function_t *fn);
 
 static void
-codegen_x86_64_emit_if(codegen_x86_64_t *codegen, ast_if_stmt_t is_stmt);
+codegen_x86_64_layout_frame(codegen_x86_64_t *codegen, ir_function_t *fn);
 
 static void
-codegen_x86_64_put_stack_offset(codegen_x86_64_t *codegen,
-                                symbol_t *symbol,
-                                size_t offset);
+codegen_x86_64_emit_instr(codegen_x86_64_t *codegen, ir_instr_t *instr);
 
-static size_t
-codegen_x86_64_get_stack_offset(codegen_x86_64_t *codegen, symbol_t *symbol);
+static void
+codegen_x86_64_emit_binary_op(codegen_x86_64_t *codegen, ir_instr_t *instr);
 
-static size_t
-type_to_bytes(type_t *type);
+static void
+codegen_x86_64_emit_cmp(codegen_x86_64_t *codegen, ir_instr_t *instr);
+
+static void
+codegen_x86_64_emit_load(codegen_x86_64_t *codegen, ir_instr_t *instr);
+
+static void
+codegen_x86_64_emit_store(codegen_x86_64_t *codegen, ir_instr_t *instr);
+
+static void
+codegen_x86_64_emit_call(codegen_x86_64_t *codegen, ir_instr_t *instr);
+
+static void
+codegen_x86_64_emit_br(codegen_x86_64_t *codegen, ir_instr_t *instr);
+
+static void
+codegen_x86_64_emit_phi_copies(codegen_x86_64_t *codegen,
+                               ir_block_t *from,
+                               ir_block_t *to);
+
+static void
+codegen_x86_64_emit_result(codegen_x86_64_t *codegen, ir_instr_t *instr);
+
+static void
+codegen_x86_64_load(codegen_x86_64_t *codegen,
+                    ir_instr_t *value,
+                    x86_64_register_type_t reg);
+
+static bool
+codegen_x86_64_is_fused(ir_instr_t *instr);
+
+static bool
+codegen_x86_64_has_phis(ir_block_t *block);
+
+static bool
+codegen_x86_64_needs_label(ir_block_t *block);
+
+static bool
+codegen_x86_64_br_is_swapped(ir_instr_t *br);
+
+static void
+codegen_x86_64_emit_zero_extend(codegen_x86_64_t *codegen, size_t bytes);
 
 static char *
 get_reg_for(x86_64_register_type_t type, size_t bytes);
 
+static char *
+get_load_for(size_t bytes);
+
 void
 codegen_x86_64_init(codegen_x86_64_t *codegen, arena_t *arena, FILE *out)
 {
     assert(codegen);
     assert(arena);
-    assert(codegen);
-    codegen->base_offset = 0;
-    codegen->symbols_stack_offset = map_new(arena);
+    codegen->slot_offsets = NULL;
+    codegen->value_offsets = NULL;
+    codegen->rax = NULL;
+    codegen->flags = NULL;
     codegen->out = out;
     codegen->arena = arena;
 }
 
 void
-codegen_x86_64_emit_translation_unit(codegen_x86_64_t *codegen,
-                                     ast_node_t *node)
+codegen_x86_64_emit_module(codegen_x86_64_t *codegen, ir_module_t *module)
 {
     codegen->label_index = 0;
+    codegen->scratch = arena_new(CODEGEN_X86_64_SCRATCH_ARENA_CAPACITY);
     fprintf(codegen->out, ".text\n");
 
-    assert(node->kind == AST_NODE_TRANSLATION_UNIT);
-    ast_translation_unit_t translation_unit = node->as_translation_unit;
-
-    list_item_t *item = list_head(translation_unit.decls);
-
-    while (item != NULL) {
-        ast_node_t *decl = (ast_node_t *)item->value;
-
-        if (decl->kind == AST_NODE_FN_DEF) {
-            ast_fn_definition_t fn = decl->as_fn_def;
-            codegen_x86_64_emit_function(codegen, &fn);
-        } else {
-            assert(0 && "translation unit only supports function declarations");
+    for (ir_function_t *fn = module->first; fn != NULL; fn = fn->next) {
+        if (!fn->_extern) {
+            codegen_x86_64_emit_function(codegen, fn);
         }
-
-        item = list_next(item);
     }
-}
 
-static size_t
-codegen_x86_64_get_next_label(codegen_x86_64_t *codegen)
-{
-    return ++codegen->label_index;
+    arena_free(&codegen->scratch);
 }
 
-typedef size_t size_in_bytes_t;
-
-static size_in_bytes_t
-codegen_x86_64_emit_expression(codegen_x86_64_t *codegen, ast_node_t *expr_node)
+static void
+codegen_x86_64_emit_function(codegen_x86_64_t *codegen, ir_function_t *fn)
 {
-    switch (expr_node->kind) {
-        case AST_NODE_LITERAL: {
-            ast_literal_t literal_u32 = expr_node->as_literal;
-            assert(literal_u32.kind == AST_LITERAL_U32);
-            uint32_t n = literal_u32.as_u32;
-
-            fprintf(codegen->out, "    mov $%d, %%eax\n", n);
-            return 4;
-        }
-        case AST_NODE_REF: {
-            ast_ref_t ref = expr_node->as_ref;
+    arena_temp_t temp = arena_temp_begin(&codegen->scratch);
 
-            symbol_t *symbol = scope_lookup(ref.scope, ref.id);
-            assert(symbol);
+    fprintf(codegen->out, ".globl " SV_FMT "\n", SV_ARG(fn->id->str));
+    fprintf(codegen->out, "" SV_FMT ":\n", SV_ARG(fn->id->str));
 
-            size_t offset = codegen_x86_64_get_stack_offset(codegen, symbol);
+    fprintf(codegen->out, "    push %%rbp\n");
+    fprintf(codegen->out, "    mov %%rsp, %%rbp\n");
 
-            size_t bytes = type_to_bytes(symbol->type);
+    codegen_x86_64_layout_frame(codegen, fn);
 
+    codegen->block_label = codegen->label_index + 1;
+    codegen->label_index += fn->blocks_size;
+
+    for (ir_block_t *block = fn->first; block != NULL; block = block->next) {
+        // Nothing is known about the registers where control flow joins.
+        if (codegen_x86_64_needs_label(block)) {
             fprintf(codegen->out,
-                    "    mov -%ld(%%rbp), %s\n",
-                    offset,
-                    get_reg_for(REG_ACCUMULATOR, bytes));
-            return bytes;
+                    ".L%zu:\n",
+                    codegen->block_label + block->id);
         }
-        case AST_NODE_FN_CALL: {
-            ast_fn_call_t fn_call = expr_node->as_fn_call;
-
-            symbol_t *symbol = scope_lookup(fn_call.scope, fn_call.id);
-            assert(symbol);
-
-            size_t i = 0;
-            for (list_item_t *item = list_head(fn_call.args); item != NULL;
-                 item = list_next(item)) {
-                // FIXME: add support for more args than X86_CALL_ARG_SIZE
-                assert(i < X86_CALL_ARG_SIZE);
+        codegen->rax = NULL;
+        codegen->flags = NULL;
 
-                ast_node_t *arg_node = (ast_node_t *)item->value;
-
-                codegen_x86_64_emit_expression(codegen, arg_node);
-
-                fprintf(codegen->out,
-                        "    push %s\n",
-                        get_reg_for(REG_ACCUMULATOR, 8));
-                ++i;
-            }
+        for (ir_instr_t *instr = block->first; instr != NULL;
+             instr = instr->next) {
+            codegen_x86_64_emit_instr(codegen, instr);
+        }
+    }
 
-            for (; i > 0; --i) {
-                fprintf(codegen->out,
-                        "    pop %s\n",
-                        get_reg_for(x86_call_args[i - 1], 8));
-            }
+    codegen->slot_offsets = NULL;
+    codegen->value_offsets = NULL;
+    arena_temp_end(temp);
+}
 
-            fprintf(codegen->out, "    call " SV_FMT "\n", SV_ARG(fn_call.id));
+/**
+ * Places the memory slots and then the values that outlive the instruction
+ * right after them in the frame, every value taking 8 bytes zero-extended
+ * from its width.
+ */
+static void
+codegen_x86_64_layout_frame(codegen_x86_64_t *codegen, ir_function_t *fn)
+{
+    size_t slots_size = (fn->slots_size + 1) * sizeof(uint32_t);
+    size_t values_size = (fn->values_size + 1) * sizeof(uint32_t);
+
+    codegen->slot_offsets = (uint32_t *)arena_alloc(&codegen->scratch,
+                                                    slots_size + values_size);
+    if (codegen->slot_offsets == NULL) {
+        fprintf(stderr,
+                "[FATAL] Out of memory: codegen_x86_64_layout_frame: %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    codegen->value_offsets = codegen->slot_offsets + fn->slots_size + 1;
+    memset(codegen->value_offsets, 0, values_size);
+
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < fn->slots_size; ++i) {
+        type_t *type = fn->slots[i];
+        offset += type->size;
+        offset =
+            (offset + type->alignment - 1) / type->alignment * type->alignment;
+        codegen->slot_offsets[i] = offset;
+    }
 
-            return type_to_bytes(symbol->type);
-        }
-        case AST_NODE_BINARY_OP: {
-            ast_binary_op_t bin_op = expr_node->as_bin_op;
-            switch (bin_op.kind) {
-                case AST_BINOP_ADDITION: {
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t rhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.rhs);
-                    fprintf(codegen->out, "    push %%rax\n");
-
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t lhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.lhs);
-
-                    size_in_bytes_t expr_bytes =
-                        bytes_max(rhs_bytes, lhs_bytes);
-
-                    fprintf(codegen->out, "    pop %%rcx\n");
-                    fprintf(codegen->out,
-                            "    add %s, %s\n",
-                            get_reg_for(REG_COUNTER, expr_bytes),
-                            get_reg_for(REG_ACCUMULATOR, expr_bytes));
-
-                    return expr_bytes;
-                }
-                case AST_BINOP_MULTIPLICATION: {
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t rhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.rhs);
-                    fprintf(codegen->out, "    push %%rax\n");
-
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t lhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.lhs);
-
-                    size_in_bytes_t expr_bytes =
-                        bytes_max(rhs_bytes, lhs_bytes);
-
-                    fprintf(codegen->out, "    pop %%rcx\n");
-                    fprintf(codegen->out,
-                            "    mul %s\n",
-                            get_reg_for(REG_COUNTER, expr_bytes));
-
-                    return expr_bytes;
-                }
-                case AST_BINOP_DIVISION: {
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t rhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.rhs);
-                    fprintf(codegen->out, "    push %%rax\n");
-
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t lhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.lhs);
-
-                    size_in_bytes_t expr_bytes =
-                        bytes_max(rhs_bytes, lhs_bytes);
-
-                    fprintf(codegen->out, "    pop %%rcx\n");
-                    fprintf(codegen->out, "    xor %%rdx, %%rdx\n");
-                    fprintf(codegen->out,
-                            "    div %s\n",
-                            get_reg_for(REG_COUNTER, expr_bytes));
-
-                    return expr_bytes;
-                }
-                case AST_BINOP_REMINDER: {
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t rhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.rhs);
-                    fprintf(codegen->out, "    push %%rax\n");
-
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t lhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.lhs);
-
-                    size_in_bytes_t expr_bytes =
-                        bytes_max(rhs_bytes, lhs_bytes);
-
-                    fprintf(codegen->out, "    pop %%rcx\n");
-                    fprintf(codegen->out, "    xor %%rdx, %%rdx\n");
-                    fprintf(codegen->out,
-                            "    div %s\n",
-                            get_reg_for(REG_COUNTER, expr_bytes));
-                    fprintf(codegen->out,
-                            "    mov %s, %s\n",
-                            get_reg_for(REG_DATA, expr_bytes),
-                            get_reg_for(REG_ACCUMULATOR, expr_bytes));
-
-                    return expr_bytes;
-                }
-                case AST_BINOP_SUBTRACTION: {
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t rhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.rhs);
-                    fprintf(codegen->out, "    push %%rax\n");
-
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t lhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.lhs);
-
-                    size_in_bytes_t expr_bytes =
-                        bytes_max(rhs_bytes, lhs_bytes);
-
-                    fprintf(codegen->out, "    pop %%rcx\n");
-                    fprintf(codegen->out,
-                            "    sub %s, %s\n",
-                            get_reg_for(REG_COUNTER, expr_bytes),
-                            get_reg_for(REG_ACCUMULATOR, expr_bytes));
-
-                    return expr_bytes;
-                }
-                case AST_BINOP_CMP_EQ: {
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t rhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.rhs);
-                    fprintf(codegen->out, "    push %%rax\n");
-
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t lhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.lhs);
-
-                    size_in_bytes_t expr_bytes =
-                        bytes_max(rhs_bytes, lhs_bytes);
-
-                    fprintf(codegen->out, "    pop %%rcx\n");
-                    fprintf(codegen->out,
-                            "    cmp %s, %s\n",
-                            get_reg_for(REG_COUNTER, expr_bytes),
-                            get_reg_for(REG_ACCUMULATOR, expr_bytes));
-                    fprintf(codegen->out, "    sete %%al\n");
-                    fprintf(codegen->out,
-                            "    movzb %%al, %s\n",
-                            get_reg_for(REG_ACCUMULATOR, expr_bytes));
-
-                    return expr_bytes;
-                }
-                case AST_BINOP_CMP_LT: {
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t rhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.rhs);
-                    fprintf(codegen->out, "    push %%rax\n");
-
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t lhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.lhs);
-
-                    size_in_bytes_t expr_bytes =
-                        bytes_max(rhs_bytes, lhs_bytes);
-
-                    fprintf(codegen->out, "    pop %%rcx\n");
-                    fprintf(codegen->out,
-                            "    cmp %s, %s\n",
-                            get_reg_for(REG_COUNTER, expr_bytes),
-                            get_reg_for(REG_ACCUMULATOR, expr_bytes));
-                    fprintf(codegen->out, "    setl %%al\n");
-                    fprintf(codegen->out,
-                            "    movzb %%al, %s\n",
-                            get_reg_for(REG_ACCUMULATOR, expr_bytes));
-
-                    return expr_bytes;
-                }
-                case AST_BINOP_CMP_GT: {
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t rhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.rhs);
-                    fprintf(codegen->out, "    push %%rax\n");
-
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t lhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.lhs);
-
-                    size_in_bytes_t expr_bytes =
-                        bytes_max(rhs_bytes, lhs_bytes);
-
-                    fprintf(codegen->out, "    pop %%rcx\n");
-                    fprintf(codegen->out,
-                            "    cmp %s, %s\n",
-                            get_reg_for(REG_COUNTER, expr_bytes),
-                            get_reg_for(REG_ACCUMULATOR, expr_bytes));
-                    fprintf(codegen->out, "    setg %%al\n");
-                    fprintf(codegen->out,
-                            "    movzb %%al, %s\n",
-                            get_reg_for(REG_ACCUMULATOR, expr_bytes));
-
-                    return expr_bytes;
-                }
-                case AST_BINOP_CMP_NEQ: {
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t rhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.rhs);
-                    fprintf(codegen->out, "    push %%rax\n");
-
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t lhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.lhs);
-
-                    size_in_bytes_t expr_bytes =
-                        bytes_max(rhs_bytes, lhs_bytes);
-
-                    fprintf(codegen->out, "    pop %%rcx\n");
-                    fprintf(codegen->out,
-                            "    cmp %s, %s\n",
-                            get_reg_for(REG_COUNTER, expr_bytes),
-                            get_reg_for(REG_ACCUMULATOR, expr_bytes));
-                    fprintf(codegen->out, "    setne %%al\n");
-                    fprintf(codegen->out,
-                            "    movzb %%al, %s\n",
-                            get_reg_for(REG_ACCUMULATOR, expr_bytes));
-
-                    return expr_bytes;
-                }
-                case AST_BINOP_CMP_LEQ: {
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t rhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.rhs);
-                    fprintf(codegen->out, "    push %%rax\n");
-
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t lhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.lhs);
-
-                    size_in_bytes_t expr_bytes =
-                        bytes_max(rhs_bytes, lhs_bytes);
-
-                    fprintf(codegen->out, "    pop %%rcx\n");
-                    fprintf(codegen->out,
-                            "    cmp %s, %s\n",
-                            get_reg_for(REG_COUNTER, expr_bytes),
-                            get_reg_for(REG_ACCUMULATOR, expr_bytes));
-                    fprintf(codegen->out, "    setle %%al\n");
-                    fprintf(codegen->out,
-                            "    movzb %%al, %s\n",
-                            get_reg_for(REG_ACCUMULATOR, expr_bytes));
-
-                    return expr_bytes;
-                }
-                case AST_BINOP_CMP_GEQ: {
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t rhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.rhs);
-                    fprintf(codegen->out, "    push %%rax\n");
-
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t lhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.lhs);
-
-                    size_in_bytes_t expr_bytes =
-                        bytes_max(rhs_bytes, lhs_bytes);
-
-                    fprintf(codegen->out, "    pop %%rcx\n");
-                    fprintf(codegen->out,
-                            "    cmp %s, %s\n",
-                            get_reg_for(REG_COUNTER, expr_bytes),
-                            get_reg_for(REG_ACCUMULATOR, expr_bytes));
-                    fprintf(codegen->out, "    setge %%al\n");
-                    fprintf(codegen->out,
-                            "    movzb %%al, %s\n",
-                            get_reg_for(REG_ACCUMULATOR, expr_bytes));
-
-                    return expr_bytes;
-                }
-                case AST_BINOP_BITWISE_LSHIFT: {
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    codegen_x86_64_emit_expression(codegen, bin_op.rhs);
-                    fprintf(codegen->out, "    push %%rax\n");
-
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t lhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.lhs);
-
-                    fprintf(codegen->out, "    pop %%rcx\n");
-                    fprintf(codegen->out,
-                            "    shl %%cl, %s\n",
-                            get_reg_for(REG_ACCUMULATOR, lhs_bytes));
-
-                    return lhs_bytes;
-                }
-                case AST_BINOP_BITWISE_RSHIFT: {
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    codegen_x86_64_emit_expression(codegen, bin_op.rhs);
-                    fprintf(codegen->out, "    push %%rax\n");
-
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t lhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.lhs);
-
-                    fprintf(codegen->out, "    pop %%rcx\n");
-                    fprintf(codegen->out,
-                            "    shr %%cl, %s\n",
-                            get_reg_for(REG_ACCUMULATOR, lhs_bytes));
-
-                    return lhs_bytes;
-                }
-                case AST_BINOP_BITWISE_XOR: {
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t rhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.rhs);
-                    fprintf(codegen->out, "    push %%rax\n");
-
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t lhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.lhs);
-
-                    size_in_bytes_t expr_bytes =
-                        bytes_max(rhs_bytes, lhs_bytes);
-
-                    fprintf(codegen->out, "    pop %%rcx\n");
-                    fprintf(codegen->out,
-                            "    xor %s, %s\n",
-                            get_reg_for(REG_COUNTER, expr_bytes),
-                            get_reg_for(REG_ACCUMULATOR, expr_bytes));
-
-                    return expr_bytes;
-                }
-                case AST_BINOP_BITWISE_AND: {
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t rhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.rhs);
-                    fprintf(codegen->out, "    push %%rax\n");
-
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t lhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.lhs);
-
-                    size_in_bytes_t expr_bytes =
-                        bytes_max(rhs_bytes, lhs_bytes);
-
-                    fprintf(codegen->out, "    pop %%rcx\n");
-                    fprintf(codegen->out,
-                            "    and %s, %s\n",
-                            get_reg_for(REG_COUNTER, expr_bytes),
-                            get_reg_for(REG_ACCUMULATOR, expr_bytes));
-
-                    return expr_bytes;
-                }
-                case AST_BINOP_BITWISE_OR: {
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t rhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.rhs);
-                    fprintf(codegen->out, "    push %%rax\n");
-
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t lhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.lhs);
-
-                    size_in_bytes_t expr_bytes =
-                        bytes_max(rhs_bytes, lhs_bytes);
-
-                    fprintf(codegen->out, "    pop %%rcx\n");
-                    fprintf(codegen->out,
-                            "    or %s, %s\n",
-                            get_reg_for(REG_COUNTER, expr_bytes),
-                            get_reg_for(REG_ACCUMULATOR, expr_bytes));
-
-                    return expr_bytes;
-                }
-                case AST_BINOP_LOGICAL_AND: {
-                    size_t label_exit = codegen_x86_64_get_next_label(codegen);
-
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t lhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.lhs);
-                    fprintf(codegen->out,
-                            "    cmp $0, %s\n",
-                            get_reg_for(REG_ACCUMULATOR, lhs_bytes));
-                    fprintf(codegen->out, "    je .L%ld\n", label_exit);
-
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t rhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.rhs);
-                    fprintf(codegen->out,
-                            "    cmp $0, %s\n",
-                            get_reg_for(REG_ACCUMULATOR, rhs_bytes));
-                    fprintf(codegen->out, "    je .L%ld\n", label_exit);
-                    fprintf(codegen->out, "    mov $1, %%rax\n");
-                    fprintf(codegen->out, ".L%ld:\n", label_exit);
-
-                    return 1;
-                }
-                case AST_BINOP_LOGICAL_OR: {
-                    size_t label_t = codegen_x86_64_get_next_label(codegen);
-                    size_t label_f = codegen_x86_64_get_next_label(codegen);
-
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t lhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.lhs);
-                    fprintf(codegen->out,
-                            "    cmp $0, %s\n",
-                            get_reg_for(REG_ACCUMULATOR, lhs_bytes));
-                    fprintf(codegen->out, "    jne .L%ld\n", label_t);
-
-                    fprintf(codegen->out, "    xor %%rax, %%rax\n");
-                    size_in_bytes_t rhs_bytes =
-                        codegen_x86_64_emit_expression(codegen, bin_op.rhs);
-                    fprintf(codegen->out,
-                            "    cmp $0, %s\n",
-                            get_reg_for(REG_ACCUMULATOR, rhs_bytes));
-                    fprintf(codegen->out, "    je .L%ld\n", label_f);
-
-                    fprintf(codegen->out, ".L%ld:\n", label_t);
-                    fprintf(codegen->out, "    mov $1, %%rax\n");
-                    fprintf(codegen->out, ".L%ld:\n", label_f);
-
-                    return 1;
-                }
-                case AST_BINOP_ASSIGN: {
-                    switch (bin_op.lhs->kind) {
-                        case AST_NODE_REF: {
-                            ast_ref_t ref = bin_op.lhs->as_ref;
-                            scope_t *scope = ref.scope;
-
-                            symbol_t *symbol = scope_lookup(scope, ref.id);
-                            assert(symbol);
-
-                            size_t offset = codegen_x86_64_get_stack_offset(
-                                codegen, symbol);
-
-                            codegen_x86_64_emit_expression(codegen, bin_op.rhs);
-
-                            size_t type_size = type_to_bytes(symbol->type);
-                            fprintf(codegen->out,
-                                    "    mov %s, -%ld(%%rbp)\n",
-                                    get_reg_for(REG_ACCUMULATOR, type_size),
-                                    offset);
-                            break;
-                        }
-                        case AST_NODE_UNARY_OP: {
-                            assert(bin_op.lhs->as_unary_op.kind ==
-                                       AST_UNARY_DEREFERENCE &&
-                                   "unsupported assignment lhs");
-
-                            codegen_x86_64_emit_expression(codegen, bin_op.lhs);
-
-                            fprintf(codegen->out, "    push %%rax\n");
-
-                            size_t type_size = codegen_x86_64_emit_expression(
-                                codegen, bin_op.rhs);
-
-                            fprintf(codegen->out, "    pop %%rdx\n");
-
-                            fprintf(codegen->out,
-                                    "    mov %s, (%%rdx) \n",
-                                    get_reg_for(REG_ACCUMULATOR, type_size));
-
-                            break;
-                        }
-                        default: {
-                            assert(false && "unsupported assignment lhs");
-                        }
-                    }
-
-                    // FIXME: we don't support a = b = c
-                    return 0;
-                }
-                default: {
-                    assert(0 && "unsupported binary operation");
-                    return 0;
-                }
+    offset = (offset + 7) & ~UINT32_C(7);
+    for (ir_block_t *block = fn->first; block != NULL; block = block->next) {
+        for (ir_instr_t *instr = block->first; instr != NULL;
+             instr = instr->next) {
+            if (instr->type == NULL || instr->op == IR_CONST ||
+                instr->op == IR_ADDR || !ir_instr_has_uses(instr) ||
+                codegen_x86_64_is_fused(instr)) {
+                continue;
             }
-        }
 
-        case AST_NODE_UNARY_OP: {
-            ast_unary_op_t unary_op = expr_node->as_unary_op;
-            switch (unary_op.kind) {
-                case AST_UNARY_BITWISE_NOT: {
-                    size_in_bytes_t expr_bytes =
-                        codegen_x86_64_emit_expression(codegen, unary_op.expr);
-
-                    fprintf(codegen->out,
-                            "    not %s\n",
-                            get_reg_for(REG_ACCUMULATOR, expr_bytes));
-
-                    return expr_bytes;
-                }
-                case AST_UNARY_ADDRESSOF: {
-                    assert(unary_op.expr->kind == AST_NODE_REF &&
-                           "unsupported unary expression for addressof (&)");
-
-                    ast_ref_t ref = unary_op.expr->as_ref;
-
-                    symbol_t *symbol = scope_lookup(ref.scope, ref.id);
-                    assert(symbol);
-
-                    size_t offset =
-                        codegen_x86_64_get_stack_offset(codegen, symbol);
-
-                    fprintf(
-                        codegen->out, "    lea -%ld(%%rbp), %%rax\n", offset);
-                    return 8;
-                }
-                case AST_UNARY_DEREFERENCE: {
-                    // FIXME: support dereference of dereference (**)
-                    assert(unary_op.expr->kind == AST_NODE_REF &&
-                           "unsupported unary expression for dereference (*)");
-
-                    return codegen_x86_64_emit_expression(codegen,
-                                                          unary_op.expr);
-                }
-                default: {
-                    assert(0 && "unsupported unary operation");
-                    return 0;
-                }
-            }
+            offset += 8;
+            codegen->value_offsets[instr->id] = offset;
         }
+    }
 
-        default:
-            assert(0 && "unsupported expression");
+    // Keeps the stack pointer 16 bytes aligned.
+    uint32_t frame_size = (offset + 15) & ~UINT32_C(15);
+    if (frame_size != 0) {
+        fprintf(codegen->out, "    sub $%u, %%rsp\n", frame_size);
     }
 }
-static void
-codegen_x86_64_emit_block(codegen_x86_64_t *codegen, ast_block_t *block)
+
+/**
+ * Next instruction after instr emitting any code, constants and addresses
+ * are only materialized where they are used.
+ */
+static ir_instr_t *
+codegen_x86_64_next_emitted(ir_instr_t *instr)
 {
-    size_t block_offset = codegen->base_offset;
-    size_t nodes_len = list_size(block->nodes);
+    ir_instr_t *next = instr->next;
+    while (next != NULL && (next->op == IR_CONST || next->op == IR_ADDR)) {
+        next = next->next;
+    }
+    return next;
+}
 
-    for (size_t i = 0; i < nodes_len; ++i) {
-        ast_node_t *node = list_get(block->nodes, i)->value;
-        switch (node->kind) {
-            case AST_NODE_RETURN_STMT: {
-                ast_return_stmt_t return_stmt = node->as_return_stmt;
+/**
+ * Whether instr is only used by the instruction right after it, which then
+ * takes it straight from rax, or from the flags for a branch on a comparison.
+ * Such values never reach the frame.
+ */
+static bool
+codegen_x86_64_is_fused(ir_instr_t *instr)
+{
+    if (instr->type == NULL || instr->op == IR_PHI ||
+        instr->op == IR_CONST || instr->op == IR_ADDR) {
+        return false;
+    }
 
-                ast_node_t *expr = return_stmt.expr;
+    ir_use_t *use = instr->uses;
+    if (use == NULL || use->next != NULL || use->user->op == IR_PHI) {
+        return false;
+    }
+    return use->user == codegen_x86_64_next_emitted(instr);
+}
 
-                codegen_x86_64_emit_expression(codegen, expr);
+/**
+ * Whether anything jumps to block.  A block only entered by falling through
+ * from the end of the previous one needs no label.
+ */
+static bool
+codegen_x86_64_needs_label(ir_block_t *block)
+{
+    if (block == block->fn->first) {
+        return false;
+    }
+    if (block->preds_size != 1 || block->preds[0] != block->prev) {
+        return true;
+    }
 
-                fprintf(codegen->out, "    mov %%rbp, %%rsp\n");
-                fprintf(codegen->out, "    pop %%rbp\n");
-                fprintf(codegen->out, "    ret\n");
+    ir_instr_t *terminator = ir_block_terminator(block->prev);
+    if (terminator->op == IR_JMP) {
+        return false;
+    }
 
-                break;
-            }
+    // The branch jumps to one target and falls through to the other, unless
+    // both edges assign phis.
+    bool swapped = codegen_x86_64_br_is_swapped(terminator);
+    ir_block_t *jumped = terminator->targets[swapped ? 1 : 0];
+    ir_block_t *fallen = terminator->targets[swapped ? 0 : 1];
+    return fallen != block || codegen_x86_64_has_phis(jumped);
+}
 
-            case AST_NODE_VAR_DEF: {
-                ast_var_definition_t var_def = node->as_var_def;
-                scope_t *scope = var_def.scope;
+/**
+ * Whether br jumps on its condition being zero rather than nonzero, so the
+ * edge assigning phis, or else the next block, is the one fallen through.
+ */
+static bool
+codegen_x86_64_br_is_swapped(ir_instr_t *br)
+{
+    ir_block_t *then = br->targets[0];
+    ir_block_t *_else = br->targets[1];
+    return codegen_x86_64_has_phis(then) ||
+           (then == br->block->next && !codegen_x86_64_has_phis(_else));
+}
 
-                symbol_t *symbol = scope_lookup(scope, var_def.id);
-                assert(symbol);
+static bool
+codegen_x86_64_has_phis(ir_block_t *block)
+{
+    return block->first != NULL && block->first->op == IR_PHI;
+}
 
-                size_t type_size = type_to_bytes(symbol->type);
-                codegen->base_offset += type_size;
+static size_t
+codegen_x86_64_label(codegen_x86_64_t *codegen, ir_block_t *block)
+{
+    return codegen->block_label + block->id;
+}
 
-                codegen_x86_64_put_stack_offset(
-                    codegen, symbol, codegen->base_offset);
+static size_t
+codegen_x86_64_get_next_label(codegen_x86_64_t *codegen)
+{
+    return ++codegen->label_index;
+}
 
-                if (var_def.value) {
-                    codegen_x86_64_emit_expression(codegen, var_def.value);
-                }
+static void
+codegen_x86_64_emit_instr(codegen_x86_64_t *codegen, ir_instr_t *instr)
+{
+    switch (instr->op) {
+        case IR_CONST:
+        case IR_ADDR:
+        case IR_PHI: {
+            // Constants and addresses are materialized at their uses, phis
+            // are written by the predecessors.
+            return;
+        }
+        case IR_PARAM: {
+            size_t bytes = instr->type->size;
+            x86_64_register_type_t reg = x86_call_args[instr->index];
+            assert(instr->index < X86_CALL_ARG_SIZE);
 
+            if (bytes <= 2) {
                 fprintf(codegen->out,
-                        "    mov %s, -%ld(%%rbp)\n",
-                        get_reg_for(REG_ACCUMULATOR, type_size),
-                        codegen->base_offset);
-
-                break;
+                        "    movz%cl %s, %%eax\n",
+                        bytes == 1 ? 'b' : 'w',
+                        get_reg_for(reg, bytes));
+            } else {
+                fprintf(codegen->out,
+                        "    mov %s, %s\n",
+                        get_reg_for(reg, bytes),
+                        get_reg_for(REG_ACCUMULATOR, bytes));
             }
-
-            case AST_NODE_BINARY_OP: {
-                codegen_x86_64_emit_expression(codegen, node);
-                break;
+            codegen_x86_64_emit_result(codegen, instr);
+            return;
+        }
+        case IR_EQ:
+        case IR_NE:
+        case IR_LT:
+        case IR_GT:
+        case IR_LE:
+        case IR_GE: {
+            codegen_x86_64_emit_cmp(codegen, instr);
+            return;
+        }
+        case IR_NOT: {
+            size_t bytes = instr->type->size;
+            codegen_x86_64_load(
+                codegen, ir_instr_operand(instr, 0), REG_ACCUMULATOR);
+            fprintf(codegen->out,
+                    "    not %s\n",
+                    get_reg_for(REG_ACCUMULATOR, bytes_max(bytes, 4)));
+            if (bytes < 4) {
+                codegen_x86_64_emit_zero_extend(codegen, bytes);
             }
+            codegen_x86_64_emit_result(codegen, instr);
+            return;
+        }
+        case IR_ZEXT: {
+            // Values are always kept zero-extended.
+            codegen_x86_64_load(
+                codegen, ir_instr_operand(instr, 0), REG_ACCUMULATOR);
+            codegen_x86_64_emit_result(codegen, instr);
+            return;
+        }
+        case IR_TRUNC: {
+            codegen_x86_64_load(
+                codegen, ir_instr_operand(instr, 0), REG_ACCUMULATOR);
+            codegen_x86_64_emit_zero_extend(codegen, instr->type->size);
+            codegen_x86_64_emit_result(codegen, instr);
+            return;
+        }
+        case IR_LOAD: {
+            codegen_x86_64_emit_load(codegen, instr);
+            return;
+        }
+        case IR_STORE: {
+            codegen_x86_64_emit_store(codegen, instr);
+            return;
+        }
+        case IR_CALL: {
+            codegen_x86_64_emit_call(codegen, instr);
+            return;
+        }
+        case IR_JMP: {
+            ir_block_t *target = instr->targets[0];
+            codegen_x86_64_emit_phi_copies(codegen, instr->block, target);
 
-            case AST_NODE_IF_STMT: {
-                codegen_x86_64_emit_if(codegen, node->as_if_stmt);
-                break;
+            if (target != instr->block->next) {
+                fprintf(codegen->out,
+                        "    jmp .L%zu\n",
+                        codegen_x86_64_label(codegen, target));
             }
+            return;
+        }
+        case IR_BR: {
+            codegen_x86_64_emit_br(codegen, instr);
+            return;
+        }
+        case IR_RET: {
+            codegen_x86_64_load(
+                codegen, ir_instr_operand(instr, 0), REG_ACCUMULATOR);
+            fprintf(codegen->out, "    mov %%rbp, %%rsp\n");
+            fprintf(codegen->out, "    pop %%rbp\n");
+            fprintf(codegen->out, "    ret\n");
+            return;
+        }
+        default: {
+            codegen_x86_64_emit_binary_op(codegen, instr);
+            return;
+        }
+    }
+}
 
-            case AST_NODE_WHILE_STMT: {
-                ast_while_stmt_t while_stmt = node->as_while_stmt;
-
-                ast_node_t *cond = while_stmt.cond;
-                ast_node_t *then = while_stmt.then;
-
-                size_t begin_label = codegen_x86_64_get_next_label(codegen);
-                size_t end_label = codegen_x86_64_get_next_label(codegen);
-
-                fprintf(codegen->out, ".L%ld:\n", begin_label);
-                codegen_x86_64_emit_expression(codegen, cond);
-                fprintf(codegen->out, "    cmp $1, %%rax\n");
-                fprintf(codegen->out, "    jnz .L%ld\n", end_label);
-
-                assert(then->kind == AST_NODE_BLOCK &&
-                       "invalid while-then block");
-                ast_block_t then_block = then->as_block;
+/**
+ * Records that instr is now in rax and spills it to its frame slot, if it has
+ * one.
+ */
+static void
+codegen_x86_64_emit_result(codegen_x86_64_t *codegen, ir_instr_t *instr)
+{
+    codegen->rax = instr;
 
-                codegen_x86_64_emit_block(codegen, &then_block);
+    uint32_t offset = codegen->value_offsets[instr->id];
+    if (offset != 0) {
+        fprintf(codegen->out, "    mov %%rax, -%u(%%rbp)\n", offset);
+    }
+}
 
-                fprintf(codegen->out, "    jmp .L%ld\n", begin_label);
-                fprintf(codegen->out, ".L%ld:\n", end_label);
+/**
+ * Brings value into reg, zero-extended to the whole register.  Nothing but
+ * reg is written, so operands already in rax survive loading the others.
+ */
+static void
+codegen_x86_64_load(codegen_x86_64_t *codegen,
+                    ir_instr_t *value,
+                    x86_64_register_type_t reg)
+{
+    if (value == codegen->rax) {
+        if (reg != REG_ACCUMULATOR) {
+            fprintf(codegen->out, "    mov %%rax, %s\n", get_reg_for(reg, 8));
+        }
+        return;
+    }
 
-                break;
-            }
-            default: {
-                // FIXME: improve error: replace the node->kind to a string
-                // representation
-                fprintf(stderr, "node kind %d not supported\n", node->kind);
-                assert(0 && "unsupported block statement");
-                break;
+    switch (value->op) {
+        case IR_CONST: {
+            if (value->imm > UINT32_MAX) {
+                fprintf(codegen->out,
+                        "    movabs $%" PRIu64 ", %s\n",
+                        value->imm,
+                        get_reg_for(reg, 8));
+            } else {
+                fprintf(codegen->out,
+                        "    mov $%" PRIu64 ", %s\n",
+                        value->imm,
+                        get_reg_for(reg, 4));
             }
+            break;
+        }
+        case IR_ADDR: {
+            fprintf(codegen->out,
+                    "    lea -%u(%%rbp), %s\n",
+                    codegen->slot_offsets[value->index],
+                    get_reg_for(reg, 8));
+            break;
+        }
+        default: {
+            uint32_t offset = codegen->value_offsets[value->id];
+            assert(offset != 0 && "value is neither in rax nor in the frame");
+
+            fprintf(codegen->out,
+                    "    mov -%u(%%rbp), %s\n",
+                    offset,
+                    get_reg_for(reg, 8));
+            break;
         }
     }
 
-    codegen->base_offset = block_offset;
+    if (reg == REG_ACCUMULATOR) {
+        codegen->rax = value;
+    }
 }
 
-static void
-codegen_x86_64_emit_if(codegen_x86_64_t *codegen, ast_if_stmt_t if_stmt)
+/**
+ * Whether the rhs of an operation of the given width can be encoded as an
+ * immediate, which is sign-extended for 64 bits operations.
+ */
+static bool
+codegen_x86_64_is_imm(ir_instr_t *value, size_t bytes)
 {
-    ast_node_t *cond = if_stmt.cond;
-    ast_node_t *then = if_stmt.then;
-    ast_node_t *_else = if_stmt._else;
-
-    size_t end_if_label = codegen_x86_64_get_next_label(codegen);
-    size_t end_else_label = codegen_x86_64_get_next_label(codegen);
-
-    codegen_x86_64_emit_expression(codegen, cond);
-    fprintf(codegen->out, "    cmp $1, %%rax\n");
-    fprintf(codegen->out, "    jnz .L%ld\n", end_if_label);
-
-    assert(then->kind == AST_NODE_BLOCK && "invalid if-then block");
-    ast_block_t then_block = then->as_block;
+    return value->op == IR_CONST &&
+           value->imm <= (bytes > 4 ? INT32_MAX : UINT32_MAX);
+}
 
-    codegen_x86_64_emit_block(codegen, &then_block);
-    fprintf(codegen->out, "    jmp .L%ld\n", end_else_label);
+/**
+ * Brings the lhs of a binary operation into rax and writes the operand the
+ * rhs is read from into rhs_operand: an immediate, its frame slot or rcx.
+ * Returns false if the operands had to be swapped, which only commutative
+ * operations allow.
+ */
+static bool
+codegen_x86_64_emit_operands(codegen_x86_64_t *codegen,
+                             ir_instr_t *instr,
+                             bool commutative,
+                             bool rhs_in_reg,
+                             char *rhs_operand,
+                             size_t rhs_operand_size)
+{
+    ir_instr_t *lhs = ir_instr_operand(instr, 0);
+    ir_instr_t *rhs = ir_instr_operand(instr, 1);
+    size_t bytes = bytes_max(lhs->type->size, 4);
+    bool swapped = false;
+
+    if (commutative && rhs == codegen->rax && lhs != codegen->rax) {
+        ir_instr_t *tmp = lhs;
+        lhs = rhs;
+        rhs = tmp;
+        swapped = true;
+    }
 
-    fprintf(codegen->out, ".L%ld:\n", end_if_label);
+    // rax is about to be taken by the lhs.
+    bool rhs_in_rcx = false;
+    if (rhs == codegen->rax && lhs != rhs) {
+        codegen_x86_64_load(codegen, rhs, REG_COUNTER);
+        rhs_in_rcx = true;
+    }
 
-    if (_else != NULL) {
-        if (_else->kind == AST_NODE_IF_STMT) {
-            ast_if_stmt_t else_if = _else->as_if_stmt;
-            codegen_x86_64_emit_if(codegen, else_if);
-        } else {
-            ast_block_t else_block = _else->as_block;
-            codegen_x86_64_emit_block(codegen, &else_block);
+    codegen_x86_64_load(codegen, lhs, REG_ACCUMULATOR);
+
+    if (lhs == rhs && !rhs_in_reg) {
+        snprintf(rhs_operand,
+                 rhs_operand_size,
+                 "%s",
+                 get_reg_for(REG_ACCUMULATOR, bytes));
+    } else if (!rhs_in_rcx && !rhs_in_reg &&
+               codegen_x86_64_is_imm(rhs, bytes)) {
+        snprintf(rhs_operand, rhs_operand_size, "$%" PRIu64, rhs->imm);
+    } else if (!rhs_in_rcx && !rhs_in_reg && rhs->op != IR_CONST &&
+               rhs->op != IR_ADDR) {
+        snprintf(rhs_operand,
+                 rhs_operand_size,
+                 "-%u(%%rbp)",
+                 codegen->value_offsets[rhs->id]);
+    } else {
+        if (!rhs_in_rcx) {
+            codegen_x86_64_load(codegen, rhs, REG_COUNTER);
         }
+        snprintf(rhs_operand,
+                 rhs_operand_size,
+                 "%s",
+                 get_reg_for(REG_COUNTER, bytes));
     }
 
-    fprintf(codegen->out, ".L%ld:\n", end_else_label);
+    return !swapped;
 }
 
-static size_t
-type_to_bytes(type_t *type)
+static void
+codegen_x86_64_emit_binary_op(codegen_x86_64_t *codegen, ir_instr_t *instr)
 {
-    switch (type->kind) {
-        case TYPE_PRIMITIVE: {
-            return type->as_primitive.size;
+    size_t type_bytes = instr->type->size;
+    size_t bytes = bytes_max(type_bytes, 4);
+    char *rax = get_reg_for(REG_ACCUMULATOR, bytes);
+    char rhs[32];
+
+    switch (instr->op) {
+        case IR_ADD:
+        case IR_MUL:
+        case IR_XOR:
+        case IR_AND:
+        case IR_OR: {
+            static const char *mnemonics[] = {
+                [IR_ADD] = "add", [IR_MUL] = "imul", [IR_XOR] = "xor",
+                [IR_AND] = "and", [IR_OR] = "or",
+            };
+
+            // Only the low half of the product is kept, which is the same
+            // for signed and unsigned operands.
+            codegen_x86_64_emit_operands(
+                codegen, instr, true, false, rhs, sizeof(rhs));
+            fprintf(codegen->out,
+                    "    %s %s, %s\n",
+                    mnemonics[instr->op],
+                    rhs,
+                    rax);
+            break;
         }
-        case TYPE_PTR: {
-            return 8;
+        case IR_SUB: {
+            codegen_x86_64_emit_operands(
+                codegen, instr, false, false, rhs, sizeof(rhs));
+            fprintf(codegen->out, "    sub %s, %s\n", rhs, rax);
+            break;
         }
-        case TYPE_UNKNOWN: {
-            assert(0 && "cannot calculate size of an unknown type: probably a "
-                        "parser issue.");
+        case IR_DIV:
+        case IR_REM: {
+            codegen_x86_64_emit_operands(
+                codegen, instr, false, true, rhs, sizeof(rhs));
+            fprintf(codegen->out, "    xor %%edx, %%edx\n");
+            fprintf(codegen->out, "    div %s\n", rhs);
+            if (instr->op == IR_REM) {
+                fprintf(codegen->out,
+                        "    mov %s, %s\n",
+                        get_reg_for(REG_DATA, bytes),
+                        rax);
+            }
+            break;
+        }
+        case IR_SHL:
+        case IR_SHR: {
+            char *mnemonic = instr->op == IR_SHL ? "shl" : "shr";
+            ir_instr_t *count = ir_instr_operand(instr, 1);
+
+            // The count is taken modulo the width, as the instruction does.
+            if (count->op == IR_CONST) {
+                codegen_x86_64_load(
+                    codegen, ir_instr_operand(instr, 0), REG_ACCUMULATOR);
+                fprintf(codegen->out,
+                        "    %s $%" PRIu64 ", %s\n",
+                        mnemonic,
+                        count->imm & (type_bytes * 8 - 1),
+                        rax);
+                break;
+            }
+
+            codegen_x86_64_emit_operands(
+                codegen, instr, false, true, rhs, sizeof(rhs));
+            // Narrow values are shifted in a 32-bit register, which would
+            // take the count modulo 32.
+            if (type_bytes < 4) {
+                fprintf(
+                    codegen->out, "    and $%zu, %%ecx\n", type_bytes * 8 - 1);
+            }
+            fprintf(codegen->out, "    %s %%cl, %s\n", mnemonic, rax);
+            break;
+        }
+        default: {
+            assert(0 && "unsupported ir operation");
+            return;
         }
     }
 
-    assert(0 && "unreachable");
+    if (type_bytes < 4) {
+        codegen_x86_64_emit_zero_extend(codegen, type_bytes);
+    }
+    codegen_x86_64_emit_result(codegen, instr);
 }
 
-static size_t
-calculate_fn_local_size(scope_t *scope)
+static const char *
+codegen_x86_64_cc(ir_op_t op)
 {
-    assert(scope);
+    switch (op) {
+        case IR_EQ:
+            return "e";
+        case IR_NE:
+            return "ne";
+        case IR_LT:
+            return "b";
+        case IR_GT:
+            return "a";
+        case IR_LE:
+            return "be";
+        case IR_GE:
+            return "ae";
+        default:
+            assert(0 && "not a comparison");
+            return NULL;
+    }
+}
 
-    // The local_size starts with 8 bytes since the first 8 bytes from the
-    // stack are reserved to store RBP during the prelude
-    size_t local_size = 8;
+/**
+ * The comparison holding when the operands of op are swapped.
+ */
+static ir_op_t
+codegen_x86_64_swap_cmp(ir_op_t op)
+{
+    switch (op) {
+        case IR_LT:
+            return IR_GT;
+        case IR_GT:
+            return IR_LT;
+        case IR_LE:
+            return IR_GE;
+        case IR_GE:
+            return IR_LE;
+        default:
+            return op;
+    }
+}
 
-    map_kv_t *kvs[scope->symbols->size];
+static ir_op_t
+codegen_x86_64_negate_cmp(ir_op_t op)
+{
+    switch (op) {
+        case IR_EQ:
+            return IR_NE;
+        case IR_NE:
+            return IR_EQ;
+        case IR_LT:
+            return IR_GE;
+        case IR_GT:
+            return IR_LE;
+        case IR_LE:
+            return IR_GT;
+        case IR_GE:
+            return IR_LT;
+        default:
+            assert(0 && "not a comparison");
+            return op;
+    }
+}
 
-    map_get_kvs(scope->symbols, kvs);
+/**
+ * Comparisons are unsigned.  One feeding the branch right after it leaves its
+ * outcome in the flags only, the branch picks the condition up from
+ * codegen->flags.
+ */
+static void
+codegen_x86_64_emit_cmp(codegen_x86_64_t *codegen, ir_instr_t *instr)
+{
+    size_t bytes = bytes_max(ir_instr_operand(instr, 0)->type->size, 4);
+    char rhs[32];
 
-    for (size_t i = 0; i < scope->symbols->size; ++i) {
-        symbol_t *symbol = (symbol_t *)kvs[i]->value;
-        local_size += type_to_bytes(symbol->type);
+    ir_op_t op = instr->op;
+    if (!codegen_x86_64_emit_operands(
+            codegen, instr, true, false, rhs, sizeof(rhs))) {
+        op = codegen_x86_64_swap_cmp(op);
     }
 
-    size_t max_child_local_size = 0;
-
-    list_item_t *item = list_head(scope->children);
+    fprintf(codegen->out,
+            "    cmp %s, %s\n",
+            rhs,
+            get_reg_for(REG_ACCUMULATOR, bytes));
+
+    if (codegen_x86_64_is_fused(instr) &&
+        instr->uses->user->op == IR_BR) {
+        // The operands may have been swapped, so the branch is told the
+        // comparison actually made.
+        codegen->flags = instr;
+        codegen->flags_op = op;
+        return;
+    }
 
-    while (item != NULL) {
-        size_t child_local_size =
-            calculate_fn_local_size((scope_t *)item->value);
+    fprintf(codegen->out, "    set%s %%al\n", codegen_x86_64_cc(op));
+    fprintf(codegen->out, "    movzbl %%al, %%eax\n");
+    codegen_x86_64_emit_result(codegen, instr);
+}
 
-        if (child_local_size > max_child_local_size) {
-            max_child_local_size = child_local_size;
-        }
+static void
+codegen_x86_64_emit_load(codegen_x86_64_t *codegen, ir_instr_t *instr)
+{
+    ir_instr_t *ptr = ir_instr_operand(instr, 0);
+    size_t bytes = instr->type->size;
+    char *rax = get_reg_for(REG_ACCUMULATOR, bytes_max(bytes, 4));
 
-        item = list_next(item);
+    if (ptr->op == IR_ADDR) {
+        fprintf(codegen->out,
+                "    %s -%u(%%rbp), %s\n",
+                get_load_for(bytes),
+                codegen->slot_offsets[ptr->index],
+                rax);
+    } else {
+        codegen_x86_64_load(codegen, ptr, REG_ACCUMULATOR);
+        fprintf(codegen->out, "    %s (%%rax), %s\n", get_load_for(bytes), rax);
     }
 
-    return local_size + max_child_local_size;
+    codegen_x86_64_emit_result(codegen, instr);
 }
 
 static void
-codegen_x86_64_emit_function(codegen_x86_64_t *codegen,
-                             ast_fn_definition_t *fn_def)
+codegen_x86_64_emit_store(codegen_x86_64_t *codegen, ir_instr_t *instr)
 {
-    if (fn_def->_extern) {
+    ir_instr_t *ptr = ir_instr_operand(instr, 0);
+    ir_instr_t *value = ir_instr_operand(instr, 1);
+    char *rax = get_reg_for(REG_ACCUMULATOR, value->type->size);
+
+    if (ptr->op == IR_ADDR) {
+        codegen_x86_64_load(codegen, value, REG_ACCUMULATOR);
+        fprintf(codegen->out,
+                "    mov %s, -%u(%%rbp)\n",
+                rax,
+                codegen->slot_offsets[ptr->index]);
         return;
     }
 
-    fprintf(codegen->out, ".globl " SV_FMT "\n", SV_ARG(fn_def->id));
-    codegen->base_offset = 0;
-
-    ast_node_t *block_node = fn_def->block;
-    fprintf(codegen->out, "" SV_FMT ":\n", SV_ARG(fn_def->id));
-
-    fprintf(codegen->out, "    push %%rbp\n");
-    fprintf(codegen->out, "    mov %%rsp, %%rbp\n");
-
-    size_t i = 0;
-    for (list_item_t *item = list_head(fn_def->params); item != NULL;
-         item = list_next(item)) {
-        assert(i < X86_CALL_ARG_SIZE);
-
-        ast_fn_param_t *param = item->value;
+    // Whichever operand is already in rax is moved out of the way first.
+    if (ptr == codegen->rax) {
+        codegen_x86_64_load(codegen, ptr, REG_COUNTER);
+        codegen_x86_64_load(codegen, value, REG_ACCUMULATOR);
+    } else {
+        codegen_x86_64_load(codegen, value, REG_ACCUMULATOR);
+        codegen_x86_64_load(codegen, ptr, REG_COUNTER);
+    }
+    fprintf(codegen->out, "    mov %s, (%%rcx)\n", rax);
+}
 
-        symbol_t *symbol = scope_lookup(fn_def->scope, param->id);
-        assert(symbol);
+static void
+codegen_x86_64_emit_call(codegen_x86_64_t *codegen, ir_instr_t *instr)
+{
+    // FIXME: add support for more args than X86_CALL_ARG_SIZE
+    assert(instr->operands_size <= X86_CALL_ARG_SIZE);
+
+    // An argument still in rax goes first, loading the others leaves rax
+    // alone.
+    for (uint32_t i = 0; i < instr->operands_size; ++i) {
+        if (ir_instr_operand(instr, i) == codegen->rax) {
+            codegen_x86_64_load(
+                codegen, ir_instr_operand(instr, i), x86_call_args[i]);
+        }
+    }
+    for (uint32_t i = 0; i < instr->operands_size; ++i) {
+        if (ir_instr_operand(instr, i) != codegen->rax) {
+            codegen_x86_64_load(
+                codegen, ir_instr_operand(instr, i), x86_call_args[i]);
+        }
+    }
 
-        // FIXME: add offset according to the param size
-        codegen->base_offset += 8;
-        size_t offset = codegen->base_offset;
+    fprintf(codegen->out, "    call " SV_FMT "\n", SV_ARG(instr->callee->str));
 
-        codegen_x86_64_put_stack_offset(codegen, symbol, codegen->base_offset);
+    // The callee may leave garbage above the width of its return type.
+    codegen_x86_64_emit_zero_extend(codegen, instr->type->size);
+    codegen_x86_64_emit_result(codegen, instr);
+}
 
-        fprintf(codegen->out,
-                "    mov %s, -%ld(%%rbp)\n",
-                // FIXME: Type may not be an as_primitive
-                get_reg_for(x86_call_args[i], symbol->type->as_primitive.size),
-                offset);
+/**
+ * Jumps to the target of a nonzero condition and falls through to the other
+ * one.  Phis are assigned on the edges, so the branch is laid out with the
+ * jump going to the target without phis when there is one.
+ */
+static void
+codegen_x86_64_emit_br(codegen_x86_64_t *codegen, ir_instr_t *instr)
+{
+    ir_instr_t *cond = ir_instr_operand(instr, 0);
+    ir_block_t *block = instr->block;
+    ir_block_t *then = instr->targets[0];
+    ir_block_t *_else = instr->targets[1];
+
+    ir_op_t op = IR_NE;
+    if (cond == codegen->flags) {
+        op = codegen->flags_op;
+    } else {
+        char *reg = get_reg_for(REG_ACCUMULATOR,
+                                bytes_max(cond->type->size, 4));
+        codegen_x86_64_load(codegen, cond, REG_ACCUMULATOR);
+        fprintf(codegen->out, "    test %s, %s\n", reg, reg);
+    }
+    codegen->flags = NULL;
 
-        ++i;
+    if (codegen_x86_64_br_is_swapped(instr)) {
+        ir_block_t *tmp = then;
+        then = _else;
+        _else = tmp;
+        op = codegen_x86_64_negate_cmp(op);
     }
 
-    size_t local_size = calculate_fn_local_size(fn_def->scope);
+    if (!codegen_x86_64_has_phis(then)) {
+        fprintf(codegen->out,
+                "    j%s .L%zu\n",
+                codegen_x86_64_cc(op),
+                codegen_x86_64_label(codegen, then));
 
-    if (local_size != 0) {
-        fprintf(codegen->out, "    sub $%ld, %%rsp\n", local_size);
+        codegen_x86_64_emit_phi_copies(codegen, block, _else);
+        if (_else != block->next) {
+            fprintf(codegen->out,
+                    "    jmp .L%zu\n",
+                    codegen_x86_64_label(codegen, _else));
+        }
+        return;
     }
 
-    assert(block_node->kind == AST_NODE_BLOCK);
-    ast_block_t block = block_node->as_block;
-
-    codegen_x86_64_emit_block(codegen, &block);
+    // Both edges assign phis: the copies of one of them get a stub of their
+    // own.
+    size_t stub_label = codegen_x86_64_get_next_label(codegen);
+    ir_instr_t *rax = codegen->rax;
+
+    fprintf(codegen->out,
+            "    j%s .L%zu\n",
+            codegen_x86_64_cc(op),
+            stub_label);
+
+    codegen_x86_64_emit_phi_copies(codegen, block, _else);
+    fprintf(codegen->out,
+            "    jmp .L%zu\n",
+            codegen_x86_64_label(codegen, _else));
+
+    fprintf(codegen->out, ".L%zu:\n", stub_label);
+    codegen->rax = rax;
+    codegen_x86_64_emit_phi_copies(codegen, block, then);
+    fprintf(codegen->out,
+            "    jmp .L%zu\n",
+            codegen_x86_64_label(codegen, then));
 }
 
+/**
+ * Assigns the phis of to their operands coming from from.  The copies happen
+ * all at once, through the stack, when a phi reads another phi of to that
+ * may already be overwritten.
+ */
 static void
-codegen_x86_64_put_stack_offset(codegen_x86_64_t *codegen,
-                                symbol_t *symbol,
-                                size_t offset)
+codegen_x86_64_emit_phi_copies(codegen_x86_64_t *codegen,
+                               ir_block_t *from,
+                               ir_block_t *to)
 {
+    uint32_t index = ir_block_pred_index(to, from);
+    bool parallel = false;
+
+    for (ir_instr_t *phi = to->first; phi != NULL && phi->op == IR_PHI;
+         phi = phi->next) {
+        ir_instr_t *value = ir_instr_operand(phi, index);
+        if (value != phi && value->op == IR_PHI && value->block == to) {
+            parallel = true;
+            break;
+        }
+    }
 
-    size_t *stack_offset = arena_alloc(codegen->arena, sizeof(size_t));
-    *stack_offset = offset;
+    for (ir_instr_t *phi = to->first; phi != NULL && phi->op == IR_PHI;
+         phi = phi->next) {
+        ir_instr_t *value = ir_instr_operand(phi, index);
+        if (value == phi || codegen->value_offsets[phi->id] == 0) {
+            continue;
+        }
 
-    char symbol_ptr[PTR_HEX_CSTR_SIZE];
-    sprintf(symbol_ptr, "%lx", (uintptr_t)symbol);
+        codegen_x86_64_load(codegen, value, REG_ACCUMULATOR);
+        if (parallel) {
+            fprintf(codegen->out, "    push %%rax\n");
+        } else {
+            fprintf(codegen->out,
+                    "    mov %%rax, -%u(%%rbp)\n",
+                    codegen->value_offsets[phi->id]);
+        }
+    }
+
+    if (!parallel) {
+        return;
+    }
+
+    for (ir_instr_t *phi = to->last; phi != NULL; phi = phi->prev) {
+        if (phi->op != IR_PHI || ir_instr_operand(phi, index) == phi ||
+            codegen->value_offsets[phi->id] == 0) {
+            continue;
+        }
 
-    map_put(codegen->symbols_stack_offset, symbol_ptr, stack_offset);
+        fprintf(codegen->out, "    pop %%rax\n");
+        fprintf(codegen->out,
+                "    mov %%rax, -%u(%%rbp)\n",
+                codegen->value_offsets[phi->id]);
+    }
+    codegen->rax = NULL;
 }
 
-static size_t
-codegen_x86_64_get_stack_offset(codegen_x86_64_t *codegen, symbol_t *symbol)
+/**
+ * Every value is kept in rax zero-extended from the width of its type, so
+ * widening a value to a larger type never needs an instruction.
+ */
+static void
+codegen_x86_64_emit_zero_extend(codegen_x86_64_t *codegen, size_t bytes)
 {
-    char symbol_ptr[PTR_HEX_CSTR_SIZE];
-    sprintf(symbol_ptr, "%lx", (uintptr_t)symbol);
-
-    return *(size_t *)map_get(codegen->symbols_stack_offset, symbol_ptr);
+    switch (bytes) {
+        case 1:
+            fprintf(codegen->out, "    movzbl %%al, %%eax\n");
+            return;
+        case 2:
+            fprintf(codegen->out, "    movzwl %%ax, %%eax\n");
+            return;
+        case 4:
+            fprintf(codegen->out, "    mov %%eax, %%eax\n");
+            return;
+        default:
+            return;
+    }
 }
 
 static char *
@@ -1017,7 +1056,7 @@ get_reg_for(x86_64_register_type_t type, size_t bytes)
         }
         case REG_DEST_IDX: {
             if (bytes <= 1) {
-                return "%sil";
+                return "%dil";
             } else if (bytes <= 2) {
                 return "%di";
             } else if (bytes <= 4) {
@@ -1129,3 +1168,18 @@ get_reg_for(x86_64_register_type_t type, size_t bytes)
     assert(0 && "invalid register");
     return NULL;
 }
+
+/**
+ * Instruction loading a value of the given width from memory into the
+ * accumulator, zero-extending values narrower than 32 bits.
+ */
+static char *
+get_load_for(size_t bytes)
+{
+    if (bytes <= 1) {
+        return "movzbl";
+    } else if (bytes <= 2) {
+        return "movzwl";
+    }
+    return "mov";
+}
@@ -18,16 +18,29 @@
 #define CODEGEN_X86_64_H
 
 #include "arena.h"
-#include "ast.h"
-#include "map.h"
+#include "ir.h"
 #include <stdio.h>
 
 typedef struct codegen_x86_64
 {
     arena_t *arena;
-    size_t base_offset;
+    // Frame layout of the function being emitted, rewound after it.
+    arena_t scratch;
     size_t label_index;
-    map_t *symbols_stack_offset;
+    // Label of the first block of the function being emitted, the others
+    // follow by block id.
+    size_t block_label;
+    // Offsets below the frame base of the memory slots and of the values
+    // living in the frame, by value id.  Values with offset 0 are either
+    // rematerialized at their uses or consumed right away from rax.
+    uint32_t *slot_offsets;
+    uint32_t *value_offsets;
+    // Value known to be in rax, NULL when unknown.
+    ir_instr_t *rax;
+    // Comparison whose outcome is only in the flags, for the branch right
+    // after it.
+    ir_instr_t *flags;
+    ir_op_t flags_op;
     FILE *out;
 } codegen_x86_64_t;
 
@@ -35,7 +48,6 @@ void
 codegen_x86_64_init(codegen_x86_64_t *codegen, arena_t *arena, FILE *out);
 
 void
-codegen_x86_64_emit_translation_unit(codegen_x86_64_t *codegen,
-                                     ast_node_t *prog);
+codegen_x86_64_emit_module(codegen_x86_64_t *codegen, ir_module_t *module);
 
 #endif /* CODEGEN_X86_64_H */
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "interner.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void
+interner_init(interner_t *interner, arena_t *arena)
+{
+    assert(interner);
+    assert(arena);
+    interner->arena = arena;
+    interner->atoms = map_new(arena);
+}
+
+atom_t *
+interner_intern(interner_t *interner, string_view_t str)
+{
+    assert(interner);
+
+    uint32_t hash = map_hash(str);
+    atom_t *atom = (atom_t *)map_get_with_hash(interner->atoms, str, hash);
+
+    if (atom != NULL) {
+        return atom;
+    }
+
+    atom = (atom_t *)arena_alloc(interner->arena, sizeof(atom_t));
+    if (atom == NULL) {
+        fprintf(stderr,
+                "[FATAL] Out of memory: interner_intern: %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    // The atom keeps pointing to the first occurrence of the string, it must
+    // outlive the interner.
+    atom->str = str;
+    atom->hash = hash;
+
+    map_put_with_hash(interner->atoms, atom->str, hash, atom);
+
+    return atom;
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include "arena.h"
+#include "map.h"
+#include "string_view.h"
+
+#include <stdint.h>
+
+/**
+ * An atom is the unique representation of an identifier.  Two identifiers
+ * with the same spelling are interned into the same atom, so they can be
+ * compared by pointer and their hash is computed only once.
+ */
+typedef struct atom
+{
+    string_view_t str;
+    uint32_t hash;
+} atom_t;
+
+typedef struct interner
+{
+    arena_t *arena;
+    map_t *atoms;
+} interner_t;
+
+void
+interner_init(interner_t *interner, arena_t *arena);
+
+atom_t *
+interner_intern(interner_t *interner, string_view_t str);
+
+#endif /* INTERNER_H */
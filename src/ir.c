@@ -0,0 +1,1532 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ir.h"
+#include "ir_analysis.h"
+
+#define IR_VERIFY_SCRATCH_ARENA_CAPACITY (16 * 1024)
+
+static void *
+ir_alloc(arena_t *arena, size_t size);
+
+static void
+ir_use_link(ir_use_t *use, ir_instr_t *value);
+
+static void
+ir_use_unlink(ir_use_t *use);
+
+static void
+ir_use_move(ir_use_t *dst, ir_use_t *src);
+
+static void
+ir_block_add_pred(ir_block_t *block, ir_block_t *pred);
+
+static void
+ir_instr_unlink(ir_instr_t *instr);
+
+static void
+ir_instr_dump(ir_instr_t *instr, FILE *out);
+
+static bool
+ir_verify_instr(ir_function_t *fn, ir_instr_t *instr);
+
+static bool
+ir_verify_dominance(ir_function_t *fn);
+
+static void
+ir_verify_error(ir_function_t *fn,
+                ir_block_t *block,
+                ir_instr_t *instr,
+                const char *fmt,
+                ...);
+
+ir_module_t *
+ir_module_new(arena_t *arena)
+{
+    assert(arena);
+
+    ir_module_t *module = (ir_module_t *)ir_alloc(arena, sizeof(ir_module_t));
+    module->arena = arena;
+    module->first = NULL;
+    module->last = NULL;
+    return module;
+}
+
+ir_function_t *
+ir_function_new(ir_module_t *module,
+                atom_t *id,
+                type_t *return_type,
+                uint32_t params_size)
+{
+    assert(module);
+
+    ir_function_t *fn =
+        (ir_function_t *)ir_alloc(module->arena, sizeof(ir_function_t));
+    fn->arena = module->arena;
+    fn->id = id;
+    fn->return_type = return_type;
+    fn->params_size = params_size;
+    fn->params = NULL;
+    if (params_size != 0) {
+        fn->params =
+            (type_t **)ir_alloc(module->arena, params_size * sizeof(type_t *));
+    }
+    fn->slots = NULL;
+    fn->slots_size = 0;
+    fn->slots_capacity = 0;
+    fn->first = NULL;
+    fn->last = NULL;
+    fn->blocks_size = 0;
+    fn->values_size = 0;
+    fn->_extern = false;
+    fn->next = NULL;
+
+    if (module->last == NULL) {
+        module->first = fn;
+    } else {
+        module->last->next = fn;
+    }
+    module->last = fn;
+
+    return fn;
+}
+
+uint32_t
+ir_function_add_slot(ir_function_t *fn, type_t *type)
+{
+    assert(fn);
+    assert(type);
+
+    if (fn->slots_size == fn->slots_capacity) {
+        uint32_t capacity = fn->slots_capacity ? fn->slots_capacity * 2 : 4;
+        type_t **slots =
+            (type_t **)ir_alloc(fn->arena, capacity * sizeof(type_t *));
+        if (fn->slots_size != 0) {
+            memcpy(slots, fn->slots, fn->slots_size * sizeof(type_t *));
+        }
+        fn->slots = slots;
+        fn->slots_capacity = capacity;
+    }
+
+    fn->slots[fn->slots_size] = type;
+    return fn->slots_size++;
+}
+
+void
+ir_function_find_escaped_slots(ir_function_t *fn, bool *escaped)
+{
+    memset(escaped, 0, fn->slots_size * sizeof(bool));
+
+    for (ir_block_t *block = fn->first; block != NULL; block = block->next) {
+        for (ir_instr_t *instr = block->first; instr != NULL;
+             instr = instr->next) {
+            if (instr->op != IR_ADDR) {
+                continue;
+            }
+
+            for (ir_use_t *use = instr->uses; use != NULL; use = use->next) {
+                ir_instr_t *user = use->user;
+                bool is_ptr = use == &user->operands[0];
+                if (!is_ptr ||
+                    (user->op != IR_LOAD && user->op != IR_STORE)) {
+                    escaped[instr->index] = true;
+                }
+            }
+        }
+    }
+}
+
+ir_block_t *
+ir_block_new(ir_function_t *fn)
+{
+    assert(fn);
+
+    ir_block_t *block = (ir_block_t *)ir_alloc(fn->arena, sizeof(ir_block_t));
+    block->id = fn->blocks_size++;
+    block->fn = fn;
+    block->first = NULL;
+    block->last = NULL;
+    block->preds = NULL;
+    block->preds_size = 0;
+    block->preds_capacity = 0;
+    block->next = NULL;
+    block->prev = fn->last;
+
+    if (fn->last == NULL) {
+        fn->first = block;
+    } else {
+        fn->last->next = block;
+    }
+    fn->last = block;
+
+    return block;
+}
+
+void
+ir_block_remove(ir_block_t *block)
+{
+    assert(block->preds_size == 0);
+    assert(block != block->fn->first);
+
+    // Removing the terminator first drops the edges to the successors.
+    while (block->last != NULL) {
+        ir_instr_remove(block->last);
+    }
+
+    ir_function_t *fn = block->fn;
+    if (block->prev == NULL) {
+        fn->first = block->next;
+    } else {
+        block->prev->next = block->next;
+    }
+    if (block->next == NULL) {
+        fn->last = block->prev;
+    } else {
+        block->next->prev = block->prev;
+    }
+    block->prev = NULL;
+    block->next = NULL;
+}
+
+void
+ir_block_remove_pred(ir_block_t *block, uint32_t index)
+{
+    assert(index < block->preds_size);
+
+    for (ir_instr_t *instr = block->first;
+         instr != NULL && instr->op == IR_PHI;
+         instr = instr->next) {
+        ir_instr_remove_operand(instr, index);
+    }
+
+    --block->preds_size;
+    memmove(&block->preds[index],
+            &block->preds[index + 1],
+            (block->preds_size - index) * sizeof(ir_block_t *));
+}
+
+bool
+ir_function_remove_dead_blocks(ir_function_t *fn, const bool *live)
+{
+    bool changed = false;
+
+    // Drops the uses reaching into the blocks kept, and among the blocks
+    // removed, so no value is still used once they go.
+    for (ir_block_t *block = fn->first; block != NULL; block = block->next) {
+        if (live[block->id]) {
+            continue;
+        }
+
+        ir_instr_t *terminator = ir_block_terminator(block);
+        if (terminator != NULL) {
+            ir_instr_remove(terminator);
+        }
+        for (ir_instr_t *instr = block->first; instr != NULL;
+             instr = instr->next) {
+            for (uint32_t i = 0; i < instr->operands_size; ++i) {
+                ir_instr_set_operand(instr, i, NULL);
+            }
+        }
+        changed = true;
+    }
+
+    ir_block_t *next = NULL;
+    for (ir_block_t *block = fn->first; block != NULL; block = next) {
+        next = block->next;
+        if (!live[block->id]) {
+            // Only other blocks removed can jump here, their terminators are
+            // gone.
+            assert(block->preds_size == 0);
+            ir_block_remove(block);
+        }
+    }
+
+    return changed;
+}
+
+void
+ir_block_merge_into_pred(ir_block_t *block)
+{
+    assert(block->preds_size == 1);
+    assert(block != block->fn->first);
+
+    ir_block_t *pred = block->preds[0];
+    ir_instr_t *jmp = ir_block_terminator(pred);
+    assert(pred != block);
+    assert(jmp && jmp->op == IR_JMP && jmp->targets[0] == block);
+
+    while (block->first != NULL && block->first->op == IR_PHI) {
+        ir_instr_t *phi = block->first;
+        ir_instr_replace_uses(phi, ir_instr_operand(phi, 0));
+        ir_instr_remove(phi);
+    }
+    ir_instr_remove(jmp);
+
+    for (ir_instr_t *instr = block->first; instr != NULL;
+         instr = instr->next) {
+        instr->block = pred;
+    }
+    if (block->first != NULL) {
+        if (pred->last == NULL) {
+            pred->first = block->first;
+        } else {
+            pred->last->next = block->first;
+        }
+        block->first->prev = pred->last;
+        pred->last = block->last;
+    }
+    block->first = NULL;
+    block->last = NULL;
+
+    // pred jumped to block alone, so it is a predecessor of none of the
+    // successors yet.
+    uint32_t succs_size = ir_block_succs_size(pred);
+    for (uint32_t i = 0; i < succs_size; ++i) {
+        ir_block_t *succ = ir_block_succ(pred, i);
+        succ->preds[ir_block_pred_index(succ, block)] = pred;
+    }
+
+    ir_block_remove(block);
+}
+
+void
+ir_block_thread_edge(ir_block_t *block, ir_block_t *pred)
+{
+    ir_instr_t *jmp = ir_block_terminator(block);
+    assert(jmp && jmp == block->first && jmp->op == IR_JMP);
+
+    ir_block_t *target = jmp->targets[0];
+    assert(ir_block_pred_index(target, pred) == UINT32_MAX);
+
+    ir_instr_t *terminator = ir_block_terminator(pred);
+    uint32_t succs_size = ir_block_succs_size(pred);
+    for (uint32_t i = 0; i < succs_size; ++i) {
+        if (terminator->targets[i] == block) {
+            terminator->targets[i] = target;
+        }
+    }
+    ir_block_remove_pred(block, ir_block_pred_index(block, pred));
+
+    uint32_t index = ir_block_pred_index(target, block);
+    ir_block_add_pred(target, pred);
+    for (ir_instr_t *phi = target->first; phi != NULL && phi->op == IR_PHI;
+         phi = phi->next) {
+        ir_phi_add_operand(phi, ir_instr_operand(phi, index));
+    }
+}
+
+ir_block_t *
+ir_block_split_preds(ir_block_t *block,
+                     ir_block_t **preds,
+                     uint32_t preds_size)
+{
+    assert(preds_size > 0);
+    assert(block != block->fn->first);
+
+    ir_function_t *fn = block->fn;
+    ir_block_t *split = ir_block_new(fn);
+    ir_block_move_before(split, block);
+
+    // The operands coming from preds are merged in split first, the new
+    // operand is appended before the edges from preds are dropped.
+    for (ir_instr_t *phi = block->first; phi != NULL && phi->op == IR_PHI;
+         phi = phi->next) {
+        ir_instr_t *value = NULL;
+        if (preds_size == 1) {
+            value = ir_instr_operand(phi,
+                                     ir_block_pred_index(block, preds[0]));
+        } else {
+            value = ir_instr_new(fn, IR_PHI, phi->type, 0);
+            ir_block_append(split, value);
+            for (uint32_t i = 0; i < preds_size; ++i) {
+                ir_phi_add_operand(
+                    value,
+                    ir_instr_operand(phi,
+                                     ir_block_pred_index(block, preds[i])));
+            }
+        }
+        ir_phi_add_operand(phi, value);
+    }
+
+    for (uint32_t i = 0; i < preds_size; ++i) {
+        ir_block_t *pred = preds[i];
+        ir_instr_t *terminator = ir_block_terminator(pred);
+        uint32_t succs_size = ir_block_succs_size(pred);
+        for (uint32_t j = 0; j < succs_size; ++j) {
+            if (terminator->targets[j] == block) {
+                terminator->targets[j] = split;
+            }
+        }
+
+        ir_block_add_pred(split, pred);
+        ir_block_remove_pred(block, ir_block_pred_index(block, pred));
+    }
+
+    ir_block_jmp(split, block);
+    return split;
+}
+
+void
+ir_block_move_before(ir_block_t *block, ir_block_t *pos)
+{
+    assert(block != pos);
+    ir_function_t *fn = block->fn;
+
+    if (block->prev == NULL) {
+        fn->first = block->next;
+    } else {
+        block->prev->next = block->next;
+    }
+    if (block->next == NULL) {
+        fn->last = block->prev;
+    } else {
+        block->next->prev = block->prev;
+    }
+
+    block->prev = pos->prev;
+    block->next = pos;
+    if (pos->prev == NULL) {
+        fn->first = block;
+    } else {
+        pos->prev->next = block;
+    }
+    pos->prev = block;
+}
+
+void
+ir_block_move_to_end(ir_block_t *block)
+{
+    ir_function_t *fn = block->fn;
+    if (fn->last == block) {
+        return;
+    }
+
+    if (block->prev == NULL) {
+        fn->first = block->next;
+    } else {
+        block->prev->next = block->next;
+    }
+    block->next->prev = block->prev;
+
+    block->prev = fn->last;
+    block->next = NULL;
+    fn->last->next = block;
+    fn->last = block;
+}
+
+void
+ir_function_renumber(ir_function_t *fn)
+{
+    uint32_t blocks_size = 0;
+    uint32_t values_size = 0;
+
+    for (ir_block_t *block = fn->first; block != NULL; block = block->next) {
+        block->id = blocks_size++;
+        for (ir_instr_t *instr = block->first; instr != NULL;
+             instr = instr->next) {
+            instr->id = values_size++;
+        }
+    }
+
+    fn->blocks_size = blocks_size;
+    fn->values_size = values_size;
+}
+
+ir_instr_t *
+ir_instr_new(ir_function_t *fn,
+             ir_op_t op,
+             type_t *type,
+             uint32_t operands_size)
+{
+    assert(fn);
+
+    ir_instr_t *instr = (ir_instr_t *)ir_alloc(fn->arena, sizeof(ir_instr_t));
+    memset(instr, 0, sizeof(ir_instr_t));
+    instr->op = op;
+    instr->id = fn->values_size++;
+    instr->type = type;
+
+    if (operands_size != 0) {
+        instr->operands = (ir_use_t *)ir_alloc(
+            fn->arena, operands_size * sizeof(ir_use_t));
+        memset(instr->operands, 0, operands_size * sizeof(ir_use_t));
+        for (uint32_t i = 0; i < operands_size; ++i) {
+            instr->operands[i].user = instr;
+        }
+    }
+    instr->operands_size = operands_size;
+    instr->operands_capacity = operands_size;
+
+    return instr;
+}
+
+ir_instr_t *
+ir_const_new(ir_function_t *fn, type_t *type, uint64_t imm)
+{
+    ir_instr_t *instr = ir_instr_new(fn, IR_CONST, type, 0);
+    instr->imm = ir_wrap(type, imm);
+    return instr;
+}
+
+uint64_t
+ir_wrap(type_t *type, uint64_t imm)
+{
+    if (type->size >= 8) {
+        return imm;
+    }
+    return imm & ((UINT64_C(1) << (type->size * 8)) - 1);
+}
+
+bool
+ir_fold(ir_op_t op,
+        type_t *operand_type,
+        type_t *type,
+        uint64_t lhs,
+        uint64_t rhs,
+        uint64_t *result)
+{
+    uint64_t bits = operand_type->size * 8;
+    uint64_t value;
+
+    switch (op) {
+        case IR_ADD:
+            value = lhs + rhs;
+            break;
+        case IR_SUB:
+            value = lhs - rhs;
+            break;
+        case IR_MUL:
+            value = lhs * rhs;
+            break;
+        case IR_DIV:
+            if (rhs == 0) {
+                return false;
+            }
+            value = lhs / rhs;
+            break;
+        case IR_REM:
+            if (rhs == 0) {
+                return false;
+            }
+            value = lhs % rhs;
+            break;
+        case IR_SHL:
+            value = lhs << (rhs % bits);
+            break;
+        case IR_SHR:
+            value = lhs >> (rhs % bits);
+            break;
+        case IR_XOR:
+            value = lhs ^ rhs;
+            break;
+        case IR_AND:
+            value = lhs & rhs;
+            break;
+        case IR_OR:
+            value = lhs | rhs;
+            break;
+        case IR_EQ:
+            value = lhs == rhs;
+            break;
+        case IR_NE:
+            value = lhs != rhs;
+            break;
+        case IR_LT:
+            value = lhs < rhs;
+            break;
+        case IR_GT:
+            value = lhs > rhs;
+            break;
+        case IR_LE:
+            value = lhs <= rhs;
+            break;
+        case IR_GE:
+            value = lhs >= rhs;
+            break;
+        case IR_NOT:
+            value = ~lhs;
+            break;
+        case IR_ZEXT:
+        case IR_TRUNC:
+            value = lhs;
+            break;
+        default:
+            return false;
+    }
+
+    *result = ir_wrap(type, value);
+    return true;
+}
+
+ir_instr_t *
+ir_instr_operand(ir_instr_t *instr, uint32_t index)
+{
+    assert(index < instr->operands_size);
+    return instr->operands[index].value;
+}
+
+void
+ir_instr_set_operand(ir_instr_t *instr, uint32_t index, ir_instr_t *value)
+{
+    assert(index < instr->operands_size);
+
+    ir_use_t *use = &instr->operands[index];
+    ir_use_unlink(use);
+    if (value != NULL) {
+        ir_use_link(use, value);
+    }
+}
+
+void
+ir_phi_add_operand(ir_instr_t *phi, ir_instr_t *value)
+{
+    assert(phi->op == IR_PHI);
+    assert(phi->block);
+
+    if (phi->operands_size == phi->operands_capacity) {
+        uint32_t capacity =
+            phi->operands_capacity ? phi->operands_capacity * 2 : 2;
+        ir_use_t *operands = (ir_use_t *)ir_alloc(
+            phi->block->fn->arena, capacity * sizeof(ir_use_t));
+
+        // Uses are linked through their addresses, so moving them means
+        // patching their neighbours.
+        for (uint32_t i = 0; i < phi->operands_size; ++i) {
+            ir_use_move(&operands[i], &phi->operands[i]);
+        }
+        phi->operands = operands;
+        phi->operands_capacity = capacity;
+    }
+
+    ir_use_t *use = &phi->operands[phi->operands_size++];
+    memset(use, 0, sizeof(ir_use_t));
+    use->user = phi;
+    ir_use_link(use, value);
+}
+
+void
+ir_instr_remove_operand(ir_instr_t *instr, uint32_t index)
+{
+    assert(index < instr->operands_size);
+
+    ir_use_unlink(&instr->operands[index]);
+    for (uint32_t i = index + 1; i < instr->operands_size; ++i) {
+        ir_use_move(&instr->operands[i - 1], &instr->operands[i]);
+    }
+    --instr->operands_size;
+}
+
+ir_instr_t *
+ir_phi_trivial_value(ir_instr_t *phi)
+{
+    assert(phi->op == IR_PHI);
+
+    ir_instr_t *value = NULL;
+    for (uint32_t i = 0; i < phi->operands_size; ++i) {
+        ir_instr_t *operand = ir_instr_operand(phi, i);
+        if (operand == phi || operand == value) {
+            continue;
+        }
+        if (value != NULL) {
+            return NULL;
+        }
+        value = operand;
+    }
+    return value;
+}
+
+void
+ir_instr_replace_uses(ir_instr_t *instr, ir_instr_t *value)
+{
+    assert(instr != value);
+
+    while (instr->uses != NULL) {
+        ir_use_t *use = instr->uses;
+        ir_use_unlink(use);
+        ir_use_link(use, value);
+    }
+}
+
+bool
+ir_instr_has_uses(ir_instr_t *instr)
+{
+    return instr->uses != NULL;
+}
+
+void
+ir_block_append(ir_block_t *block, ir_instr_t *instr)
+{
+    assert(instr->block == NULL);
+
+    instr->block = block;
+    instr->prev = block->last;
+    instr->next = NULL;
+
+    if (block->last == NULL) {
+        block->first = instr;
+    } else {
+        block->last->next = instr;
+    }
+    block->last = instr;
+}
+
+void
+ir_block_prepend(ir_block_t *block, ir_instr_t *instr)
+{
+    if (block->first == NULL) {
+        ir_block_append(block, instr);
+        return;
+    }
+    ir_instr_insert_before(block->first, instr);
+}
+
+void
+ir_instr_insert_before(ir_instr_t *pos, ir_instr_t *instr)
+{
+    assert(pos->block);
+    assert(instr->block == NULL);
+
+    ir_block_t *block = pos->block;
+    instr->block = block;
+    instr->prev = pos->prev;
+    instr->next = pos;
+
+    if (pos->prev == NULL) {
+        block->first = instr;
+    } else {
+        pos->prev->next = instr;
+    }
+    pos->prev = instr;
+}
+
+void
+ir_instr_remove(ir_instr_t *instr)
+{
+    assert(instr->block);
+    assert(!ir_instr_has_uses(instr));
+
+    for (uint32_t i = 0; i < instr->operands_size; ++i) {
+        ir_use_unlink(&instr->operands[i]);
+    }
+
+    ir_block_t *block = instr->block;
+    if (ir_op_is_terminator(instr->op)) {
+        uint32_t succs_size = ir_block_succs_size(block);
+        for (uint32_t i = 0; i < succs_size; ++i) {
+            ir_block_t *succ = ir_block_succ(block, i);
+            ir_block_remove_pred(succ, ir_block_pred_index(succ, block));
+        }
+    }
+
+    ir_instr_unlink(instr);
+}
+
+void
+ir_instr_move_before(ir_instr_t *pos, ir_instr_t *instr)
+{
+    assert(instr->block);
+    assert(!ir_op_is_terminator(instr->op));
+
+    ir_instr_unlink(instr);
+    ir_instr_insert_before(pos, instr);
+}
+
+static void
+ir_instr_unlink(ir_instr_t *instr)
+{
+    ir_block_t *block = instr->block;
+    if (instr->prev == NULL) {
+        block->first = instr->next;
+    } else {
+        instr->prev->next = instr->next;
+    }
+    if (instr->next == NULL) {
+        block->last = instr->prev;
+    } else {
+        instr->next->prev = instr->prev;
+    }
+
+    instr->block = NULL;
+    instr->prev = NULL;
+    instr->next = NULL;
+}
+
+ir_instr_t *
+ir_block_jmp(ir_block_t *block, ir_block_t *target)
+{
+    ir_instr_t *jmp = ir_instr_new(block->fn, IR_JMP, NULL, 0);
+    jmp->targets[0] = target;
+    ir_block_append(block, jmp);
+
+    ir_block_add_pred(target, block);
+    return jmp;
+}
+
+ir_instr_t *
+ir_block_br(ir_block_t *block,
+            ir_instr_t *cond,
+            ir_block_t *then,
+            ir_block_t *_else)
+{
+    // Each edge is a distinct predecessor, phis could not tell two edges
+    // between the same blocks apart.
+    assert(then != _else);
+
+    ir_instr_t *br = ir_instr_new(block->fn, IR_BR, NULL, 1);
+    ir_instr_set_operand(br, 0, cond);
+    br->targets[0] = then;
+    br->targets[1] = _else;
+    ir_block_append(block, br);
+
+    ir_block_add_pred(then, block);
+    ir_block_add_pred(_else, block);
+    return br;
+}
+
+ir_instr_t *
+ir_block_ret(ir_block_t *block, ir_instr_t *value)
+{
+    ir_instr_t *ret = ir_instr_new(block->fn, IR_RET, NULL, 1);
+    ir_instr_set_operand(ret, 0, value);
+    ir_block_append(block, ret);
+    return ret;
+}
+
+void
+ir_block_fold_br(ir_block_t *block, uint32_t index)
+{
+    ir_instr_t *br = ir_block_terminator(block);
+    assert(br && br->op == IR_BR);
+    assert(index < 2);
+
+    ir_block_t *target = br->targets[index];
+    ir_block_t *dropped = br->targets[1 - index];
+    ir_block_remove_pred(dropped, ir_block_pred_index(dropped, block));
+
+    // The edge to target is kept as is, along with its phi operands.
+    ir_instr_remove_operand(br, 0);
+    br->op = IR_JMP;
+    br->targets[0] = target;
+    br->targets[1] = NULL;
+}
+
+ir_instr_t *
+ir_block_terminator(ir_block_t *block)
+{
+    if (block->last == NULL || !ir_op_is_terminator(block->last->op)) {
+        return NULL;
+    }
+    return block->last;
+}
+
+uint32_t
+ir_block_succs_size(ir_block_t *block)
+{
+    ir_instr_t *terminator = ir_block_terminator(block);
+    if (terminator == NULL) {
+        return 0;
+    }
+
+    switch (terminator->op) {
+        case IR_JMP:
+            return 1;
+        case IR_BR:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+ir_block_t *
+ir_block_succ(ir_block_t *block, uint32_t index)
+{
+    assert(index < ir_block_succs_size(block));
+    return block->last->targets[index];
+}
+
+uint32_t
+ir_block_pred_index(ir_block_t *block, ir_block_t *pred)
+{
+    for (uint32_t i = 0; i < block->preds_size; ++i) {
+        if (block->preds[i] == pred) {
+            return i;
+        }
+    }
+    return UINT32_MAX;
+}
+
+static void
+ir_block_add_pred(ir_block_t *block, ir_block_t *pred)
+{
+    if (block->preds_size == block->preds_capacity) {
+        uint32_t capacity =
+            block->preds_capacity ? block->preds_capacity * 2 : 2;
+        ir_block_t **preds = (ir_block_t **)ir_alloc(
+            block->fn->arena, capacity * sizeof(ir_block_t *));
+        if (block->preds_size != 0) {
+            memcpy(preds, block->preds, block->preds_size * sizeof(*preds));
+        }
+        block->preds = preds;
+        block->preds_capacity = capacity;
+    }
+
+    block->preds[block->preds_size++] = pred;
+}
+
+bool
+ir_op_is_terminator(ir_op_t op)
+{
+    return op == IR_JMP || op == IR_BR || op == IR_RET;
+}
+
+bool
+ir_op_is_binary(ir_op_t op)
+{
+    return op >= IR_ADD && op <= IR_GE;
+}
+
+bool
+ir_op_is_cmp(ir_op_t op)
+{
+    return op >= IR_EQ && op <= IR_GE;
+}
+
+bool
+ir_op_is_commutative(ir_op_t op)
+{
+    switch (op) {
+        case IR_ADD:
+        case IR_MUL:
+        case IR_XOR:
+        case IR_AND:
+        case IR_OR:
+        case IR_EQ:
+        case IR_NE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+const char *
+ir_op_to_cstr(ir_op_t op)
+{
+    static const char *names[] = {
+        [IR_CONST] = "const", [IR_PARAM] = "param", [IR_PHI] = "phi",
+        [IR_ADDR] = "addr",   [IR_ADD] = "add",     [IR_SUB] = "sub",
+        [IR_MUL] = "mul",     [IR_DIV] = "div",     [IR_REM] = "rem",
+        [IR_SHL] = "shl",     [IR_SHR] = "shr",     [IR_XOR] = "xor",
+        [IR_AND] = "and",     [IR_OR] = "or",       [IR_EQ] = "eq",
+        [IR_NE] = "ne",       [IR_LT] = "lt",       [IR_GT] = "gt",
+        [IR_LE] = "le",       [IR_GE] = "ge",       [IR_NOT] = "not",
+        [IR_ZEXT] = "zext",   [IR_TRUNC] = "trunc", [IR_LOAD] = "load",
+        [IR_STORE] = "store", [IR_CALL] = "call",   [IR_JMP] = "jmp",
+        [IR_BR] = "br",       [IR_RET] = "ret",
+    };
+
+    assert(op <= IR_RET);
+    return names[op];
+}
+
+void
+ir_module_dump(ir_module_t *module, FILE *out)
+{
+    for (ir_function_t *fn = module->first; fn != NULL; fn = fn->next) {
+        if (fn != module->first) {
+            fprintf(out, "\n");
+        }
+        ir_function_dump(fn, out);
+    }
+}
+
+void
+ir_function_dump(ir_function_t *fn, FILE *out)
+{
+    fprintf(out,
+            "%sfn " SV_FMT "(",
+            fn->_extern ? "extern " : "",
+            SV_ARG(fn->id->str));
+    for (uint32_t i = 0; i < fn->params_size; ++i) {
+        fprintf(out, "%s" SV_FMT, i ? ", " : "", SV_ARG(fn->params[i]->id));
+    }
+    fprintf(out, "): " SV_FMT, SV_ARG(fn->return_type->id));
+
+    if (fn->_extern) {
+        fprintf(out, "\n");
+        return;
+    }
+    fprintf(out, " {\n");
+
+    for (uint32_t i = 0; i < fn->slots_size; ++i) {
+        fprintf(out, "  slot%u: " SV_FMT "\n", i, SV_ARG(fn->slots[i]->id));
+    }
+
+    for (ir_block_t *block = fn->first; block != NULL; block = block->next) {
+        fprintf(out, "bb%u:", block->id);
+        for (uint32_t i = 0; i < block->preds_size; ++i) {
+            fprintf(out,
+                    "%sbb%u",
+                    i ? ", " : "  ; preds: ",
+                    block->preds[i]->id);
+        }
+        fprintf(out, "\n");
+
+        for (ir_instr_t *instr = block->first; instr != NULL;
+             instr = instr->next) {
+            fprintf(out, "  ");
+            ir_instr_dump(instr, out);
+            fprintf(out, "\n");
+        }
+    }
+
+    fprintf(out, "}\n");
+}
+
+static void
+ir_instr_dump(ir_instr_t *instr, FILE *out)
+{
+    if (instr->type != NULL) {
+        fprintf(out,
+                "%%%u = %s " SV_FMT,
+                instr->id,
+                ir_op_to_cstr(instr->op),
+                SV_ARG(instr->type->id));
+    } else {
+        fprintf(out, "%s", ir_op_to_cstr(instr->op));
+    }
+
+    switch (instr->op) {
+        case IR_CONST: {
+            fprintf(out, " %" PRIu64, instr->imm);
+            return;
+        }
+        case IR_PARAM: {
+            fprintf(out, " %u", instr->index);
+            return;
+        }
+        case IR_ADDR: {
+            fprintf(out, " slot%u", instr->index);
+            return;
+        }
+        case IR_PHI: {
+            ir_block_t *block = instr->block;
+            for (uint32_t i = 0; i < instr->operands_size; ++i) {
+                fprintf(out,
+                        "%s[%%%u, bb%u]",
+                        i ? ", " : " ",
+                        instr->operands[i].value->id,
+                        block->preds[i]->id);
+            }
+            return;
+        }
+        case IR_CALL: {
+            fprintf(out, " " SV_FMT "(", SV_ARG(instr->callee->str));
+            for (uint32_t i = 0; i < instr->operands_size; ++i) {
+                fprintf(out,
+                        "%s%%%u",
+                        i ? ", " : "",
+                        instr->operands[i].value->id);
+            }
+            fprintf(out, ")");
+            return;
+        }
+        case IR_JMP: {
+            fprintf(out, " bb%u", instr->targets[0]->id);
+            return;
+        }
+        case IR_BR: {
+            fprintf(out,
+                    " %%%u, bb%u, bb%u",
+                    instr->operands[0].value->id,
+                    instr->targets[0]->id,
+                    instr->targets[1]->id);
+            return;
+        }
+        default: {
+            for (uint32_t i = 0; i < instr->operands_size; ++i) {
+                fprintf(out,
+                        "%s%%%u",
+                        i ? ", " : " ",
+                        instr->operands[i].value->id);
+            }
+            return;
+        }
+    }
+}
+
+bool
+ir_module_verify(ir_module_t *module)
+{
+    bool ok = true;
+    for (ir_function_t *fn = module->first; fn != NULL; fn = fn->next) {
+        ok = ir_function_verify(fn) && ok;
+    }
+    return ok;
+}
+
+bool
+ir_function_verify(ir_function_t *fn)
+{
+    if (fn->_extern) {
+        return true;
+    }
+
+    if (fn->first == NULL) {
+        ir_verify_error(fn, NULL, NULL, "function has no entry block");
+        return false;
+    }
+
+    if (fn->first->preds_size != 0) {
+        ir_verify_error(fn, fn->first, NULL, "entry block has predecessors");
+        return false;
+    }
+
+    arena_t scratch = arena_new(IR_VERIFY_SCRATCH_ARENA_CAPACITY);
+
+    // Values defined so far in the block being walked, operands defined in
+    // the same block must come before their user.  Whether the definitions
+    // in other blocks dominate their uses is left to the dominator tree.
+    bool *defined = (bool *)ir_alloc(&scratch, fn->values_size + 1);
+    memset(defined, 0, fn->values_size + 1);
+    bool *blocks = (bool *)ir_alloc(&scratch, fn->blocks_size + 1);
+    memset(blocks, 0, fn->blocks_size + 1);
+
+    bool ok = true;
+
+    for (ir_block_t *block = fn->first; block != NULL; block = block->next) {
+        if (block->fn != fn) {
+            ir_verify_error(fn, block, NULL, "block of another function");
+            ok = false;
+        }
+
+        if (block->id >= fn->blocks_size || blocks[block->id]) {
+            ir_verify_error(fn, block, NULL, "duplicated block id");
+            ok = false;
+        } else {
+            blocks[block->id] = true;
+        }
+
+        ir_instr_t *terminator = ir_block_terminator(block);
+        if (terminator == NULL) {
+            ir_verify_error(fn, block, NULL, "block is not terminated");
+            ok = false;
+        }
+
+        bool phis = true;
+        for (ir_instr_t *instr = block->first; instr != NULL;
+             instr = instr->next) {
+            if (instr->block != block ||
+                (instr->next != NULL && instr->next->prev != instr) ||
+                (instr->next == NULL && block->last != instr)) {
+                ir_verify_error(fn, block, instr, "broken instruction list");
+                ok = false;
+                break;
+            }
+
+            if (ir_op_is_terminator(instr->op) && instr != terminator) {
+                ir_verify_error(
+                    fn, block, instr, "terminator in the middle of a block");
+                ok = false;
+            }
+
+            if (instr->op == IR_PHI) {
+                if (!phis) {
+                    ir_verify_error(
+                        fn, block, instr, "phi after a non-phi instruction");
+                    ok = false;
+                }
+                if (instr->operands_size != block->preds_size) {
+                    ir_verify_error(fn,
+                                    block,
+                                    instr,
+                                    "phi has %u operands for %u predecessors",
+                                    instr->operands_size,
+                                    block->preds_size);
+                    ok = false;
+                }
+            } else {
+                phis = false;
+            }
+
+            if (instr->op == IR_PARAM &&
+                (block != fn->first ||
+                 (instr->prev != NULL && instr->prev->op != IR_PARAM))) {
+                ir_verify_error(fn,
+                                block,
+                                instr,
+                                "param not at the start of the entry block");
+                ok = false;
+            }
+
+            if (instr->id >= fn->values_size || defined[instr->id]) {
+                ir_verify_error(fn, block, instr, "duplicated value id");
+                ok = false;
+                continue;
+            }
+
+            // Phis read their operands at the end of the predecessors, so
+            // they may refer to values defined further down this block.
+            if (instr->op != IR_PHI) {
+                for (uint32_t i = 0; i < instr->operands_size; ++i) {
+                    ir_instr_t *value = instr->operands[i].value;
+                    if (value != NULL && value->block == block &&
+                        !defined[value->id]) {
+                        ir_verify_error(fn,
+                                        block,
+                                        instr,
+                                        "%%%u used before its definition",
+                                        value->id);
+                        ok = false;
+                    }
+                }
+            }
+
+            ok = ir_verify_instr(fn, instr) && ok;
+            defined[instr->id] = true;
+        }
+
+        // Edges must be recorded on both ends.
+        uint32_t succs_size = ir_block_succs_size(block);
+        for (uint32_t i = 0; i < succs_size; ++i) {
+            ir_block_t *succ = ir_block_succ(block, i);
+            if (succ->fn != fn) {
+                ir_verify_error(fn, block, terminator, "target out of fn");
+                ok = false;
+                continue;
+            }
+
+            uint32_t count = 0;
+            for (uint32_t j = 0; j < succ->preds_size; ++j) {
+                count += succ->preds[j] == block;
+            }
+            if (count != 1) {
+                ir_verify_error(fn,
+                                block,
+                                terminator,
+                                "edge to bb%u recorded %u times",
+                                succ->id,
+                                count);
+                ok = false;
+            }
+        }
+
+        for (uint32_t i = 0; i < block->preds_size; ++i) {
+            ir_block_t *pred = block->preds[i];
+            bool found = false;
+            uint32_t pred_succs_size = ir_block_succs_size(pred);
+            for (uint32_t j = 0; j < pred_succs_size; ++j) {
+                found = found || ir_block_succ(pred, j) == block;
+            }
+            if (!found) {
+                ir_verify_error(fn,
+                                block,
+                                NULL,
+                                "predecessor bb%u does not branch here",
+                                pred->id);
+                ok = false;
+            }
+        }
+
+        // Clears the values of this block for the next one.
+        for (ir_instr_t *instr = block->first; instr != NULL;
+             instr = instr->next) {
+            if (instr->id < fn->values_size) {
+                defined[instr->id] = false;
+            }
+        }
+    }
+
+    arena_free(&scratch);
+
+    // The analyses rely on a well formed function.
+    return ok && ir_verify_dominance(fn);
+}
+
+/**
+ * Checks the use lists and the operand and result types of instr.
+ */
+static bool
+ir_verify_instr(ir_function_t *fn, ir_instr_t *instr)
+{
+    ir_block_t *block = instr->block;
+    bool ok = true;
+
+    for (uint32_t i = 0; i < instr->operands_size; ++i) {
+        ir_use_t *use = &instr->operands[i];
+        ir_instr_t *value = use->value;
+
+        if (value == NULL) {
+            ir_verify_error(fn, block, instr, "operand %u is unset", i);
+            return false;
+        }
+        if (use->user != instr || *use->pprev != use) {
+            ir_verify_error(fn, block, instr, "broken use of %%%u", value->id);
+            return false;
+        }
+        if (value->block == NULL || value->block->fn != fn) {
+            ir_verify_error(
+                fn, block, instr, "%%%u is not in the function", value->id);
+            return false;
+        }
+        if (value->type == NULL) {
+            ir_verify_error(
+                fn, block, instr, "%%%u does not produce a value", value->id);
+            return false;
+        }
+    }
+
+    for (ir_use_t *use = instr->uses; use != NULL; use = use->next) {
+        if (use->value != instr || use->user->block == NULL) {
+            ir_verify_error(fn, block, instr, "broken use list");
+            return false;
+        }
+    }
+
+    bool has_type = instr->type != NULL;
+    uint32_t size = has_type ? instr->type->size : 0;
+    ir_instr_t *lhs = instr->operands_size > 0 ? instr->operands[0].value : 0;
+    ir_instr_t *rhs = instr->operands_size > 1 ? instr->operands[1].value : 0;
+
+    switch (instr->op) {
+        case IR_CONST: {
+            ok = has_type && instr->operands_size == 0 &&
+                 (size >= 8 || instr->imm < (UINT64_C(1) << (size * 8)));
+            break;
+        }
+        case IR_PARAM: {
+            ok = instr->operands_size == 0 && instr->index < fn->params_size &&
+                 instr->type == fn->params[instr->index];
+            break;
+        }
+        case IR_ADDR: {
+            ok = has_type && instr->operands_size == 0 &&
+                 instr->index < fn->slots_size &&
+                 instr->type->kind == TYPE_PTR &&
+                 instr->type->as_ptr.type == fn->slots[instr->index];
+            break;
+        }
+        case IR_PHI: {
+            ok = has_type;
+            for (uint32_t i = 0; ok && i < instr->operands_size; ++i) {
+                ok = instr->operands[i].value->type->size == size;
+            }
+            break;
+        }
+        case IR_EQ:
+        case IR_NE:
+        case IR_LT:
+        case IR_GT:
+        case IR_LE:
+        case IR_GE: {
+            ok = has_type && instr->operands_size == 2 &&
+                 lhs->type->size == rhs->type->size;
+            break;
+        }
+        case IR_NOT: {
+            ok = has_type && instr->operands_size == 1 &&
+                 lhs->type->size == size;
+            break;
+        }
+        case IR_ZEXT: {
+            ok = has_type && instr->operands_size == 1 &&
+                 lhs->type->size < size;
+            break;
+        }
+        case IR_TRUNC: {
+            ok = has_type && instr->operands_size == 1 &&
+                 lhs->type->size > size;
+            break;
+        }
+        case IR_LOAD: {
+            ok = has_type && instr->operands_size == 1 &&
+                 lhs->type->kind == TYPE_PTR &&
+                 lhs->type->as_ptr.type->size == size;
+            break;
+        }
+        case IR_STORE: {
+            ok = !has_type && instr->operands_size == 2 &&
+                 lhs->type->kind == TYPE_PTR &&
+                 lhs->type->as_ptr.type->size == rhs->type->size;
+            break;
+        }
+        case IR_CALL: {
+            ok = has_type && instr->callee != NULL;
+            break;
+        }
+        case IR_JMP: {
+            ok = !has_type && instr->operands_size == 0 &&
+                 instr->targets[0] != NULL;
+            break;
+        }
+        case IR_BR: {
+            ok = !has_type && instr->operands_size == 1 &&
+                 instr->targets[0] != NULL && instr->targets[1] != NULL &&
+                 instr->targets[0] != instr->targets[1];
+            break;
+        }
+        case IR_RET: {
+            ok = !has_type && instr->operands_size == 1 &&
+                 lhs->type->size == fn->return_type->size;
+            break;
+        }
+        default: {
+            assert(ir_op_is_binary(instr->op));
+            ok = has_type && instr->operands_size == 2 &&
+                 lhs->type->size == size && rhs->type->size == size;
+            break;
+        }
+    }
+
+    if (!ok) {
+        ir_verify_error(fn,
+                        block,
+                        instr,
+                        "malformed %s instruction",
+                        ir_op_to_cstr(instr->op));
+    }
+    return ok;
+}
+
+static void
+ir_verify_error(ir_function_t *fn,
+                ir_block_t *block,
+                ir_instr_t *instr,
+                const char *fmt,
+                ...)
+{
+    fprintf(stderr, "ir: fn " SV_FMT ":", SV_ARG(fn->id->str));
+    if (block != NULL) {
+        fprintf(stderr, " bb%u:", block->id);
+    }
+    if (instr != NULL) {
+        fprintf(stderr, " %%%u:", instr->id);
+    }
+    fprintf(stderr, " error: ");
+
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+
+    fprintf(stderr, "\n");
+}
+
+static void *
+ir_alloc(arena_t *arena, size_t size)
+{
+    void *ptr = arena_alloc(arena, size);
+    if (ptr == NULL) {
+        fprintf(stderr,
+                "[FATAL] Out of memory: ir_alloc: %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+static void
+ir_use_link(ir_use_t *use, ir_instr_t *value)
+{
+    use->value = value;
+    use->next = value->uses;
+    use->pprev = &value->uses;
+    if (value->uses != NULL) {
+        value->uses->pprev = &use->next;
+    }
+    value->uses = use;
+}
+
+static void
+ir_use_unlink(ir_use_t *use)
+{
+    if (use->value == NULL) {
+        return;
+    }
+
+    *use->pprev = use->next;
+    if (use->next != NULL) {
+        use->next->pprev = use->pprev;
+    }
+    use->value = NULL;
+    use->next = NULL;
+    use->pprev = NULL;
+}
+
+/**
+ * Moves the use at src to dst, relinking it in the use list of its value.
+ */
+static void
+ir_use_move(ir_use_t *dst, ir_use_t *src)
+{
+    *dst = *src;
+    if (dst->value == NULL) {
+        return;
+    }
+
+    *dst->pprev = dst;
+    if (dst->next != NULL) {
+        dst->next->pprev = &dst->next;
+    }
+}
+
+/**
+ * Checks that the definition of every operand dominates its use.  Code that
+ * cannot be reached is left alone, as well as the phi operands coming from
+ * it.
+ */
+static bool
+ir_verify_dominance(ir_function_t *fn)
+{
+    ir_analysis_t analysis;
+    ir_analysis_init(&analysis, fn);
+    const ir_cfg_t *cfg = ir_analysis_cfg(&analysis);
+    const ir_dom_tree_t *dom_tree = ir_analysis_dom_tree(&analysis);
+    bool ok = true;
+
+    for (uint32_t i = 0; i < cfg->rpo_size; ++i) {
+        ir_block_t *block = cfg->rpo[i];
+        for (ir_instr_t *instr = block->first; instr != NULL;
+             instr = instr->next) {
+            for (uint32_t j = 0; j < instr->operands_size; ++j) {
+                ir_instr_t *value = ir_instr_operand(instr, j);
+                if (instr->op == IR_PHI &&
+                    !ir_cfg_reachable(cfg, block->preds[j])) {
+                    continue;
+                }
+
+                if (!ir_cfg_reachable(cfg, value->block) ||
+                    !ir_dom_tree_dominates_use(dom_tree, value, instr, j)) {
+                    ir_verify_error(fn,
+                                    block,
+                                    instr,
+                                    "%%%u does not dominate its use",
+                                    value->id);
+                    ok = false;
+                }
+            }
+        }
+    }
+
+    ir_analysis_free(&analysis);
+    return ok;
+}
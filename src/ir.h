@@ -0,0 +1,435 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef IR_H
+#define IR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "arena.h"
+#include "interner.h"
+#include "type.h"
+
+/**
+ * Linear SSA intermediate representation sitting between the checked AST and
+ * the backends.  A function is a list of basic blocks, each a list of
+ * instructions ending in exactly one terminator.  Every instruction with a
+ * type produces a value, which is defined once and used by the instructions
+ * taking it as an operand.
+ *
+ * A value of type T always holds an integer in [0, 2^(8 * T->size)),
+ * arithmetic wraps around at the width of its type and shift counts are
+ * taken modulo that width.  Comparisons are unsigned.
+ */
+typedef enum ir_op
+{
+    // Leaves.
+    IR_CONST,
+    IR_PARAM,
+    IR_PHI,
+    IR_ADDR,
+
+    // Arithmetic, both operands and the result share a width.
+    IR_ADD,
+    IR_SUB,
+    IR_MUL,
+    IR_DIV,
+    IR_REM,
+    IR_SHL,
+    IR_SHR,
+    IR_XOR,
+    IR_AND,
+    IR_OR,
+
+    // Comparisons, both operands share a width, the result is 0 or 1.
+    IR_EQ,
+    IR_NE,
+    IR_LT,
+    IR_GT,
+    IR_LE,
+    IR_GE,
+
+    IR_NOT,
+    IR_ZEXT,
+    IR_TRUNC,
+
+    IR_LOAD,
+    IR_STORE,
+    IR_CALL,
+
+    // Terminators.
+    IR_JMP,
+    IR_BR,
+    IR_RET
+} ir_op_t;
+
+typedef struct ir_instr ir_instr_t;
+typedef struct ir_block ir_block_t;
+typedef struct ir_function ir_function_t;
+
+/**
+ * An operand of user referring to value.  The uses of a value form a doubly
+ * linked list threaded through the operands of its users, so replacing a
+ * value or dropping an operand never scans the function.
+ */
+typedef struct ir_use
+{
+    ir_instr_t *value;
+    ir_instr_t *user;
+    struct ir_use *next;
+    struct ir_use **pprev;
+} ir_use_t;
+
+struct ir_instr
+{
+    ir_op_t op;
+    // Unique within the function, printed as %id.
+    uint32_t id;
+    // Type of the value produced, NULL for stores and terminators.
+    type_t *type;
+    // NULL once removed from its block.
+    ir_block_t *block;
+    ir_instr_t *prev;
+    ir_instr_t *next;
+    ir_use_t *operands;
+    uint32_t operands_size;
+    uint32_t operands_capacity;
+    // First use of this value.
+    ir_use_t *uses;
+    union
+    {
+        // IR_CONST.
+        uint64_t imm;
+        // IR_PARAM parameter index, IR_ADDR memory slot.
+        uint32_t index;
+        // IR_CALL.
+        atom_t *callee;
+        // IR_JMP target, IR_BR targets when the condition is nonzero and
+        // when it is zero.
+        ir_block_t *targets[2];
+    };
+};
+
+struct ir_block
+{
+    // Unique within the function, printed as bb<id>.
+    uint32_t id;
+    ir_function_t *fn;
+    ir_instr_t *first;
+    ir_instr_t *last;
+    // One entry per incoming edge, phi operands are in the same order.  The
+    // successors are the targets of the terminator.
+    ir_block_t **preds;
+    uint32_t preds_size;
+    uint32_t preds_capacity;
+    ir_block_t *prev;
+    ir_block_t *next;
+};
+
+struct ir_function
+{
+    arena_t *arena;
+    atom_t *id;
+    type_t *return_type;
+    type_t **params;
+    uint32_t params_size;
+    // Types of the memory slots holding the locals whose address is taken,
+    // every other local lives in SSA values.
+    type_t **slots;
+    uint32_t slots_size;
+    uint32_t slots_capacity;
+    // The first block is the entry.
+    ir_block_t *first;
+    ir_block_t *last;
+    // Ids handed out so far, an upper bound for tables indexed by id.
+    uint32_t blocks_size;
+    uint32_t values_size;
+    bool _extern;
+    ir_function_t *next;
+};
+
+typedef struct ir_module
+{
+    arena_t *arena;
+    ir_function_t *first;
+    ir_function_t *last;
+} ir_module_t;
+
+ir_module_t *
+ir_module_new(arena_t *arena);
+
+ir_function_t *
+ir_function_new(ir_module_t *module,
+                atom_t *id,
+                type_t *return_type,
+                uint32_t params_size);
+
+uint32_t
+ir_function_add_slot(ir_function_t *fn, type_t *type);
+
+/**
+ * Flags in escaped, indexed by slot, the slots of fn whose address is used
+ * other than as the pointer of a load or a store: passed to a call, stored
+ * to memory, merged by a phi.  Any other slot is only ever accessed by the
+ * loads and stores through its address.
+ */
+void
+ir_function_find_escaped_slots(ir_function_t *fn, bool *escaped);
+
+/**
+ * Appends a new empty block to fn.
+ */
+ir_block_t *
+ir_block_new(ir_function_t *fn);
+
+/**
+ * Unlinks block, which must be unreachable, from its function along with its
+ * instructions and its edges.  Values defined in block must only be used in
+ * it.
+ */
+void
+ir_block_remove(ir_block_t *block);
+
+/**
+ * Drops the index-th incoming edge of block and the matching phi operands.
+ */
+void
+ir_block_remove_pred(ir_block_t *block, uint32_t index);
+
+/**
+ * Removes every block of fn whose id is not flagged in live.  The blocks
+ * removed must not be reachable from the ones kept, their values can only be
+ * used by each other and by the phis along the edges leaving them.  Returns
+ * whether any block was removed.
+ */
+bool
+ir_function_remove_dead_blocks(ir_function_t *fn, const bool *live);
+
+/**
+ * Moves the instructions of block to the end of its only predecessor, which
+ * must end in a jump to it, and removes block.  The phis of block are
+ * replaced by their single operand.
+ */
+void
+ir_block_merge_into_pred(ir_block_t *block);
+
+/**
+ * Redirects the edge from pred to block, which holds nothing but a jump, to
+ * the target of that jump.  The phis of the target take along the new edge
+ * the values they had along the edge from block.  pred must not be a
+ * predecessor of the target already.
+ */
+void
+ir_block_thread_edge(ir_block_t *block, ir_block_t *pred);
+
+/**
+ * Inserts a new block jumping to block, and moves the edges coming from the
+ * preds_size blocks of preds over to it.  The phis of block take the values
+ * along these edges from new phis of the new block, or directly from the
+ * single one.  The new block is placed right before block.
+ */
+ir_block_t *
+ir_block_split_preds(ir_block_t *block,
+                     ir_block_t **preds,
+                     uint32_t preds_size);
+
+/**
+ * Moves block right before pos in the layout of its function.
+ */
+void
+ir_block_move_before(ir_block_t *block, ir_block_t *pos);
+
+/**
+ * Moves block to the end of the layout of its function.
+ */
+void
+ir_block_move_to_end(ir_block_t *block);
+
+/**
+ * Gives the blocks and values of fn dense ids in layout order, any table
+ * indexed by the previous ids is invalidated.
+ */
+void
+ir_function_renumber(ir_function_t *fn);
+
+/**
+ * Creates an instruction not placed in any block yet, with operands_size
+ * operands all unset.
+ */
+ir_instr_t *
+ir_instr_new(ir_function_t *fn,
+             ir_op_t op,
+             type_t *type,
+             uint32_t operands_size);
+
+/**
+ * Creates an unplaced constant of type, imm is wrapped around to its width.
+ */
+ir_instr_t *
+ir_const_new(ir_function_t *fn, type_t *type, uint64_t imm);
+
+/**
+ * imm wrapped around to the width of type.
+ */
+uint64_t
+ir_wrap(type_t *type, uint64_t imm);
+
+/**
+ * Evaluates op, which is binary or one of IR_NOT, IR_ZEXT and IR_TRUNC, over
+ * constant operands of operand_type into a result of type.  rhs is ignored by
+ * the unary operations.  Returns false when there is nothing to fold to, a
+ * division by zero must still trap at runtime.
+ */
+bool
+ir_fold(ir_op_t op,
+        type_t *operand_type,
+        type_t *type,
+        uint64_t lhs,
+        uint64_t rhs,
+        uint64_t *result);
+
+ir_instr_t *
+ir_instr_operand(ir_instr_t *instr, uint32_t index);
+
+void
+ir_instr_set_operand(ir_instr_t *instr, uint32_t index, ir_instr_t *value);
+
+/**
+ * Appends value as a new operand of phi, for a newly added predecessor.  phi
+ * must already be placed in its block.
+ */
+void
+ir_phi_add_operand(ir_instr_t *phi, ir_instr_t *value);
+
+/**
+ * Drops the index-th operand of instr, the ones after it shift down.
+ */
+void
+ir_instr_remove_operand(ir_instr_t *instr, uint32_t index);
+
+/**
+ * The value phi always takes when its operands are only that value and phi
+ * itself, NULL when it merges different values.
+ */
+ir_instr_t *
+ir_phi_trivial_value(ir_instr_t *phi);
+
+/**
+ * Makes every user of instr use value instead.
+ */
+void
+ir_instr_replace_uses(ir_instr_t *instr, ir_instr_t *value);
+
+bool
+ir_instr_has_uses(ir_instr_t *instr);
+
+void
+ir_block_append(ir_block_t *block, ir_instr_t *instr);
+
+void
+ir_block_prepend(ir_block_t *block, ir_instr_t *instr);
+
+void
+ir_instr_insert_before(ir_instr_t *pos, ir_instr_t *instr);
+
+/**
+ * Unlinks instr from its block and drops its operands.  instr must be unused.
+ * Removing a terminator also drops the edges to its successors.
+ */
+void
+ir_instr_remove(ir_instr_t *instr);
+
+/**
+ * Moves instr right before pos, keeping its operands and its uses.
+ */
+void
+ir_instr_move_before(ir_instr_t *pos, ir_instr_t *instr);
+
+/**
+ * Terminators are built through these, which also record the new edges in
+ * the predecessors of the targets.
+ */
+ir_instr_t *
+ir_block_jmp(ir_block_t *block, ir_block_t *target);
+
+ir_instr_t *
+ir_block_br(ir_block_t *block,
+            ir_instr_t *cond,
+            ir_block_t *then,
+            ir_block_t *_else);
+
+ir_instr_t *
+ir_block_ret(ir_block_t *block, ir_instr_t *value);
+
+/**
+ * Turns the branch ending block into a jump to its index-th target, the edge
+ * to the other target is dropped.
+ */
+void
+ir_block_fold_br(ir_block_t *block, uint32_t index);
+
+/**
+ * The terminator of block, NULL while it is still open.
+ */
+ir_instr_t *
+ir_block_terminator(ir_block_t *block);
+
+uint32_t
+ir_block_succs_size(ir_block_t *block);
+
+ir_block_t *
+ir_block_succ(ir_block_t *block, uint32_t index);
+
+/**
+ * Index of pred among the predecessors of block, or UINT32_MAX.
+ */
+uint32_t
+ir_block_pred_index(ir_block_t *block, ir_block_t *pred);
+
+bool
+ir_op_is_terminator(ir_op_t op);
+
+bool
+ir_op_is_binary(ir_op_t op);
+
+bool
+ir_op_is_cmp(ir_op_t op);
+
+bool
+ir_op_is_commutative(ir_op_t op);
+
+const char *
+ir_op_to_cstr(ir_op_t op);
+
+void
+ir_module_dump(ir_module_t *module, FILE *out);
+
+void
+ir_function_dump(ir_function_t *fn, FILE *out);
+
+/**
+ * Checks the structural invariants of fn, reporting every violation found to
+ * stderr.  Returns whether fn is well formed.
+ */
+bool
+ir_function_verify(ir_function_t *fn);
+
+bool
+ir_module_verify(ir_module_t *module);
+
+#endif /* IR_H */
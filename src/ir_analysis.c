@@ -0,0 +1,717 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ir_analysis.h"
+
+#define IR_ANALYSIS_ARENA_CAPACITY (1024 * 4)
+
+static void *
+ir_analysis_alloc(arena_t *arena, size_t size);
+
+static void
+ir_analysis_compute_cfg(ir_analysis_t *analysis);
+
+static void
+ir_analysis_compute_dom_tree(ir_analysis_t *analysis);
+
+static void
+ir_analysis_compute_loops(ir_analysis_t *analysis);
+
+static void
+ir_analysis_compute_liveness(ir_analysis_t *analysis);
+
+static ir_block_t *
+ir_dom_tree_intersect(const ir_cfg_t *cfg,
+                      ir_block_t **idoms,
+                      ir_block_t *a,
+                      ir_block_t *b);
+
+static ir_loop_t *
+ir_loop_outermost(ir_loop_t *loop);
+
+void
+ir_analysis_init(ir_analysis_t *analysis, ir_function_t *fn)
+{
+    assert(analysis);
+    assert(fn && !fn->_extern);
+
+    analysis->fn = fn;
+    analysis->valid = 0;
+    analysis->cfg_arena = arena_new(IR_ANALYSIS_ARENA_CAPACITY);
+    analysis->dom_tree_arena = arena_new(IR_ANALYSIS_ARENA_CAPACITY);
+    analysis->loops_arena = arena_new(IR_ANALYSIS_ARENA_CAPACITY);
+    analysis->liveness_arena = arena_new(IR_ANALYSIS_ARENA_CAPACITY);
+    analysis->scratch = arena_new(IR_ANALYSIS_ARENA_CAPACITY);
+}
+
+void
+ir_analysis_free(ir_analysis_t *analysis)
+{
+    arena_free(&analysis->cfg_arena);
+    arena_free(&analysis->dom_tree_arena);
+    arena_free(&analysis->loops_arena);
+    arena_free(&analysis->liveness_arena);
+    arena_free(&analysis->scratch);
+    analysis->valid = 0;
+}
+
+void
+ir_analysis_invalidate(ir_analysis_t *analysis, uint32_t kinds)
+{
+    if (kinds & IR_ANALYSIS_CFG) {
+        kinds |= IR_ANALYSIS_ALL;
+    }
+    if (kinds & IR_ANALYSIS_DOM_TREE) {
+        kinds |= IR_ANALYSIS_LOOPS;
+    }
+    kinds &= analysis->valid;
+
+    if (kinds & IR_ANALYSIS_CFG) {
+        arena_release(&analysis->cfg_arena);
+    }
+    if (kinds & IR_ANALYSIS_DOM_TREE) {
+        arena_release(&analysis->dom_tree_arena);
+    }
+    if (kinds & IR_ANALYSIS_LOOPS) {
+        arena_release(&analysis->loops_arena);
+    }
+    if (kinds & IR_ANALYSIS_LIVENESS) {
+        arena_release(&analysis->liveness_arena);
+    }
+
+    analysis->valid &= ~kinds;
+}
+
+const ir_cfg_t *
+ir_analysis_cfg(ir_analysis_t *analysis)
+{
+    if (!(analysis->valid & IR_ANALYSIS_CFG)) {
+        ir_analysis_compute_cfg(analysis);
+        analysis->valid |= IR_ANALYSIS_CFG;
+    }
+    // Blocks added since would be missing from every table.
+    assert(analysis->cfg.blocks_size == analysis->fn->blocks_size);
+    return &analysis->cfg;
+}
+
+const ir_dom_tree_t *
+ir_analysis_dom_tree(ir_analysis_t *analysis)
+{
+    if (!(analysis->valid & IR_ANALYSIS_DOM_TREE)) {
+        ir_analysis_compute_dom_tree(analysis);
+        analysis->valid |= IR_ANALYSIS_DOM_TREE;
+    }
+    return &analysis->dom_tree;
+}
+
+const ir_loop_forest_t *
+ir_analysis_loops(ir_analysis_t *analysis)
+{
+    if (!(analysis->valid & IR_ANALYSIS_LOOPS)) {
+        ir_analysis_compute_loops(analysis);
+        analysis->valid |= IR_ANALYSIS_LOOPS;
+    }
+    return &analysis->loops;
+}
+
+const ir_liveness_t *
+ir_analysis_liveness(ir_analysis_t *analysis)
+{
+    if (!(analysis->valid & IR_ANALYSIS_LIVENESS)) {
+        ir_analysis_compute_liveness(analysis);
+        analysis->valid |= IR_ANALYSIS_LIVENESS;
+    }
+    return &analysis->liveness;
+}
+
+bool
+ir_cfg_reachable(const ir_cfg_t *cfg, ir_block_t *block)
+{
+    assert(block->id < cfg->blocks_size);
+    return cfg->rpo_index[block->id] != UINT32_MAX;
+}
+
+bool
+ir_dom_tree_dominates(const ir_dom_tree_t *dom_tree,
+                      ir_block_t *a,
+                      ir_block_t *b)
+{
+    const ir_dom_node_t *node_a = &dom_tree->nodes[a->id];
+    const ir_dom_node_t *node_b = &dom_tree->nodes[b->id];
+
+    return node_a->pre <= node_b->pre && node_b->post <= node_a->post;
+}
+
+bool
+ir_dom_tree_dominates_use(const ir_dom_tree_t *dom_tree,
+                          ir_instr_t *value,
+                          ir_instr_t *user,
+                          uint32_t index)
+{
+    if (user->op == IR_PHI) {
+        return ir_dom_tree_dominates(
+            dom_tree, value->block, user->block->preds[index]);
+    }
+
+    if (value->block != user->block) {
+        return ir_dom_tree_dominates(dom_tree, value->block, user->block);
+    }
+
+    for (ir_instr_t *instr = value->next; instr != NULL; instr = instr->next) {
+        if (instr == user) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+ir_loop_contains(const ir_loop_forest_t *loops,
+                 ir_loop_t *loop,
+                 ir_block_t *block)
+{
+    for (ir_loop_t *it = loops->innermost[block->id]; it != NULL;
+         it = it->parent) {
+        if (it == loop) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t
+ir_loop_depth(const ir_loop_forest_t *loops, ir_block_t *block)
+{
+    ir_loop_t *loop = loops->innermost[block->id];
+    return loop == NULL ? 0 : loop->depth;
+}
+
+bool
+ir_liveness_live_in(const ir_liveness_t *liveness,
+                    ir_block_t *block,
+                    ir_instr_t *value)
+{
+    assert(value->id < liveness->values_size);
+
+    uint64_t *set = liveness->live_in + (size_t)block->id * liveness->words;
+    return (set[value->id / 64] >> (value->id % 64)) & 1;
+}
+
+bool
+ir_liveness_live_out(const ir_liveness_t *liveness,
+                     ir_block_t *block,
+                     ir_instr_t *value)
+{
+    assert(value->id < liveness->values_size);
+
+    uint64_t *set = liveness->live_out + (size_t)block->id * liveness->words;
+    return (set[value->id / 64] >> (value->id % 64)) & 1;
+}
+
+/**
+ * Numbers the blocks in postorder with an explicit stack, so deeply nested
+ * control flow cannot overflow the native one.
+ */
+static void
+ir_analysis_compute_cfg(ir_analysis_t *analysis)
+{
+    ir_function_t *fn = analysis->fn;
+    ir_cfg_t *cfg = &analysis->cfg;
+    uint32_t blocks_size = fn->blocks_size;
+    arena_temp_t temp = arena_temp_begin(&analysis->scratch);
+
+    cfg->blocks_size = blocks_size;
+    cfg->rpo = (ir_block_t **)ir_analysis_alloc(
+        &analysis->cfg_arena, blocks_size * sizeof(ir_block_t *));
+    cfg->rpo_index = (uint32_t *)ir_analysis_alloc(
+        &analysis->cfg_arena, blocks_size * sizeof(uint32_t));
+    memset(cfg->rpo_index, 0xff, blocks_size * sizeof(uint32_t));
+
+    bool *visited = (bool *)ir_analysis_alloc(&analysis->scratch, blocks_size);
+    memset(visited, 0, blocks_size);
+    // Blocks being walked and the index of their next successor.
+    ir_block_t **stack = (ir_block_t **)ir_analysis_alloc(
+        &analysis->scratch, blocks_size * sizeof(ir_block_t *));
+    uint32_t *next_succ = (uint32_t *)ir_analysis_alloc(
+        &analysis->scratch, blocks_size * sizeof(uint32_t));
+    uint32_t stack_size = 0;
+    uint32_t rpo_size = 0;
+
+    visited[fn->first->id] = true;
+    stack[stack_size] = fn->first;
+    next_succ[stack_size++] = 0;
+
+    while (stack_size > 0) {
+        ir_block_t *block = stack[stack_size - 1];
+        uint32_t index = next_succ[stack_size - 1];
+
+        if (index < ir_block_succs_size(block)) {
+            ir_block_t *succ = ir_block_succ(block, index);
+            next_succ[stack_size - 1] = index + 1;
+            if (!visited[succ->id]) {
+                visited[succ->id] = true;
+                stack[stack_size] = succ;
+                next_succ[stack_size++] = 0;
+            }
+            continue;
+        }
+
+        cfg->rpo[rpo_size++] = block;
+        --stack_size;
+    }
+
+    for (uint32_t i = 0; i < rpo_size / 2; ++i) {
+        ir_block_t *block = cfg->rpo[i];
+        cfg->rpo[i] = cfg->rpo[rpo_size - 1 - i];
+        cfg->rpo[rpo_size - 1 - i] = block;
+    }
+    for (uint32_t i = 0; i < rpo_size; ++i) {
+        cfg->rpo_index[cfg->rpo[i]->id] = i;
+    }
+    cfg->rpo_size = rpo_size;
+
+    arena_temp_end(temp);
+}
+
+/**
+ * Finds the immediate dominators with "A Simple, Fast Dominance Algorithm"
+ * (Cooper, Harvey and Kennedy), then the dominance frontiers by walking up
+ * the tree from the predecessors of every join.
+ */
+static void
+ir_analysis_compute_dom_tree(ir_analysis_t *analysis)
+{
+    const ir_cfg_t *cfg = ir_analysis_cfg(analysis);
+    arena_t *arena = &analysis->dom_tree_arena;
+    uint32_t blocks_size = cfg->blocks_size;
+    arena_temp_t temp = arena_temp_begin(&analysis->scratch);
+
+    ir_dom_node_t *nodes = (ir_dom_node_t *)ir_analysis_alloc(
+        arena, blocks_size * sizeof(ir_dom_node_t));
+    memset(nodes, 0, blocks_size * sizeof(ir_dom_node_t));
+    analysis->dom_tree.nodes = nodes;
+
+    // The entry is its own dominator while iterating, so the walks up the
+    // tree stop there.
+    ir_block_t **idoms = (ir_block_t **)ir_analysis_alloc(
+        &analysis->scratch, blocks_size * sizeof(ir_block_t *));
+    memset(idoms, 0, blocks_size * sizeof(ir_block_t *));
+    ir_block_t *entry = cfg->rpo[0];
+    idoms[entry->id] = entry;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uint32_t i = 1; i < cfg->rpo_size; ++i) {
+            ir_block_t *block = cfg->rpo[i];
+            ir_block_t *idom = NULL;
+
+            for (uint32_t j = 0; j < block->preds_size; ++j) {
+                ir_block_t *pred = block->preds[j];
+                if (idoms[pred->id] == NULL) {
+                    continue;
+                }
+                idom = idom == NULL
+                           ? pred
+                           : ir_dom_tree_intersect(cfg, idoms, pred, idom);
+            }
+
+            if (idoms[block->id] != idom) {
+                idoms[block->id] = idom;
+                changed = true;
+            }
+        }
+    }
+
+    // The children of every block are laid out next to each other in a
+    // single array, in reverse postorder.
+    ir_block_t **children = (ir_block_t **)ir_analysis_alloc(
+        arena, cfg->rpo_size * sizeof(ir_block_t *));
+    for (uint32_t i = 1; i < cfg->rpo_size; ++i) {
+        ir_block_t *block = cfg->rpo[i];
+        nodes[block->id].idom = idoms[block->id];
+        nodes[idoms[block->id]->id].children_size++;
+    }
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < cfg->rpo_size; ++i) {
+        ir_dom_node_t *node = &nodes[cfg->rpo[i]->id];
+        node->children = children + offset;
+        offset += node->children_size;
+        node->children_size = 0;
+    }
+    for (uint32_t i = 1; i < cfg->rpo_size; ++i) {
+        ir_dom_node_t *parent = &nodes[idoms[cfg->rpo[i]->id]->id];
+        parent->children[parent->children_size++] = cfg->rpo[i];
+    }
+
+    ir_block_t **stack = (ir_block_t **)ir_analysis_alloc(
+        &analysis->scratch, blocks_size * sizeof(ir_block_t *));
+    uint32_t *next_child = (uint32_t *)ir_analysis_alloc(
+        &analysis->scratch, blocks_size * sizeof(uint32_t));
+    uint32_t stack_size = 0;
+    uint32_t time = 0;
+
+    nodes[entry->id].pre = time++;
+    stack[stack_size] = entry;
+    next_child[stack_size++] = 0;
+
+    while (stack_size > 0) {
+        ir_dom_node_t *node = &nodes[stack[stack_size - 1]->id];
+        uint32_t index = next_child[stack_size - 1];
+
+        if (index < node->children_size) {
+            ir_block_t *child = node->children[index];
+            next_child[stack_size - 1] = index + 1;
+            nodes[child->id].pre = time++;
+            stack[stack_size] = child;
+            next_child[stack_size++] = 0;
+            continue;
+        }
+
+        node->post = time++;
+        --stack_size;
+    }
+
+    // The frontiers are counted first and filled on a second walk, a block
+    // reached from several predecessors is only added once.
+    uint32_t *marks = (uint32_t *)ir_analysis_alloc(
+        &analysis->scratch, blocks_size * sizeof(uint32_t));
+    ir_block_t **frontiers = NULL;
+
+    for (int pass = 0; pass < 2; ++pass) {
+        memset(marks, 0xff, blocks_size * sizeof(uint32_t));
+
+        for (uint32_t i = 1; i < cfg->rpo_size; ++i) {
+            ir_block_t *block = cfg->rpo[i];
+            if (block->preds_size < 2) {
+                continue;
+            }
+
+            for (uint32_t j = 0; j < block->preds_size; ++j) {
+                ir_block_t *runner = block->preds[j];
+                if (!ir_cfg_reachable(cfg, runner)) {
+                    continue;
+                }
+
+                while (runner != idoms[block->id]) {
+                    if (marks[runner->id] != block->id) {
+                        ir_dom_node_t *node = &nodes[runner->id];
+                        marks[runner->id] = block->id;
+                        if (frontiers != NULL) {
+                            node->frontier[node->frontier_size] = block;
+                        }
+                        node->frontier_size++;
+                    }
+                    runner = idoms[runner->id];
+                }
+            }
+        }
+
+        if (frontiers != NULL) {
+            break;
+        }
+
+        offset = 0;
+        for (uint32_t i = 0; i < cfg->rpo_size; ++i) {
+            offset += nodes[cfg->rpo[i]->id].frontier_size;
+        }
+        frontiers = (ir_block_t **)ir_analysis_alloc(
+            arena, offset * sizeof(ir_block_t *));
+
+        offset = 0;
+        for (uint32_t i = 0; i < cfg->rpo_size; ++i) {
+            ir_dom_node_t *node = &nodes[cfg->rpo[i]->id];
+            node->frontier = frontiers + offset;
+            offset += node->frontier_size;
+            node->frontier_size = 0;
+        }
+    }
+
+    arena_temp_end(temp);
+}
+
+/**
+ * Finds the natural loops innermost first, walking the headers in
+ * postorder.  The body of a loop is collected backwards from its latches,
+ * a block already claimed by an inner loop makes that loop a child and the
+ * walk carries on from its header.
+ */
+static void
+ir_analysis_compute_loops(ir_analysis_t *analysis)
+{
+    const ir_cfg_t *cfg = ir_analysis_cfg(analysis);
+    const ir_dom_tree_t *dom_tree = ir_analysis_dom_tree(analysis);
+    ir_loop_forest_t *forest = &analysis->loops;
+    arena_t *arena = &analysis->loops_arena;
+    uint32_t blocks_size = cfg->blocks_size;
+    arena_temp_t temp = arena_temp_begin(&analysis->scratch);
+
+    forest->loops = (ir_loop_t *)ir_analysis_alloc(
+        arena, cfg->rpo_size * sizeof(ir_loop_t));
+    forest->loops_size = 0;
+    forest->innermost = (ir_loop_t **)ir_analysis_alloc(
+        arena, blocks_size * sizeof(ir_loop_t *));
+    memset(forest->innermost, 0, blocks_size * sizeof(ir_loop_t *));
+
+    ir_block_t **worklist = (ir_block_t **)ir_analysis_alloc(
+        &analysis->scratch, blocks_size * sizeof(ir_block_t *));
+    // Index of the last loop which queued every block.
+    uint32_t *queued = (uint32_t *)ir_analysis_alloc(
+        &analysis->scratch, blocks_size * sizeof(uint32_t));
+    memset(queued, 0xff, blocks_size * sizeof(uint32_t));
+
+    for (uint32_t i = cfg->rpo_size; i > 0; --i) {
+        ir_block_t *header = cfg->rpo[i - 1];
+
+        uint32_t latches_size = 0;
+        for (uint32_t j = 0; j < header->preds_size; ++j) {
+            ir_block_t *pred = header->preds[j];
+            latches_size += ir_cfg_reachable(cfg, pred) &&
+                            ir_dom_tree_dominates(dom_tree, header, pred);
+        }
+        if (latches_size == 0) {
+            continue;
+        }
+
+        uint32_t index = forest->loops_size++;
+        ir_loop_t *loop = &forest->loops[index];
+        loop->header = header;
+        loop->parent = NULL;
+        loop->depth = 0;
+        loop->latches = (ir_block_t **)ir_analysis_alloc(
+            arena, latches_size * sizeof(ir_block_t *));
+        loop->latches_size = 0;
+        loop->blocks = NULL;
+        loop->blocks_size = 0;
+
+        forest->innermost[header->id] = loop;
+        queued[header->id] = index;
+        uint32_t worklist_size = 0;
+
+        for (uint32_t j = 0; j < header->preds_size; ++j) {
+            ir_block_t *pred = header->preds[j];
+            if (!ir_cfg_reachable(cfg, pred) ||
+                !ir_dom_tree_dominates(dom_tree, header, pred)) {
+                continue;
+            }
+            loop->latches[loop->latches_size++] = pred;
+            if (queued[pred->id] != index) {
+                queued[pred->id] = index;
+                worklist[worklist_size++] = pred;
+            }
+        }
+
+        while (worklist_size > 0) {
+            ir_block_t *block = worklist[--worklist_size];
+
+            if (forest->innermost[block->id] == NULL) {
+                forest->innermost[block->id] = loop;
+            } else {
+                ir_loop_t *inner =
+                    ir_loop_outermost(forest->innermost[block->id]);
+                if (inner == loop) {
+                    continue;
+                }
+                inner->parent = loop;
+                block = inner->header;
+            }
+
+            for (uint32_t j = 0; j < block->preds_size; ++j) {
+                ir_block_t *pred = block->preds[j];
+                if (ir_cfg_reachable(cfg, pred) && queued[pred->id] != index) {
+                    queued[pred->id] = index;
+                    worklist[worklist_size++] = pred;
+                }
+            }
+        }
+    }
+
+    // Enclosing loops were found after the loops they enclose.
+    for (uint32_t i = forest->loops_size; i > 0; --i) {
+        ir_loop_t *loop = &forest->loops[i - 1];
+        loop->depth = loop->parent == NULL ? 1 : loop->parent->depth + 1;
+    }
+
+    for (int pass = 0; pass < 2; ++pass) {
+        for (uint32_t i = 0; i < cfg->rpo_size; ++i) {
+            ir_block_t *block = cfg->rpo[i];
+            for (ir_loop_t *loop = forest->innermost[block->id]; loop != NULL;
+                 loop = loop->parent) {
+                if (loop->blocks != NULL) {
+                    loop->blocks[loop->blocks_size] = block;
+                }
+                loop->blocks_size++;
+            }
+        }
+
+        if (pass == 1) {
+            break;
+        }
+
+        for (uint32_t i = 0; i < forest->loops_size; ++i) {
+            ir_loop_t *loop = &forest->loops[i];
+            loop->blocks = (ir_block_t **)ir_analysis_alloc(
+                arena, loop->blocks_size * sizeof(ir_block_t *));
+            loop->blocks_size = 0;
+        }
+    }
+
+    arena_temp_end(temp);
+}
+
+/**
+ * Solves the backward data-flow equations over bit sets, visiting the
+ * blocks in postorder so most successors are done before their
+ * predecessors:
+ *
+ *     out(B) = union of in(S) and the phi operands of S coming from B
+ *     in(B)  = uses(B) | (out(B) & ~defs(B))
+ *
+ * Only the values used before being defined in a block are in uses(B), in
+ * SSA that is the operands defined in another block.
+ */
+static void
+ir_analysis_compute_liveness(ir_analysis_t *analysis)
+{
+    const ir_cfg_t *cfg = ir_analysis_cfg(analysis);
+    ir_liveness_t *liveness = &analysis->liveness;
+    arena_t *arena = &analysis->liveness_arena;
+    uint32_t values_size = analysis->fn->values_size;
+    uint32_t words = (values_size + 63) / 64;
+    size_t sets_size = (size_t)cfg->blocks_size * words * sizeof(uint64_t);
+    arena_temp_t temp = arena_temp_begin(&analysis->scratch);
+
+    liveness->words = words;
+    liveness->values_size = values_size;
+    liveness->live_in = (uint64_t *)ir_analysis_alloc(arena, sets_size);
+    liveness->live_out = (uint64_t *)ir_analysis_alloc(arena, sets_size);
+    memset(liveness->live_in, 0, sets_size);
+    memset(liveness->live_out, 0, sets_size);
+
+    uint64_t *uses =
+        (uint64_t *)ir_analysis_alloc(&analysis->scratch, sets_size);
+    uint64_t *defs =
+        (uint64_t *)ir_analysis_alloc(&analysis->scratch, sets_size);
+    memset(uses, 0, sets_size);
+    memset(defs, 0, sets_size);
+
+    for (uint32_t i = 0; i < cfg->rpo_size; ++i) {
+        ir_block_t *block = cfg->rpo[i];
+        uint64_t *block_uses = uses + (size_t)block->id * words;
+        uint64_t *block_defs = defs + (size_t)block->id * words;
+
+        for (ir_instr_t *instr = block->first; instr != NULL;
+             instr = instr->next) {
+            if (instr->op != IR_PHI) {
+                for (uint32_t j = 0; j < instr->operands_size; ++j) {
+                    ir_instr_t *value = ir_instr_operand(instr, j);
+                    if (value->block != block) {
+                        block_uses[value->id / 64] |= 1ull << (value->id % 64);
+                    }
+                }
+            }
+            block_defs[instr->id / 64] |= 1ull << (instr->id % 64);
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        for (uint32_t i = cfg->rpo_size; i > 0; --i) {
+            ir_block_t *block = cfg->rpo[i - 1];
+            uint64_t *out = liveness->live_out + (size_t)block->id * words;
+            uint64_t *in = liveness->live_in + (size_t)block->id * words;
+            uint64_t *block_uses = uses + (size_t)block->id * words;
+            uint64_t *block_defs = defs + (size_t)block->id * words;
+
+            uint32_t succs_size = ir_block_succs_size(block);
+            for (uint32_t j = 0; j < succs_size; ++j) {
+                ir_block_t *succ = ir_block_succ(block, j);
+                uint64_t *succ_in =
+                    liveness->live_in + (size_t)succ->id * words;
+                for (uint32_t w = 0; w < words; ++w) {
+                    out[w] |= succ_in[w];
+                }
+
+                uint32_t index = ir_block_pred_index(succ, block);
+                for (ir_instr_t *phi = succ->first;
+                     phi != NULL && phi->op == IR_PHI;
+                     phi = phi->next) {
+                    ir_instr_t *value = ir_instr_operand(phi, index);
+                    out[value->id / 64] |= 1ull << (value->id % 64);
+                }
+            }
+
+            // The sets only grow, so comparing the live-in sets is enough to
+            // tell the fixed point.
+            for (uint32_t w = 0; w < words; ++w) {
+                uint64_t word = block_uses[w] | (out[w] & ~block_defs[w]);
+                if (word != in[w]) {
+                    in[w] = word;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    arena_temp_end(temp);
+}
+
+static ir_block_t *
+ir_dom_tree_intersect(const ir_cfg_t *cfg,
+                      ir_block_t **idoms,
+                      ir_block_t *a,
+                      ir_block_t *b)
+{
+    while (a != b) {
+        while (cfg->rpo_index[a->id] > cfg->rpo_index[b->id]) {
+            a = idoms[a->id];
+        }
+        while (cfg->rpo_index[b->id] > cfg->rpo_index[a->id]) {
+            b = idoms[b->id];
+        }
+    }
+    return a;
+}
+
+static ir_loop_t *
+ir_loop_outermost(ir_loop_t *loop)
+{
+    while (loop->parent != NULL) {
+        loop = loop->parent;
+    }
+    return loop;
+}
+
+static void *
+ir_analysis_alloc(arena_t *arena, size_t size)
+{
+    void *ptr = arena_alloc(arena, size);
+    if (ptr == NULL) {
+        fprintf(stderr,
+                "[FATAL] Out of memory: ir_analysis_alloc: %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef IR_ANALYSIS_H
+#define IR_ANALYSIS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "ir.h"
+
+/**
+ * Analyses of a function body.  They are computed the first time they are
+ * asked for and cached until the pass changing the function invalidates them,
+ * so the passes of a pipeline share them instead of each walking the blocks
+ * again.  Invalidating an analysis also invalidates the ones built on top of
+ * it: the dominator tree and the loops depend on the CFG, the loops on the
+ * dominator tree and the liveness on the CFG.
+ */
+typedef enum ir_analysis_kind
+{
+    IR_ANALYSIS_CFG = 1 << 0,
+    IR_ANALYSIS_DOM_TREE = 1 << 1,
+    IR_ANALYSIS_LOOPS = 1 << 2,
+    IR_ANALYSIS_LIVENESS = 1 << 3,
+} ir_analysis_kind_t;
+
+#define IR_ANALYSIS_ALL                                                        \
+    (IR_ANALYSIS_CFG | IR_ANALYSIS_DOM_TREE | IR_ANALYSIS_LOOPS |              \
+     IR_ANALYSIS_LIVENESS)
+
+typedef struct ir_cfg
+{
+    // Blocks reachable from the entry in reverse postorder, every block comes
+    // before its successors except along back edges.
+    ir_block_t **rpo;
+    uint32_t rpo_size;
+    // Position of every block in rpo indexed by block id, UINT32_MAX for the
+    // unreachable ones.
+    uint32_t *rpo_index;
+    uint32_t blocks_size;
+} ir_cfg_t;
+
+typedef struct ir_dom_node
+{
+    // NULL for the entry and the unreachable blocks.
+    ir_block_t *idom;
+    // Blocks immediately dominated, in reverse postorder.
+    ir_block_t **children;
+    uint32_t children_size;
+    // Blocks where the dominance of this one ends.
+    ir_block_t **frontier;
+    uint32_t frontier_size;
+    // Entry and exit times of a walk of the tree, a block dominates the
+    // blocks whose interval is nested in its own.
+    uint32_t pre;
+    uint32_t post;
+} ir_dom_node_t;
+
+typedef struct ir_dom_tree
+{
+    // Indexed by block id.
+    ir_dom_node_t *nodes;
+} ir_dom_tree_t;
+
+typedef struct ir_loop ir_loop_t;
+
+/**
+ * Natural loop of the back edges into header, a back edge being one whose
+ * target dominates its source.
+ */
+struct ir_loop
+{
+    ir_block_t *header;
+    // Innermost loop enclosing this one, NULL for an outermost loop.
+    ir_loop_t *parent;
+    // 1 for an outermost loop.
+    uint32_t depth;
+    // Sources of the back edges.
+    ir_block_t **latches;
+    uint32_t latches_size;
+    // Every block of the loop, nested loops included, in reverse postorder,
+    // so the header comes first.
+    ir_block_t **blocks;
+    uint32_t blocks_size;
+};
+
+typedef struct ir_loop_forest
+{
+    // Inner loops come before the loops enclosing them.
+    ir_loop_t *loops;
+    uint32_t loops_size;
+    // Innermost loop of every block indexed by block id, NULL outside loops.
+    ir_loop_t **innermost;
+} ir_loop_forest_t;
+
+/**
+ * Values live on entry and on exit of every block, as bit sets indexed by
+ * value id.  The phis of a block are defined by its incoming edges: they are
+ * not live on its entry and their operands are live on exit of the matching
+ * predecessors.
+ */
+typedef struct ir_liveness
+{
+    uint64_t *live_in;
+    uint64_t *live_out;
+    // Words of a set, the sets of block id b start at b * words.
+    uint32_t words;
+    uint32_t values_size;
+} ir_liveness_t;
+
+typedef struct ir_analysis
+{
+    ir_function_t *fn;
+    // Mask of the ir_analysis_kind_t up to date.
+    uint32_t valid;
+
+    // Every analysis owns an arena, released when it is invalidated so the
+    // next computation reuses its memory.
+    ir_cfg_t cfg;
+    arena_t cfg_arena;
+    ir_dom_tree_t dom_tree;
+    arena_t dom_tree_arena;
+    ir_loop_forest_t loops;
+    arena_t loops_arena;
+    ir_liveness_t liveness;
+    arena_t liveness_arena;
+    // Work lists of the computation in progress.
+    arena_t scratch;
+} ir_analysis_t;
+
+void
+ir_analysis_init(ir_analysis_t *analysis, ir_function_t *fn);
+
+void
+ir_analysis_free(ir_analysis_t *analysis);
+
+/**
+ * Drops the cached results of kinds, a mask of ir_analysis_kind_t, and of
+ * the analyses depending on them.  A pass must invalidate what it changed
+ * before asking for an analysis again: the CFG when it adds, removes or
+ * redirects blocks or edges, the liveness when it adds, removes or rewires
+ * values.
+ */
+void
+ir_analysis_invalidate(ir_analysis_t *analysis, uint32_t kinds);
+
+const ir_cfg_t *
+ir_analysis_cfg(ir_analysis_t *analysis);
+
+const ir_dom_tree_t *
+ir_analysis_dom_tree(ir_analysis_t *analysis);
+
+const ir_loop_forest_t *
+ir_analysis_loops(ir_analysis_t *analysis);
+
+const ir_liveness_t *
+ir_analysis_liveness(ir_analysis_t *analysis);
+
+bool
+ir_cfg_reachable(const ir_cfg_t *cfg, ir_block_t *block);
+
+/**
+ * Whether every path from the entry to b goes through a, a block dominates
+ * itself.  Both blocks must be reachable.
+ */
+bool
+ir_dom_tree_dominates(const ir_dom_tree_t *dom_tree,
+                      ir_block_t *a,
+                      ir_block_t *b);
+
+/**
+ * Whether the definition of value dominates the operand index of user.  The
+ * operands of a phi are used at the end of the matching predecessor.
+ */
+bool
+ir_dom_tree_dominates_use(const ir_dom_tree_t *dom_tree,
+                          ir_instr_t *value,
+                          ir_instr_t *user,
+                          uint32_t index);
+
+bool
+ir_loop_contains(const ir_loop_forest_t *loops,
+                 ir_loop_t *loop,
+                 ir_block_t *block);
+
+/**
+ * Number of loops enclosing block, 0 outside loops.
+ */
+uint32_t
+ir_loop_depth(const ir_loop_forest_t *loops, ir_block_t *block);
+
+bool
+ir_liveness_live_in(const ir_liveness_t *liveness,
+                    ir_block_t *block,
+                    ir_instr_t *value);
+
+bool
+ir_liveness_live_out(const ir_liveness_t *liveness,
+                     ir_block_t *block,
+                     ir_instr_t *value);
+
+#endif
@@ -0,0 +1,1262 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ir_builder.h"
+#include "scope.h"
+
+#define IR_BUILDER_SCRATCH_ARENA_CAPACITY (16 * 1024)
+
+struct ir_builder_phi
+{
+    ir_instr_t *phi;
+    // Slot of the local the phi merges.
+    uint32_t slot;
+    ir_builder_phi_t *next;
+};
+
+struct ir_builder_block
+{
+    // Current definition of every local at the end of the block, allocated
+    // on the first one.
+    ir_instr_t **defs;
+    // Phis placed before all the predecessors were known, completed once the
+    // block is sealed.
+    ir_builder_phi_t *incomplete;
+    bool sealed;
+};
+
+/**
+ * Blocks an if, a while or a logical operation jumps to, kept in the frame of
+ * the statement while its children are lowered.
+ */
+typedef struct ir_builder_branch
+{
+    // The else block of an if, the header of a while or the block the lhs of
+    // a logical operation ends in.
+    ir_block_t *from;
+    // Where the control flow joins again.
+    ir_block_t *end;
+} ir_builder_branch_t;
+
+static bool
+ir_builder_pre(ast_visitor_t *visitor, ast_visit_frame_t *frame);
+
+static bool
+ir_builder_enter_child(ast_visitor_t *visitor, ast_visit_frame_t *frame);
+
+static void
+ir_builder_leave_child(ast_visitor_t *visitor, ast_visit_frame_t *frame);
+
+static void
+ir_builder_post(ast_visitor_t *visitor, ast_visit_frame_t *frame);
+
+static bool
+ir_builder_begin_fn(ir_builder_t *builder, ast_fn_definition_t *fn_def);
+
+static void
+ir_builder_end_fn(ir_builder_t *builder);
+
+static void
+ir_builder_lower_binary_op(ir_builder_t *builder, ast_node_t *node);
+
+static void
+ir_builder_lower_logical_op(ir_builder_t *builder, ast_visit_frame_t *frame);
+
+static ir_block_t *
+ir_builder_new_block(ir_builder_t *builder);
+
+static void
+ir_builder_switch_to(ir_builder_t *builder, ir_block_t *block);
+
+static void
+ir_builder_jump(ir_builder_t *builder, ir_block_t *target);
+
+static ir_builder_branch_t *
+ir_builder_new_branch(ir_builder_t *builder);
+
+static ir_instr_t *
+ir_builder_emit(ir_builder_t *builder,
+                ir_op_t op,
+                type_t *type,
+                ir_instr_t *lhs,
+                ir_instr_t *rhs);
+
+static ir_instr_t *
+ir_builder_const(ir_builder_t *builder, type_t *type, uint64_t imm);
+
+static ir_instr_t *
+ir_builder_convert(ir_builder_t *builder, ir_instr_t *value, type_t *type);
+
+static void
+ir_builder_insert_at_top(ir_block_t *block, ir_instr_t *instr);
+
+static void
+ir_builder_push(ir_builder_t *builder, ir_instr_t *value);
+
+static ir_instr_t *
+ir_builder_pop(ir_builder_t *builder);
+
+static void
+ir_builder_declare(ir_builder_t *builder, symbol_t *symbol);
+
+static void
+ir_builder_assign(ir_builder_t *builder, symbol_t *symbol, ir_instr_t *value);
+
+static ir_instr_t *
+ir_builder_load(ir_builder_t *builder, symbol_t *symbol);
+
+static ir_instr_t *
+ir_builder_addr(ir_builder_t *builder, symbol_t *symbol);
+
+static ir_builder_block_t *
+ir_builder_block_info(ir_builder_t *builder, ir_block_t *block);
+
+static void
+ir_builder_write_var(ir_builder_t *builder,
+                     ir_block_t *block,
+                     uint32_t slot,
+                     ir_instr_t *value);
+
+static ir_instr_t *
+ir_builder_read_var(ir_builder_t *builder, ir_block_t *block, uint32_t slot);
+
+static ir_instr_t *
+ir_builder_lookup_var(ir_builder_t *builder, ir_block_t *block, uint32_t slot);
+
+static ir_instr_t *
+ir_builder_new_phi(ir_builder_t *builder, ir_block_t *block, uint32_t slot);
+
+static ir_instr_t *
+ir_builder_undef(ir_builder_t *builder, ir_block_t *block, type_t *type);
+
+static void
+ir_builder_seal(ir_builder_t *builder, ir_block_t *block);
+
+static void
+ir_builder_complete_phis(ir_builder_t *builder, uint32_t base);
+
+static void
+ir_builder_remove_trivial_phis(ir_builder_t *builder, ir_instr_t *phi);
+
+static ir_instr_t *
+ir_builder_resolve(ir_builder_t *builder, ir_instr_t *value);
+
+static void *
+ir_builder_alloc(ir_builder_t *builder, size_t size);
+
+static void *
+ir_builder_grow(ir_builder_t *builder,
+                void *items,
+                uint32_t size,
+                uint32_t *capacity,
+                uint32_t min_capacity,
+                size_t item_size);
+
+ir_builder_t *
+ir_builder_new(arena_t *arena)
+{
+    assert(arena);
+
+    ir_builder_t *builder =
+        (ir_builder_t *)arena_alloc(arena, sizeof(ir_builder_t));
+    if (builder == NULL) {
+        fprintf(stderr,
+                "[FATAL] Out of memory: ir_builder_new: %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    memset(builder, 0, sizeof(ir_builder_t));
+    builder->arena = arena;
+
+    return builder;
+}
+
+ir_module_t *
+ir_builder_build(ir_builder_t *builder, ast_node_t *ast)
+{
+    assert(builder);
+    assert(ast);
+    assert(ast->kind == AST_NODE_TRANSLATION_UNIT);
+
+    builder->scratch = arena_new(IR_BUILDER_SCRATCH_ARENA_CAPACITY);
+    builder->module = ir_module_new(builder->arena);
+
+    ast_visitor_init(&builder->visitor);
+    builder->visitor.pre = ir_builder_pre;
+    builder->visitor.enter_child = ir_builder_enter_child;
+    builder->visitor.leave_child = ir_builder_leave_child;
+    builder->visitor.post = ir_builder_post;
+    ast_visitor_walk(&builder->visitor, ast);
+
+    arena_free(&builder->scratch);
+    return builder->module;
+}
+
+static bool
+ir_builder_is_expr(ast_node_t *node)
+{
+    switch (node->kind) {
+        case AST_NODE_FN_CALL:
+        case AST_NODE_BINARY_OP:
+        case AST_NODE_UNARY_OP:
+        case AST_NODE_LITERAL:
+        case AST_NODE_REF:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool
+ir_builder_is_logical_op(ast_node_t *node)
+{
+    return node->kind == AST_NODE_BINARY_OP &&
+           (node->as_bin_op.kind == AST_BINOP_LOGICAL_AND ||
+            node->as_bin_op.kind == AST_BINOP_LOGICAL_OR);
+}
+
+static bool
+ir_builder_pre(ast_visitor_t *visitor, ast_visit_frame_t *frame)
+{
+    ir_builder_t *builder = (ir_builder_t *)visitor;
+    ast_node_t *node = frame->node;
+
+    switch (node->kind) {
+        case AST_NODE_FN_DEF: {
+            return ir_builder_begin_fn(builder, &node->as_fn_def);
+        }
+
+        case AST_NODE_IF_STMT: {
+            frame->data = (uintptr_t)ir_builder_new_branch(builder);
+            return true;
+        }
+
+        case AST_NODE_WHILE_STMT: {
+            ir_builder_branch_t *branch = ir_builder_new_branch(builder);
+
+            // The header is sealed once the back edge is known.
+            branch->from = ir_builder_new_block(builder);
+            ir_builder_jump(builder, branch->from);
+            ir_builder_switch_to(builder, branch->from);
+
+            frame->data = (uintptr_t)branch;
+            return true;
+        }
+
+        case AST_NODE_BINARY_OP: {
+            if (ir_builder_is_logical_op(node)) {
+                frame->data = (uintptr_t)ir_builder_new_branch(builder);
+            }
+            return true;
+        }
+
+        case AST_NODE_UNARY_OP: {
+            ast_unary_op_t *unary_op = &node->as_unary_op;
+
+            if (unary_op->kind == AST_UNARY_ADDRESSOF) {
+                assert(unary_op->expr->kind == AST_NODE_REF);
+                ir_builder_push(
+                    builder,
+                    ir_builder_addr(builder, unary_op->expr->as_ref.symbol));
+                return false;
+            }
+
+            // The target of an assignment only needs its address.
+            ast_visit_frame_t *parent = ast_visitor_parent(visitor);
+            if (unary_op->kind == AST_UNARY_DEREFERENCE &&
+                parent->node->kind == AST_NODE_BINARY_OP &&
+                parent->node->as_bin_op.kind == AST_BINOP_ASSIGN &&
+                parent->child == 0) {
+                frame->data = 1;
+            }
+            return true;
+        }
+
+        default:
+            return true;
+    }
+}
+
+static bool
+ir_builder_enter_child(ast_visitor_t *visitor, ast_visit_frame_t *frame)
+{
+    (void)visitor;
+    ast_node_t *node = frame->node;
+
+    // A variable being assigned is written, never read.
+    return node->kind != AST_NODE_BINARY_OP ||
+           node->as_bin_op.kind != AST_BINOP_ASSIGN || frame->child != 0 ||
+           node->as_bin_op.lhs->kind != AST_NODE_REF;
+}
+
+static void
+ir_builder_leave_child(ast_visitor_t *visitor, ast_visit_frame_t *frame)
+{
+    ir_builder_t *builder = (ir_builder_t *)visitor;
+    ast_node_t *node = frame->node;
+    ir_builder_branch_t *branch = (ir_builder_branch_t *)frame->data;
+
+    switch (node->kind) {
+        case AST_NODE_BLOCK: {
+            // The value of an expression statement is discarded.
+            if (ir_builder_is_expr(node->as_block.nodes[frame->child])) {
+                ir_builder_pop(builder);
+            }
+            return;
+        }
+
+        case AST_NODE_IF_STMT: {
+            ast_if_stmt_t *if_stmt = &node->as_if_stmt;
+
+            switch (frame->child) {
+                case 0: {
+                    ir_instr_t *cond = ir_builder_pop(builder);
+                    ir_block_t *then = ir_builder_new_block(builder);
+                    branch->end = ir_builder_new_block(builder);
+                    branch->from = branch->end;
+                    if (if_stmt->_else != NULL) {
+                        branch->from = ir_builder_new_block(builder);
+                    }
+
+                    ir_block_br(builder->block, cond, then, branch->from);
+                    ir_builder_seal(builder, then);
+                    if (branch->from != branch->end) {
+                        ir_builder_seal(builder, branch->from);
+                    }
+                    ir_builder_switch_to(builder, then);
+                    return;
+                }
+                case 1: {
+                    ir_builder_jump(builder, branch->end);
+                    if (branch->from != branch->end) {
+                        ir_builder_switch_to(builder, branch->from);
+                    }
+                    return;
+                }
+                default: {
+                    ir_builder_jump(builder, branch->end);
+                    return;
+                }
+            }
+        }
+
+        case AST_NODE_WHILE_STMT: {
+            if (frame->child != 0) {
+                return;
+            }
+
+            ir_instr_t *cond = ir_builder_pop(builder);
+            ir_block_t *body = ir_builder_new_block(builder);
+            branch->end = ir_builder_new_block(builder);
+
+            ir_block_br(builder->block, cond, body, branch->end);
+            ir_builder_seal(builder, body);
+            ir_builder_seal(builder, branch->end);
+            ir_builder_switch_to(builder, body);
+            return;
+        }
+
+        case AST_NODE_BINARY_OP: {
+            if (!ir_builder_is_logical_op(node) || frame->child != 0) {
+                return;
+            }
+
+            // The rhs is only evaluated when the lhs does not decide the
+            // result on its own.
+            ir_instr_t *lhs = ir_builder_pop(builder);
+            ir_block_t *rhs_block = ir_builder_new_block(builder);
+            branch->end = ir_builder_new_block(builder);
+            branch->from = builder->block;
+
+            if (node->as_bin_op.kind == AST_BINOP_LOGICAL_AND) {
+                ir_block_br(builder->block, lhs, rhs_block, branch->end);
+            } else {
+                ir_block_br(builder->block, lhs, branch->end, rhs_block);
+            }
+            ir_builder_seal(builder, rhs_block);
+            ir_builder_switch_to(builder, rhs_block);
+            return;
+        }
+
+        default:
+            return;
+    }
+}
+
+static void
+ir_builder_post(ast_visitor_t *visitor, ast_visit_frame_t *frame)
+{
+    ir_builder_t *builder = (ir_builder_t *)visitor;
+    ast_node_t *node = frame->node;
+
+    switch (node->kind) {
+        case AST_NODE_FN_DEF: {
+            ir_builder_end_fn(builder);
+            return;
+        }
+
+        case AST_NODE_IF_STMT: {
+            ir_builder_branch_t *branch = (ir_builder_branch_t *)frame->data;
+
+            ir_builder_seal(builder, branch->end);
+            ir_builder_switch_to(builder, branch->end);
+            return;
+        }
+
+        case AST_NODE_WHILE_STMT: {
+            ir_builder_branch_t *branch = (ir_builder_branch_t *)frame->data;
+
+            ir_builder_jump(builder, branch->from);
+            ir_builder_seal(builder, branch->from);
+            ir_builder_switch_to(builder, branch->end);
+            return;
+        }
+
+        case AST_NODE_VAR_DEF: {
+            ast_var_definition_t *var_def = &node->as_var_def;
+
+            // Locals without an initializer start out zeroed.
+            ir_instr_t *value =
+                var_def->value != NULL
+                    ? ir_builder_convert(
+                          builder, ir_builder_pop(builder), var_def->type)
+                    : ir_builder_const(builder, var_def->type, 0);
+
+            ir_builder_declare(builder, var_def->symbol);
+            ir_builder_assign(builder, var_def->symbol, value);
+            return;
+        }
+
+        case AST_NODE_RETURN_STMT: {
+            type_t *type = builder->fn->return_type;
+            ir_instr_t *value =
+                node->as_return_stmt.expr != NULL
+                    ? ir_builder_convert(builder, ir_builder_pop(builder), type)
+                    : ir_builder_const(builder, type, 0);
+
+            ir_block_ret(builder->block, value);
+
+            // Whatever follows is unreachable, it is lowered into a block
+            // nothing jumps to.
+            ir_block_t *block = ir_builder_new_block(builder);
+            ir_builder_seal(builder, block);
+            ir_builder_switch_to(builder, block);
+            return;
+        }
+
+        case AST_NODE_LITERAL: {
+            ir_builder_push(
+                builder,
+                ir_builder_const(builder,
+                                 node->type,
+                                 ast_literal_value(&node->as_literal)));
+            return;
+        }
+
+        case AST_NODE_REF: {
+            ir_builder_push(builder,
+                            ir_builder_load(builder, node->as_ref.symbol));
+            return;
+        }
+
+        case AST_NODE_FN_CALL: {
+            ast_fn_call_t *fn_call = &node->as_fn_call;
+
+            ir_instr_t *call = ir_instr_new(
+                builder->fn, IR_CALL, node->type, fn_call->args_size);
+            call->callee = fn_call->id;
+            for (uint32_t i = fn_call->args_size; i > 0; --i) {
+                ir_instr_set_operand(call, i - 1, ir_builder_pop(builder));
+            }
+            ir_block_append(builder->block, call);
+
+            ir_builder_push(builder, call);
+            return;
+        }
+
+        case AST_NODE_BINARY_OP: {
+            if (ir_builder_is_logical_op(node)) {
+                ir_builder_lower_logical_op(builder, frame);
+                return;
+            }
+            ir_builder_lower_binary_op(builder, node);
+            return;
+        }
+
+        case AST_NODE_UNARY_OP: {
+            ast_unary_op_t *unary_op = &node->as_unary_op;
+
+            switch (unary_op->kind) {
+                case AST_UNARY_BITWISE_NOT: {
+                    ir_instr_t *value = ir_builder_convert(
+                        builder, ir_builder_pop(builder), node->type);
+                    ir_builder_push(
+                        builder,
+                        ir_builder_emit(
+                            builder, IR_NOT, node->type, value, NULL));
+                    return;
+                }
+                case AST_UNARY_NEGATIVE: {
+                    // Values wrap, so -x is 0 - x in the type of the result.
+                    ir_instr_t *value = ir_builder_convert(
+                        builder, ir_builder_pop(builder), node->type);
+                    ir_instr_t *zero =
+                        ir_builder_const(builder, node->type, 0);
+                    ir_builder_push(
+                        builder,
+                        ir_builder_emit(
+                            builder, IR_SUB, node->type, zero, value));
+                    return;
+                }
+                case AST_UNARY_POSITIVE: {
+                    ir_instr_t *value = ir_builder_convert(
+                        builder, ir_builder_pop(builder), node->type);
+                    ir_builder_push(builder, value);
+                    return;
+                }
+                case AST_UNARY_LOGICAL_NOT: {
+                    // Compared in the type of the operand, pointers included.
+                    ir_instr_t *value = ir_builder_pop(builder);
+                    ir_instr_t *zero =
+                        ir_builder_const(builder, value->type, 0);
+                    ir_builder_push(
+                        builder,
+                        ir_builder_emit(
+                            builder, IR_EQ, node->type, value, zero));
+                    return;
+                }
+                case AST_UNARY_DEREFERENCE: {
+                    // An assignment target leaves its address for the store.
+                    if (frame->data) {
+                        return;
+                    }
+
+                    ir_instr_t *ptr = ir_builder_pop(builder);
+                    ir_builder_push(
+                        builder,
+                        ir_builder_emit(
+                            builder, IR_LOAD, node->type, ptr, NULL));
+                    return;
+                }
+                default: {
+                    assert(0 && "unsupported unary operation");
+                    return;
+                }
+            }
+        }
+
+        default:
+            return;
+    }
+}
+
+static bool
+ir_builder_begin_fn(ir_builder_t *builder, ast_fn_definition_t *fn_def)
+{
+    ir_function_t *fn = ir_function_new(
+        builder->module, fn_def->id, fn_def->return_type, fn_def->params_size);
+    for (uint32_t i = 0; i < fn_def->params_size; ++i) {
+        fn->params[i] = fn_def->params[i]->type;
+    }
+
+    if (fn_def->_extern) {
+        fn->_extern = true;
+        return false;
+    }
+
+    builder->fn = fn;
+    builder->fn_def = fn_def;
+    builder->fn_temp = arena_temp_begin(&builder->scratch);
+
+    builder->blocks = NULL;
+    builder->blocks_capacity = 0;
+    builder->forwards = NULL;
+    builder->forwards_capacity = 0;
+    builder->values_size = 0;
+    builder->values_capacity = 0;
+    builder->chain_size = 0;
+    builder->chain_capacity = 0;
+    builder->pending_size = 0;
+    builder->pending_capacity = 0;
+    builder->retry_size = 0;
+    builder->retry_capacity = 0;
+
+    builder->vars_size = fn_def->slots_size;
+    builder->var_types = (type_t **)ir_builder_alloc(
+        builder, (fn_def->slots_size + 1) * sizeof(type_t *));
+    builder->var_mem_slots = (uint32_t *)ir_builder_alloc(
+        builder, (fn_def->slots_size + 1) * sizeof(uint32_t));
+    memset(builder->var_mem_slots,
+           0xff,
+           (fn_def->slots_size + 1) * sizeof(uint32_t));
+
+    ir_block_t *entry = ir_builder_new_block(builder);
+    ir_builder_seal(builder, entry);
+    builder->block = entry;
+
+    // Every parameter is read before anything can clobber the registers it
+    // arrives in.
+    ir_instr_t **params = (ir_instr_t **)ir_builder_alloc(
+        builder, (fn_def->params_size + 1) * sizeof(ir_instr_t *));
+    for (uint32_t i = 0; i < fn_def->params_size; ++i) {
+        params[i] =
+            ir_builder_emit(builder, IR_PARAM, fn->params[i], NULL, NULL);
+        params[i]->index = i;
+    }
+
+    for (uint32_t i = 0; i < fn_def->params_size; ++i) {
+        symbol_t *symbol = fn_def->params[i]->symbol;
+        ir_builder_declare(builder, symbol);
+        ir_builder_assign(builder, symbol, params[i]);
+    }
+
+    return true;
+}
+
+static void
+ir_builder_end_fn(ir_builder_t *builder)
+{
+    ir_block_t *block = builder->block;
+
+    // Falling off the end returns zero, unless the end is unreachable.
+    if (block->first == NULL && block->preds_size == 0 &&
+        block != builder->fn->first) {
+        ir_block_remove(block);
+    } else {
+        ir_block_ret(block,
+                     ir_builder_const(builder, builder->fn->return_type, 0));
+    }
+
+    assert(builder->values_size == 0);
+    ir_function_renumber(builder->fn);
+
+    arena_temp_end(builder->fn_temp);
+    builder->fn = NULL;
+    builder->fn_def = NULL;
+    builder->block = NULL;
+}
+
+static void
+ir_builder_lower_binary_op(ir_builder_t *builder, ast_node_t *node)
+{
+    ast_binary_op_t *bin_op = &node->as_bin_op;
+    type_t *type = node->type;
+
+    ir_instr_t *rhs = ir_builder_pop(builder);
+    rhs = ir_builder_convert(builder, rhs, type);
+
+    if (bin_op->kind == AST_BINOP_ASSIGN) {
+        if (bin_op->lhs->kind == AST_NODE_REF) {
+            ir_builder_assign(builder, bin_op->lhs->as_ref.symbol, rhs);
+        } else {
+            ir_instr_t *ptr = ir_builder_pop(builder);
+            ir_builder_emit(builder, IR_STORE, NULL, ptr, rhs);
+        }
+
+        ir_builder_push(builder, rhs);
+        return;
+    }
+
+    static const ir_op_t ops[] = {
+        [AST_BINOP_ADDITION] = IR_ADD,
+        [AST_BINOP_SUBTRACTION] = IR_SUB,
+        [AST_BINOP_MULTIPLICATION] = IR_MUL,
+        [AST_BINOP_DIVISION] = IR_DIV,
+        [AST_BINOP_REMINDER] = IR_REM,
+        [AST_BINOP_BITWISE_LSHIFT] = IR_SHL,
+        [AST_BINOP_BITWISE_RSHIFT] = IR_SHR,
+        [AST_BINOP_BITWISE_XOR] = IR_XOR,
+        [AST_BINOP_BITWISE_AND] = IR_AND,
+        [AST_BINOP_BITWISE_OR] = IR_OR,
+        [AST_BINOP_CMP_LT] = IR_LT,
+        [AST_BINOP_CMP_GT] = IR_GT,
+        [AST_BINOP_CMP_LEQ] = IR_LE,
+        [AST_BINOP_CMP_GEQ] = IR_GE,
+        [AST_BINOP_CMP_EQ] = IR_EQ,
+        [AST_BINOP_CMP_NEQ] = IR_NE,
+    };
+    assert(bin_op->kind < sizeof(ops) / sizeof(ops[0]));
+
+    // Both operands are widened to the type of the operation, comparisons
+    // included, whose type is the one they are carried out in.
+    ir_instr_t *lhs = ir_builder_pop(builder);
+    lhs = ir_builder_convert(builder, lhs, type);
+    ir_instr_t *value =
+        ir_builder_emit(builder, ops[bin_op->kind], type, lhs, rhs);
+    ir_builder_push(builder, value);
+}
+
+/**
+ * Joins the two ways a logical operation can be decided: by its lhs alone or
+ * by its rhs, which is normalized to 0 or 1.
+ */
+static void
+ir_builder_lower_logical_op(ir_builder_t *builder, ast_visit_frame_t *frame)
+{
+    ast_node_t *node = frame->node;
+    ir_builder_branch_t *branch = (ir_builder_branch_t *)frame->data;
+    type_t *type = node->type;
+
+    ir_instr_t *rhs = ir_builder_pop(builder);
+    if (!ir_op_is_cmp(rhs->op)) {
+        rhs = ir_builder_emit(builder,
+                              IR_NE,
+                              type,
+                              rhs,
+                              ir_builder_const(builder, rhs->type, 0));
+    }
+    rhs = ir_builder_convert(builder, rhs, type);
+
+    ir_block_t *rhs_block = builder->block;
+    ir_builder_jump(builder, branch->end);
+    ir_builder_seal(builder, branch->end);
+    ir_builder_switch_to(builder, branch->end);
+
+    uint64_t short_circuit =
+        node->as_bin_op.kind == AST_BINOP_LOGICAL_AND ? 0 : 1;
+
+    ir_instr_t *phi = ir_instr_new(builder->fn, IR_PHI, type, 0);
+    ir_builder_insert_at_top(branch->end, phi);
+    for (uint32_t i = 0; i < branch->end->preds_size; ++i) {
+        ir_block_t *pred = branch->end->preds[i];
+        if (pred == rhs_block) {
+            ir_phi_add_operand(phi, rhs);
+            continue;
+        }
+
+        assert(pred == branch->from);
+        ir_instr_t *value = ir_const_new(builder->fn, type, short_circuit);
+        ir_instr_insert_before(pred->last, value);
+        ir_phi_add_operand(phi, value);
+    }
+
+    ir_builder_push(builder, phi);
+}
+
+static ir_block_t *
+ir_builder_new_block(ir_builder_t *builder)
+{
+    ir_block_t *block = ir_block_new(builder->fn);
+
+    if (block->id >= builder->blocks_capacity) {
+        builder->blocks =
+            (ir_builder_block_t *)ir_builder_grow(builder,
+                                                  builder->blocks,
+                                                  block->id,
+                                                  &builder->blocks_capacity,
+                                                  block->id + 1,
+                                                  sizeof(ir_builder_block_t));
+    }
+    return block;
+}
+
+/**
+ * Makes block the one instructions are appended to.  Blocks are laid out in
+ * the order they are filled, not the order they are created.
+ */
+static void
+ir_builder_switch_to(ir_builder_t *builder, ir_block_t *block)
+{
+    ir_block_move_to_end(block);
+    builder->block = block;
+}
+
+/**
+ * Ends the current block with a jump to target.  An empty unreachable block
+ * is dropped instead, so the join does not get an edge from it.
+ */
+static void
+ir_builder_jump(ir_builder_t *builder, ir_block_t *target)
+{
+    ir_block_t *block = builder->block;
+
+    if (block->first == NULL && block->preds_size == 0 &&
+        block != builder->fn->first) {
+        ir_block_remove(block);
+        builder->block = NULL;
+        return;
+    }
+
+    ir_block_jmp(block, target);
+}
+
+static ir_builder_branch_t *
+ir_builder_new_branch(ir_builder_t *builder)
+{
+    ir_builder_branch_t *branch = (ir_builder_branch_t *)ir_builder_alloc(
+        builder, sizeof(ir_builder_branch_t));
+    branch->from = NULL;
+    branch->end = NULL;
+    return branch;
+}
+
+static ir_instr_t *
+ir_builder_emit(ir_builder_t *builder,
+                ir_op_t op,
+                type_t *type,
+                ir_instr_t *lhs,
+                ir_instr_t *rhs)
+{
+    uint32_t operands_size = (lhs != NULL) + (rhs != NULL);
+    ir_instr_t *instr = ir_instr_new(builder->fn, op, type, operands_size);
+
+    if (lhs != NULL) {
+        ir_instr_set_operand(instr, 0, lhs);
+    }
+    if (rhs != NULL) {
+        ir_instr_set_operand(instr, 1, rhs);
+    }
+
+    ir_block_append(builder->block, instr);
+    return instr;
+}
+
+static ir_instr_t *
+ir_builder_const(ir_builder_t *builder, type_t *type, uint64_t imm)
+{
+    ir_instr_t *instr = ir_const_new(builder->fn, type, imm);
+    ir_block_append(builder->block, instr);
+    return instr;
+}
+
+/**
+ * Zero-extends or truncates value to the width of type.  Types of the same
+ * width, like u64 and pointers, share their representation.
+ */
+static ir_instr_t *
+ir_builder_convert(ir_builder_t *builder, ir_instr_t *value, type_t *type)
+{
+    if (value->type->size == type->size) {
+        return value;
+    }
+
+    if (value->op == IR_CONST) {
+        return ir_builder_const(builder, type, value->imm);
+    }
+
+    ir_op_t op = value->type->size < type->size ? IR_ZEXT : IR_TRUNC;
+    return ir_builder_emit(builder, op, type, value, NULL);
+}
+
+/**
+ * Places instr right after the phis of block.
+ */
+static void
+ir_builder_insert_at_top(ir_block_t *block, ir_instr_t *instr)
+{
+    ir_instr_t *pos = block->first;
+    while (pos != NULL && pos->op == IR_PHI) {
+        pos = pos->next;
+    }
+
+    if (pos == NULL) {
+        ir_block_append(block, instr);
+    } else {
+        ir_instr_insert_before(pos, instr);
+    }
+}
+
+static void
+ir_builder_push(ir_builder_t *builder, ir_instr_t *value)
+{
+    if (builder->values_size == builder->values_capacity) {
+        builder->values =
+            (ir_instr_t **)ir_builder_grow(builder,
+                                           builder->values,
+                                           builder->values_size,
+                                           &builder->values_capacity,
+                                           builder->values_size + 1,
+                                           sizeof(ir_instr_t *));
+    }
+    builder->values[builder->values_size++] = value;
+}
+
+static ir_instr_t *
+ir_builder_pop(ir_builder_t *builder)
+{
+    assert(builder->values_size > 0);
+    return ir_builder_resolve(builder,
+                              builder->values[--builder->values_size]);
+}
+
+static void
+ir_builder_declare(ir_builder_t *builder, symbol_t *symbol)
+{
+    assert(symbol->slot < builder->vars_size);
+    builder->var_types[symbol->slot] = symbol->type;
+
+    if (symbol->address_taken) {
+        builder->var_mem_slots[symbol->slot] =
+            ir_function_add_slot(builder->fn, symbol->type);
+    }
+}
+
+static void
+ir_builder_assign(ir_builder_t *builder, symbol_t *symbol, ir_instr_t *value)
+{
+    if (builder->var_mem_slots[symbol->slot] != UINT32_MAX) {
+        ir_builder_emit(
+            builder, IR_STORE, NULL, ir_builder_addr(builder, symbol), value);
+        return;
+    }
+
+    ir_builder_write_var(builder, builder->block, symbol->slot, value);
+}
+
+static ir_instr_t *
+ir_builder_load(ir_builder_t *builder, symbol_t *symbol)
+{
+    if (builder->var_mem_slots[symbol->slot] != UINT32_MAX) {
+        return ir_builder_emit(builder,
+                               IR_LOAD,
+                               symbol->type,
+                               ir_builder_addr(builder, symbol),
+                               NULL);
+    }
+
+    return ir_builder_read_var(builder, builder->block, symbol->slot);
+}
+
+static ir_instr_t *
+ir_builder_addr(ir_builder_t *builder, symbol_t *symbol)
+{
+    uint32_t mem_slot = builder->var_mem_slots[symbol->slot];
+    assert(mem_slot != UINT32_MAX);
+
+    // The checker interned the pointer type when it typed the address-of.
+    assert(symbol->type->ptr);
+    ir_instr_t *addr =
+        ir_builder_emit(builder, IR_ADDR, symbol->type->ptr, NULL, NULL);
+    addr->index = mem_slot;
+    return addr;
+}
+
+static ir_builder_block_t *
+ir_builder_block_info(ir_builder_t *builder, ir_block_t *block)
+{
+    assert(block->id < builder->blocks_capacity);
+    return &builder->blocks[block->id];
+}
+
+static void
+ir_builder_write_var(ir_builder_t *builder,
+                     ir_block_t *block,
+                     uint32_t slot,
+                     ir_instr_t *value)
+{
+    ir_builder_block_t *info = ir_builder_block_info(builder, block);
+
+    if (info->defs == NULL) {
+        size_t size = builder->vars_size * sizeof(ir_instr_t *);
+        info->defs = (ir_instr_t **)ir_builder_alloc(builder, size);
+        memset(info->defs, 0, size);
+    }
+    info->defs[slot] = value;
+}
+
+static ir_instr_t *
+ir_builder_read_var(ir_builder_t *builder, ir_block_t *block, uint32_t slot)
+{
+    uint32_t base = builder->pending_size;
+    ir_instr_t *value = ir_builder_lookup_var(builder, block, slot);
+    ir_builder_complete_phis(builder, base);
+
+    return ir_builder_resolve(builder, value);
+}
+
+/**
+ * Finds the definition of a local reaching the end of block.  Chains of
+ * single predecessors are followed in a loop and the phis needed at joins are
+ * left pending for ir_builder_complete_phis, so lookups never recurse.
+ */
+static ir_instr_t *
+ir_builder_lookup_var(ir_builder_t *builder, ir_block_t *block, uint32_t slot)
+{
+    uint32_t chain_base = builder->chain_size;
+    ir_instr_t *value = NULL;
+
+    for (;;) {
+        ir_builder_block_t *info = ir_builder_block_info(builder, block);
+
+        if (info->defs != NULL && info->defs[slot] != NULL) {
+            value = ir_builder_resolve(builder, info->defs[slot]);
+            break;
+        }
+
+        if (!info->sealed) {
+            value = ir_builder_new_phi(builder, block, slot);
+
+            ir_builder_phi_t *incomplete = (ir_builder_phi_t *)ir_builder_alloc(
+                builder, sizeof(ir_builder_phi_t));
+            incomplete->phi = value;
+            incomplete->slot = slot;
+            incomplete->next = info->incomplete;
+            info->incomplete = incomplete;
+            break;
+        }
+
+        if (block->preds_size == 0) {
+            value = ir_builder_undef(builder, block, builder->var_types[slot]);
+            break;
+        }
+
+        if (block->preds_size == 1) {
+            if (builder->chain_size == builder->chain_capacity) {
+                builder->chain =
+                    (ir_block_t **)ir_builder_grow(builder,
+                                                   builder->chain,
+                                                   builder->chain_size,
+                                                   &builder->chain_capacity,
+                                                   builder->chain_size + 1,
+                                                   sizeof(ir_block_t *));
+            }
+            builder->chain[builder->chain_size++] = block;
+            block = block->preds[0];
+            continue;
+        }
+
+        // Recorded before its operands are looked up, which may loop back
+        // here and must find the phi instead of placing another one.
+        value = ir_builder_new_phi(builder, block, slot);
+
+        if (builder->pending_size == builder->pending_capacity) {
+            builder->pending =
+                (ir_builder_phi_t *)ir_builder_grow(builder,
+                                                    builder->pending,
+                                                    builder->pending_size,
+                                                    &builder->pending_capacity,
+                                                    builder->pending_size + 1,
+                                                    sizeof(ir_builder_phi_t));
+        }
+        builder->pending[builder->pending_size].phi = value;
+        builder->pending[builder->pending_size].slot = slot;
+        ++builder->pending_size;
+        break;
+    }
+
+    ir_builder_write_var(builder, block, slot, value);
+    while (builder->chain_size > chain_base) {
+        ir_builder_write_var(
+            builder, builder->chain[--builder->chain_size], slot, value);
+    }
+
+    return value;
+}
+
+static ir_instr_t *
+ir_builder_new_phi(ir_builder_t *builder, ir_block_t *block, uint32_t slot)
+{
+    ir_instr_t *phi =
+        ir_instr_new(builder->fn, IR_PHI, builder->var_types[slot], 0);
+    ir_builder_insert_at_top(block, phi);
+    return phi;
+}
+
+/**
+ * Value of a local read before any assignment reaches it, locals are zeroed.
+ */
+static ir_instr_t *
+ir_builder_undef(ir_builder_t *builder, ir_block_t *block, type_t *type)
+{
+    ir_instr_t *value = ir_const_new(builder->fn, type, 0);
+    ir_builder_insert_at_top(block, value);
+    return value;
+}
+
+/**
+ * Marks that every predecessor of block is known, completing the phis that
+ * were placed before.
+ */
+static void
+ir_builder_seal(ir_builder_t *builder, ir_block_t *block)
+{
+    ir_builder_block_t *info = ir_builder_block_info(builder, block);
+    assert(!info->sealed);
+
+    uint32_t base = builder->pending_size;
+    for (ir_builder_phi_t *it = info->incomplete; it != NULL; it = it->next) {
+        if (builder->pending_size == builder->pending_capacity) {
+            builder->pending =
+                (ir_builder_phi_t *)ir_builder_grow(builder,
+                                                    builder->pending,
+                                                    builder->pending_size,
+                                                    &builder->pending_capacity,
+                                                    builder->pending_size + 1,
+                                                    sizeof(ir_builder_phi_t));
+        }
+        builder->pending[builder->pending_size++] = *it;
+    }
+
+    info->incomplete = NULL;
+    info->sealed = true;
+
+    ir_builder_complete_phis(builder, base);
+}
+
+/**
+ * Gives the pending phis above base an operand per predecessor, then drops
+ * the ones that turn out trivial.
+ */
+static void
+ir_builder_complete_phis(ir_builder_t *builder, uint32_t base)
+{
+    while (builder->pending_size > base) {
+        ir_builder_phi_t pending = builder->pending[--builder->pending_size];
+        ir_instr_t *phi = pending.phi;
+        ir_block_t *block = phi->block;
+
+        for (uint32_t i = 0; i < block->preds_size; ++i) {
+            ir_instr_t *value =
+                ir_builder_lookup_var(builder, block->preds[i], pending.slot);
+            ir_phi_add_operand(phi, value);
+        }
+
+        ir_builder_remove_trivial_phis(builder, phi);
+    }
+}
+
+/**
+ * Replaces phi by its only operand other than itself, if it has one, and
+ * revisits the phis using it, which may have become trivial in turn.
+ */
+static void
+ir_builder_remove_trivial_phis(ir_builder_t *builder, ir_instr_t *phi)
+{
+    uint32_t base = builder->retry_size;
+
+    for (;;) {
+        if (phi != NULL && phi->block != NULL &&
+            phi->operands_size == phi->block->preds_size) {
+            ir_instr_t *same = NULL;
+            bool trivial = true;
+
+            for (uint32_t i = 0; i < phi->operands_size; ++i) {
+                ir_instr_t *value = ir_instr_operand(phi, i);
+                if (value == same || value == phi) {
+                    continue;
+                }
+                if (same != NULL) {
+                    trivial = false;
+                    break;
+                }
+                same = value;
+            }
+
+            if (trivial) {
+                if (same == NULL) {
+                    same = ir_builder_undef(builder, phi->block, phi->type);
+                }
+
+                for (ir_use_t *use = phi->uses; use != NULL; use = use->next) {
+                    if (use->user == phi || use->user->op != IR_PHI) {
+                        continue;
+                    }
+
+                    if (builder->retry_size == builder->retry_capacity) {
+                        builder->retry = (ir_instr_t **)ir_builder_grow(
+                            builder,
+                            builder->retry,
+                            builder->retry_size,
+                            &builder->retry_capacity,
+                            builder->retry_size + 1,
+                            sizeof(ir_instr_t *));
+                    }
+                    builder->retry[builder->retry_size++] = use->user;
+                }
+
+                if (phi->id >= builder->forwards_capacity) {
+                    builder->forwards = (ir_instr_t **)ir_builder_grow(
+                        builder,
+                        builder->forwards,
+                        builder->forwards_capacity,
+                        &builder->forwards_capacity,
+                        phi->id + 1,
+                        sizeof(ir_instr_t *));
+                }
+                builder->forwards[phi->id] = same;
+
+                ir_instr_replace_uses(phi, same);
+                ir_instr_remove(phi);
+            }
+        }
+
+        if (builder->retry_size == base) {
+            return;
+        }
+        phi = builder->retry[--builder->retry_size];
+    }
+}
+
+/**
+ * Follows the replacements of the phis removed since value was recorded.
+ */
+static ir_instr_t *
+ir_builder_resolve(ir_builder_t *builder, ir_instr_t *value)
+{
+    while (value->block == NULL) {
+        assert(value->op == IR_PHI && value->id < builder->forwards_capacity);
+        value = builder->forwards[value->id];
+    }
+    return value;
+}
+
+static void *
+ir_builder_alloc(ir_builder_t *builder, size_t size)
+{
+    void *ptr = arena_alloc(&builder->scratch, size);
+    if (ptr == NULL) {
+        fprintf(stderr,
+                "[FATAL] Out of memory: ir_builder_alloc: %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+/**
+ * Copies the size items of a scratch array into one at least min_capacity
+ * long, doubling the capacity as needed.  The new tail is zeroed.
+ */
+static void *
+ir_builder_grow(ir_builder_t *builder,
+                void *items,
+                uint32_t size,
+                uint32_t *capacity,
+                uint32_t min_capacity,
+                size_t item_size)
+{
+    uint32_t new_capacity = *capacity ? *capacity : 16;
+    while (new_capacity < min_capacity) {
+        new_capacity *= 2;
+    }
+
+    void *new_items = ir_builder_alloc(builder, new_capacity * item_size);
+    if (size != 0) {
+        memcpy(new_items, items, size * item_size);
+    }
+    memset((char *)new_items + size * item_size,
+           0,
+           (new_capacity - size) * item_size);
+
+    *capacity = new_capacity;
+    return new_items;
+}
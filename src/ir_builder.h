@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef IR_BUILDER_H
+#define IR_BUILDER_H
+
+#include <stdint.h>
+
+#include "arena.h"
+#include "ast.h"
+#include "ast_visitor.h"
+#include "ir.h"
+
+typedef struct ir_builder_block ir_builder_block_t;
+typedef struct ir_builder_phi ir_builder_phi_t;
+
+/**
+ * Lowers a checked AST to SSA form in a single walk, following "Simple and
+ * Efficient Construction of Static Single Assignment Form" (Braun et al.):
+ * the current definition of every local is tracked per block and phis are
+ * only placed where a read reaches a join, so no dominance frontiers are
+ * needed.  Locals whose address is taken live in memory slots instead.
+ */
+typedef struct ir_builder
+{
+    ast_visitor_t visitor;
+    arena_t *arena;
+    // Construction state of the function being lowered, rewound once it is
+    // done.
+    arena_t scratch;
+    arena_temp_t fn_temp;
+    ir_module_t *module;
+    ir_function_t *fn;
+    ast_fn_definition_t *fn_def;
+    // Block new instructions are appended to.
+    ir_block_t *block;
+
+    // Indexed by block id.
+    ir_builder_block_t *blocks;
+    uint32_t blocks_capacity;
+    // Replacement of every phi found trivial, indexed by value id, the
+    // current definitions may still refer to it.
+    ir_instr_t **forwards;
+    uint32_t forwards_capacity;
+    // Type and memory slot of the locals, indexed by symbol slot.  Locals
+    // without a memory slot have UINT32_MAX.
+    type_t **var_types;
+    uint32_t *var_mem_slots;
+    uint32_t vars_size;
+
+    // Operands of the expressions being lowered.
+    ir_instr_t **values;
+    uint32_t values_size;
+    uint32_t values_capacity;
+    // Work lists of the variable lookups.
+    ir_block_t **chain;
+    uint32_t chain_size;
+    uint32_t chain_capacity;
+    ir_builder_phi_t *pending;
+    uint32_t pending_size;
+    uint32_t pending_capacity;
+    ir_instr_t **retry;
+    uint32_t retry_size;
+    uint32_t retry_capacity;
+} ir_builder_t;
+
+ir_builder_t *
+ir_builder_new(arena_t *arena);
+
+ir_module_t *
+ir_builder_build(ir_builder_t *builder, ast_node_t *ast);
+
+#endif /* IR_BUILDER_H */
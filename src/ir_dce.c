@@ -0,0 +1,565 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ir_dce.h"
+#include "vector.h"
+
+#define IR_DCE_ARENA_CAPACITY (1024 * 16)
+
+typedef struct ir_dce
+{
+    arena_t arena;
+    ir_function_t *fn;
+    ir_analysis_t *analysis;
+    // Indexed by slot, whether its address is only used to load from and
+    // store to it, so its stores are observed by nothing but these loads.
+    bool *tracked;
+    // Bit sets over the slots, words long and indexed by block id: the slots
+    // possibly loaded before being stored again on entry, the ones loaded
+    // before any store in the block and the ones stored in it.
+    uint32_t words;
+    uint64_t *live_in;
+    uint64_t *loads;
+    uint64_t *stores;
+    vector_t instrs;
+} ir_dce_t;
+
+static void *
+ir_dce_alloc(arena_t *arena, size_t size);
+
+static bool
+ir_dce_remove_unreachable_blocks(ir_dce_t *dce);
+
+static bool
+ir_dce_remove_dead_stores(ir_dce_t *dce);
+
+static bool
+ir_dce_track_slots(ir_dce_t *dce);
+
+static void
+ir_dce_solve_slots(ir_dce_t *dce);
+
+static void
+ir_dce_live_out(ir_dce_t *dce, ir_block_t *block, uint64_t *out);
+
+static uint32_t
+ir_dce_tracked_slot(ir_dce_t *dce, ir_instr_t *instr);
+
+static bool
+ir_dce_is_kill(ir_dce_t *dce, ir_instr_t *instr);
+
+static bool
+ir_dce_remove_dead_values(ir_dce_t *dce);
+
+static bool
+ir_dce_has_effects(ir_instr_t *instr);
+
+static bool
+ir_dce_remove_unused_slots(ir_dce_t *dce);
+
+static bool
+ir_dce_simplify_cfg(ir_dce_t *dce);
+
+static bool
+ir_dce_thread_edges(ir_block_t *block);
+
+bool
+ir_dce_run(ir_function_t *fn, ir_analysis_t *analysis)
+{
+    ir_dce_t dce;
+    dce.arena = arena_new(IR_DCE_ARENA_CAPACITY);
+    dce.fn = fn;
+    dce.analysis = analysis;
+    vector_init(&dce.instrs, &dce.arena);
+
+    bool cfg_changed = ir_dce_remove_unreachable_blocks(&dce);
+
+    // Removing a store leaves the values it stored unused, they can be loads
+    // keeping other stores alive in turn.
+    bool changed = false;
+    bool values_changed = true;
+    while (values_changed) {
+        changed = ir_dce_remove_dead_stores(&dce) || changed;
+        values_changed = ir_dce_remove_dead_values(&dce);
+        changed = changed || values_changed;
+    }
+    changed = ir_dce_remove_unused_slots(&dce) || changed;
+
+    cfg_changed = ir_dce_simplify_cfg(&dce) || cfg_changed;
+
+    if (cfg_changed) {
+        ir_analysis_invalidate(analysis, IR_ANALYSIS_CFG);
+    } else if (changed) {
+        ir_analysis_invalidate(analysis, IR_ANALYSIS_LIVENESS);
+    }
+
+    arena_free(&dce.arena);
+    return changed || cfg_changed;
+}
+
+/**
+ * Removes the blocks no path from the entry reaches, such as the code
+ * following a return.
+ */
+static bool
+ir_dce_remove_unreachable_blocks(ir_dce_t *dce)
+{
+    ir_function_t *fn = dce->fn;
+    const ir_cfg_t *cfg = ir_analysis_cfg(dce->analysis);
+
+    bool *live = (bool *)ir_dce_alloc(&dce->arena, fn->blocks_size);
+    memset(live, 0, fn->blocks_size);
+    for (ir_block_t *block = fn->first; block != NULL; block = block->next) {
+        live[block->id] = ir_cfg_reachable(cfg, block);
+    }
+
+    if (!ir_function_remove_dead_blocks(fn, live)) {
+        return false;
+    }
+
+    ir_analysis_invalidate(dce->analysis, IR_ANALYSIS_CFG);
+    return true;
+}
+
+/**
+ * Removes the stores to a tracked slot that no load reads, the slot being
+ * stored again or the function returning first.  Locals are dead once the
+ * function returns, so nothing is live on exit.
+ */
+static bool
+ir_dce_remove_dead_stores(ir_dce_t *dce)
+{
+    if (!ir_dce_track_slots(dce)) {
+        return false;
+    }
+    ir_dce_solve_slots(dce);
+
+    const ir_cfg_t *cfg = ir_analysis_cfg(dce->analysis);
+    uint64_t *live =
+        (uint64_t *)ir_dce_alloc(&dce->arena, dce->words * sizeof(uint64_t));
+    bool changed = false;
+
+    for (uint32_t i = 0; i < cfg->rpo_size; ++i) {
+        ir_block_t *block = cfg->rpo[i];
+        ir_dce_live_out(dce, block, live);
+
+        ir_instr_t *prev = NULL;
+        for (ir_instr_t *instr = block->last; instr != NULL; instr = prev) {
+            prev = instr->prev;
+
+            uint32_t slot = ir_dce_tracked_slot(dce, instr);
+            if (slot == UINT32_MAX) {
+                continue;
+            }
+
+            uint64_t bit = 1ull << (slot % 64);
+            if (instr->op == IR_LOAD) {
+                live[slot / 64] |= bit;
+            } else if ((live[slot / 64] & bit) == 0) {
+                ir_instr_remove(instr);
+                changed = true;
+            } else if (ir_dce_is_kill(dce, instr)) {
+                live[slot / 64] &= ~bit;
+            }
+        }
+    }
+
+    return changed;
+}
+
+/**
+ * Flags the slots not escaped, the only ones whose loads are all known.
+ * Returns whether any slot is tracked.
+ */
+static bool
+ir_dce_track_slots(ir_dce_t *dce)
+{
+    ir_function_t *fn = dce->fn;
+    if (fn->slots_size == 0) {
+        return false;
+    }
+
+    dce->tracked = (bool *)ir_dce_alloc(&dce->arena, fn->slots_size);
+    ir_function_find_escaped_slots(fn, dce->tracked);
+
+    bool tracked = false;
+    for (uint32_t i = 0; i < fn->slots_size; ++i) {
+        dce->tracked[i] = !dce->tracked[i];
+        tracked = tracked || dce->tracked[i];
+    }
+    return tracked;
+}
+
+/**
+ * Solves the backward data-flow equations over the tracked slots, visiting
+ * the blocks in postorder:
+ *
+ *     out(B) = union of in(S)
+ *     in(B)  = loads(B) | (out(B) & ~stores(B))
+ */
+static void
+ir_dce_solve_slots(ir_dce_t *dce)
+{
+    ir_function_t *fn = dce->fn;
+    const ir_cfg_t *cfg = ir_analysis_cfg(dce->analysis);
+    uint32_t words = (fn->slots_size + 63) / 64;
+    size_t sets_size = (size_t)cfg->blocks_size * words * sizeof(uint64_t);
+
+    dce->words = words;
+    dce->live_in = (uint64_t *)ir_dce_alloc(&dce->arena, sets_size);
+    dce->loads = (uint64_t *)ir_dce_alloc(&dce->arena, sets_size);
+    dce->stores = (uint64_t *)ir_dce_alloc(&dce->arena, sets_size);
+    memset(dce->live_in, 0, sets_size);
+    memset(dce->loads, 0, sets_size);
+    memset(dce->stores, 0, sets_size);
+
+    for (uint32_t i = 0; i < cfg->rpo_size; ++i) {
+        ir_block_t *block = cfg->rpo[i];
+        uint64_t *loads = dce->loads + (size_t)block->id * words;
+        uint64_t *stores = dce->stores + (size_t)block->id * words;
+
+        for (ir_instr_t *instr = block->first; instr != NULL;
+             instr = instr->next) {
+            uint32_t slot = ir_dce_tracked_slot(dce, instr);
+            if (slot == UINT32_MAX) {
+                continue;
+            }
+
+            uint64_t bit = 1ull << (slot % 64);
+            if (instr->op == IR_LOAD && (stores[slot / 64] & bit) == 0) {
+                loads[slot / 64] |= bit;
+            } else if (ir_dce_is_kill(dce, instr)) {
+                stores[slot / 64] |= bit;
+            }
+        }
+    }
+
+    uint64_t *out =
+        (uint64_t *)ir_dce_alloc(&dce->arena, words * sizeof(uint64_t));
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        for (uint32_t i = cfg->rpo_size; i > 0; --i) {
+            ir_block_t *block = cfg->rpo[i - 1];
+            uint64_t *in = dce->live_in + (size_t)block->id * words;
+            uint64_t *loads = dce->loads + (size_t)block->id * words;
+            uint64_t *stores = dce->stores + (size_t)block->id * words;
+
+            ir_dce_live_out(dce, block, out);
+
+            // The sets only grow, so comparing them is enough to tell the
+            // fixed point.
+            for (uint32_t w = 0; w < words; ++w) {
+                uint64_t word = loads[w] | (out[w] & ~stores[w]);
+                if (word != in[w]) {
+                    in[w] = word;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+static void
+ir_dce_live_out(ir_dce_t *dce, ir_block_t *block, uint64_t *out)
+{
+    memset(out, 0, dce->words * sizeof(uint64_t));
+
+    uint32_t succs_size = ir_block_succs_size(block);
+    for (uint32_t i = 0; i < succs_size; ++i) {
+        ir_block_t *succ = ir_block_succ(block, i);
+        uint64_t *succ_in = dce->live_in + (size_t)succ->id * dce->words;
+        for (uint32_t w = 0; w < dce->words; ++w) {
+            out[w] |= succ_in[w];
+        }
+    }
+}
+
+/**
+ * The tracked slot instr loads from or stores to, UINT32_MAX if none.
+ */
+static uint32_t
+ir_dce_tracked_slot(ir_dce_t *dce, ir_instr_t *instr)
+{
+    if (instr->op != IR_LOAD && instr->op != IR_STORE) {
+        return UINT32_MAX;
+    }
+
+    ir_instr_t *ptr = ir_instr_operand(instr, 0);
+    if (ptr->op != IR_ADDR || !dce->tracked[ptr->index]) {
+        return UINT32_MAX;
+    }
+    return ptr->index;
+}
+
+/**
+ * Whether instr stores to the whole of its tracked slot, so the value held
+ * before can no longer be loaded.
+ */
+static bool
+ir_dce_is_kill(ir_dce_t *dce, ir_instr_t *instr)
+{
+    if (instr->op != IR_STORE) {
+        return false;
+    }
+
+    ir_instr_t *ptr = ir_instr_operand(instr, 0);
+    ir_instr_t *value = ir_instr_operand(instr, 1);
+    return value->type->size == dce->fn->slots[ptr->index]->size;
+}
+
+/**
+ * Marks the values the instructions with effects need, transitively, and
+ * removes the others.  Marking rather than counting uses also catches the
+ * cycles of values only needed by each other, such as a phi and the
+ * increment feeding it back around a loop.
+ */
+static bool
+ir_dce_remove_dead_values(ir_dce_t *dce)
+{
+    ir_function_t *fn = dce->fn;
+    vector_t *instrs = &dce->instrs;
+    vector_truncate(instrs, 0);
+
+    bool *live = (bool *)ir_dce_alloc(&dce->arena, fn->values_size);
+    memset(live, 0, fn->values_size);
+
+    for (ir_block_t *block = fn->first; block != NULL; block = block->next) {
+        for (ir_instr_t *instr = block->first; instr != NULL;
+             instr = instr->next) {
+            if (ir_dce_has_effects(instr)) {
+                live[instr->id] = true;
+                vector_push(instrs, instr);
+            }
+        }
+    }
+
+    while (vector_size(instrs) > 0) {
+        size_t size = vector_size(instrs);
+        ir_instr_t *instr = (ir_instr_t *)vector_get(instrs, size - 1);
+        vector_truncate(instrs, size - 1);
+
+        for (uint32_t i = 0; i < instr->operands_size; ++i) {
+            ir_instr_t *value = ir_instr_operand(instr, i);
+            if (!live[value->id]) {
+                live[value->id] = true;
+                vector_push(instrs, value);
+            }
+        }
+    }
+
+    // The dead values may use each other, all their uses are dropped before
+    // any of them goes.
+    bool changed = false;
+    for (ir_block_t *block = fn->first; block != NULL; block = block->next) {
+        for (ir_instr_t *instr = block->first; instr != NULL;
+             instr = instr->next) {
+            if (live[instr->id]) {
+                continue;
+            }
+            for (uint32_t i = 0; i < instr->operands_size; ++i) {
+                ir_instr_set_operand(instr, i, NULL);
+            }
+            changed = true;
+        }
+    }
+
+    if (!changed) {
+        return false;
+    }
+
+    for (ir_block_t *block = fn->first; block != NULL; block = block->next) {
+        ir_instr_t *next = NULL;
+        for (ir_instr_t *instr = block->first; instr != NULL; instr = next) {
+            next = instr->next;
+            if (!live[instr->id]) {
+                ir_instr_remove(instr);
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Whether instr must run even if its result is unused.  A division traps
+ * when its divisor is zero, so it only goes when the divisor is a nonzero
+ * constant.
+ */
+static bool
+ir_dce_has_effects(ir_instr_t *instr)
+{
+    switch (instr->op) {
+        case IR_STORE:
+        case IR_CALL:
+        case IR_JMP:
+        case IR_BR:
+        case IR_RET:
+            return true;
+        case IR_DIV:
+        case IR_REM: {
+            ir_instr_t *divisor = ir_instr_operand(instr, 1);
+            return divisor->op != IR_CONST || divisor->imm == 0;
+        }
+        default:
+            return false;
+    }
+}
+
+/**
+ * Drops the slots no address refers to anymore, the remaining ones are
+ * renumbered in order.
+ */
+static bool
+ir_dce_remove_unused_slots(ir_dce_t *dce)
+{
+    ir_function_t *fn = dce->fn;
+    if (fn->slots_size == 0) {
+        return false;
+    }
+
+    uint32_t *slots = (uint32_t *)ir_dce_alloc(
+        &dce->arena, fn->slots_size * sizeof(uint32_t));
+    for (uint32_t i = 0; i < fn->slots_size; ++i) {
+        slots[i] = UINT32_MAX;
+    }
+
+    for (ir_block_t *block = fn->first; block != NULL; block = block->next) {
+        for (ir_instr_t *instr = block->first; instr != NULL;
+             instr = instr->next) {
+            if (instr->op == IR_ADDR) {
+                slots[instr->index] = 0;
+            }
+        }
+    }
+
+    uint32_t slots_size = 0;
+    for (uint32_t i = 0; i < fn->slots_size; ++i) {
+        if (slots[i] != UINT32_MAX) {
+            fn->slots[slots_size] = fn->slots[i];
+            slots[i] = slots_size++;
+        }
+    }
+
+    if (slots_size == fn->slots_size) {
+        return false;
+    }
+
+    for (ir_block_t *block = fn->first; block != NULL; block = block->next) {
+        for (ir_instr_t *instr = block->first; instr != NULL;
+             instr = instr->next) {
+            if (instr->op == IR_ADDR) {
+                instr->index = slots[instr->index];
+            }
+        }
+    }
+    fn->slots_size = slots_size;
+    return true;
+}
+
+/**
+ * Merges the blocks jumped to from a single predecessor into it, and threads
+ * the edges going into blocks holding nothing but a jump.  Each step can
+ * enable others, so it goes on until none applies.
+ */
+static bool
+ir_dce_simplify_cfg(ir_dce_t *dce)
+{
+    ir_function_t *fn = dce->fn;
+    bool changed = false;
+    bool progress = true;
+
+    while (progress) {
+        progress = false;
+
+        ir_block_t *next = NULL;
+        for (ir_block_t *block = fn->first->next; block != NULL;
+             block = next) {
+            next = block->next;
+
+            if (block->preds_size == 1 && block->preds[0] != block &&
+                ir_block_terminator(block->preds[0])->op == IR_JMP) {
+                ir_block_merge_into_pred(block);
+                progress = true;
+                continue;
+            }
+
+            if (ir_dce_thread_edges(block)) {
+                progress = true;
+            }
+        }
+
+        changed = changed || progress;
+    }
+
+    return changed;
+}
+
+/**
+ * When block holds nothing but a jump, sends its predecessors straight to
+ * the target, and removes block once none is left.  A predecessor already
+ * jumping to the target is left alone, unless the target has no phis to
+ * tell the two edges apart, its branch then becomes a jump.
+ */
+static bool
+ir_dce_thread_edges(ir_block_t *block)
+{
+    ir_instr_t *jmp = block->first;
+    if (jmp->op != IR_JMP || jmp->targets[0] == block) {
+        return false;
+    }
+
+    ir_block_t *target = jmp->targets[0];
+    bool has_phis = target->first->op == IR_PHI;
+    bool changed = false;
+
+    for (uint32_t i = block->preds_size; i > 0; --i) {
+        ir_block_t *pred = block->preds[i - 1];
+        if (ir_block_pred_index(target, pred) == UINT32_MAX) {
+            ir_block_thread_edge(block, pred);
+            changed = true;
+        } else if (!has_phis) {
+            ir_instr_t *br = ir_block_terminator(pred);
+            ir_block_fold_br(pred, br->targets[0] == target ? 0 : 1);
+            changed = true;
+        }
+    }
+
+    if (block->preds_size == 0) {
+        ir_block_remove(block);
+    }
+    return changed;
+}
+
+static void *
+ir_dce_alloc(arena_t *arena, size_t size)
+{
+    void *ptr = arena_alloc(arena, size);
+    if (ptr == NULL) {
+        fprintf(stderr,
+                "[FATAL] Out of memory: ir_dce_alloc: %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef IR_DCE_H
+#define IR_DCE_H
+
+#include <stdbool.h>
+
+#include "ir.h"
+#include "ir_analysis.h"
+
+/**
+ * Dead code elimination.  Removes the blocks unreachable from the entry,
+ * the stores to memory slots never loaded afterwards, and the values whose
+ * computation has no effect and whose result is not needed, phis feeding
+ * only each other around a loop included.  The control flow left is then
+ * tidied up: a block jumped to from a single predecessor is merged into it,
+ * and edges into blocks holding nothing but a jump go to its target instead.
+ * Returns whether fn changed.
+ */
+bool
+ir_dce_run(ir_function_t *fn, ir_analysis_t *analysis);
+
+#endif
@@ -0,0 +1,407 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ir_gvn.h"
+
+#define IR_GVN_ARENA_CAPACITY (1024 * 16)
+
+typedef struct ir_gvn_entry
+{
+    ir_op_t op;
+    type_t *type;
+    // NULL past the operands of op.
+    ir_instr_t *operands[2];
+    // IR_CONST value, IR_PARAM and IR_ADDR index, memory state of IR_LOAD.
+    uint64_t imm;
+    uint32_t hash;
+    ir_instr_t *value;
+    struct ir_gvn_entry *next;
+} ir_gvn_entry_t;
+
+typedef struct ir_gvn_frame
+{
+    ir_block_t *block;
+    // Next child to visit in the dominator tree.
+    uint32_t child;
+    // Entries in the table on entry of block.
+    uint32_t entries_size;
+} ir_gvn_frame_t;
+
+typedef struct ir_gvn
+{
+    arena_t arena;
+    ir_function_t *fn;
+    const ir_dom_tree_t *dom_tree;
+    // Hash table chaining the entries, buckets_size is a power of two.
+    ir_gvn_entry_t **buckets;
+    uint32_t buckets_size;
+    // In the order they were added, one at most per instruction.  Entries
+    // are only ever removed last in first out, so each one is the head of
+    // its chain when it goes.
+    ir_gvn_entry_t *entries;
+    uint32_t entries_size;
+    // Memory states, the first for the memory reached through any pointer
+    // and one for each slot not escaped, UINT32_MAX for the escaped ones.
+    // Every change takes a fresh number out of states_size.
+    uint32_t *memory;
+    uint32_t memory_size;
+    uint32_t states_size;
+    // Memory states on exit of every block, indexed by block id.
+    uint32_t *memory_out;
+    bool changed;
+} ir_gvn_t;
+
+static void *
+ir_gvn_alloc(arena_t *arena, size_t size);
+
+static void
+ir_gvn_init(ir_gvn_t *gvn, ir_function_t *fn, ir_analysis_t *analysis);
+
+static void
+ir_gvn_visit_block(ir_gvn_t *gvn, ir_block_t *block);
+
+static void
+ir_gvn_visit(ir_gvn_t *gvn, ir_instr_t *instr);
+
+static bool
+ir_gvn_key(ir_gvn_t *gvn, ir_instr_t *instr, ir_gvn_entry_t *key);
+
+static uint32_t *
+ir_gvn_memory_of(ir_gvn_t *gvn, ir_instr_t *ptr);
+
+static ir_gvn_entry_t *
+ir_gvn_lookup(ir_gvn_t *gvn, ir_gvn_entry_t *key);
+
+static void
+ir_gvn_insert(ir_gvn_t *gvn, ir_gvn_entry_t *key, ir_instr_t *value);
+
+static void
+ir_gvn_pop(ir_gvn_t *gvn, uint32_t entries_size);
+
+static uint32_t
+ir_gvn_hash(ir_gvn_entry_t *key);
+
+bool
+ir_gvn_run(ir_function_t *fn, ir_analysis_t *analysis)
+{
+    ir_gvn_t gvn;
+    ir_gvn_init(&gvn, fn, analysis);
+
+    const ir_cfg_t *cfg = ir_analysis_cfg(analysis);
+    ir_gvn_frame_t *frames = (ir_gvn_frame_t *)ir_gvn_alloc(
+        &gvn.arena, cfg->rpo_size * sizeof(ir_gvn_frame_t));
+    uint32_t frames_size = 0;
+
+    frames[frames_size++] = (ir_gvn_frame_t){ fn->first, 0, 0 };
+    ir_gvn_visit_block(&gvn, fn->first);
+
+    // Preorder walk of the dominator tree, the values of a block are in the
+    // table while the blocks it dominates are visited.
+    while (frames_size > 0) {
+        ir_gvn_frame_t *frame = &frames[frames_size - 1];
+        const ir_dom_node_t *node = &gvn.dom_tree->nodes[frame->block->id];
+
+        if (frame->child == node->children_size) {
+            ir_gvn_pop(&gvn, frame->entries_size);
+            --frames_size;
+            continue;
+        }
+
+        ir_block_t *child = node->children[frame->child++];
+        frames[frames_size++] =
+            (ir_gvn_frame_t){ child, 0, gvn.entries_size };
+        ir_gvn_visit_block(&gvn, child);
+    }
+
+    if (gvn.changed) {
+        ir_analysis_invalidate(analysis, IR_ANALYSIS_LIVENESS);
+    }
+
+    arena_free(&gvn.arena);
+    return gvn.changed;
+}
+
+static void
+ir_gvn_init(ir_gvn_t *gvn, ir_function_t *fn, ir_analysis_t *analysis)
+{
+    gvn->arena = arena_new(IR_GVN_ARENA_CAPACITY);
+    gvn->fn = fn;
+    gvn->dom_tree = ir_analysis_dom_tree(analysis);
+    gvn->changed = false;
+
+    gvn->buckets_size = 16;
+    while (gvn->buckets_size < fn->values_size) {
+        gvn->buckets_size *= 2;
+    }
+    gvn->buckets = (ir_gvn_entry_t **)ir_gvn_alloc(
+        &gvn->arena, gvn->buckets_size * sizeof(ir_gvn_entry_t *));
+    memset(gvn->buckets, 0, gvn->buckets_size * sizeof(ir_gvn_entry_t *));
+
+    gvn->entries = (ir_gvn_entry_t *)ir_gvn_alloc(
+        &gvn->arena, fn->values_size * sizeof(ir_gvn_entry_t));
+    gvn->entries_size = 0;
+
+    gvn->memory_size = 1 + fn->slots_size;
+    gvn->memory = (uint32_t *)ir_gvn_alloc(
+        &gvn->arena, gvn->memory_size * sizeof(uint32_t));
+    gvn->memory_out = (uint32_t *)ir_gvn_alloc(
+        &gvn->arena,
+        (size_t)fn->blocks_size * gvn->memory_size * sizeof(uint32_t));
+    gvn->states_size = 0;
+
+    // Escaped slots are part of the memory reached through pointers.
+    bool *escaped = (bool *)ir_gvn_alloc(&gvn->arena, fn->slots_size);
+    ir_function_find_escaped_slots(fn, escaped);
+    for (uint32_t i = 0; i < fn->slots_size; ++i) {
+        gvn->memory[1 + i] = escaped[i] ? UINT32_MAX : 0;
+    }
+}
+
+static void
+ir_gvn_visit_block(ir_gvn_t *gvn, ir_block_t *block)
+{
+    // Along a single edge from the dominator, memory is as that block left
+    // it.  Stores on any other path could reach a join or a loop header.
+    ir_block_t *idom = gvn->dom_tree->nodes[block->id].idom;
+    if (idom != NULL && block->preds_size == 1 && block->preds[0] == idom) {
+        memcpy(gvn->memory,
+               gvn->memory_out + (size_t)idom->id * gvn->memory_size,
+               gvn->memory_size * sizeof(uint32_t));
+    } else {
+        uint32_t state = gvn->states_size++;
+        for (uint32_t i = 0; i < gvn->memory_size; ++i) {
+            if (gvn->memory[i] != UINT32_MAX) {
+                gvn->memory[i] = state;
+            }
+        }
+    }
+
+    ir_instr_t *next = NULL;
+    for (ir_instr_t *instr = block->first; instr != NULL; instr = next) {
+        next = instr->next;
+        ir_gvn_visit(gvn, instr);
+    }
+
+    memcpy(gvn->memory_out + (size_t)block->id * gvn->memory_size,
+           gvn->memory,
+           gvn->memory_size * sizeof(uint32_t));
+}
+
+static void
+ir_gvn_visit(ir_gvn_t *gvn, ir_instr_t *instr)
+{
+    ir_gvn_entry_t key;
+
+    switch (instr->op) {
+        case IR_CALL:
+            // The callee can store through any pointer it is given or holds,
+            // not to the slots whose address never escaped.
+            gvn->memory[0] = gvn->states_size++;
+            return;
+
+        case IR_STORE: {
+            ir_instr_t *ptr = ir_instr_operand(instr, 0);
+            ir_instr_t *value = ir_instr_operand(instr, 1);
+
+            *ir_gvn_memory_of(gvn, ptr) = gvn->states_size++;
+
+            // Until memory changes again, loading ptr gives value back.
+            key.op = IR_LOAD;
+            key.type = value->type;
+            key.operands[0] = ptr;
+            key.operands[1] = NULL;
+            key.imm = *ir_gvn_memory_of(gvn, ptr);
+            ir_gvn_insert(gvn, &key, value);
+            return;
+        }
+
+        default:
+            break;
+    }
+
+    if (!ir_gvn_key(gvn, instr, &key)) {
+        return;
+    }
+
+    ir_gvn_entry_t *entry = ir_gvn_lookup(gvn, &key);
+    if (entry == NULL) {
+        ir_gvn_insert(gvn, &key, instr);
+        return;
+    }
+
+    ir_instr_replace_uses(instr, entry->value);
+    ir_instr_remove(instr);
+    gvn->changed = true;
+}
+
+/**
+ * Fills key with what tells the value of instr apart, returns false when
+ * instr is not numbered.
+ */
+static bool
+ir_gvn_key(ir_gvn_t *gvn, ir_instr_t *instr, ir_gvn_entry_t *key)
+{
+    key->op = instr->op;
+    key->type = instr->type;
+    key->operands[0] = NULL;
+    key->operands[1] = NULL;
+    key->imm = 0;
+
+    switch (instr->op) {
+        case IR_CONST:
+            key->imm = instr->imm;
+            return true;
+        case IR_PARAM:
+        case IR_ADDR:
+            key->imm = instr->index;
+            return true;
+        case IR_NOT:
+        case IR_ZEXT:
+        case IR_TRUNC:
+            key->operands[0] = ir_instr_operand(instr, 0);
+            return true;
+        case IR_LOAD:
+            key->operands[0] = ir_instr_operand(instr, 0);
+            key->imm = *ir_gvn_memory_of(gvn, key->operands[0]);
+            return true;
+        default:
+            break;
+    }
+
+    if (!ir_op_is_binary(instr->op) && !ir_op_is_cmp(instr->op)) {
+        return false;
+    }
+
+    ir_instr_t *lhs = ir_instr_operand(instr, 0);
+    ir_instr_t *rhs = ir_instr_operand(instr, 1);
+
+    // a > b is b < a, and a >= b is b <= a.
+    if (instr->op == IR_GT || instr->op == IR_GE) {
+        key->op = instr->op == IR_GT ? IR_LT : IR_LE;
+        ir_instr_t *tmp = lhs;
+        lhs = rhs;
+        rhs = tmp;
+    } else if (ir_op_is_commutative(instr->op) && lhs->id > rhs->id) {
+        ir_instr_t *tmp = lhs;
+        lhs = rhs;
+        rhs = tmp;
+    }
+
+    key->operands[0] = lhs;
+    key->operands[1] = rhs;
+    return true;
+}
+
+/**
+ * The memory state a store through ptr changes and a load through it reads.
+ */
+static uint32_t *
+ir_gvn_memory_of(ir_gvn_t *gvn, ir_instr_t *ptr)
+{
+    if (ptr->op == IR_ADDR && gvn->memory[1 + ptr->index] != UINT32_MAX) {
+        return &gvn->memory[1 + ptr->index];
+    }
+    return &gvn->memory[0];
+}
+
+static uint32_t
+ir_gvn_hash(ir_gvn_entry_t *key)
+{
+    // FNV-1a over the fields.
+    uint64_t fields[] = {
+        key->op,
+        (uintptr_t)key->type,
+        key->operands[0] ? key->operands[0]->id : UINT32_MAX,
+        key->operands[1] ? key->operands[1]->id : UINT32_MAX,
+        key->imm,
+    };
+
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i) {
+        hash ^= fields[i];
+        hash *= 0x100000001b3ull;
+    }
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+static ir_gvn_entry_t *
+ir_gvn_lookup(ir_gvn_t *gvn, ir_gvn_entry_t *key)
+{
+    key->hash = ir_gvn_hash(key);
+
+    ir_gvn_entry_t *entry = gvn->buckets[key->hash & (gvn->buckets_size - 1)];
+    for (; entry != NULL; entry = entry->next) {
+        if (entry->hash == key->hash && entry->op == key->op &&
+            entry->type == key->type &&
+            entry->operands[0] == key->operands[0] &&
+            entry->operands[1] == key->operands[1] &&
+            entry->imm == key->imm) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void
+ir_gvn_insert(ir_gvn_t *gvn, ir_gvn_entry_t *key, ir_instr_t *value)
+{
+    assert(gvn->entries_size < gvn->fn->values_size);
+
+    ir_gvn_entry_t *entry = &gvn->entries[gvn->entries_size++];
+    *entry = *key;
+    entry->hash = ir_gvn_hash(key);
+    entry->value = value;
+
+    ir_gvn_entry_t **bucket =
+        &gvn->buckets[entry->hash & (gvn->buckets_size - 1)];
+    entry->next = *bucket;
+    *bucket = entry;
+}
+
+/**
+ * Removes the entries added after the first entries_size ones.
+ */
+static void
+ir_gvn_pop(ir_gvn_t *gvn, uint32_t entries_size)
+{
+    while (gvn->entries_size > entries_size) {
+        ir_gvn_entry_t *entry = &gvn->entries[--gvn->entries_size];
+        ir_gvn_entry_t **bucket =
+            &gvn->buckets[entry->hash & (gvn->buckets_size - 1)];
+        assert(*bucket == entry);
+        *bucket = entry->next;
+    }
+}
+
+static void *
+ir_gvn_alloc(arena_t *arena, size_t size)
+{
+    void *ptr = arena_alloc(arena, size);
+    if (ptr == NULL) {
+        fprintf(stderr,
+                "[FATAL] Out of memory: ir_gvn_alloc: %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
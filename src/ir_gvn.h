@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef IR_GVN_H
+#define IR_GVN_H
+
+#include <stdbool.h>
+
+#include "ir.h"
+#include "ir_analysis.h"
+
+/**
+ * Dominator-based global value numbering.  The blocks are walked down the
+ * dominator tree with a scoped table of the values computed in the blocks
+ * dominating the current one, keyed by operator, type and operands.  A
+ * value already in the table is replaced by it.  Commutative operands are
+ * ordered first, so a + b and b + a are found equal.
+ *
+ * Loads are keyed by the memory state too, which changes with every store
+ * and call.  The state carries over into a block only from its single
+ * predecessor, when that is the block dominating it.  A slot not escaped
+ * has a state of its own, no store through another pointer and no call can
+ * change it.  A load following a store to the same pointer takes the value
+ * stored.  Returns whether fn changed.
+ */
+bool
+ir_gvn_run(ir_function_t *fn, ir_analysis_t *analysis);
+
+#endif
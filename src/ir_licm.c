@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ir_licm.h"
+
+#define IR_LICM_ARENA_CAPACITY (1024 * 16)
+
+typedef struct ir_licm
+{
+    arena_t arena;
+    ir_function_t *fn;
+    // Indexed by slot.
+    bool *escaped;
+    // What the loop being visited stores to: the slots not escaped indexed
+    // by slot, and whether it stores to anything else or calls.
+    bool *stored_slots;
+    bool stores_memory;
+} ir_licm_t;
+
+static void *
+ir_licm_alloc(arena_t *arena, size_t size);
+
+static bool
+ir_licm_insert_preheaders(ir_licm_t *licm, const ir_loop_forest_t *loops);
+
+static ir_block_t *
+ir_licm_preheader(const ir_loop_forest_t *loops, ir_loop_t *loop);
+
+static bool
+ir_licm_hoist(ir_licm_t *licm,
+              const ir_loop_forest_t *loops,
+              ir_loop_t *loop);
+
+static void
+ir_licm_find_stores(ir_licm_t *licm, ir_loop_t *loop);
+
+static bool
+ir_licm_is_invariant(const ir_loop_forest_t *loops,
+                     ir_loop_t *loop,
+                     ir_instr_t *instr);
+
+static bool
+ir_licm_can_hoist(ir_licm_t *licm, ir_loop_t *loop, ir_instr_t *instr);
+
+bool
+ir_licm_run(ir_function_t *fn, ir_analysis_t *analysis)
+{
+    const ir_loop_forest_t *loops = ir_analysis_loops(analysis);
+    if (loops->loops_size == 0) {
+        return false;
+    }
+
+    ir_licm_t licm;
+    licm.arena = arena_new(IR_LICM_ARENA_CAPACITY);
+    licm.fn = fn;
+    licm.escaped = (bool *)ir_licm_alloc(&licm.arena, fn->slots_size + 1);
+    licm.stored_slots =
+        (bool *)ir_licm_alloc(&licm.arena, fn->slots_size + 1);
+    ir_function_find_escaped_slots(fn, licm.escaped);
+
+    bool cfg_changed = ir_licm_insert_preheaders(&licm, loops);
+    if (cfg_changed) {
+        ir_analysis_invalidate(analysis, IR_ANALYSIS_CFG);
+        loops = ir_analysis_loops(analysis);
+    }
+
+    // Inner loops come first, what leaves them lands in the enclosing loop
+    // and is looked at again there.
+    bool changed = false;
+    for (uint32_t i = 0; i < loops->loops_size; ++i) {
+        changed = ir_licm_hoist(&licm, loops, &loops->loops[i]) || changed;
+    }
+
+    if (changed && !cfg_changed) {
+        ir_analysis_invalidate(analysis, IR_ANALYSIS_LIVENESS);
+    }
+
+    arena_free(&licm.arena);
+    return changed || cfg_changed;
+}
+
+/**
+ * Gives a preheader to every loop without one.  The edges from outside the
+ * loop into its header are moved over to a new block, so the loop forest is
+ * out of date for the blocks added only.
+ */
+static bool
+ir_licm_insert_preheaders(ir_licm_t *licm, const ir_loop_forest_t *loops)
+{
+    bool changed = false;
+
+    for (uint32_t i = 0; i < loops->loops_size; ++i) {
+        ir_loop_t *loop = &loops->loops[i];
+        ir_block_t *header = loop->header;
+
+        // Nothing can be placed before the entry.
+        if (header == licm->fn->first ||
+            ir_licm_preheader(loops, loop) != NULL) {
+            continue;
+        }
+
+        ir_block_t **preds = (ir_block_t **)ir_licm_alloc(
+            &licm->arena, header->preds_size * sizeof(ir_block_t *));
+        uint32_t preds_size = 0;
+        for (uint32_t j = 0; j < header->preds_size; ++j) {
+            if (!ir_loop_contains(loops, loop, header->preds[j])) {
+                preds[preds_size++] = header->preds[j];
+            }
+        }
+
+        ir_block_split_preds(header, preds, preds_size);
+        changed = true;
+    }
+
+    return changed;
+}
+
+/**
+ * The single block outside loop jumping to its header, NULL if the header
+ * is entered from several blocks or from a branch.
+ */
+static ir_block_t *
+ir_licm_preheader(const ir_loop_forest_t *loops, ir_loop_t *loop)
+{
+    ir_block_t *header = loop->header;
+    ir_block_t *preheader = NULL;
+
+    for (uint32_t i = 0; i < header->preds_size; ++i) {
+        ir_block_t *pred = header->preds[i];
+        if (ir_loop_contains(loops, loop, pred)) {
+            continue;
+        }
+        if (preheader != NULL) {
+            return NULL;
+        }
+        preheader = pred;
+    }
+
+    if (preheader == NULL ||
+        ir_block_terminator(preheader)->op != IR_JMP) {
+        return NULL;
+    }
+    return preheader;
+}
+
+/**
+ * Moves the invariant values of loop to its preheader.  The blocks are
+ * visited in reverse postorder, so a value comes after its operands
+ * defined in the loop, and is moved once they all are.
+ */
+static bool
+ir_licm_hoist(ir_licm_t *licm,
+              const ir_loop_forest_t *loops,
+              ir_loop_t *loop)
+{
+    ir_block_t *preheader = ir_licm_preheader(loops, loop);
+    if (preheader == NULL) {
+        return false;
+    }
+
+    ir_licm_find_stores(licm, loop);
+
+    ir_instr_t *pos = ir_block_terminator(preheader);
+    bool changed = false;
+
+    for (uint32_t i = 0; i < loop->blocks_size; ++i) {
+        ir_instr_t *next = NULL;
+        for (ir_instr_t *instr = loop->blocks[i]->first; instr != NULL;
+             instr = next) {
+            next = instr->next;
+            if (ir_licm_can_hoist(licm, loop, instr) &&
+                ir_licm_is_invariant(loops, loop, instr)) {
+                ir_instr_move_before(pos, instr);
+                changed = true;
+            }
+        }
+    }
+
+    return changed;
+}
+
+static void
+ir_licm_find_stores(ir_licm_t *licm, ir_loop_t *loop)
+{
+    memset(licm->stored_slots, 0, licm->fn->slots_size * sizeof(bool));
+    licm->stores_memory = false;
+
+    for (uint32_t i = 0; i < loop->blocks_size; ++i) {
+        for (ir_instr_t *instr = loop->blocks[i]->first; instr != NULL;
+             instr = instr->next) {
+            if (instr->op == IR_CALL) {
+                licm->stores_memory = true;
+                continue;
+            }
+            if (instr->op != IR_STORE) {
+                continue;
+            }
+
+            ir_instr_t *ptr = ir_instr_operand(instr, 0);
+            if (ptr->op == IR_ADDR && !licm->escaped[ptr->index]) {
+                licm->stored_slots[ptr->index] = true;
+            } else {
+                licm->stores_memory = true;
+            }
+        }
+    }
+}
+
+static bool
+ir_licm_is_invariant(const ir_loop_forest_t *loops,
+                     ir_loop_t *loop,
+                     ir_instr_t *instr)
+{
+    for (uint32_t i = 0; i < instr->operands_size; ++i) {
+        ir_instr_t *value = ir_instr_operand(instr, i);
+        if (ir_loop_contains(loops, loop, value->block)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Whether instr can run on every entry of loop, whatever it depends on.
+ */
+static bool
+ir_licm_can_hoist(ir_licm_t *licm, ir_loop_t *loop, ir_instr_t *instr)
+{
+    switch (instr->op) {
+        case IR_PARAM:
+        case IR_PHI:
+        case IR_STORE:
+        case IR_CALL:
+        case IR_JMP:
+        case IR_BR:
+        case IR_RET:
+            return false;
+
+        case IR_DIV:
+        case IR_REM: {
+            ir_instr_t *divisor = ir_instr_operand(instr, 1);
+            return divisor->op == IR_CONST && divisor->imm != 0;
+        }
+
+        case IR_LOAD: {
+            ir_instr_t *ptr = ir_instr_operand(instr, 0);
+            if (ptr->op == IR_ADDR && !licm->escaped[ptr->index]) {
+                return !licm->stored_slots[ptr->index];
+            }
+
+            // The header runs whenever the loop is entered, a pointer
+            // loaded there is valid on entry.
+            return !licm->stores_memory &&
+                   (ptr->op == IR_ADDR || instr->block == loop->header);
+        }
+
+        default:
+            return true;
+    }
+}
+
+static void *
+ir_licm_alloc(arena_t *arena, size_t size)
+{
+    void *ptr = arena_alloc(arena, size);
+    if (ptr == NULL) {
+        fprintf(stderr,
+                "[FATAL] Out of memory: ir_licm_alloc: %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef IR_LICM_H
+#define IR_LICM_H
+
+#include <stdbool.h>
+
+#include "ir.h"
+#include "ir_analysis.h"
+
+/**
+ * Loop-invariant code motion.  Every loop is given a preheader, a block
+ * entered from outside the loop only and jumping to its header, and the
+ * values computed the same on every iteration move there, inner loops
+ * first so they can keep moving out of the enclosing ones.
+ *
+ * A value is invariant when its operands are defined outside the loop.  A
+ * division only moves with a nonzero constant divisor, it could trap in a
+ * loop never entered.  A load moves when nothing in the loop can store to
+ * the memory it reads: for a slot not escaped, no store to its address;
+ * otherwise no store through another pointer and no call.  It must also be
+ * safe to execute on entry: loads of slots always are, loads through any
+ * other pointer only from the header.  Returns whether fn changed.
+ */
+bool
+ir_licm_run(ir_function_t *fn, ir_analysis_t *analysis);
+
+#endif
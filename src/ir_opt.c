@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ir_analysis.h"
+#include "ir_dce.h"
+#include "ir_gvn.h"
+#include "ir_licm.h"
+#include "ir_opt.h"
+#include "ir_sccp.h"
+
+typedef bool (*ir_pass_fn_t)(ir_function_t *fn, ir_analysis_t *analysis);
+
+// In the order they run.
+static const ir_pass_fn_t ir_passes[] = {
+    ir_sccp_run,
+    ir_dce_run,
+    ir_gvn_run,
+    ir_licm_run,
+    // Hoisted values meet the ones computed before the loop.
+    ir_gvn_run,
+    // Reused values leave stores and loads behind, and the preheaders left
+    // empty go.
+    ir_dce_run,
+};
+
+static void
+ir_optimize_function(ir_function_t *fn);
+
+void
+ir_optimize_module(ir_module_t *module)
+{
+    for (ir_function_t *fn = module->first; fn != NULL; fn = fn->next) {
+        if (!fn->_extern) {
+            ir_optimize_function(fn);
+        }
+    }
+}
+
+static void
+ir_optimize_function(ir_function_t *fn)
+{
+    ir_analysis_t analysis;
+    ir_analysis_init(&analysis, fn);
+
+    for (size_t i = 0; i < sizeof(ir_passes) / sizeof(ir_passes[0]); ++i) {
+        ir_passes[i](fn, &analysis);
+        assert(ir_function_verify(fn));
+    }
+
+    ir_analysis_free(&analysis);
+
+    // Removed values and blocks leave holes in the ids.
+    ir_function_renumber(fn);
+}
@@ -14,39 +14,17 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
-#ifndef LIST_H
-#define LIST_H
-#include "arena.h"
+#ifndef IR_OPT_H
+#define IR_OPT_H
 
-typedef struct list_item
-{
-    void *value;
-    struct list_item *next;
-} list_item_t;
-
-typedef struct list
-{
-    size_t size;
-    arena_t *arena;
-    list_item_t *head;
-    list_item_t *tail;
-} list_t;
-
-void
-list_init(list_t *list, arena_t *arena);
+#include "ir.h"
 
+/**
+ * Runs the optimization passes over every function of module, in place.
+ * The passes share the analyses of a function and invalidate what they
+ * change.
+ */
 void
-list_append(list_t *list, void *value);
-
-list_item_t *
-list_get(list_t *list, size_t index);
-
-list_item_t *
-list_head(list_t *list);
-
-list_item_t *
-list_next(list_item_t *item);
+ir_optimize_module(ir_module_t *module);
 
-size_t
-list_size(list_t *list);
 #endif
@@ -0,0 +1,481 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ir_sccp.h"
+#include "vector.h"
+
+#define IR_SCCP_ARENA_CAPACITY (1024 * 16)
+
+typedef enum ir_sccp_state
+{
+    // No definition reached yet.
+    IR_SCCP_UNDEF,
+    IR_SCCP_CONST,
+    IR_SCCP_VARYING
+} ir_sccp_state_t;
+
+typedef struct ir_sccp_value
+{
+    ir_sccp_state_t state;
+    uint64_t imm;
+} ir_sccp_value_t;
+
+typedef struct ir_sccp
+{
+    arena_t arena;
+    ir_function_t *fn;
+    // Indexed by value id.
+    ir_sccp_value_t *values;
+    // Indexed by block id.
+    bool *executable;
+    // Executable incoming edges, the ones of block id b start at
+    // edges_start[b] in the order of its predecessors.
+    bool *edges;
+    uint32_t *edges_start;
+    // Blocks reached for the first time, waiting to be visited.
+    ir_block_t **blocks;
+    uint32_t blocks_size;
+    // Instructions to evaluate again as an operand changed.
+    vector_t instrs;
+    // Whether edges were dropped.
+    bool cfg_changed;
+} ir_sccp_t;
+
+static void *
+ir_sccp_alloc(arena_t *arena, size_t size);
+
+static void
+ir_sccp_init(ir_sccp_t *sccp, ir_function_t *fn);
+
+static void
+ir_sccp_solve(ir_sccp_t *sccp);
+
+static void
+ir_sccp_visit(ir_sccp_t *sccp, ir_instr_t *instr);
+
+static ir_sccp_value_t
+ir_sccp_eval(ir_sccp_t *sccp, ir_instr_t *instr);
+
+static void
+ir_sccp_mark_edge(ir_sccp_t *sccp, ir_block_t *from, ir_block_t *to);
+
+static bool
+ir_sccp_rewrite(ir_sccp_t *sccp);
+
+static void
+ir_sccp_remove_dead_blocks(ir_sccp_t *sccp);
+
+static void
+ir_sccp_remove_trivial_phis(ir_sccp_t *sccp);
+
+static void
+ir_sccp_remove_unused_consts(ir_sccp_t *sccp);
+
+bool
+ir_sccp_run(ir_function_t *fn, ir_analysis_t *analysis)
+{
+    ir_sccp_t sccp;
+    ir_sccp_init(&sccp, fn);
+    ir_sccp_solve(&sccp);
+
+    bool changed = ir_sccp_rewrite(&sccp);
+    ir_sccp_remove_dead_blocks(&sccp);
+
+    if (sccp.cfg_changed) {
+        ir_sccp_remove_trivial_phis(&sccp);
+        ir_analysis_invalidate(analysis, IR_ANALYSIS_CFG);
+    } else if (changed) {
+        ir_analysis_invalidate(analysis, IR_ANALYSIS_LIVENESS);
+    }
+    changed = changed || sccp.cfg_changed;
+
+    if (changed) {
+        ir_sccp_remove_unused_consts(&sccp);
+    }
+
+    arena_free(&sccp.arena);
+    return changed;
+}
+
+static void
+ir_sccp_init(ir_sccp_t *sccp, ir_function_t *fn)
+{
+    sccp->arena = arena_new(IR_SCCP_ARENA_CAPACITY);
+    sccp->fn = fn;
+
+    size_t values_bytes = fn->values_size * sizeof(ir_sccp_value_t);
+    sccp->values = (ir_sccp_value_t *)ir_sccp_alloc(&sccp->arena, values_bytes);
+    memset(sccp->values, 0, values_bytes);
+
+    sccp->executable = (bool *)ir_sccp_alloc(&sccp->arena, fn->blocks_size);
+    memset(sccp->executable, 0, fn->blocks_size);
+
+    sccp->edges_start = (uint32_t *)ir_sccp_alloc(
+        &sccp->arena, fn->blocks_size * sizeof(uint32_t));
+    uint32_t edges_size = 0;
+    for (ir_block_t *block = fn->first; block != NULL; block = block->next) {
+        sccp->edges_start[block->id] = edges_size;
+        edges_size += block->preds_size;
+    }
+    sccp->edges = (bool *)ir_sccp_alloc(&sccp->arena, edges_size);
+    memset(sccp->edges, 0, edges_size);
+
+    sccp->blocks = (ir_block_t **)ir_sccp_alloc(
+        &sccp->arena, fn->blocks_size * sizeof(ir_block_t *));
+    sccp->blocks_size = 0;
+
+    vector_init(&sccp->instrs, &sccp->arena);
+    sccp->cfg_changed = false;
+}
+
+static void
+ir_sccp_solve(ir_sccp_t *sccp)
+{
+    ir_block_t *entry = sccp->fn->first;
+    sccp->executable[entry->id] = true;
+    sccp->blocks[sccp->blocks_size++] = entry;
+
+    while (sccp->blocks_size > 0 || vector_size(&sccp->instrs) > 0) {
+        while (sccp->blocks_size > 0) {
+            ir_block_t *block = sccp->blocks[--sccp->blocks_size];
+            for (ir_instr_t *instr = block->first; instr != NULL;
+                 instr = instr->next) {
+                ir_sccp_visit(sccp, instr);
+            }
+        }
+
+        size_t size = vector_size(&sccp->instrs);
+        if (size > 0) {
+            ir_instr_t *instr =
+                (ir_instr_t *)vector_get(&sccp->instrs, size - 1);
+            vector_truncate(&sccp->instrs, size - 1);
+
+            // Blocks not reached yet are evaluated as a whole once they are.
+            if (sccp->executable[instr->block->id]) {
+                ir_sccp_visit(sccp, instr);
+            }
+        }
+    }
+}
+
+static void
+ir_sccp_visit(ir_sccp_t *sccp, ir_instr_t *instr)
+{
+    ir_block_t *block = instr->block;
+
+    switch (instr->op) {
+        case IR_JMP: {
+            ir_sccp_mark_edge(sccp, block, instr->targets[0]);
+            return;
+        }
+
+        case IR_BR: {
+            ir_sccp_value_t cond =
+                sccp->values[ir_instr_operand(instr, 0)->id];
+            if (cond.state == IR_SCCP_VARYING) {
+                ir_sccp_mark_edge(sccp, block, instr->targets[0]);
+                ir_sccp_mark_edge(sccp, block, instr->targets[1]);
+            } else if (cond.state == IR_SCCP_CONST) {
+                ir_sccp_mark_edge(
+                    sccp, block, instr->targets[cond.imm != 0 ? 0 : 1]);
+            }
+            return;
+        }
+
+        case IR_RET:
+        case IR_STORE:
+            return;
+
+        default:
+            break;
+    }
+
+    ir_sccp_value_t *value = &sccp->values[instr->id];
+    ir_sccp_value_t result = ir_sccp_eval(sccp, instr);
+
+    if (result.state == value->state &&
+        (result.state != IR_SCCP_CONST || result.imm == value->imm)) {
+        return;
+    }
+
+    // Values only ever move down the lattice, so every instruction is only
+    // queued again a bounded number of times.
+    *value = result;
+    for (ir_use_t *use = instr->uses; use != NULL; use = use->next) {
+        vector_push(&sccp->instrs, use->user);
+    }
+}
+
+static ir_sccp_value_t
+ir_sccp_eval(ir_sccp_t *sccp, ir_instr_t *instr)
+{
+    ir_sccp_value_t varying = { .state = IR_SCCP_VARYING };
+    ir_sccp_value_t undef = { .state = IR_SCCP_UNDEF };
+
+    switch (instr->op) {
+        case IR_CONST: {
+            return (ir_sccp_value_t){ .state = IR_SCCP_CONST,
+                                      .imm = instr->imm };
+        }
+
+        case IR_PHI: {
+            // Only the edges known to execute contribute.
+            ir_sccp_value_t result = undef;
+            bool *edges = sccp->edges + sccp->edges_start[instr->block->id];
+
+            for (uint32_t i = 0; i < instr->operands_size; ++i) {
+                if (!edges[i]) {
+                    continue;
+                }
+
+                ir_sccp_value_t operand =
+                    sccp->values[ir_instr_operand(instr, i)->id];
+                if (operand.state == IR_SCCP_UNDEF) {
+                    continue;
+                }
+                if (operand.state == IR_SCCP_VARYING ||
+                    (result.state == IR_SCCP_CONST &&
+                     result.imm != operand.imm)) {
+                    return varying;
+                }
+                result = operand;
+            }
+            return result;
+        }
+
+        case IR_PARAM:
+        case IR_ADDR:
+        case IR_LOAD:
+        case IR_CALL: {
+            return varying;
+        }
+
+        default:
+            break;
+    }
+
+    assert(ir_op_is_binary(instr->op) || instr->op == IR_NOT ||
+           instr->op == IR_ZEXT || instr->op == IR_TRUNC);
+
+    ir_instr_t *lhs = ir_instr_operand(instr, 0);
+    ir_sccp_value_t operands[2] = { sccp->values[lhs->id], undef };
+    if (instr->operands_size > 1) {
+        operands[1] = sccp->values[ir_instr_operand(instr, 1)->id];
+    } else {
+        operands[1].state = IR_SCCP_CONST;
+        operands[1].imm = 0;
+    }
+
+    if (operands[0].state == IR_SCCP_VARYING ||
+        operands[1].state == IR_SCCP_VARYING) {
+        return varying;
+    }
+    if (operands[0].state == IR_SCCP_UNDEF ||
+        operands[1].state == IR_SCCP_UNDEF) {
+        return undef;
+    }
+
+    ir_sccp_value_t result = { .state = IR_SCCP_CONST };
+    if (!ir_fold(instr->op,
+                 lhs->type,
+                 instr->type,
+                 operands[0].imm,
+                 operands[1].imm,
+                 &result.imm)) {
+        return varying;
+    }
+    return result;
+}
+
+static void
+ir_sccp_mark_edge(ir_sccp_t *sccp, ir_block_t *from, ir_block_t *to)
+{
+    uint32_t index = ir_block_pred_index(to, from);
+    bool *edge = &sccp->edges[sccp->edges_start[to->id] + index];
+    if (*edge) {
+        return;
+    }
+    *edge = true;
+
+    if (!sccp->executable[to->id]) {
+        sccp->executable[to->id] = true;
+        sccp->blocks[sccp->blocks_size++] = to;
+        return;
+    }
+
+    // A block already visited only needs its phis to take the new edge in.
+    for (ir_instr_t *phi = to->first; phi != NULL && phi->op == IR_PHI;
+         phi = phi->next) {
+        vector_push(&sccp->instrs, phi);
+    }
+}
+
+/**
+ * Replaces the values found constant and folds the branches on them in the
+ * executed blocks.
+ */
+static bool
+ir_sccp_rewrite(ir_sccp_t *sccp)
+{
+    bool changed = false;
+
+    // The branches go first, the constants created below have no lattice
+    // value.
+    for (ir_block_t *block = sccp->fn->first; block != NULL;
+         block = block->next) {
+        ir_instr_t *terminator = ir_block_terminator(block);
+        if (!sccp->executable[block->id] || terminator->op != IR_BR) {
+            continue;
+        }
+
+        ir_sccp_value_t cond =
+            sccp->values[ir_instr_operand(terminator, 0)->id];
+        // The condition of an executed branch is always evaluated.
+        assert(cond.state != IR_SCCP_UNDEF);
+        if (cond.state == IR_SCCP_CONST) {
+            ir_block_fold_br(block, cond.imm != 0 ? 0 : 1);
+            sccp->cfg_changed = true;
+        }
+    }
+
+    for (ir_block_t *block = sccp->fn->first; block != NULL;
+         block = block->next) {
+        if (!sccp->executable[block->id]) {
+            continue;
+        }
+
+        ir_instr_t *first = block->first;
+        while (first != NULL && first->op == IR_PHI) {
+            first = first->next;
+        }
+
+        ir_instr_t *next = NULL;
+        for (ir_instr_t *instr = block->first; instr != NULL; instr = next) {
+            next = instr->next;
+
+            if (instr->op == IR_CONST || instr->type == NULL ||
+                sccp->values[instr->id].state != IR_SCCP_CONST) {
+                continue;
+            }
+
+            // Every value found constant is pure, it goes away with its
+            // uses.
+            if (ir_instr_has_uses(instr)) {
+                ir_instr_t *value = ir_const_new(
+                    sccp->fn, instr->type, sccp->values[instr->id].imm);
+                ir_instr_insert_before(instr->op == IR_PHI ? first : instr,
+                                       value);
+                ir_instr_replace_uses(instr, value);
+            }
+            ir_instr_remove(instr);
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+/**
+ * Removes the blocks never executed.  Their values can only be used by other
+ * blocks never executed and by the phis along the edges coming from them.
+ */
+static void
+ir_sccp_remove_dead_blocks(ir_sccp_t *sccp)
+{
+    if (ir_function_remove_dead_blocks(sccp->fn, sccp->executable)) {
+        sccp->cfg_changed = true;
+    }
+}
+
+/**
+ * Dropping edges leaves phis merging a single value, they are replaced by
+ * it.  Replacing a phi can make the phis using it trivial in turn.
+ */
+static void
+ir_sccp_remove_trivial_phis(ir_sccp_t *sccp)
+{
+    vector_t *phis = &sccp->instrs;
+    vector_truncate(phis, 0);
+
+    for (ir_block_t *block = sccp->fn->first; block != NULL;
+         block = block->next) {
+        for (ir_instr_t *phi = block->first; phi != NULL && phi->op == IR_PHI;
+             phi = phi->next) {
+            vector_push(phis, phi);
+        }
+    }
+
+    while (vector_size(phis) > 0) {
+        size_t size = vector_size(phis);
+        ir_instr_t *phi = (ir_instr_t *)vector_get(phis, size - 1);
+        vector_truncate(phis, size - 1);
+
+        // Already removed through another path of the work list.
+        if (phi->block == NULL) {
+            continue;
+        }
+
+        ir_instr_t *value = ir_phi_trivial_value(phi);
+        if (value == NULL) {
+            continue;
+        }
+
+        for (ir_use_t *use = phi->uses; use != NULL; use = use->next) {
+            if (use->user != phi && use->user->op == IR_PHI) {
+                vector_push(phis, use->user);
+            }
+        }
+        ir_instr_replace_uses(phi, value);
+        ir_instr_remove(phi);
+    }
+}
+
+/**
+ * Removes the constants whose users were all folded or removed.
+ */
+static void
+ir_sccp_remove_unused_consts(ir_sccp_t *sccp)
+{
+    for (ir_block_t *block = sccp->fn->first; block != NULL;
+         block = block->next) {
+        ir_instr_t *next = NULL;
+        for (ir_instr_t *instr = block->first; instr != NULL; instr = next) {
+            next = instr->next;
+            if (instr->op == IR_CONST && !ir_instr_has_uses(instr)) {
+                ir_instr_remove(instr);
+            }
+        }
+    }
+}
+
+static void *
+ir_sccp_alloc(arena_t *arena, size_t size)
+{
+    void *ptr = arena_alloc(arena, size);
+    if (ptr == NULL) {
+        fprintf(stderr,
+                "[FATAL] Out of memory: ir_sccp_alloc: %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef IR_SCCP_H
+#define IR_SCCP_H
+
+#include <stdbool.h>
+
+#include "ir.h"
+#include "ir_analysis.h"
+
+/**
+ * Sparse conditional constant propagation ("Constant Propagation with
+ * Conditional Branches", Wegman and Zadeck).  Values are assumed constant
+ * until proven otherwise and blocks unreachable until an executable edge
+ * reaches them, so constants flowing around loops and branches that are
+ * never taken are both found.  Constant values are replaced by IR_CONST,
+ * branches on a constant become jumps and the blocks never executed are
+ * removed.  Returns whether fn changed.
+ */
+bool
+ir_sccp_run(ir_function_t *fn, ir_analysis_t *analysis);
+
+#endif
@@ -15,20 +15,29 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #include "lexer.h"
+#include "lexer_scan.h"
+#include "lexer_tables.h"
 
 #include <assert.h>
-#include <ctype.h>
+#include <errno.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
+
+// Initial token buffer capacity per byte of source code, it is a rough
+// estimate that avoids most of the regrowth on real code.
+#define TOKEN_BUFFER_BYTES_PER_TOKEN 4
+#define TOKEN_BUFFER_MIN_CAPACITY 64
 
 void
-lexer_init(lexer_t *lexer, source_code_t src)
+lexer_init(lexer_t *lexer, source_code_t src, interner_t *interner)
 {
     assert(lexer);
+    assert(interner);
     lexer->src = src;
+    lexer->file_id = source_register(src);
+    lexer->interner = interner;
     lexer->cur.offset = 0;
-    lexer->cur.row = 0;
-    lexer->cur.bol = 0;
 }
 
 static char
@@ -37,15 +46,15 @@ lexer_current_char(lexer_t *lexer);
 static void
 lexer_skip_char(lexer_t *lexer);
 
+static void
+lexer_skip_run(lexer_t *lexer, lexer_scan_class_t cls);
+
 static bool
 lexer_is_eof(lexer_t *lexer);
 
 static bool
 lexer_is_not_eof(lexer_t *lexer);
 
-static bool
-_isspace(char c);
-
 static void
 lexer_init_char_value_token(lexer_t *lexer, token_t *token, token_kind_t kind);
 
@@ -58,40 +67,96 @@ lexer_init_str_value_token(lexer_t *lexer,
 static void
 lexer_init_eof_token(lexer_t *lexer, token_t *token);
 
+static token_loc_t
+lexer_loc(lexer_t *lexer, size_t offset);
+
+static void
+lexer_number_too_large(lexer_t *lexer, lexer_cursor_t cur);
+
+static token_loc_t
+lexer_loc(lexer_t *lexer, size_t offset)
+{
+    // source_register rejects the sources larger than SOURCE_MAX_SIZE, so
+    // any offset into the source, its end included, fits in 32 bits.
+    assert(offset <= SOURCE_MAX_SIZE);
+    return (token_loc_t){
+        .file_id = lexer->file_id,
+        .offset = (uint32_t)offset,
+    };
+}
+
+/**
+ * Reports the integer literal starting at cur, which does not fit in any
+ * integer type, instead of letting its value wrap around.
+ */
+static void
+lexer_number_too_large(lexer_t *lexer, lexer_cursor_t cur)
+{
+    token_loc_t loc = lexer_loc(lexer, cur.offset);
+    string_view_t text = {
+        .chars = lexer->src.code.chars + cur.offset,
+        .size = lexer->cur.offset - cur.offset,
+    };
+
+    fprintf(stderr,
+            "%s:%lu:%lu: syntax error: integer literal '" SV_FMT
+            "' is too large\n",
+            token_loc_to_filepath(loc),
+            token_loc_to_lineno(loc),
+            token_loc_to_colno(loc),
+            SV_ARG(text));
+
+    fprintf(stderr, SV_FMT "\n", SV_ARG(token_loc_to_line(loc)));
+    fprintf(stderr, "%*s\n", (int)token_loc_to_colno(loc), "^");
+
+    exit(EXIT_FAILURE);
+}
+
 static token_kind_t
 lexer_str_to_token_kind(string_view_t text);
 
+static token_kind_t
+lexer_skip_operator(lexer_t *lexer);
+
+static void
+token_buffer_init(token_buffer_t *buffer,
+                  source_code_t src,
+                  uint32_t file_id,
+                  arena_t *arena,
+                  size_t capacity);
+
+static void
+token_buffer_push(token_buffer_t *buffer, token_t *token);
+
+static void
+token_buffer_grow(token_buffer_t *buffer, size_t capacity);
+
+static void *
+token_buffer_realloc(token_buffer_t *buffer,
+                     void *items,
+                     size_t item_size,
+                     size_t capacity);
+
 void
 lexer_next_token(lexer_t *lexer, token_t *token)
 {
+    lexer_skip_run(lexer, LEXER_SCAN_SPACE);
+
+    if (lexer_is_not_eof(lexer) && lexer_current_char(lexer) == '#') {
+        lexer_skip_run(lexer, LEXER_SCAN_NOT_LF);
+    }
+
     if (lexer_is_eof(lexer)) {
         lexer_init_eof_token(lexer, token);
         return;
     }
 
-    char current_char = lexer_current_char(lexer);
+    lexer_cursor_t start_cur = lexer->cur;
+    uint8_t current_char = (uint8_t)lexer_current_char(lexer);
 
-    if (_isspace(current_char)) {
-        while (_isspace(current_char) && lexer_is_not_eof(lexer)) {
-            lexer_skip_char(lexer);
-            current_char = lexer_current_char(lexer);
-        }
-    }
-
-    while (lexer_is_not_eof(lexer)) {
-        if (current_char == '#') {
-            while (current_char != '\n' && lexer_is_not_eof(lexer)) {
-                lexer_skip_char(lexer);
-                current_char = lexer_current_char(lexer);
-            }
-        }
-
-        if (isalpha(current_char)) {
-            lexer_cursor_t start_cur = lexer->cur;
-            while (isalnum(current_char) && lexer_is_not_eof(lexer)) {
-                lexer_skip_char(lexer);
-                current_char = lexer_current_char(lexer);
-            }
+    switch (lexer_char_class[current_char]) {
+        case LEXER_CC_ALPHA: {
+            lexer_skip_run(lexer, LEXER_SCAN_ALNUM);
 
             string_view_t text = {
                 .chars = lexer->src.code.chars + start_cur.offset,
@@ -102,204 +167,34 @@ lexer_next_token(lexer_t *lexer, token_t *token)
                 lexer, token, lexer_str_to_token_kind(text), start_cur);
             return;
         }
-
-        if (isdigit(current_char)) {
-            lexer_cursor_t start_cur = lexer->cur;
-            while (isdigit(current_char) && lexer_is_not_eof(lexer)) {
-                lexer_skip_char(lexer);
-                current_char = lexer_current_char(lexer);
+        case LEXER_CC_DIGIT: {
+            lexer_skip_run(lexer, LEXER_SCAN_DIGIT);
+
+            uint64_t number = 0;
+            for (size_t i = start_cur.offset; i < lexer->cur.offset; ++i) {
+                uint64_t digit = (uint64_t)(lexer->src.code.chars[i] - '0');
+                if (number > (UINT64_MAX - digit) / 10) {
+                    lexer_number_too_large(lexer, start_cur);
+                }
+                number = number * 10 + digit;
             }
 
             lexer_init_str_value_token(lexer, token, TOKEN_NUMBER, start_cur);
+            token->number = number;
             return;
         }
+        case LEXER_CC_OP: {
+            token_kind_t kind = lexer_skip_operator(lexer);
+            assert(kind != TOKEN_UNKNOWN);
 
-        switch (current_char) {
-            case '=': {
-                lexer_cursor_t start_cur = lexer->cur;
-                lexer_skip_char(lexer);
-
-                if (lexer_current_char(lexer) == '=') {
-                    lexer_skip_char(lexer);
-                    lexer_init_str_value_token(
-                        lexer, token, TOKEN_CMP_EQ, start_cur);
-                    return;
-                }
-
-                lexer_init_str_value_token(lexer, token, TOKEN_EQ, start_cur);
-                return;
-            }
-            case '!': {
-                lexer_cursor_t start_cur = lexer->cur;
-                lexer_skip_char(lexer);
-
-                if (lexer_current_char(lexer) == '=') {
-                    lexer_skip_char(lexer);
-                    lexer_init_str_value_token(
-                        lexer, token, TOKEN_CMP_NEQ, start_cur);
-                    return;
-                }
-
-                lexer_init_str_value_token(lexer, token, TOKEN_BANG, start_cur);
-                return;
-            }
-            case '&': {
-                lexer_cursor_t start_cur = lexer->cur;
-                lexer_skip_char(lexer);
-
-                if (lexer_current_char(lexer) == '&') {
-                    lexer_skip_char(lexer);
-                    lexer_init_str_value_token(
-                        lexer, token, TOKEN_LOGICAL_AND, start_cur);
-                    return;
-                }
-
-                lexer_init_str_value_token(lexer, token, TOKEN_AND, start_cur);
-                return;
-            }
-            case '|': {
-                lexer_cursor_t start_cur = lexer->cur;
-                lexer_skip_char(lexer);
-
-                if (lexer_current_char(lexer) == '|') {
-                    lexer_skip_char(lexer);
-                    lexer_init_str_value_token(
-                        lexer, token, TOKEN_LOGICAL_OR, start_cur);
-                    return;
-                }
-
-                lexer_init_str_value_token(lexer, token, TOKEN_PIPE, start_cur);
-                return;
-            }
-            case '<': {
-                lexer_cursor_t start_cur = lexer->cur;
-                lexer_skip_char(lexer);
-
-                switch (lexer_current_char(lexer)) {
-                    case '<': {
-                        lexer_skip_char(lexer);
-                        lexer_init_str_value_token(
-                            lexer, token, TOKEN_BITWISE_LSHIFT, start_cur);
-                        return;
-                    }
-                    case '=': {
-                        lexer_skip_char(lexer);
-                        lexer_init_str_value_token(
-                            lexer, token, TOKEN_CMP_LEQ, start_cur);
-                        return;
-                    }
-                    default: {
-                        lexer_init_str_value_token(
-                            lexer, token, TOKEN_LT, start_cur);
-                        return;
-                    }
-                }
-            }
-            case '>': {
-                lexer_cursor_t start_cur = lexer->cur;
-                lexer_skip_char(lexer);
-
-                switch (lexer_current_char(lexer)) {
-                    case '>': {
-                        lexer_skip_char(lexer);
-                        lexer_init_str_value_token(
-                            lexer, token, TOKEN_BITWISE_RSHIFT, start_cur);
-                        return;
-                    }
-                    case '=': {
-                        lexer_skip_char(lexer);
-                        lexer_init_str_value_token(
-                            lexer, token, TOKEN_CMP_GEQ, start_cur);
-                        return;
-                    }
-                    default: {
-                        lexer_init_str_value_token(
-                            lexer, token, TOKEN_GT, start_cur);
-                        return;
-                    }
-                }
-            }
-            case '^': {
-                lexer_init_char_value_token(lexer, token, TOKEN_CIRCUMFLEX);
-                lexer_skip_char(lexer);
-                return;
-            }
-            case '%': {
-                lexer_init_char_value_token(lexer, token, TOKEN_PERCENT);
-                lexer_skip_char(lexer);
-                return;
-            }
-            case '(': {
-                lexer_init_char_value_token(lexer, token, TOKEN_OPAREN);
-                lexer_skip_char(lexer);
-                return;
-            }
-            case ')': {
-                lexer_init_char_value_token(lexer, token, TOKEN_CPAREN);
-                lexer_skip_char(lexer);
-                return;
-            }
-            case ':': {
-                lexer_init_char_value_token(lexer, token, TOKEN_COLON);
-                lexer_skip_char(lexer);
-                return;
-            }
-            case ',': {
-                lexer_init_char_value_token(lexer, token, TOKEN_COMMA);
-                lexer_skip_char(lexer);
-                return;
-            }
-            case '{': {
-                lexer_init_char_value_token(lexer, token, TOKEN_OCURLY);
-                lexer_skip_char(lexer);
-                return;
-            }
-            case '}': {
-                lexer_init_char_value_token(lexer, token, TOKEN_CCURLY);
-                lexer_skip_char(lexer);
-                return;
-            }
-            case '+': {
-                lexer_init_char_value_token(lexer, token, TOKEN_PLUS);
-                lexer_skip_char(lexer);
-                return;
-            }
-            case '-': {
-                lexer_init_char_value_token(lexer, token, TOKEN_DASH);
-                lexer_skip_char(lexer);
-                return;
-            }
-            case '*': {
-                lexer_init_char_value_token(lexer, token, TOKEN_STAR);
-                lexer_skip_char(lexer);
-                return;
-            }
-            case '~': {
-                lexer_init_char_value_token(lexer, token, TOKEN_TILDE);
-                lexer_skip_char(lexer);
-                return;
-            }
-            case '/': {
-                lexer_init_char_value_token(lexer, token, TOKEN_SLASH);
-                lexer_skip_char(lexer);
-                return;
-            }
-            case '\n': {
-                lexer_init_char_value_token(lexer, token, TOKEN_LF);
-                lexer_skip_char(lexer);
-                return;
-            }
-            default: {
-                lexer_init_char_value_token(lexer, token, TOKEN_UNKNOWN);
-                lexer_skip_char(lexer);
-                return;
-            }
+            lexer_init_str_value_token(lexer, token, kind, start_cur);
+            return;
+        }
+        default: {
+            lexer_init_char_value_token(lexer, token, TOKEN_UNKNOWN);
+            lexer_skip_char(lexer);
+            return;
         }
-    }
-
-    if (lexer_is_eof(lexer)) {
-        lexer_init_eof_token(lexer, token);
-        return;
     }
 }
 
@@ -391,12 +286,14 @@ static void
 lexer_skip_char(lexer_t *lexer)
 {
     assert(lexer->cur.offset < lexer->src.code.size);
-    if (lexer_current_char(lexer) == '\n') {
-        lexer->cur.row++;
-        lexer->cur.bol = ++lexer->cur.offset;
-    } else {
-        lexer->cur.offset++;
-    }
+    lexer->cur.offset++;
+}
+
+static void
+lexer_skip_run(lexer_t *lexer, lexer_scan_class_t cls)
+{
+    lexer->cur.offset = lexer_scan(
+        lexer->src.code.chars, lexer->cur.offset, lexer->src.code.size, cls);
 }
 
 static bool
@@ -411,12 +308,6 @@ lexer_is_not_eof(lexer_t *lexer)
     return !lexer_is_eof(lexer);
 }
 
-static bool
-_isspace(char c)
-{
-    return c != '\n' && isspace(c);
-}
-
 static void
 lexer_init_char_value_token(lexer_t *lexer, token_t *token, token_kind_t kind)
 {
@@ -427,11 +318,7 @@ lexer_init_char_value_token(lexer_t *lexer, token_t *token, token_kind_t kind)
     *token = (token_t){
         .kind = kind,
         .value = str,
-        .loc =
-            (token_loc_t){
-                .src = lexer->src,
-                .cur = lexer->cur,
-            },
+        .loc = lexer_loc(lexer, lexer->cur.offset),
     };
 }
 
@@ -445,14 +332,17 @@ lexer_init_str_value_token(lexer_t *lexer,
         .chars = lexer->src.code.chars + cur.offset,
         .size = lexer->cur.offset - cur.offset,
     };
+
+    atom_t *atom = NULL;
+    if (kind == TOKEN_ID) {
+        atom = interner_intern(lexer->interner, str);
+    }
+
     *token = (token_t){
         .kind = kind,
         .value = str,
-        .loc =
-            (token_loc_t){
-                .src = lexer->src,
-                .cur = cur,
-            },
+        .atom = atom,
+        .loc = lexer_loc(lexer, cur.offset),
     };
 }
 
@@ -463,46 +353,52 @@ lexer_init_eof_token(lexer_t *lexer, token_t *token)
     *token = (token_t){
         .kind = TOKEN_EOF,
         .value = str,
-        .loc =
-            (token_loc_t){
-                .src = lexer->src,
-                .cur = lexer->cur,
-            },
+        .loc = lexer_loc(lexer, lexer->cur.offset),
     };
 }
 
 static token_kind_t
 lexer_str_to_token_kind(string_view_t text)
 {
-    if (string_view_eq_to_cstr(text, "if")) {
-        return TOKEN_IF;
-    }
+    const lexer_keyword_t *keyword =
+        &lexer_keywords[lexer_keyword_slot(text.chars, text.size)];
 
-    if (string_view_eq_to_cstr(text, "else")) {
-        return TOKEN_ELSE;
+    if (keyword->size == text.size &&
+        memcmp(keyword->chars, text.chars, text.size) == 0) {
+        return keyword->kind;
     }
 
-    if (string_view_eq_to_cstr(text, "while")) {
-        return TOKEN_WHILE;
-    }
+    return TOKEN_ID;
+}
 
-    if (string_view_eq_to_cstr(text, "var")) {
-        return TOKEN_VAR;
-    }
+static token_kind_t
+lexer_skip_operator(lexer_t *lexer)
+{
+    // Longest match: walk the DFA as far as it goes and go back to the last
+    // accepting state.
+    uint8_t state = 0;
+    token_kind_t kind = TOKEN_UNKNOWN;
+    lexer_cursor_t accept_cur = lexer->cur;
 
-    if (string_view_eq_to_cstr(text, "extern")) {
-        return TOKEN_EXTERN;
-    }
+    while (lexer_is_not_eof(lexer)) {
+        uint8_t c = (uint8_t)lexer_current_char(lexer);
+        uint8_t next_state = lexer_op_dfa[state][lexer_op_column[c]];
 
-    if (string_view_eq_to_cstr(text, "return")) {
-        return TOKEN_RETURN;
-    }
+        if (next_state == 0) {
+            break;
+        }
+
+        state = next_state;
+        lexer_skip_char(lexer);
 
-    if (string_view_eq_to_cstr(text, "fn")) {
-        return TOKEN_FN;
+        if (lexer_op_accept[state] != TOKEN_UNKNOWN) {
+            kind = (token_kind_t)lexer_op_accept[state];
+            accept_cur = lexer->cur;
+        }
     }
 
-    return TOKEN_ID;
+    lexer->cur = accept_cur;
+    return kind;
 }
 
 void
@@ -523,16 +419,163 @@ lexer_lookahead(lexer_t *lexer, token_t *token, size_t n)
     lexer->cur = previous_cur;
 }
 
+void
+lexer_tokenize(lexer_t *lexer, token_buffer_t *buffer, arena_t *arena)
+{
+    assert(lexer);
+    assert(buffer);
+
+    size_t capacity = lexer->src.code.size / TOKEN_BUFFER_BYTES_PER_TOKEN + 1;
+    if (capacity < TOKEN_BUFFER_MIN_CAPACITY) {
+        capacity = TOKEN_BUFFER_MIN_CAPACITY;
+    }
+
+    token_buffer_init(buffer, lexer->src, lexer->file_id, arena, capacity);
+
+    token_t token;
+    do {
+        lexer_next_token(lexer, &token);
+        token_buffer_push(buffer, &token);
+    } while (token.kind != TOKEN_EOF);
+}
+
+void
+token_buffer_get(token_buffer_t *buffer, size_t index, token_t *token)
+{
+    assert(buffer);
+    assert(buffer->size > 0);
+
+    // Reading past the end keeps returning the trailing EOF.
+    if (index >= buffer->size) {
+        index = buffer->size - 1;
+    }
+
+    token_kind_t kind = (token_kind_t)buffer->kinds[index];
+    uint32_t offset = buffer->offsets[index];
+
+    *token = (token_t){
+        .kind = kind,
+        .value =
+            (string_view_t){
+                .chars = buffer->src.code.chars + offset,
+                .size = buffer->lengths[index],
+            },
+        .atom = kind == TOKEN_ID ? buffer->payloads[index].atom : NULL,
+        .number = kind == TOKEN_NUMBER ? buffer->payloads[index].number : 0,
+        .loc =
+            (token_loc_t){
+                .file_id = buffer->file_id,
+                .offset = offset,
+            },
+    };
+}
+
+token_kind_t
+token_buffer_kind(token_buffer_t *buffer, size_t index)
+{
+    assert(buffer);
+    assert(buffer->size > 0);
+
+    if (index >= buffer->size) {
+        index = buffer->size - 1;
+    }
+
+    return (token_kind_t)buffer->kinds[index];
+}
+
+static void
+token_buffer_init(token_buffer_t *buffer,
+                  source_code_t src,
+                  uint32_t file_id,
+                  arena_t *arena,
+                  size_t capacity)
+{
+    *buffer = (token_buffer_t){
+        .src = src,
+        .file_id = file_id,
+        .arena = arena,
+    };
+
+    token_buffer_grow(buffer, capacity);
+}
+
+static void
+token_buffer_push(token_buffer_t *buffer, token_t *token)
+{
+    if (buffer->size == buffer->capacity) {
+        token_buffer_grow(buffer, buffer->capacity * 2);
+    }
+
+    size_t index = buffer->size++;
+
+    buffer->kinds[index] = (uint8_t)token->kind;
+    buffer->offsets[index] = token->loc.offset;
+    // A token lies within a source of at most SOURCE_MAX_SIZE bytes.
+    assert(token->value.size <= SOURCE_MAX_SIZE);
+    buffer->lengths[index] = (uint32_t)token->value.size;
+
+    if (token->kind == TOKEN_NUMBER) {
+        buffer->payloads[index].number = token->number;
+    } else {
+        buffer->payloads[index].atom = token->atom;
+    }
+}
+
+static void *
+token_buffer_realloc(token_buffer_t *buffer,
+                     void *items,
+                     size_t item_size,
+                     size_t capacity)
+{
+    void *new_items = arena_alloc(buffer->arena, item_size * capacity);
+    if (new_items == NULL) {
+        fprintf(stderr,
+                "[FATAL] Out of memory: token_buffer_grow: %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    if (buffer->size > 0) {
+        memcpy(new_items, items, item_size * buffer->size);
+    }
+
+    return new_items;
+}
+
+static void
+token_buffer_grow(token_buffer_t *buffer, size_t capacity)
+{
+    buffer->kinds = token_buffer_realloc(
+        buffer, buffer->kinds, sizeof(*buffer->kinds), capacity);
+    buffer->offsets = token_buffer_realloc(
+        buffer, buffer->offsets, sizeof(*buffer->offsets), capacity);
+    buffer->lengths = token_buffer_realloc(
+        buffer, buffer->lengths, sizeof(*buffer->lengths), capacity);
+    buffer->payloads = token_buffer_realloc(
+        buffer, buffer->payloads, sizeof(*buffer->payloads), capacity);
+
+    buffer->capacity = capacity;
+}
+
+char *
+token_loc_to_filepath(token_loc_t loc)
+{
+    return source_get(loc.file_id).filepath;
+}
+
 string_view_t
 token_loc_to_line(token_loc_t loc)
 {
-    size_t offset = loc.cur.bol;
+    source_code_t src = source_get(loc.file_id);
+    size_t line_index = source_line_index(loc.file_id, loc.offset);
+    size_t offset = source_line_start(loc.file_id, line_index);
+
     string_view_t line = {
-        .chars = loc.src.code.chars + offset,
+        .chars = src.code.chars + offset,
         .size = 0,
     };
 
-    while ((line.size + offset) < loc.src.code.size &&
+    while ((line.size + offset) < src.code.size &&
            line.chars[line.size] != '\n' && line.chars[line.size] != 0) {
         ++line.size;
     }
@@ -543,11 +586,12 @@ token_loc_to_line(token_loc_t loc)
 size_t
 token_loc_to_lineno(token_loc_t loc)
 {
-    return loc.cur.row + 1;
+    return source_line_index(loc.file_id, loc.offset) + 1;
 }
 
 size_t
 token_loc_to_colno(token_loc_t loc)
 {
-    return loc.cur.offset - loc.cur.bol + 1;
+    size_t line_index = source_line_index(loc.file_id, loc.offset);
+    return loc.offset - source_line_start(loc.file_id, line_index) + 1;
 }
@@ -17,27 +17,24 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include "arena.h"
+#include "interner.h"
+#include "source.h"
 #include "string_view.h"
 #include <stdint.h>
 #include <stdio.h>
 
-typedef struct source_code
-{
-    char *filepath;
-    string_view_t code;
-} source_code_t;
-
 typedef struct lexer_cursor
 {
     size_t offset;
-    size_t row;
-    size_t bol;
 } lexer_cursor_t;
 
 typedef struct lexer
 {
     source_code_t src;
+    uint32_t file_id;
     lexer_cursor_t cur;
+    interner_t *interner;
 } lexer_t;
 
 typedef enum token_kind
@@ -93,19 +90,57 @@ typedef enum token_kind
     TOKEN_EOF
 } token_kind_t;
 
+/**
+ * Location of a token in the source code.  Line and column are only needed
+ * by diagnostics so they are computed on demand from the offset, see
+ * source_line_index.  Sources are at most SOURCE_MAX_SIZE bytes long, so a
+ * byte offset always fits in 32 bits.
+ */
 typedef struct token_loc
 {
-    source_code_t src;
-    lexer_cursor_t cur;
+    uint32_t file_id;
+    uint32_t offset;
 } token_loc_t;
 
 typedef struct token
 {
     token_kind_t kind;
     string_view_t value;
+    // Interned identifier, only set for TOKEN_ID.
+    atom_t *atom;
+    // Decoded literal value, only set for TOKEN_NUMBER.
+    uint64_t number;
     token_loc_t loc;
 } token_t;
 
+typedef union token_payload
+{
+    atom_t *atom;
+    uint64_t number;
+} token_payload_t;
+
+/**
+ * All the tokens of a source code, lexed in a single pass.  Tokens are stored
+ * as a structure of arrays so that scanning kinds (what the parser does most
+ * of the time) touches as little memory as possible.  The buffer always ends
+ * with a TOKEN_EOF.
+ */
+typedef struct token_buffer
+{
+    source_code_t src;
+    uint32_t file_id;
+    arena_t *arena;
+    size_t size;
+    size_t capacity;
+    uint8_t *kinds;
+    uint32_t *offsets;
+    uint32_t *lengths;
+    token_payload_t *payloads;
+} token_buffer_t;
+
+char *
+token_loc_to_filepath(token_loc_t loc);
+
 size_t
 token_loc_to_lineno(token_loc_t loc);
 
@@ -113,7 +148,7 @@ size_t
 token_loc_to_colno(token_loc_t loc);
 
 void
-lexer_init(lexer_t *lexer, source_code_t src);
+lexer_init(lexer_t *lexer, source_code_t src, interner_t *interner);
 
 void
 lexer_next_token(lexer_t *lexer, token_t *token);
@@ -124,6 +159,19 @@ lexer_peek_next(lexer_t *lexer, token_t *token);
 void
 lexer_lookahead(lexer_t *lexer, token_t *token, size_t n);
 
+void
+lexer_tokenize(lexer_t *lexer, token_buffer_t *buffer, arena_t *arena);
+
+void
+token_buffer_get(token_buffer_t *buffer, size_t index, token_t *token);
+
+/**
+ * Returns only the kind of the token at index, it is cheaper than
+ * token_buffer_get when the rest of the token is not needed.
+ */
+token_kind_t
+token_buffer_kind(token_buffer_t *buffer, size_t index);
+
 char *
 token_kind_to_cstr(token_kind_t kind);
 
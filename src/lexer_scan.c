@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "lexer_scan.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifdef __AVX2__
+static __m256i
+lexer_scan_range_avx2(__m256i c, char lo, char hi);
+
+static __m256i
+lexer_scan_class_mask_avx2(__m256i c, lexer_scan_class_t cls);
+#endif
+
+#ifdef __SSE2__
+static __m128i
+lexer_scan_range_sse2(__m128i c, char lo, char hi);
+
+static __m128i
+lexer_scan_class_mask_sse2(__m128i c, lexer_scan_class_t cls);
+#endif
+
+bool
+lexer_scan_char_is(lexer_scan_class_t cls, char c)
+{
+    // Plain ASCII ranges, the lexer doesn't depend on the current locale.
+    unsigned char u = (unsigned char)c;
+    switch (cls) {
+        case LEXER_SCAN_SPACE:
+            return u == ' ' || u == '\t' || (u >= '\v' && u <= '\r');
+        case LEXER_SCAN_ALNUM:
+            return (u >= '0' && u <= '9') ||
+                   ((u | 0x20) >= 'a' && (u | 0x20) <= 'z');
+        case LEXER_SCAN_DIGIT:
+            return u >= '0' && u <= '9';
+        case LEXER_SCAN_NOT_LF:
+            return u != '\n';
+    }
+    assert(false && "unknown lexer_scan_class_t");
+    return false;
+}
+
+size_t
+lexer_scan(const char *chars,
+           size_t offset,
+           size_t size,
+           lexer_scan_class_t cls)
+{
+    // The vector loops only load full blocks within the source, the tail is
+    // left to the scalar loop so we never read past the end of the buffer.
+#ifdef __AVX2__
+    while (offset + 32 <= size) {
+        __m256i c = _mm256_loadu_si256((const __m256i *)(chars + offset));
+        uint32_t mask =
+            (uint32_t)_mm256_movemask_epi8(lexer_scan_class_mask_avx2(c, cls));
+        if (mask != UINT32_MAX) {
+            return offset + (size_t)__builtin_ctz(~mask);
+        }
+        offset += 32;
+    }
+#endif
+
+#ifdef __SSE2__
+    while (offset + 16 <= size) {
+        __m128i c = _mm_loadu_si128((const __m128i *)(chars + offset));
+        uint32_t mask =
+            (uint32_t)_mm_movemask_epi8(lexer_scan_class_mask_sse2(c, cls));
+        if (mask != 0xffff) {
+            return offset + (size_t)__builtin_ctz(~mask);
+        }
+        offset += 16;
+    }
+#endif
+
+    return lexer_scan_scalar(chars, offset, size, cls);
+}
+
+size_t
+lexer_scan_scalar(const char *chars,
+                  size_t offset,
+                  size_t size,
+                  lexer_scan_class_t cls)
+{
+    while (offset < size && lexer_scan_char_is(cls, chars[offset])) {
+        ++offset;
+    }
+    return offset;
+}
+
+// The range checks below rely on signed byte comparisons: bytes >= 0x80 are
+// negative and therefore never fall in any of the ASCII ranges.
+
+#ifdef __AVX2__
+static __m256i
+lexer_scan_range_avx2(__m256i c, char lo, char hi)
+{
+    return _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8(lo - 1)),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), c));
+}
+
+static __m256i
+lexer_scan_class_mask_avx2(__m256i c, lexer_scan_class_t cls)
+{
+    switch (cls) {
+        case LEXER_SCAN_SPACE: {
+            __m256i space = _mm256_cmpeq_epi8(c, _mm256_set1_epi8(' '));
+            __m256i tab = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\t'));
+            __m256i vt_to_cr = lexer_scan_range_avx2(c, '\v', '\r');
+            return _mm256_or_si256(_mm256_or_si256(space, tab), vt_to_cr);
+        }
+        case LEXER_SCAN_ALNUM: {
+            __m256i digit = lexer_scan_range_avx2(c, '0', '9');
+            __m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+            __m256i alpha = lexer_scan_range_avx2(lower, 'a', 'z');
+            return _mm256_or_si256(digit, alpha);
+        }
+        case LEXER_SCAN_DIGIT:
+            return lexer_scan_range_avx2(c, '0', '9');
+        case LEXER_SCAN_NOT_LF: {
+            __m256i lf = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\n'));
+            return _mm256_xor_si256(lf, _mm256_set1_epi8(-1));
+        }
+    }
+    assert(false && "unknown lexer_scan_class_t");
+    return _mm256_setzero_si256();
+}
+#endif
+
+#ifdef __SSE2__
+static __m128i
+lexer_scan_range_sse2(__m128i c, char lo, char hi)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8(lo - 1)),
+                         _mm_cmplt_epi8(c, _mm_set1_epi8(hi + 1)));
+}
+
+static __m128i
+lexer_scan_class_mask_sse2(__m128i c, lexer_scan_class_t cls)
+{
+    switch (cls) {
+        case LEXER_SCAN_SPACE: {
+            __m128i space = _mm_cmpeq_epi8(c, _mm_set1_epi8(' '));
+            __m128i tab = _mm_cmpeq_epi8(c, _mm_set1_epi8('\t'));
+            __m128i vt_to_cr = lexer_scan_range_sse2(c, '\v', '\r');
+            return _mm_or_si128(_mm_or_si128(space, tab), vt_to_cr);
+        }
+        case LEXER_SCAN_ALNUM: {
+            __m128i digit = lexer_scan_range_sse2(c, '0', '9');
+            __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+            __m128i alpha = lexer_scan_range_sse2(lower, 'a', 'z');
+            return _mm_or_si128(digit, alpha);
+        }
+        case LEXER_SCAN_DIGIT:
+            return lexer_scan_range_sse2(c, '0', '9');
+        case LEXER_SCAN_NOT_LF: {
+            __m128i lf = _mm_cmpeq_epi8(c, _mm_set1_epi8('\n'));
+            return _mm_xor_si128(lf, _mm_set1_epi8(-1));
+        }
+    }
+    assert(false && "unknown lexer_scan_class_t");
+    return _mm_setzero_si128();
+}
+#endif
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef LEXER_SCAN_H
+#define LEXER_SCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Character classes the lexer skips in runs.  None of them contains a line
+ * feed, so a run never crosses a line and the lexer row/bol bookkeeping is
+ * not affected by skipping it at once.
+ */
+typedef enum lexer_scan_class
+{
+    // ' ', '\t', '\v', '\f' and '\r', line feeds are tokens.
+    LEXER_SCAN_SPACE,
+    // [0-9A-Za-z]
+    LEXER_SCAN_ALNUM,
+    // [0-9]
+    LEXER_SCAN_DIGIT,
+    // Anything but '\n', used to find the end of a comment.
+    LEXER_SCAN_NOT_LF,
+} lexer_scan_class_t;
+
+bool
+lexer_scan_char_is(lexer_scan_class_t cls, char c);
+
+/**
+ * Returns the offset of the first char in [offset, size) which does not
+ * belong to the class, or size if every char does.  Runs are scanned 32 (AVX2)
+ * or 16 (SSE2) bytes at a time when the target supports it.
+ */
+size_t
+lexer_scan(const char *chars,
+           size_t offset,
+           size_t size,
+           lexer_scan_class_t cls);
+
+/**
+ * Same as lexer_scan, one char at a time.
+ */
+size_t
+lexer_scan_scalar(const char *chars,
+                  size_t offset,
+                  size_t size,
+                  lexer_scan_class_t cls);
+
+#endif /* LEXER_SCAN_H */
@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Generated by contrib/lexgen/lexgen.c from docs/info/olang.ebnf, do not
+ * edit.  Run `make lexer-tables` to regenerate it.
+ *
+ * Terminals without a token kind (not part of the tables):
+ * 'const' ';' '*=' '/=' '%=' '+=' '-=' '<<=' '>>=' '&=' '^=' '|=' 'u8' 'u16'
+ * 'u32' 'u64' '_' '0' '\r\n'
+ */
+#ifndef LEXER_TABLES_H
+#define LEXER_TABLES_H
+
+#include "lexer.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum lexer_char_class
+{
+    LEXER_CC_OTHER,
+    LEXER_CC_SPACE,
+    LEXER_CC_ALPHA,
+    LEXER_CC_DIGIT,
+    LEXER_CC_HASH,
+    // Chars starting an operator, see lexer_op_dfa.
+    LEXER_CC_OP,
+} lexer_char_class_t;
+
+#define LEXER_OP_STATES 29
+#define LEXER_OP_COLUMNS 21
+#define LEXER_KEYWORD_TABLE_SIZE 16
+#define LEXER_KEYWORD_HASH_M1 2
+#define LEXER_KEYWORD_HASH_M2 2
+
+// clang-format off
+static const uint8_t lexer_char_class[256] = {
+    ['\t'] = LEXER_CC_SPACE,
+    ['\n'] = LEXER_CC_OP,
+    ['\v'] = LEXER_CC_SPACE,
+    ['\f'] = LEXER_CC_SPACE,
+    ['\r'] = LEXER_CC_SPACE,
+    [' '] = LEXER_CC_SPACE,
+    ['!'] = LEXER_CC_OP,
+    ['#'] = LEXER_CC_HASH,
+    ['%'] = LEXER_CC_OP,
+    ['&'] = LEXER_CC_OP,
+    ['('] = LEXER_CC_OP,
+    [')'] = LEXER_CC_OP,
+    ['*'] = LEXER_CC_OP,
+    ['+'] = LEXER_CC_OP,
+    [','] = LEXER_CC_OP,
+    ['-'] = LEXER_CC_OP,
+    ['/'] = LEXER_CC_OP,
+    ['0'] = LEXER_CC_DIGIT,
+    ['1'] = LEXER_CC_DIGIT,
+    ['2'] = LEXER_CC_DIGIT,
+    ['3'] = LEXER_CC_DIGIT,
+    ['4'] = LEXER_CC_DIGIT,
+    ['5'] = LEXER_CC_DIGIT,
+    ['6'] = LEXER_CC_DIGIT,
+    ['7'] = LEXER_CC_DIGIT,
+    ['8'] = LEXER_CC_DIGIT,
+    ['9'] = LEXER_CC_DIGIT,
+    [':'] = LEXER_CC_OP,
+    ['<'] = LEXER_CC_OP,
+    ['='] = LEXER_CC_OP,
+    ['>'] = LEXER_CC_OP,
+    ['A'] = LEXER_CC_ALPHA,
+    ['B'] = LEXER_CC_ALPHA,
+    ['C'] = LEXER_CC_ALPHA,
+    ['D'] = LEXER_CC_ALPHA,
+    ['E'] = LEXER_CC_ALPHA,
+    ['F'] = LEXER_CC_ALPHA,
+    ['G'] = LEXER_CC_ALPHA,
+    ['H'] = LEXER_CC_ALPHA,
+    ['I'] = LEXER_CC_ALPHA,
+    ['J'] = LEXER_CC_ALPHA,
+    ['K'] = LEXER_CC_ALPHA,
+    ['L'] = LEXER_CC_ALPHA,
+    ['M'] = LEXER_CC_ALPHA,
+    ['N'] = LEXER_CC_ALPHA,
+    ['O'] = LEXER_CC_ALPHA,
+    ['P'] = LEXER_CC_ALPHA,
+    ['Q'] = LEXER_CC_ALPHA,
+    ['R'] = LEXER_CC_ALPHA,
+    ['S'] = LEXER_CC_ALPHA,
+    ['T'] = LEXER_CC_ALPHA,
+    ['U'] = LEXER_CC_ALPHA,
+    ['V'] = LEXER_CC_ALPHA,
+    ['W'] = LEXER_CC_ALPHA,
+    ['X'] = LEXER_CC_ALPHA,
+    ['Y'] = LEXER_CC_ALPHA,
+    ['Z'] = LEXER_CC_ALPHA,
+    ['^'] = LEXER_CC_OP,
+    ['a'] = LEXER_CC_ALPHA,
+    ['b'] = LEXER_CC_ALPHA,
+    ['c'] = LEXER_CC_ALPHA,
+    ['d'] = LEXER_CC_ALPHA,
+    ['e'] = LEXER_CC_ALPHA,
+    ['f'] = LEXER_CC_ALPHA,
+    ['g'] = LEXER_CC_ALPHA,
+    ['h'] = LEXER_CC_ALPHA,
+    ['i'] = LEXER_CC_ALPHA,
+    ['j'] = LEXER_CC_ALPHA,
+    ['k'] = LEXER_CC_ALPHA,
+    ['l'] = LEXER_CC_ALPHA,
+    ['m'] = LEXER_CC_ALPHA,
+    ['n'] = LEXER_CC_ALPHA,
+    ['o'] = LEXER_CC_ALPHA,
+    ['p'] = LEXER_CC_ALPHA,
+    ['q'] = LEXER_CC_ALPHA,
+    ['r'] = LEXER_CC_ALPHA,
+    ['s'] = LEXER_CC_ALPHA,
+    ['t'] = LEXER_CC_ALPHA,
+    ['u'] = LEXER_CC_ALPHA,
+    ['v'] = LEXER_CC_ALPHA,
+    ['w'] = LEXER_CC_ALPHA,
+    ['x'] = LEXER_CC_ALPHA,
+    ['y'] = LEXER_CC_ALPHA,
+    ['z'] = LEXER_CC_ALPHA,
+    ['{'] = LEXER_CC_OP,
+    ['|'] = LEXER_CC_OP,
+    ['}'] = LEXER_CC_OP,
+    ['~'] = LEXER_CC_OP,
+};
+
+// Column of each char in lexer_op_dfa, 0 is not an operator char.
+static const uint8_t lexer_op_column[256] = {
+    ['\n'] = 20,
+    ['!'] = 11,
+    ['%'] = 18,
+    ['&'] = 9,
+    ['('] = 3,
+    [')'] = 4,
+    ['*'] = 16,
+    ['+'] = 14,
+    [','] = 5,
+    ['-'] = 15,
+    ['/'] = 17,
+    [':'] = 1,
+    ['<'] = 12,
+    ['='] = 2,
+    ['>'] = 13,
+    ['^'] = 10,
+    ['{'] = 6,
+    ['|'] = 8,
+    ['}'] = 7,
+    ['~'] = 19,
+};
+
+// Operator DFA, state 0 is the start state and a 0 transition means there is
+// no transition.
+static const uint8_t lexer_op_dfa[LEXER_OP_STATES][LEXER_OP_COLUMNS] = {
+    [0] = { [1] = 1, [2] = 2, [3] = 3, [4] = 4, [5] = 5, [6] = 6, [7] = 7,
+        [8] = 8, [9] = 10, [10] = 12, [11] = 14, [12] = 16, [13] = 17,
+        [14] = 22, [15] = 23, [16] = 24, [17] = 25, [18] = 26, [19] = 27,
+        [20] = 28 },
+    [1] = { 0 },
+    [2] = { [2] = 13 },
+    [3] = { 0 },
+    [4] = { 0 },
+    [5] = { 0 },
+    [6] = { 0 },
+    [7] = { 0 },
+    [8] = { [8] = 9 },
+    [9] = { 0 },
+    [10] = { [9] = 11 },
+    [11] = { 0 },
+    [12] = { 0 },
+    [13] = { 0 },
+    [14] = { [2] = 15 },
+    [15] = { 0 },
+    [16] = { [2] = 18, [12] = 20 },
+    [17] = { [2] = 19, [13] = 21 },
+    [18] = { 0 },
+    [19] = { 0 },
+    [20] = { 0 },
+    [21] = { 0 },
+    [22] = { 0 },
+    [23] = { 0 },
+    [24] = { 0 },
+    [25] = { 0 },
+    [26] = { 0 },
+    [27] = { 0 },
+    [28] = { 0 },
+};
+
+// Token kind of each accepting state, TOKEN_UNKNOWN means the state does not
+// accept.
+static const uint8_t lexer_op_accept[LEXER_OP_STATES] = {
+    [1] = TOKEN_COLON,
+    [2] = TOKEN_EQ,
+    [3] = TOKEN_OPAREN,
+    [4] = TOKEN_CPAREN,
+    [5] = TOKEN_COMMA,
+    [6] = TOKEN_OCURLY,
+    [7] = TOKEN_CCURLY,
+    [8] = TOKEN_PIPE,
+    [9] = TOKEN_LOGICAL_OR,
+    [10] = TOKEN_AND,
+    [11] = TOKEN_LOGICAL_AND,
+    [12] = TOKEN_CIRCUMFLEX,
+    [13] = TOKEN_CMP_EQ,
+    [14] = TOKEN_BANG,
+    [15] = TOKEN_CMP_NEQ,
+    [16] = TOKEN_LT,
+    [17] = TOKEN_GT,
+    [18] = TOKEN_CMP_LEQ,
+    [19] = TOKEN_CMP_GEQ,
+    [20] = TOKEN_BITWISE_LSHIFT,
+    [21] = TOKEN_BITWISE_RSHIFT,
+    [22] = TOKEN_PLUS,
+    [23] = TOKEN_DASH,
+    [24] = TOKEN_STAR,
+    [25] = TOKEN_SLASH,
+    [26] = TOKEN_PERCENT,
+    [27] = TOKEN_TILDE,
+    [28] = TOKEN_LF,
+};
+
+typedef struct lexer_keyword
+{
+    const char *chars;
+    size_t size;
+    token_kind_t kind;
+} lexer_keyword_t;
+
+static const lexer_keyword_t lexer_keywords[LEXER_KEYWORD_TABLE_SIZE] = {
+    [0] = { "if", 2, TOKEN_IF },
+    [3] = { "var", 3, TOKEN_VAR },
+    [6] = { "return", 6, TOKEN_RETURN },
+    [8] = { "else", 4, TOKEN_ELSE },
+    [10] = { "fn", 2, TOKEN_FN },
+    [12] = { "extern", 6, TOKEN_EXTERN },
+    [13] = { "while", 5, TOKEN_WHILE },
+};
+// clang-format on
+
+static uint32_t
+lexer_keyword_slot(const char *chars, size_t size)
+{
+    uint32_t first = (uint8_t)chars[0];
+    uint32_t last = (uint8_t)chars[size - 1];
+    return (first * LEXER_KEYWORD_HASH_M1 + last * LEXER_KEYWORD_HASH_M2 +
+            (uint32_t)size) &
+           (LEXER_KEYWORD_TABLE_SIZE - 1);
+}
+
+#endif /* LEXER_TABLES_H */
@@ -15,7 +15,6 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #include <assert.h>
-#include <errno.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -26,13 +25,16 @@
 #include "cli.h"
 #include "codegen_aarch64.h"
 #include "codegen_x86_64.h"
+#include "ir.h"
+#include "ir_builder.h"
+#include "ir_opt.h"
 #include "lexer.h"
 #include "parser.h"
 #include "pretty_print_ast.h"
 #include "string_view.h"
 
-// TODO: find a better solution to define the arena capacity
-#define ARENA_CAPACITY (1024 * 1024)
+// The arena grows on demand, this is only the size of its first block.
+#define ARENA_INITIAL_CAPACITY (64 * 1024)
 
 void
 handle_dump_tokens(cli_opts_t *opts);
@@ -40,14 +42,17 @@ handle_dump_tokens(cli_opts_t *opts);
 void
 handle_dump_ast(cli_opts_t *opts);
 
+void
+handle_dump_ir(cli_opts_t *opts);
+
 void
 handle_codegen_linux(cli_opts_t *opts);
 
 static void
 print_token(token_t *token);
 
-source_code_t
-read_entire_file(char *filepath, arena_t *arena);
+static ir_module_t *
+build_ir(arena_t *arena, ast_node_t *ast);
 
 int
 main(int argc, char **argv)
@@ -64,6 +69,11 @@ main(int argc, char **argv)
         return EXIT_SUCCESS;
     }
 
+    if (opts.options & CLI_OPT_DUMP_IR) {
+        handle_dump_ir(&opts);
+        return EXIT_SUCCESS;
+    }
+
     if (opts.options & CLI_OPT_OUTPUT) {
         handle_codegen_linux(&opts);
         return EXIT_SUCCESS;
@@ -80,11 +90,14 @@ handle_dump_tokens(cli_opts_t *opts)
         exit(EXIT_FAILURE);
     }
 
-    arena_t arena = arena_new(ARENA_CAPACITY);
-    source_code_t src = read_entire_file(opts->filepath, &arena);
+    arena_t arena = arena_new(ARENA_INITIAL_CAPACITY);
+    source_code_t src = source_read(opts->filepath, &arena);
+
+    interner_t interner;
+    interner_init(&interner, &arena);
 
     lexer_t lexer = { 0 };
-    lexer_init(&lexer, src);
+    lexer_init(&lexer, src, &interner);
 
     token_t token = { 0 };
     lexer_next_token(&lexer, &token);
@@ -105,13 +118,16 @@ handle_dump_ast(cli_opts_t *opts)
         exit(EXIT_FAILURE);
     }
 
-    arena_t arena = arena_new(ARENA_CAPACITY);
+    arena_t arena = arena_new(ARENA_INITIAL_CAPACITY);
+    interner_t interner;
+    interner_init(&interner, &arena);
+
     lexer_t lexer = { 0 };
     parser_t parser = { 0 };
 
-    source_code_t src = read_entire_file(opts->filepath, &arena);
+    source_code_t src = source_read(opts->filepath, &arena);
 
-    lexer_init(&lexer, src);
+    lexer_init(&lexer, src, &interner);
     parser_init(&parser, &lexer, &arena);
 
     ast_node_t *ast = parser_parse_translation_unit(&parser);
@@ -119,6 +135,35 @@ handle_dump_ast(cli_opts_t *opts)
     pretty_print_ast(ast);
 }
 
+void
+handle_dump_ir(cli_opts_t *opts)
+{
+    if (opts->filepath == NULL) {
+        cli_print_usage(stderr, opts->compiler_path);
+        exit(EXIT_FAILURE);
+    }
+
+    arena_t arena = arena_new(ARENA_INITIAL_CAPACITY);
+    interner_t interner;
+    interner_init(&interner, &arena);
+
+    lexer_t lexer = { 0 };
+    parser_t parser = { 0 };
+
+    source_code_t src = source_read(opts->filepath, &arena);
+    lexer_init(&lexer, src, &interner);
+    parser_init(&parser, &lexer, &arena);
+
+    ast_node_t *ast = parser_parse_translation_unit(&parser);
+
+    checker_t *checker = checker_new(&arena);
+    checker_check(checker, ast);
+
+    ir_module_dump(build_ir(&arena, ast), stdout);
+
+    arena_free(&arena);
+}
+
 void
 handle_codegen_linux(cli_opts_t *opts)
 {
@@ -127,12 +172,15 @@ handle_codegen_linux(cli_opts_t *opts)
         exit(EXIT_FAILURE);
     }
 
-    arena_t arena = arena_new(ARENA_CAPACITY);
+    arena_t arena = arena_new(ARENA_INITIAL_CAPACITY);
+    interner_t interner;
+    interner_init(&interner, &arena);
+
     lexer_t lexer = { 0 };
     parser_t parser = { 0 };
 
-    source_code_t src = read_entire_file(opts->filepath, &arena);
-    lexer_init(&lexer, src);
+    source_code_t src = source_read(opts->filepath, &arena);
+    lexer_init(&lexer, src, &interner);
     parser_init(&parser, &lexer, &arena);
 
     ast_node_t *ast = parser_parse_translation_unit(&parser);
@@ -149,12 +197,12 @@ handle_codegen_linux(cli_opts_t *opts)
     if (!(opts->options & CLI_OPT_ARCH)) {
         codegen_x86_64_t codegen = { 0 };
         codegen_x86_64_init(&codegen, &arena, out);
-        codegen_x86_64_emit_translation_unit(&codegen, ast);
+        codegen_x86_64_emit_module(&codegen, build_ir(&arena, ast));
     } else {
         if (strcmp(opts->arch, "x86_64") == 0) {
             codegen_x86_64_t codegen = { 0 };
             codegen_x86_64_init(&codegen, &arena, out);
-            codegen_x86_64_emit_translation_unit(&codegen, ast);
+            codegen_x86_64_emit_module(&codegen, build_ir(&arena, ast));
         } else if (strcmp(opts->arch, "aarch64") == 0) {
             codegen_aarch64_emit_translation_unit(out, ast);
         } else {
@@ -212,57 +260,30 @@ handle_codegen_linux(cli_opts_t *opts)
     arena_free(&arena);
 }
 
-source_code_t
-read_entire_file(char *filepath, arena_t *arena)
+/**
+ * Lowers the checked ast and optimizes it, an ill-formed result is a bug of
+ * the compiler.
+ */
+static ir_module_t *
+build_ir(arena_t *arena, ast_node_t *ast)
 {
-    FILE *stream = fopen(filepath, "rb");
+    ir_builder_t *builder = ir_builder_new(arena);
+    ir_module_t *module = ir_builder_build(builder, ast);
 
-    if (stream == NULL) {
-        fprintf(stderr,
-                "error: could not open file %s: %s\n",
-                filepath,
-                strerror(errno));
+    if (!ir_module_verify(module)) {
+        fprintf(stderr, "error: internal compiler error: invalid ir\n");
         exit(EXIT_FAILURE);
     }
 
-    string_view_t code = { 0 };
-
-    fseek(stream, 0, SEEK_END);
-    code.size = ftell(stream);
-    fseek(stream, 0, SEEK_SET);
-
-    assert(code.size * 2 < ARENA_CAPACITY);
-
-    code.chars = (char *)arena_alloc(arena, (size_t)code.size);
-
-    if (code.chars == NULL) {
-        fprintf(stderr,
-                "error: could not read file %s: %s\n",
-                filepath,
-                strerror(errno));
-        exit(EXIT_FAILURE);
-    }
-
-    size_t read_bytes = fread(code.chars, 1, code.size, stream);
-
-    if (read_bytes != code.size) {
-        fprintf(stderr, "error: failed to read all file bytes %s\n", filepath);
-        exit(EXIT_FAILURE);
-    }
-
-    fclose(stream);
-
-    return (source_code_t){
-        .filepath = filepath,
-        .code = code,
-    };
+    ir_optimize_module(module);
+    return module;
 }
 
 static void
 print_token(token_t *token)
 {
     printf("%s:%lu:%lu: <%s>\n",
-           token->loc.src.filepath,
+           token_loc_to_filepath(token->loc),
            token_loc_to_lineno(token->loc),
            token_loc_to_colno(token->loc),
            token_kind_to_cstr(token->kind));
@@ -25,17 +25,20 @@
 #include <stdlib.h>
 #include <string.h>
 
-static uint32_t
-u32_fnv1a_hash(const char *s);
+#define MAP_HASH_SEED 0x9e3779b97f4a7c15ULL
+#define MAP_HASH_MULTIPLIER 0xff51afd7ed558ccdULL
 
 static void
-map_init(map_t *map);
+map_init(map_t *map, size_t capacity);
 
-static char *
-_strdup(const char *s, arena_t *arena);
+static void
+map_grow(map_t *map);
+
+static bool
+map_key_eq(string_view_t a, string_view_t b);
 
-static uint32_t
-map_get_index(map_t *map, uint32_t hash);
+static void
+map_insert_entry(map_t *map, map_entry_t entry);
 
 map_t *
 map_new(arena_t *arena)
@@ -47,99 +50,151 @@ map_new(arena_t *arena)
         exit(EXIT_FAILURE);
     }
     map->arena = arena;
-    map_init(map);
+    map_init(map, MAP_INITIAL_CAPACITY);
     return map;
 }
 
 static void
-map_init(map_t *map)
+map_init(map_t *map, size_t capacity)
 {
     assert(map);
-    map->entries = (map_entry_t *)arena_alloc(
-        map->arena, MAP_INITIAL_CAPACITY * sizeof(map_entry_t));
-    assert(map->entries != NULL);
-    memset(map->entries, 0, MAP_INITIAL_CAPACITY * sizeof(map_entry_t));
+    assert((capacity & (capacity - 1)) == 0 && "capacity must be power of 2");
+
+    map->entries =
+        (map_entry_t *)arena_alloc(map->arena, capacity * sizeof(map_entry_t));
     if (map->entries == NULL) {
         fprintf(
             stderr, "[FATAL] Out of memory: map_init: %s\n", strerror(errno));
         exit(EXIT_FAILURE);
     }
-    map->capacity = MAP_INITIAL_CAPACITY;
+    memset(map->entries, 0, capacity * sizeof(map_entry_t));
+    map->capacity = capacity;
+    map->size = 0;
+}
+
+static uint64_t
+map_hash_mix(uint64_t hash, uint64_t word)
+{
+    hash = (hash ^ word) * MAP_HASH_MULTIPLIER;
+    return hash ^ (hash >> 32);
 }
 
-static uint32_t
-u32_fnv1a_hash(const char *s)
+/**
+ * Hashes the key eight bytes at a time, the remaining bytes are packed into a
+ * last zero padded word.
+ */
+uint32_t
+map_hash(string_view_t key)
 {
-    uint32_t hash = U32_FNV1A_OFFSET_BASIS;
-    size_t len = strlen(s);
-    for (size_t i = 0; i < len; ++i) {
-        hash ^= s[i];
-        hash *= U32_FNV1A_PRIME;
+    uint64_t hash = MAP_HASH_SEED ^ key.size;
+    const char *chars = key.chars;
+    size_t size = key.size;
+
+    while (size >= sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, chars, sizeof(uint64_t));
+        hash = map_hash_mix(hash, word);
+        chars += sizeof(uint64_t);
+        size -= sizeof(uint64_t);
+    }
+
+    if (size > 0) {
+        uint64_t word = 0;
+        memcpy(&word, chars, size);
+        hash = map_hash_mix(hash, word);
     }
-    return hash;
+
+    hash *= MAP_HASH_MULTIPLIER;
+    return (uint32_t)(hash ^ (hash >> 29));
+}
+
+static bool
+map_key_eq(string_view_t a, string_view_t b)
+{
+    return a.size == b.size &&
+           (a.chars == b.chars || memcmp(a.chars, b.chars, a.size) == 0);
 }
 
 bool
-map_put(map_t *map, char *key, void *value)
+map_put(map_t *map, string_view_t key, void *value)
 {
-    assert(map && key);
-    map->size++;
-
-    uint32_t hash = u32_fnv1a_hash(key);
-    map_entry_t *entry = map->entries + map_get_index(map, hash);
-
-    if (entry->key == NULL) {
-        *entry = (map_entry_t){
-            .key = _strdup(key, map->arena),
-            .hash = hash,
-            .value = value,
-            .next = NULL,
-        };
-        return true;
-    }
+    return map_put_with_hash(map, key, map_hash(key), value);
+}
+
+/**
+ * Same as map_put but reuses a hash previously computed by map_hash.
+ */
+bool
+map_put_with_hash(map_t *map, string_view_t key, uint32_t hash, void *value)
+{
+    assert(map && key.chars);
 
-    do {
-        if (entry->hash == hash && strcmp(entry->key, key) == 0) {
-            entry->value = value;
+    uint32_t mask = map->capacity - 1;
+    uint32_t index = hash & mask;
+
+    for (uint32_t distance = 1;; ++distance) {
+        map_entry_t *entry = map->entries + index;
+
+        if (entry->distance < distance) {
             break;
         }
-        if (entry->next == NULL) {
-            entry->next =
-                (map_entry_t *)arena_alloc(map->arena, sizeof(map_entry_t));
-            *entry->next = (map_entry_t){
-                .key = _strdup(key, map->arena),
-                .hash = hash,
-                .value = value,
-                .next = NULL,
-            };
 
-            break;
+        if (entry->hash == hash && map_key_eq(entry->kv.key, key)) {
+            entry->kv.value = value;
+            return true;
         }
-        entry = entry->next;
-    } while (entry != NULL);
 
+        index = (index + 1) & mask;
+    }
+
+    // Only an actual insertion can push the load over the limit.
+    if ((map->size + 1) * MAP_MAX_LOAD_DENOMINATOR >
+        map->capacity * MAP_MAX_LOAD_NUMERATOR) {
+        map_grow(map);
+    }
+
+    map_insert_entry(map,
+                     (map_entry_t){
+                         .kv = { .key = key, .value = value },
+                         .hash = hash,
+                         .distance = 1,
+                     });
     return true;
 }
 
 void *
-map_get(map_t *map, char *key)
+map_get(map_t *map, string_view_t key)
 {
-    uint32_t hash = u32_fnv1a_hash(key);
-    map_entry_t *entry = map->entries + map_get_index(map, hash);
-    while (entry != NULL) {
-        if (entry->hash == hash && strcmp(entry->key, key) == 0) {
-            return entry->value;
-        }
-        entry = entry->next;
-    }
-    return NULL;
+    return map_get_with_hash(map, key, map_hash(key));
 }
 
-static uint32_t
-map_get_index(map_t *map, uint32_t hash)
+/**
+ * Same as map_get but reuses a hash previously computed by map_hash.
+ */
+void *
+map_get_with_hash(map_t *map, string_view_t key, uint32_t hash)
 {
-    uint32_t capacity_mask = map->capacity - 1;
-    return hash & capacity_mask;
+    assert(map);
+
+    uint32_t mask = map->capacity - 1;
+    uint32_t index = hash & mask;
+
+    // Robin Hood keeps entries ordered by probe distance, the lookup can stop
+    // as soon as it finds an entry closer to its home slot than the key would
+    // be.
+    for (uint32_t distance = 1;; ++distance) {
+        map_entry_t *entry = map->entries + index;
+
+        if (entry->distance < distance) {
+            return NULL;
+        }
+
+        if (entry->hash == hash && map_key_eq(entry->kv.key, key)) {
+            return entry->kv.value;
+        }
+
+        index = (index + 1) & mask;
+    }
 }
 
 void
@@ -150,22 +205,54 @@ map_get_kvs(map_t *map, map_kv_t **kvs)
     for (size_t j = 0; j < map->capacity; ++j) {
         map_entry_t *entry = map->entries + j;
 
-        while (entry != NULL && entry->key != NULL) {
-            kvs[index++] = (map_kv_t *)entry;
-            entry = entry->next;
+        if (entry->distance != 0) {
+            kvs[index++] = &entry->kv;
         }
     }
 }
 
-static char *
-_strdup(const char *s, arena_t *arena)
+/**
+ * Inserts an entry known to be absent from the map, displacing entries that
+ * are closer to their home slot.
+ */
+static void
+map_insert_entry(map_t *map, map_entry_t entry)
 {
-    size_t slen = strlen(s);
-    char *result = arena_alloc(arena, slen + 1);
-    if (result == NULL) {
-        return NULL;
+    uint32_t mask = map->capacity - 1;
+    uint32_t index = entry.hash & mask;
+
+    while (true) {
+        map_entry_t *slot = map->entries + index;
+
+        if (slot->distance == 0) {
+            *slot = entry;
+            map->size++;
+            return;
+        }
+
+        if (slot->distance < entry.distance) {
+            map_entry_t displaced = *slot;
+            *slot = entry;
+            entry = displaced;
+        }
+
+        entry.distance++;
+        index = (index + 1) & mask;
     }
+}
+
+static void
+map_grow(map_t *map)
+{
+    map_entry_t *entries = map->entries;
+    size_t capacity = map->capacity;
 
-    memcpy(result, s, slen + 1);
-    return result;
+    map_init(map, capacity * 2);
+
+    for (size_t i = 0; i < capacity; ++i) {
+        if (entries[i].distance != 0) {
+            entries[i].distance = 1;
+            map_insert_entry(map, entries[i]);
+        }
+    }
 }
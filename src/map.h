@@ -18,6 +18,7 @@
 #define MAP_H
 
 #include "arena.h"
+#include "string_view.h"
 
 #include <stdbool.h>
 #include <stdint.h>
@@ -25,13 +26,17 @@
 
 #define MAP_INITIAL_CAPACITY 32
 
-#define U32_FNV1A_PRIME 0x01000193
-#define U32_FNV1A_OFFSET_BASIS 0x811c9dc5
+// The table grows once it is more than 3/4 full.
+#define MAP_MAX_LOAD_NUMERATOR 3
+#define MAP_MAX_LOAD_DENOMINATOR 4
 
 typedef struct map map_t;
-typedef struct map_bucket map_bucket_t;
 typedef struct map_entry map_entry_t;
 
+/**
+ * Open addressing hash table using Robin Hood linear probing.  Keys are not
+ * copied, they must outlive the map.
+ */
 typedef struct map
 {
     arena_t *arena;
@@ -42,26 +47,36 @@ typedef struct map
 
 typedef struct map_kv
 {
-    char *key;
+    string_view_t key;
     void *value;
 } map_kv_t;
 
 typedef struct map_entry
 {
-    char *key;
-    void *value;
+    // First so that map_get_kvs can hand out pointers to it.
+    map_kv_t kv;
     uint32_t hash;
-    map_entry_t *next;
+    // Probe sequence length plus one, zero means the slot is empty.
+    uint32_t distance;
 } map_entry_t;
 
 map_t *
 map_new(arena_t *arena);
 
 bool
-map_put(map_t *map, char *key, void *value);
+map_put(map_t *map, string_view_t key, void *value);
+
+void *
+map_get(map_t *map, string_view_t key);
+
+uint32_t
+map_hash(string_view_t key);
+
+bool
+map_put_with_hash(map_t *map, string_view_t key, uint32_t hash, void *value);
 
 void *
-map_get(map_t *map, char *key);
+map_get_with_hash(map_t *map, string_view_t key, uint32_t hash);
 
 void
 map_get_kvs(map_t *map, map_kv_t **kvs);
@@ -15,16 +15,96 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#define _DEFAULT_SOURCE
 #include <assert.h>
 #include <errno.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <threads.h>
+#include <unistd.h>
 
 #include "ast.h"
 #include "lexer.h"
 #include "parser.h"
 
+#define PARSER_EXPR_FRAMES_INITIAL_CAPACITY 32
+
+// Smaller inputs are parsed on the calling thread, starting workers would
+// cost more than it saves.
+#define PARSER_PARALLEL_MIN_TOKENS (64 * 1024)
+#define PARSER_PARALLEL_MAX_WORKERS 64
+// Functions are handed out in chunks, a few per worker so that a worker stuck
+// on a big chunk doesn't leave the others idle.
+#define PARSER_PARALLEL_CHUNKS_PER_WORKER 8
+#define PARSER_WORKER_ARENA_CAPACITY (1024 * 1024)
+
+typedef enum
+{
+    // Waits for an operand and continues as a binary expression of the lowest
+    // precedence.
+    EXPR_FRAME_EXPR,
+    // Climbs binary operators of at least min_precedence.  The operand handed
+    // back to this frame is always the right hand side of its operator.
+    EXPR_FRAME_BINARY,
+    // Prefix operator waiting for its operand.
+    EXPR_FRAME_UNARY,
+    // Parenthesised expression waiting for its closing paren.
+    EXPR_FRAME_PAREN,
+    // Function call waiting for its next argument, the arguments parsed so
+    // far are on the scratch stack from args_start.
+    EXPR_FRAME_CALL,
+} parser_expr_frame_kind_t;
+
+typedef struct parser_parallel_job
+{
+    parser_t *parser;
+    // Token index where each function starts, plus the trailing EOF index.
+    size_t *decl_starts;
+    ast_node_t **decls;
+    size_t decls_size;
+    size_t chunk_size;
+    atomic_size_t next_chunk;
+    atomic_bool failed;
+} parser_parallel_job_t;
+
+typedef struct parser_worker
+{
+    parser_parallel_job_t *job;
+    arena_t arena;
+} parser_worker_t;
+
+struct parser_expr_frame
+{
+    parser_expr_frame_kind_t kind;
+    // Operator of unary and binary frames.
+    token_kind_t op;
+    token_loc_t loc;
+    // Callee of call frames.
+    atom_t *id;
+    ast_node_t *lhs;
+    ast_node_t *rhs;
+    size_t min_precedence;
+    size_t args_start;
+};
+
+static ast_node_t *
+parser_parse_translation_unit_sequential(parser_t *parser);
+
+static size_t
+parser_parallel_workers_size(parser_t *parser);
+
+static size_t
+parser_scan_decls(token_buffer_t *tokens, size_t *starts);
+
+static ast_node_t *
+parser_parse_translation_unit_parallel(parser_t *parser, size_t workers_size);
+
+static int
+parser_worker_run(void *arg);
+
 static bool
 skip_expected_token(parser_t *parser, token_kind_t expected_kind);
 
@@ -35,7 +115,7 @@ static bool
 expected_next_token(parser_t *parser, token_t *token, token_kind_t kind);
 
 static bool
-expected_token(token_t *token, token_kind_t kind);
+expected_token(parser_t *parser, token_t *token, token_kind_t kind);
 
 static type_t *
 parser_parse_type(parser_t *parser);
@@ -58,26 +138,43 @@ parser_parse_var_def(parser_t *parser);
 static ast_node_t *
 parser_parse_fn_definition(parser_t *parser);
 
-static list_t *
-parser_parse_fn_args(parser_t *parser);
-
-static list_t *
+static bool
 parser_parse_fn_params(parser_t *parser);
 
+static void **
+parser_take_scratch(parser_t *parser, size_t start, uint32_t *size);
+
 static ast_node_t *
 parser_parse_expr(parser_t *parser);
 
-static ast_node_t *
-parser_parse_unary_expr(parser_t *parser);
+static bool
+parser_parse_operand(parser_t *parser, size_t *frames_size, ast_node_t **value);
 
 static ast_node_t *
-parser_parse_primary_expr(parser_t *parser);
+parser_climb_binary_expr(parser_t *parser, size_t *frames_size);
+
+static parser_expr_frame_t *
+parser_push_expr_frame(parser_t *parser,
+                       size_t *frames_size,
+                       parser_expr_frame_kind_t kind);
+
+static void
+skip_line_feeds(parser_t *parser);
 
 static void
-skip_line_feeds(lexer_t *lexer);
+peek_next_non_lf_token(parser_t *parser, token_t *token);
 
 static void
-peek_next_non_lf_token(lexer_t *lexer, token_t *token);
+parser_next_token(parser_t *parser, token_t *token);
+
+static void
+parser_peek_next(parser_t *parser, token_t *token);
+
+static token_kind_t
+parser_peek_next_kind(parser_t *parser);
+
+static void
+parser_lookahead(parser_t *parser, token_t *token, size_t n);
 
 void
 parser_init(parser_t *parser, lexer_t *lexer, arena_t *arena)
@@ -86,16 +183,44 @@ parser_init(parser_t *parser, lexer_t *lexer, arena_t *arena)
     assert(lexer && "lexer is required");
     parser->lexer = lexer;
     parser->arena = arena;
+    parser->cursor = 0;
+    vector_init(&parser->scratch, arena);
+    parser->expr_frames = NULL;
+    parser->expr_frames_capacity = 0;
+    parser->quiet = false;
+    parser->failed = false;
+    parser->workers_size = 0;
+
+    lexer_tokenize(lexer, &parser->tokens, arena);
 }
 
 ast_node_t *
 parser_parse_translation_unit(parser_t *parser)
+{
+    size_t workers_size = parser_parallel_workers_size(parser);
+
+    if (workers_size > 1) {
+        ast_node_t *translation_unit =
+            parser_parse_translation_unit_parallel(parser, workers_size);
+        if (translation_unit != NULL) {
+            return translation_unit;
+        }
+        // Either the functions couldn't be split or one of them has a syntax
+        // error.  The sequential parser reports the first error in source
+        // order, exactly as if the workers never ran.
+    }
+
+    return parser_parse_translation_unit_sequential(parser);
+}
+
+static ast_node_t *
+parser_parse_translation_unit_sequential(parser_t *parser)
 {
     token_t token;
-    ast_node_t *translation_unit_node = ast_new_translation_unit(parser->arena);
+    size_t decls_start = vector_size(&parser->scratch);
 
-    skip_line_feeds(parser->lexer);
-    lexer_peek_next(parser->lexer, &token);
+    skip_line_feeds(parser);
+    parser_peek_next(parser, &token);
 
     while (token.kind != TOKEN_EOF) {
         ast_node_t *fn = parser_parse_fn_definition(parser);
@@ -104,13 +229,245 @@ parser_parse_translation_unit(parser_t *parser)
             return NULL;
         }
 
-        list_append(translation_unit_node->as_translation_unit.decls, fn);
+        vector_push(&parser->scratch, fn);
+
+        skip_line_feeds(parser);
+        parser_peek_next(parser, &token);
+    }
+
+    uint32_t decls_size;
+    ast_node_t **decls =
+        (ast_node_t **)parser_take_scratch(parser, decls_start, &decls_size);
+
+    return ast_new_translation_unit(parser->arena, decls, decls_size);
+}
+
+static size_t
+parser_parallel_workers_size(parser_t *parser)
+{
+    if (parser->workers_size > 0) {
+        return parser->workers_size < PARSER_PARALLEL_MAX_WORKERS
+                   ? parser->workers_size
+                   : PARSER_PARALLEL_MAX_WORKERS;
+    }
+
+    if (parser->tokens.size < PARSER_PARALLEL_MIN_TOKENS) {
+        return 1;
+    }
 
-        skip_line_feeds(parser->lexer);
-        lexer_peek_next(parser->lexer, &token);
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) {
+        return 1;
     }
 
-    return translation_unit_node;
+    return cpus < PARSER_PARALLEL_MAX_WORKERS ? (size_t)cpus
+                                              : PARSER_PARALLEL_MAX_WORKERS;
+}
+
+/**
+ * Finds where the top-level functions start by tracking the braces depth over
+ * the token kinds, comments never make it to the tokens buffer.  When starts
+ * is not NULL the token index of each function is stored there.  Returns the
+ * number of functions found.
+ */
+static size_t
+parser_scan_decls(token_buffer_t *tokens, size_t *starts)
+{
+    size_t decls_size = 0;
+    size_t depth = 0;
+
+    for (size_t i = 0; i < tokens->size; ++i) {
+        switch (tokens->kinds[i]) {
+            case TOKEN_OCURLY: {
+                ++depth;
+                break;
+            }
+            case TOKEN_CCURLY: {
+                if (depth > 0) {
+                    --depth;
+                }
+                break;
+            }
+            case TOKEN_FN: {
+                // extern fn starts at the extern token.
+                if (i > 0 && tokens->kinds[i - 1] == TOKEN_EXTERN) {
+                    break;
+                }
+            }
+            // fall through
+            case TOKEN_EXTERN: {
+                if (depth == 0) {
+                    if (starts != NULL) {
+                        starts[decls_size] = i;
+                    }
+                    ++decls_size;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    return decls_size;
+}
+
+/**
+ * Parses the top-level functions concurrently.  Each worker parses whole
+ * chunks of functions into its own arena, the arenas are merged into the
+ * parser arena once every worker is done and the functions are stitched in
+ * source order, so the tree is the same as the sequential parser's.
+ *
+ * Returns NULL when the sequential parser must be used instead: the input
+ * doesn't split into functions or a worker hit a syntax error.
+ */
+static ast_node_t *
+parser_parse_translation_unit_parallel(parser_t *parser, size_t workers_size)
+{
+    token_buffer_t *tokens = &parser->tokens;
+
+    size_t decls_size = parser_scan_decls(tokens, NULL);
+    if (decls_size < 2 || decls_size > UINT32_MAX) {
+        return NULL;
+    }
+
+    // One more start marks the end of the last function, the trailing EOF.
+    size_t *decl_starts = (size_t *)arena_alloc(
+        parser->arena, (decls_size + 1) * sizeof(size_t));
+    ast_node_t **decls = (ast_node_t **)arena_alloc(
+        parser->arena, decls_size * sizeof(ast_node_t *));
+    if (decl_starts == NULL || decls == NULL) {
+        fprintf(stderr,
+                "[FATAL] Out of memory: "
+                "parser_parse_translation_unit_parallel: %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    parser_scan_decls(tokens, decl_starts);
+    decl_starts[decls_size] = tokens->size - 1;
+
+    // Only line feeds may come before the first function.
+    size_t cursor = parser->cursor;
+    skip_line_feeds(parser);
+    bool starts_with_decl = parser->cursor == decl_starts[0];
+    parser->cursor = cursor;
+
+    if (!starts_with_decl) {
+        return NULL;
+    }
+
+    if (workers_size > decls_size) {
+        workers_size = decls_size;
+    }
+
+    size_t chunks_size = workers_size * PARSER_PARALLEL_CHUNKS_PER_WORKER;
+
+    parser_parallel_job_t job = {
+        .parser = parser,
+        .decl_starts = decl_starts,
+        .decls = decls,
+        .decls_size = decls_size,
+        .chunk_size = (decls_size + chunks_size - 1) / chunks_size,
+    };
+    atomic_init(&job.next_chunk, 0);
+    atomic_init(&job.failed, false);
+
+    parser_worker_t workers[PARSER_PARALLEL_MAX_WORKERS];
+    thrd_t threads[PARSER_PARALLEL_MAX_WORKERS];
+    size_t threads_size = 0;
+
+    for (size_t i = 0; i < workers_size; ++i) {
+        workers[i] = (parser_worker_t){
+            .job = &job,
+            .arena = arena_new(PARSER_WORKER_ARENA_CAPACITY),
+        };
+    }
+
+    // The calling thread is the first worker.  Chunks are handed out on
+    // demand, so if a thread can't be created the others pick up its share.
+    for (size_t i = 1; i < workers_size; ++i) {
+        int status =
+            thrd_create(&threads[threads_size], parser_worker_run, &workers[i]);
+        if (status != thrd_success) {
+            break;
+        }
+        ++threads_size;
+    }
+
+    parser_worker_run(&workers[0]);
+
+    for (size_t i = 0; i < threads_size; ++i) {
+        thrd_join(threads[i], NULL);
+    }
+
+    bool failed = atomic_load(&job.failed);
+
+    for (size_t i = 0; i < workers_size; ++i) {
+        if (failed) {
+            arena_free(&workers[i].arena);
+        } else {
+            arena_merge(parser->arena, &workers[i].arena);
+        }
+    }
+
+    if (failed) {
+        return NULL;
+    }
+
+    parser->cursor = decl_starts[decls_size];
+
+    return ast_new_translation_unit(
+        parser->arena, decls, (uint32_t)decls_size);
+}
+
+static int
+parser_worker_run(void *arg)
+{
+    parser_worker_t *worker = (parser_worker_t *)arg;
+    parser_parallel_job_t *job = worker->job;
+
+    // Tokens are shared read-only, everything the worker allocates goes to
+    // its own arena.
+    parser_t parser = {
+        .lexer = job->parser->lexer,
+        .arena = &worker->arena,
+        .tokens = job->parser->tokens,
+        .quiet = true,
+    };
+    vector_init(&parser.scratch, &worker->arena);
+
+    while (!atomic_load(&job->failed)) {
+        size_t begin = atomic_fetch_add(&job->next_chunk, 1) * job->chunk_size;
+        if (begin >= job->decls_size) {
+            break;
+        }
+
+        size_t end = begin + job->chunk_size;
+        if (end > job->decls_size) {
+            end = job->decls_size;
+        }
+
+        for (size_t i = begin; i < end; ++i) {
+            parser.cursor = job->decl_starts[i];
+
+            ast_node_t *decl = parser_parse_fn_definition(&parser);
+
+            // A function must end right where the next one starts, otherwise
+            // the split disagrees with the grammar.
+            skip_line_feeds(&parser);
+
+            if (decl == NULL || parser.failed ||
+                parser.cursor != job->decl_starts[i + 1]) {
+                atomic_store(&job->failed, true);
+                return 0;
+            }
+
+            job->decls[i] = decl;
+        }
+    }
+
+    return 0;
 }
 
 static ast_binary_op_kind_t
@@ -242,61 +599,116 @@ token_kind_to_unary_op_kind(token_kind_t token_kind)
     }
 }
 
+/**
+ * Expressions are parsed with an explicit stack of frames instead of
+ * recursion, so nesting depth is only bounded by memory.  Each iteration
+ * either parses an operand (pushing frames for prefix operators, parens and
+ * calls until a literal or a reference is found) or hands the last complete
+ * expression to the frame on top of the stack.
+ *
+ * The binary frames follow the precedence climbing the recursive parser used
+ * to do, operators of higher precedence are climbed with a frame of the
+ * current operator precedence, so trees are the same as before.
+ */
 static ast_node_t *
-parser_parse_expr_1(parser_t *parser, ast_node_t *lhs, size_t prev_precedence)
+parser_parse_expr(parser_t *parser)
 {
-    token_t lookahead_token;
-    lexer_peek_next(parser->lexer, &lookahead_token);
+    size_t frames_size = 0;
+    parser_push_expr_frame(parser, &frames_size, EXPR_FRAME_EXPR);
 
-    while (token_kind_is_binary_op(lookahead_token.kind) &&
-           get_binary_op_precedence(lookahead_token.kind) >= prev_precedence) {
-        token_t token_op;
-        lexer_next_token(parser->lexer, &token_op);
+    ast_node_t *value = NULL;
 
-        ast_node_t *rhs = parser_parse_unary_expr(parser);
-        if (rhs == NULL) {
-            return NULL;
+    while (frames_size > 0) {
+        if (value == NULL) {
+            if (!parser_parse_operand(parser, &frames_size, &value)) {
+                return NULL;
+            }
+            continue;
         }
 
-        lexer_peek_next(parser->lexer, &lookahead_token);
+        parser_expr_frame_t *frame = &parser->expr_frames[frames_size - 1];
 
-        while (token_kind_is_binary_op(lookahead_token.kind) &&
-               get_binary_op_precedence(lookahead_token.kind) >
-                   get_binary_op_precedence(token_op.kind)) {
-            rhs = parser_parse_expr_1(
-                parser, rhs, get_binary_op_precedence(token_op.kind));
-            lexer_peek_next(parser->lexer, &lookahead_token);
-        }
-
-        lhs = ast_new_node_bin_op(parser->arena,
-                                  token_op.loc,
-                                  token_kind_to_binary_op_kind(token_op.kind),
-                                  lhs,
-                                  rhs);
-        if (lhs == NULL) {
-            return NULL;
+        switch (frame->kind) {
+            case EXPR_FRAME_EXPR: {
+                frame->kind = EXPR_FRAME_BINARY;
+                frame->min_precedence = BINOP_MIN_PREC;
+                frame->lhs = value;
+                frame->rhs = NULL;
+                value = parser_climb_binary_expr(parser, &frames_size);
+                break;
+            }
+            case EXPR_FRAME_BINARY: {
+                frame->rhs = value;
+                value = parser_climb_binary_expr(parser, &frames_size);
+                break;
+            }
+            case EXPR_FRAME_UNARY: {
+                ast_unary_op_kind_t kind =
+                    token_kind_to_unary_op_kind(frame->op);
+                value = ast_new_node_unary_op(
+                    parser->arena, frame->loc, kind, value);
+                --frames_size;
+                break;
+            }
+            case EXPR_FRAME_PAREN: {
+                --frames_size;
+                if (!skip_expected_token(parser, TOKEN_CPAREN)) {
+                    return NULL;
+                }
+                break;
+            }
+            case EXPR_FRAME_CALL: {
+                vector_push(&parser->scratch, value);
+
+                skip_line_feeds(parser);
+
+                token_t token;
+                parser_peek_next(parser, &token);
+
+                if (token.kind != TOKEN_CPAREN && token.kind != TOKEN_EOF) {
+                    if (expected_token(parser, &token, TOKEN_COMMA)) {
+                        parser_next_token(parser, &token);
+                    }
+                    parser_push_expr_frame(
+                        parser, &frames_size, EXPR_FRAME_EXPR);
+                    value = NULL;
+                    break;
+                }
+
+                token_loc_t loc = frame->loc;
+                atom_t *id = frame->id;
+                size_t args_start = frame->args_start;
+                --frames_size;
+
+                if (!skip_expected_token(parser, TOKEN_CPAREN)) {
+                    return NULL;
+                }
+
+                uint32_t args_size;
+                ast_node_t **args = (ast_node_t **)parser_take_scratch(
+                    parser, args_start, &args_size);
+
+                value = ast_new_node_fn_call(
+                    parser->arena, loc, id, args, args_size);
+                break;
+            }
         }
     }
 
-    return lhs;
-}
-
-static ast_node_t *
-parser_parse_expr(parser_t *parser)
-{
-    ast_node_t *lhs = parser_parse_unary_expr(parser);
-    if (lhs == NULL) {
-        return NULL;
-    }
-
-    return parser_parse_expr_1(parser, lhs, BINOP_MIN_PREC);
+    return value;
 }
 
-static ast_node_t *
-parser_parse_unary_expr(parser_t *parser)
+/**
+ * Parses the next operand token.  Prefix operators, parens and calls with
+ * arguments only push their frame and leave value NULL, the operand is
+ * complete once value is set.
+ */
+static bool
+parser_parse_operand(parser_t *parser, size_t *frames_size, ast_node_t **value)
 {
     token_t token;
-    lexer_peek_next(parser->lexer, &token);
+    parser_next_token(parser, &token);
+
     switch (token.kind) {
         case TOKEN_AND:
         case TOKEN_STAR:
@@ -304,164 +716,202 @@ parser_parse_unary_expr(parser_t *parser)
         case TOKEN_DASH:
         case TOKEN_TILDE:
         case TOKEN_BANG: {
-            skip_next_token(parser);
-            ast_node_t *expr = parser_parse_unary_expr(parser);
-            if (expr == NULL) {
-                return NULL;
-            }
-
-            ast_unary_op_kind_t kind = token_kind_to_unary_op_kind(token.kind);
-            return ast_new_node_unary_op(parser->arena, token.loc, kind, expr);
-        }
-        default: {
-            return parser_parse_primary_expr(parser);
+            parser_expr_frame_t *frame =
+                parser_push_expr_frame(parser, frames_size, EXPR_FRAME_UNARY);
+            frame->op = token.kind;
+            frame->loc = token.loc;
+            return true;
         }
-    }
-}
 
-static ast_node_t *
-parser_parse_primary_expr(parser_t *parser)
-{
-    token_t token;
-    lexer_next_token(parser->lexer, &token);
-
-    switch (token.kind) {
         case TOKEN_NUMBER:
-            return ast_new_node_literal_u32(
-                parser->arena, token.loc, string_view_to_u32(token.value));
+            // Literals that do not fit in u32 keep their value as u64.
+            if (token.number > UINT32_MAX) {
+                *value = ast_new_node_literal_u64(
+                    parser->arena, token.loc, token.number);
+                return true;
+            }
+
+            *value = ast_new_node_literal_u32(
+                parser->arena, token.loc, (uint32_t)token.number);
+            return true;
 
         case TOKEN_ID: {
+            if (parser_peek_next_kind(parser) != TOKEN_OPAREN) {
+                *value = ast_new_node_ref(parser->arena, token.loc, token.atom);
+                return true;
+            }
+
             token_t token_id = token;
 
-            lexer_peek_next(parser->lexer, &token);
+            skip_next_token(parser);
+            skip_line_feeds(parser);
+            token_kind_t next_kind = parser_peek_next_kind(parser);
+
+            if (next_kind != TOKEN_CPAREN && next_kind != TOKEN_EOF) {
+                parser_expr_frame_t *frame = parser_push_expr_frame(
+                    parser, frames_size, EXPR_FRAME_CALL);
+                frame->loc = token_id.loc;
+                frame->id = token_id.atom;
+                frame->args_start = vector_size(&parser->scratch);
+
+                parser_push_expr_frame(parser, frames_size, EXPR_FRAME_EXPR);
+                return true;
+            }
 
-            if (token.kind == TOKEN_OPAREN) {
-                list_t *args = parser_parse_fn_args(parser);
-                return ast_new_node_fn_call(
-                    parser->arena, token_id.loc, token_id.value, args);
+            if (!skip_expected_token(parser, TOKEN_CPAREN)) {
+                return false;
             }
-            return ast_new_node_ref(
-                parser->arena, token_id.loc, token_id.value);
+
+            *value = ast_new_node_fn_call(
+                parser->arena, token_id.loc, token_id.atom, NULL, 0);
+            return true;
         }
 
         case TOKEN_OPAREN: {
-            ast_node_t *expr = parser_parse_expr(parser);
-            if (expr == NULL) {
-                return NULL;
-            }
+            parser_push_expr_frame(parser, frames_size, EXPR_FRAME_PAREN);
+            parser_push_expr_frame(parser, frames_size, EXPR_FRAME_EXPR);
+            return true;
+        }
 
-            if (!skip_expected_token(parser, TOKEN_CPAREN)) {
-                return NULL;
+        default: {
+            parser->failed = true;
+            if (parser->quiet) {
+                return false;
             }
 
-            return expr;
-        }
-        default: {
             fprintf(stderr,
                     "error: parse_factor: unsupported or invalid token (%s)\n",
                     token_kind_to_cstr(token.kind));
             assert(false);
+            return false;
         }
     }
 }
 
-static list_t *
-parser_parse_fn_args(parser_t *parser)
+/**
+ * Runs the binary frame on top of the stack until it needs the right hand
+ * side of an operator, then NULL is returned.  Once no operator of enough
+ * precedence follows, the frame is popped and its expression returned.
+ */
+static ast_node_t *
+parser_climb_binary_expr(parser_t *parser, size_t *frames_size)
 {
-    if (!skip_expected_token(parser, TOKEN_OPAREN)) {
-        return NULL;
-    }
+    while (true) {
+        parser_expr_frame_t *frame = &parser->expr_frames[*frames_size - 1];
+        token_kind_t lookahead_kind = parser_peek_next_kind(parser);
 
-    list_t *args = arena_alloc(parser->arena, sizeof(list_t));
-    if (args == NULL) {
-        fprintf(stderr,
-                "[FATAL] Out of memory: parser_parse_fn_args: %s\n",
-                strerror(errno));
-        exit(EXIT_FAILURE);
-    }
+        bool is_binary_op = token_kind_is_binary_op(lookahead_kind);
 
-    list_init(args, parser->arena);
+        if (frame->rhs == NULL) {
+            if (!is_binary_op || get_binary_op_precedence(lookahead_kind) <
+                                     frame->min_precedence) {
+                --*frames_size;
+                return frame->lhs;
+            }
 
-    skip_line_feeds(parser->lexer);
+            token_t token_op;
+            parser_next_token(parser, &token_op);
+            frame->op = token_op.kind;
+            frame->loc = token_op.loc;
+            return NULL;
+        }
 
-    token_t token;
-    lexer_peek_next(parser->lexer, &token);
+        binary_op_precedence_t op_precedence =
+            get_binary_op_precedence(frame->op);
 
-    bool is_not_first_arg = false;
+        if (is_binary_op &&
+            get_binary_op_precedence(lookahead_kind) > op_precedence) {
+            ast_node_t *rhs = frame->rhs;
 
-    while (token.kind != TOKEN_CPAREN && token.kind != TOKEN_EOF) {
-        if (is_not_first_arg && expected_token(&token, TOKEN_COMMA)) {
-            lexer_next_token(parser->lexer, &token);
+            parser_expr_frame_t *rhs_frame =
+                parser_push_expr_frame(parser, frames_size, EXPR_FRAME_BINARY);
+            rhs_frame->min_precedence = op_precedence;
+            rhs_frame->lhs = rhs;
+            rhs_frame->rhs = NULL;
+            continue;
         }
 
-        ast_node_t *expr = parser_parse_expr(parser);
-        list_append(args, expr);
-
-        skip_line_feeds(parser->lexer);
-        lexer_peek_next(parser->lexer, &token);
-        is_not_first_arg = true;
+        ast_binary_op_kind_t kind = token_kind_to_binary_op_kind(frame->op);
+        frame->lhs = ast_new_node_bin_op(
+            parser->arena, frame->loc, kind, frame->lhs, frame->rhs);
+        frame->rhs = NULL;
     }
+}
 
-    if (!skip_expected_token(parser, TOKEN_CPAREN)) {
-        return NULL;
+static parser_expr_frame_t *
+parser_push_expr_frame(parser_t *parser,
+                       size_t *frames_size,
+                       parser_expr_frame_kind_t kind)
+{
+    if (*frames_size == parser->expr_frames_capacity) {
+        size_t capacity = parser->expr_frames_capacity == 0
+                              ? PARSER_EXPR_FRAMES_INITIAL_CAPACITY
+                              : parser->expr_frames_capacity * 2;
+
+        parser_expr_frame_t *frames = (parser_expr_frame_t *)arena_alloc(
+            parser->arena, capacity * sizeof(parser_expr_frame_t));
+        if (frames == NULL) {
+            fprintf(stderr,
+                    "[FATAL] Out of memory: parser_push_expr_frame: %s\n",
+                    strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+
+        if (*frames_size > 0) {
+            memcpy(frames,
+                   parser->expr_frames,
+                   *frames_size * sizeof(parser_expr_frame_t));
+        }
+
+        parser->expr_frames = frames;
+        parser->expr_frames_capacity = capacity;
     }
 
-    return args;
+    parser_expr_frame_t *frame = &parser->expr_frames[(*frames_size)++];
+    frame->kind = kind;
+
+    return frame;
 }
 
-static list_t *
+static bool
 parser_parse_fn_params(parser_t *parser)
 {
     if (!skip_expected_token(parser, TOKEN_OPAREN)) {
-        return NULL;
-    }
-
-    list_t *params = arena_alloc(parser->arena, sizeof(list_t));
-    if (params == NULL) {
-        fprintf(stderr,
-                "[FATAL] Out of memory: parser_parse_fn_params: %s\n",
-                strerror(errno));
-        exit(EXIT_FAILURE);
+        return false;
     }
 
-    list_init(params, parser->arena);
-
-    skip_line_feeds(parser->lexer);
+    skip_line_feeds(parser);
 
     token_t token;
-    lexer_next_token(parser->lexer, &token);
+    parser_next_token(parser, &token);
 
     bool is_not_first_param = false;
 
     while (token.kind != TOKEN_CPAREN && token.kind != TOKEN_EOF) {
-        if (is_not_first_param && expected_token(&token, TOKEN_COMMA)) {
-            lexer_next_token(parser->lexer, &token);
+        if (is_not_first_param && expected_token(parser, &token, TOKEN_COMMA)) {
+            parser_next_token(parser, &token);
         }
 
-        if (!expected_token(&token, TOKEN_ID)) {
-            return NULL;
+        if (!expected_token(parser, &token, TOKEN_ID)) {
+            return false;
         }
 
         type_t *type = parser_parse_type(parser);
 
         if (type == NULL) {
-            return NULL;
+            return false;
         }
 
         ast_fn_param_t *param =
-            ast_new_fn_param(parser->arena, token.value, type);
-        list_append(params, param);
+            ast_new_fn_param(parser->arena, token.atom, type);
+        vector_push(&parser->scratch, param);
 
-        skip_line_feeds(parser->lexer);
-        lexer_next_token(parser->lexer, &token);
+        skip_line_feeds(parser);
+        parser_next_token(parser, &token);
         is_not_first_param = true;
     }
 
-    if (!expected_token(&token, TOKEN_CPAREN)) {
-        return NULL;
-    }
-
-    return params;
+    return expected_token(parser, &token, TOKEN_CPAREN);
 }
 
 ast_node_t *
@@ -470,7 +920,7 @@ parser_parse_fn_definition(parser_t *parser)
     bool _extern = false;
 
     token_t _extern_token;
-    lexer_peek_next(parser->lexer, &_extern_token);
+    parser_peek_next(parser, &_extern_token);
 
     if (_extern_token.kind == TOKEN_EXTERN) {
         _extern = true;
@@ -481,7 +931,7 @@ parser_parse_fn_definition(parser_t *parser)
         return NULL;
     }
 
-    skip_line_feeds(parser->lexer);
+    skip_line_feeds(parser);
 
     token_t fn_name_token;
 
@@ -489,20 +939,24 @@ parser_parse_fn_definition(parser_t *parser)
         return NULL;
     }
 
-    skip_line_feeds(parser->lexer);
+    skip_line_feeds(parser);
 
-    list_t *params = parser_parse_fn_params(parser);
-    if (params == NULL) {
+    size_t params_start = vector_size(&parser->scratch);
+    if (!parser_parse_fn_params(parser)) {
         return NULL;
     }
 
+    uint32_t params_size;
+    ast_fn_param_t **params = (ast_fn_param_t **)parser_take_scratch(
+        parser, params_start, &params_size);
+
     type_t *ret_type = parser_parse_type(parser);
 
     if (ret_type == NULL) {
         return NULL;
     }
 
-    skip_line_feeds(parser->lexer);
+    skip_line_feeds(parser);
 
     ast_node_t *block = NULL;
     if (!_extern) {
@@ -514,8 +968,9 @@ parser_parse_fn_definition(parser_t *parser)
 
     return ast_new_node_fn_def(parser->arena,
                                fn_name_token.loc,
-                               fn_name_token.value,
+                               fn_name_token.atom,
                                params,
+                               params_size,
                                ret_type,
                                _extern,
                                block);
@@ -524,13 +979,13 @@ parser_parse_fn_definition(parser_t *parser)
 static type_t *
 parser_parse_type(parser_t *parser)
 {
-    skip_line_feeds(parser->lexer);
+    skip_line_feeds(parser);
 
     if (!skip_expected_token(parser, TOKEN_COLON)) {
         return NULL;
     }
 
-    skip_line_feeds(parser->lexer);
+    skip_line_feeds(parser);
 
     token_t token;
 
@@ -540,7 +995,7 @@ parser_parse_type(parser_t *parser)
 
     token_t ptr_token;
 
-    lexer_peek_next(parser->lexer, &ptr_token);
+    parser_peek_next(parser, &ptr_token);
 
     type_t *type = type_new_unknown(parser->arena, token.value);
 
@@ -562,21 +1017,20 @@ parser_parse_type(parser_t *parser)
 static ast_node_t *
 parser_parse_block(parser_t *parser)
 {
-    if (!skip_expected_token(parser, TOKEN_OCURLY)) {
+    token_t token_ocurly;
+
+    if (!expected_next_token(parser, &token_ocurly, TOKEN_OCURLY)) {
         return NULL;
     }
 
-    skip_line_feeds(parser->lexer);
+    skip_line_feeds(parser);
 
-    ast_node_t *node_block = ast_new_node_block(parser->arena);
-    if (node_block == NULL) {
-        return NULL;
-    }
+    size_t nodes_start = vector_size(&parser->scratch);
 
     token_t next_token;
 
 StartLoop:
-    lexer_peek_next(parser->lexer, &next_token);
+    parser_peek_next(parser, &next_token);
     ast_node_t *node = NULL;
 
     switch (next_token.kind) {
@@ -612,9 +1066,9 @@ StartLoop:
         return NULL;
     }
 
-    skip_line_feeds(parser->lexer);
+    skip_line_feeds(parser);
 
-    list_append(node_block->as_block.nodes, node);
+    vector_push(&parser->scratch, node);
 
     goto StartLoop;
 EndLoop:
@@ -623,7 +1077,12 @@ EndLoop:
         return NULL;
     }
 
-    return node_block;
+    uint32_t nodes_size;
+    ast_node_t **nodes =
+        (ast_node_t **)parser_take_scratch(parser, nodes_start, &nodes_size);
+
+    return ast_new_node_block(
+        parser->arena, token_ocurly.loc, nodes, nodes_size);
 }
 
 static ast_node_t *
@@ -661,7 +1120,7 @@ parser_parse_if_stmt(parser_t *parser)
         return NULL;
     }
 
-    skip_line_feeds(parser->lexer);
+    skip_line_feeds(parser);
 
     ast_node_t *then = parser_parse_block(parser);
 
@@ -672,14 +1131,14 @@ parser_parse_if_stmt(parser_t *parser)
     ast_node_t *_else = NULL;
 
     token_t next_token;
-    peek_next_non_lf_token(parser->lexer, &next_token);
+    peek_next_non_lf_token(parser, &next_token);
 
     if (next_token.kind == TOKEN_ELSE) {
-        skip_line_feeds(parser->lexer);
-        lexer_next_token(parser->lexer, &next_token);
-        skip_line_feeds(parser->lexer);
+        skip_line_feeds(parser);
+        parser_next_token(parser, &next_token);
+        skip_line_feeds(parser);
 
-        lexer_peek_next(parser->lexer, &next_token);
+        parser_peek_next(parser, &next_token);
 
         if (next_token.kind == TOKEN_IF) {
             _else = parser_parse_if_stmt(parser);
@@ -714,7 +1173,7 @@ parser_parse_while_stmt(parser_t *parser)
         return NULL;
     }
 
-    skip_line_feeds(parser->lexer);
+    skip_line_feeds(parser);
 
     ast_node_t *then = parser_parse_block(parser);
 
@@ -723,7 +1182,7 @@ parser_parse_while_stmt(parser_t *parser)
     }
 
     token_t next_token;
-    peek_next_non_lf_token(parser->lexer, &next_token);
+    peek_next_non_lf_token(parser, &next_token);
 
     ast_node_t *node_while_stmt =
         ast_new_node_while_stmt(parser->arena, token_while.loc, cond, then);
@@ -761,7 +1220,7 @@ parser_parse_var_def(parser_t *parser)
     }
 
     ast_node_t *var_node = ast_new_node_var_def(
-        parser->arena, token_id.loc, token_id.value, type, expr);
+        parser->arena, token_id.loc, token_id.atom, type, expr);
 
     return var_node;
 }
@@ -777,7 +1236,7 @@ static void
 skip_next_token(parser_t *parser)
 {
     token_t token;
-    lexer_next_token(parser->lexer, &token);
+    parser_next_token(parser, &token);
 }
 
 static bool
@@ -785,18 +1244,23 @@ expected_next_token(parser_t *parser,
                     token_t *token,
                     token_kind_t expected_kind)
 {
-    lexer_next_token(parser->lexer, token);
-    return expected_token(token, expected_kind);
+    parser_next_token(parser, token);
+    return expected_token(parser, token, expected_kind);
 }
 
 static bool
-expected_token(token_t *token, token_kind_t expected_kind)
+expected_token(parser_t *parser, token_t *token, token_kind_t expected_kind)
 {
     if (token->kind != expected_kind) {
+        parser->failed = true;
+        if (parser->quiet) {
+            return false;
+        }
+
         fprintf(stderr,
                 "%s:%lu:%lu: syntax error: got '" SV_FMT
                 "' token but expect '%s'\n",
-                token->loc.src.filepath,
+                token_loc_to_filepath(token->loc),
                 token_loc_to_lineno(token->loc),
                 token_loc_to_colno(token->loc),
                 SV_ARG(token->value),
@@ -811,24 +1275,82 @@ expected_token(token_t *token, token_kind_t expected_kind)
 }
 
 static void
-skip_line_feeds(lexer_t *lexer)
+skip_line_feeds(parser_t *parser)
 {
-    token_t token;
-    lexer_peek_next(lexer, &token);
+    token_buffer_t *tokens = &parser->tokens;
 
-    while (token.kind == TOKEN_LF) {
-        lexer_next_token(lexer, &token);
-        lexer_peek_next(lexer, &token);
+    while (parser->cursor < tokens->size &&
+           tokens->kinds[parser->cursor] == TOKEN_LF) {
+        ++parser->cursor;
     }
 }
 
 static void
-peek_next_non_lf_token(lexer_t *lexer, token_t *token)
+peek_next_non_lf_token(parser_t *parser, token_t *token)
 {
-    lexer_cursor_t cur = lexer->cur;
+    token_buffer_t *tokens = &parser->tokens;
+    size_t index = parser->cursor;
+
+    while (index < tokens->size && tokens->kinds[index] == TOKEN_LF) {
+        ++index;
+    }
+
+    token_buffer_get(tokens, index, token);
+}
+
+static void
+parser_next_token(parser_t *parser, token_t *token)
+{
+    token_buffer_get(&parser->tokens, parser->cursor, token);
+
+    if (parser->cursor + 1 < parser->tokens.size) {
+        ++parser->cursor;
+    }
+}
+
+static void
+parser_peek_next(parser_t *parser, token_t *token)
+{
+    parser_lookahead(parser, token, 1);
+}
+
+static token_kind_t
+parser_peek_next_kind(parser_t *parser)
+{
+    return token_buffer_kind(&parser->tokens, parser->cursor);
+}
+
+static void
+parser_lookahead(parser_t *parser, token_t *token, size_t n)
+{
+    assert(n > 0);
+    token_buffer_get(&parser->tokens, parser->cursor + n - 1, token);
+}
+
+static void **
+parser_take_scratch(parser_t *parser, size_t start, uint32_t *size)
+{
+    size_t scratch_size = vector_size(&parser->scratch);
+    assert(start <= scratch_size);
+
+    *size = (uint32_t)(scratch_size - start);
+    if (*size == 0) {
+        return NULL;
+    }
+
+    void **items = (void **)arena_alloc_aligned(
+        parser->arena, *size * sizeof(void *), _Alignof(void *));
+    if (items == NULL) {
+        fprintf(stderr,
+                "[FATAL] Out of memory: parser_take_scratch: %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
 
-    skip_line_feeds(lexer);
-    lexer_peek_next(lexer, token);
+    memcpy(items,
+           vector_items(&parser->scratch) + start,
+           *size * sizeof(void *));
+    vector_truncate(&parser->scratch, start);
 
-    lexer->cur = cur;
+    return items;
 }
@@ -17,14 +17,36 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <stdbool.h>
+
 #include "arena.h"
 #include "ast.h"
 #include "lexer.h"
+#include "vector.h"
+
+typedef struct parser_expr_frame parser_expr_frame_t;
 
 typedef struct parser
 {
     lexer_t *lexer;
     arena_t *arena;
+    token_buffer_t tokens;
+    // Index of the next token to be consumed in the tokens buffer.
+    size_t cursor;
+    // Children of the nodes being parsed are stacked here until their parent
+    // takes them as an exact-size array, see parser_take_scratch.
+    vector_t scratch;
+    // Explicit stack of the expression parser, reused by every expression.
+    parser_expr_frame_t *expr_frames;
+    size_t expr_frames_capacity;
+    // Quiet parsers don't report syntax errors nor exit, they only set failed
+    // and unwind.  Parallel workers are quiet, see
+    // parser_parse_translation_unit.
+    bool quiet;
+    bool failed;
+    // Threads parsing top-level functions concurrently.  0 uses one per online
+    // CPU, for inputs big enough to be worth it.
+    size_t workers_size;
 } parser_t;
 
 void
@@ -32,26 +32,16 @@ scope_new(arena_t *arena)
             stderr, "[FATAL] Out of memory: scope_new: %s\n", strerror(errno));
         exit(EXIT_FAILURE);
     }
+    scope->parent = NULL;
     scope->arena = arena;
-    scope->symbols = map_new(arena);
-
-    // FIXME: create a list_new function to avoid spreading this.
-    list_t *children = (list_t *)arena_alloc(arena, sizeof(list_t));
-
-    if (children == NULL) {
-        fprintf(
-            stderr, "[FATAL] Out of memory: scope_new: %s\n", strerror(errno));
-        exit(EXIT_FAILURE);
-    }
-
-    list_init(children, arena);
-
-    scope->children = children;
+    scope->symbols_size = 0;
+    scope->overflow_symbols = NULL;
+    scope->index = NULL;
     return scope;
 }
 
 symbol_t *
-symbol_new(arena_t *arena, string_view_t id, type_t *type)
+symbol_new(arena_t *arena, atom_t *id, type_t *type)
 {
     assert(arena);
     symbol_t *symbol = (symbol_t *)arena_alloc(arena, sizeof(symbol_t));
@@ -62,22 +52,34 @@ symbol_new(arena_t *arena, string_view_t id, type_t *type)
     }
     symbol->id = id;
     symbol->type = type;
+    symbol->slot = 0;
+    symbol->address_taken = false;
     return symbol;
 }
 
 symbol_t *
-scope_lookup(scope_t *scope, string_view_t id)
+scope_lookup(scope_t *scope, atom_t *id)
 {
     assert(scope);
-    while (scope != NULL) {
-
-        char cstr_id[id.size + 1];
-        cstr_id[id.size] = 0;
-        memcpy(cstr_id, id.chars, id.size);
+    assert(id);
 
-        symbol_t *symbol = (symbol_t *)map_get(scope->symbols, cstr_id);
-        if (symbol != NULL) {
-            return symbol;
+    // Atoms are unique, so symbols are matched by pointer and the map lookup
+    // never recomputes the hash.
+    while (scope != NULL) {
+        if (scope->index != NULL) {
+            symbol_t *symbol = (symbol_t *)map_get_with_hash(
+                scope->index, id->str, id->hash);
+            if (symbol != NULL) {
+                return symbol;
+            }
+        } else {
+            // Scanned backwards so a redeclaration shadows the earlier one,
+            // like the map does.
+            for (size_t i = scope->symbols_size; i > 0; --i) {
+                if (scope->inline_symbols[i - 1]->id == id) {
+                    return scope->inline_symbols[i - 1];
+                }
+            }
         }
         scope = scope->parent;
     }
@@ -90,23 +92,58 @@ scope_insert(scope_t *scope, symbol_t *symbol)
     assert(scope);
     assert(symbol);
 
-    char id[symbol->id.size + 1];
-    id[symbol->id.size] = 0;
-    memcpy(id, symbol->id.chars, symbol->id.size);
+    if (scope->symbols_size < SCOPE_INLINE_SYMBOLS) {
+        scope->inline_symbols[scope->symbols_size++] = symbol;
+        return;
+    }
+
+    if (scope->index == NULL) {
+        scope->overflow_symbols = vector_new(scope->arena);
+        scope->index = map_new(scope->arena);
+
+        for (size_t i = 0; i < SCOPE_INLINE_SYMBOLS; ++i) {
+            symbol_t *inline_symbol = scope->inline_symbols[i];
+            map_put_with_hash(scope->index,
+                              inline_symbol->id->str,
+                              inline_symbol->id->hash,
+                              inline_symbol);
+        }
+    }
+
+    vector_push(scope->overflow_symbols, symbol);
+    map_put_with_hash(scope->index, symbol->id->str, symbol->id->hash, symbol);
+    scope->symbols_size++;
+}
+
+symbol_t *
+scope_symbol_at(scope_t *scope, size_t index)
+{
+    assert(scope);
+    assert(index < scope->symbols_size);
 
-    map_put(scope->symbols, id, symbol);
+    if (index < SCOPE_INLINE_SYMBOLS) {
+        return scope->inline_symbols[index];
+    }
+    return (symbol_t *)vector_get(scope->overflow_symbols,
+                                  index - SCOPE_INLINE_SYMBOLS);
 }
 
 scope_t *
 scope_push(scope_t *scope)
 {
     assert(scope);
+    return scope_push_in(scope, scope->arena);
+}
 
-    scope_t *child = scope_new(scope->arena);
-    child->parent = scope;
-
-    list_append(scope->children, child);
+scope_t *
+scope_push_in(scope_t *scope, arena_t *arena)
+{
+    assert(scope);
 
+    // Parents do not point to their children, so a child can live in an
+    // arena shorter-lived than its parent's.
+    scope_t *child = scope_new(arena);
+    child->parent = scope;
     return child;
 }
 
@@ -17,41 +17,71 @@
 #ifndef SCOPE_H
 #define SCOPE_H
 
+#include <stdbool.h>
+
 #include "arena.h"
-#include "list.h"
+#include "interner.h"
+#include "vector.h"
 #include "map.h"
 #include "string_view.h"
 #include "type.h"
 
 typedef struct symbol
 {
-    string_view_t id;
+    atom_t *id;
     type_t *type;
+    // Dense index of a parameter or local within its function, assigned by
+    // the checker.
+    uint32_t slot;
+    // Set by the checker when the address of the symbol is taken, such
+    // symbols must live in memory rather than in SSA values.
+    bool address_taken;
 } symbol_t;
 
+// Most scopes declare only a few symbols, if any, so the first ones are kept
+// in an array inside the scope and found by a linear scan over their atoms.
+// Past that a scope spills into a vector and indexes every symbol in a map.
+#define SCOPE_INLINE_SYMBOLS 8
+
 typedef struct scope
 {
     struct scope *parent;
-    list_t *children;
     arena_t *arena;
-    map_t *symbols;
+    size_t symbols_size;
+    symbol_t *inline_symbols[SCOPE_INLINE_SYMBOLS];
+    // Both NULL until the inline array is full.
+    vector_t *overflow_symbols;
+    map_t *index;
 } scope_t;
 
 scope_t *
 scope_new(arena_t *arena);
 
 symbol_t *
-symbol_new(arena_t *arena, string_view_t id, type_t *type);
+symbol_new(arena_t *arena, atom_t *id, type_t *type);
 
 symbol_t *
-scope_lookup(scope_t *scope, string_view_t id);
+scope_lookup(scope_t *scope, atom_t *id);
 
 void
 scope_insert(scope_t *scope, symbol_t *symbol);
 
+/**
+ * Symbols of the scope itself, excluding its parents, in insertion order.
+ */
+symbol_t *
+scope_symbol_at(scope_t *scope, size_t index);
+
 scope_t *
 scope_push(scope_t *scope);
 
+/**
+ * Same as scope_push, but the child and the scopes pushed onto it are
+ * allocated in arena, which can be rewound once the child is popped.
+ */
+scope_t *
+scope_push_in(scope_t *scope, arena_t *arena);
+
 scope_t *
 scope_pop(scope_t *scope);
 
@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#define _DEFAULT_SOURCE
+#include "source.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SOURCE_FILES_INITIAL_CAPACITY 4
+#define SOURCE_READ_CHUNK_BYTES (64 * 1024)
+#define SOURCE_STDIN_FILEPATH "-"
+
+typedef struct source_file
+{
+    source_code_t src;
+    // Offset of the first char of every line, built lazily.
+    uint32_t *line_starts;
+    size_t lines_size;
+} source_file_t;
+
+// Files are registered for the whole compilation, they are never released.
+static source_file_t *source_files = NULL;
+static size_t source_files_size = 0;
+static size_t source_files_capacity = 0;
+
+static source_file_t *
+source_file_get(uint32_t file_id);
+
+static bool
+source_map(int fd, size_t size, string_view_t *code);
+
+static void
+source_read_stream(int fd, char *filepath, arena_t *arena, string_view_t *code);
+
+static void
+source_file_build_line_starts(source_file_t *file);
+
+static void
+source_check_size(char *filepath, size_t size);
+
+source_code_t
+source_read(char *filepath, arena_t *arena)
+{
+    assert(filepath);
+
+    source_code_t src = { .filepath = filepath };
+
+    if (strcmp(filepath, SOURCE_STDIN_FILEPATH) == 0) {
+        source_read_stream(STDIN_FILENO, filepath, arena, &src.code);
+        source_check_size(filepath, src.code.size);
+        return src;
+    }
+
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr,
+                "error: could not open file %s: %s\n",
+                filepath,
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        fprintf(stderr,
+                "error: could not stat file %s: %s\n",
+                filepath,
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    // Checked before mapping, the size of anything else is only known once
+    // read.
+    if (S_ISREG(st.st_mode)) {
+        source_check_size(filepath, (size_t)st.st_size);
+    }
+
+    if (!S_ISREG(st.st_mode) || !source_map(fd, st.st_size, &src.code)) {
+        source_read_stream(fd, filepath, arena, &src.code);
+        source_check_size(filepath, src.code.size);
+    }
+
+    close(fd);
+
+    return src;
+}
+
+uint32_t
+source_register(source_code_t src)
+{
+    source_check_size(src.filepath, src.code.size);
+
+    if (source_files_size == source_files_capacity) {
+        size_t capacity = source_files_capacity == 0
+                              ? SOURCE_FILES_INITIAL_CAPACITY
+                              : source_files_capacity * 2;
+
+        source_file_t *files =
+            realloc(source_files, capacity * sizeof(source_file_t));
+        if (files == NULL) {
+            fprintf(stderr,
+                    "[FATAL] Out of memory: source_register: %s\n",
+                    strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+
+        source_files = files;
+        source_files_capacity = capacity;
+    }
+
+    assert(source_files_size < UINT32_MAX);
+
+    source_files[source_files_size] = (source_file_t){ .src = src };
+
+    return (uint32_t)source_files_size++;
+}
+
+source_code_t
+source_get(uint32_t file_id)
+{
+    return source_file_get(file_id)->src;
+}
+
+size_t
+source_line_index(uint32_t file_id, uint32_t offset)
+{
+    source_file_t *file = source_file_get(file_id);
+
+    if (file->line_starts == NULL) {
+        source_file_build_line_starts(file);
+    }
+
+    // Last line starting at or before the offset.
+    size_t low = 0;
+    size_t high = file->lines_size;
+
+    while (high - low > 1) {
+        size_t mid = low + (high - low) / 2;
+
+        if (file->line_starts[mid] <= offset) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+uint32_t
+source_line_start(uint32_t file_id, size_t line_index)
+{
+    source_file_t *file = source_file_get(file_id);
+
+    if (file->line_starts == NULL) {
+        source_file_build_line_starts(file);
+    }
+
+    assert(line_index < file->lines_size);
+
+    return file->line_starts[line_index];
+}
+
+static bool
+source_map(int fd, size_t size, string_view_t *code)
+{
+    // Empty files can't be mapped, there is nothing to read anyway.
+    if (size == 0) {
+        *code = (string_view_t){ .chars = "", .size = 0 };
+        return true;
+    }
+
+    void *chars = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (chars == MAP_FAILED) {
+        return false;
+    }
+
+    // Pages are faulted in as the lexer reaches them, so lexing starts right
+    // away instead of waiting for the whole file (as MAP_POPULATE would).
+    // Reading ahead sequentially keeps the lexer from stalling on page faults.
+    madvise(chars, size, MADV_SEQUENTIAL);
+
+    *code = (string_view_t){ .chars = chars, .size = size };
+    return true;
+}
+
+static void
+source_read_stream(int fd, char *filepath, arena_t *arena, string_view_t *code)
+{
+    size_t capacity = 0;
+    size_t size = 0;
+    char *chars = NULL;
+
+    while (true) {
+        if (size == capacity) {
+            // The arena can't resize in place, the previous buffer is only
+            // given back with the arena.
+            capacity = capacity == 0 ? SOURCE_READ_CHUNK_BYTES : capacity * 2;
+            char *new_chars = arena_alloc(arena, capacity);
+            if (new_chars == NULL) {
+                fprintf(stderr,
+                        "[FATAL] Out of memory: source_read_stream: %s\n",
+                        strerror(errno));
+                exit(EXIT_FAILURE);
+            }
+            if (size > 0) {
+                memcpy(new_chars, chars, size);
+            }
+            chars = new_chars;
+        }
+
+        ssize_t read_bytes = read(fd, chars + size, capacity - size);
+
+        if (read_bytes == 0) {
+            break;
+        }
+
+        if (read_bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr,
+                    "error: could not read file %s: %s\n",
+                    filepath,
+                    strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+
+        size += (size_t)read_bytes;
+    }
+
+    *code = (string_view_t){ .chars = chars, .size = size };
+}
+
+static source_file_t *
+source_file_get(uint32_t file_id)
+{
+    assert(file_id < source_files_size && "unknown file id");
+    return &source_files[file_id];
+}
+
+static void
+source_file_build_line_starts(source_file_t *file)
+{
+    string_view_t code = file->src.code;
+
+    size_t lines_size = 1;
+    for (size_t i = 0; i < code.size; ++i) {
+        lines_size += code.chars[i] == '\n';
+    }
+
+    uint32_t *line_starts = malloc(lines_size * sizeof(uint32_t));
+    if (line_starts == NULL) {
+        fprintf(stderr,
+                "[FATAL] Out of memory: source_file_build_line_starts: %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    size_t line = 0;
+    line_starts[line++] = 0;
+    for (size_t i = 0; i < code.size; ++i) {
+        if (code.chars[i] == '\n') {
+            line_starts[line++] = (uint32_t)(i + 1);
+        }
+    }
+
+    file->line_starts = line_starts;
+    file->lines_size = lines_size;
+}
+
+static void
+source_check_size(char *filepath, size_t size)
+{
+    if (size <= SOURCE_MAX_SIZE) {
+        return;
+    }
+
+    fprintf(stderr,
+            "[FATAL] Source too big: %s: %zu bytes, the limit is 4 GiB - 1 "
+            "(%zu bytes)\n",
+            filepath,
+            size,
+            SOURCE_MAX_SIZE);
+    exit(EXIT_FAILURE);
+}
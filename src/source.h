@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include "arena.h"
+#include "string_view.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Largest source code accepted, in bytes.  Locations store 32-bit byte
+ * offsets, so every offset into a source, the end included, fits in them.
+ */
+#define SOURCE_MAX_SIZE ((size_t)UINT32_MAX)
+
+typedef struct source_code
+{
+    char *filepath;
+    string_view_t code;
+} source_code_t;
+
+/**
+ * Reads the source code at filepath, "-" reads from the standard input.
+ *
+ * Regular files are mapped read-only into memory and never copied, the
+ * mapping lives until the end of the process.  Pipes, terminals and anything
+ * that can't be mapped are read in chunks into the arena.  Sources larger
+ * than SOURCE_MAX_SIZE are a fatal error.
+ */
+source_code_t
+source_read(char *filepath, arena_t *arena);
+
+/**
+ * Registers a source code and returns its file id.  Source locations only
+ * store the file id and a byte offset, everything else (file path, line and
+ * column) is recovered from the registry when a diagnostic is reported.
+ * Sources larger than SOURCE_MAX_SIZE are a fatal error.
+ */
+uint32_t
+source_register(source_code_t src);
+
+source_code_t
+source_get(uint32_t file_id);
+
+/**
+ * Returns the 0-based line of the byte offset.  The line table of the file is
+ * built on the first call, later calls are a binary search.
+ */
+size_t
+source_line_index(uint32_t file_id, uint32_t offset);
+
+/**
+ * Returns the byte offset where the 0-based line starts.
+ */
+uint32_t
+source_line_start(uint32_t file_id, size_t line_index);
+
+#endif /* SOURCE_H */
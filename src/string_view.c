@@ -16,6 +16,7 @@
  */
 #include "string_view.h"
 
+#include <ctype.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -48,8 +49,9 @@ string_view_eq_to_cstr(string_view_t str, char *cstr)
 uint32_t
 string_view_to_u32(string_view_t str)
 {
-    char ret[str.size + 1];
-    ret[str.size] = 0;
-    memcpy(ret, str.chars, str.size);
-    return atoi(ret);
+    uint32_t ret = 0;
+    for (size_t i = 0; i < str.size && isdigit(str.chars[i]); ++i) {
+        ret = ret * 10 + (uint32_t)(str.chars[i] - '0');
+    }
+    return ret;
 }
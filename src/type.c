@@ -14,8 +14,19 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
-#include "type.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "assert.h"
+#include "type.h"
+
+static type_t *
+type_table_new_type(type_table_t *table,
+                    type_kind_t kind,
+                    string_view_t id,
+                    uint32_t size);
 
 type_t *
 type_new_unknown(arena_t *arena, string_view_t id)
@@ -25,6 +36,7 @@ type_new_unknown(arena_t *arena, string_view_t id)
 
     type->kind = TYPE_UNKNOWN;
     type->id = id;
+    type->ptr = NULL;
     return type;
 }
 
@@ -36,6 +48,129 @@ type_new_ptr(arena_t *arena, string_view_t id, type_t *ref_type)
 
     type->kind = TYPE_PTR;
     type->id = id;
+    type->ptr = NULL;
     type->as_ptr.type = ref_type;
     return type;
 }
+
+void
+type_table_init(type_table_t *table, arena_t *arena)
+{
+    assert(table);
+    assert(arena);
+
+    static const struct
+    {
+        char *id;
+        uint32_t size;
+    } primitives[] = {
+        [TYPE_U8] = { "u8", 1 },
+        [TYPE_U16] = { "u16", 2 },
+        [TYPE_U32] = { "u32", 4 },
+        [TYPE_U64] = { "u64", 8 },
+    };
+
+    table->arena = arena;
+    table->named = map_new(arena);
+
+    for (size_t i = 0; i <= TYPE_U64; ++i) {
+        type_t *type =
+            type_table_new_type(table,
+                                TYPE_PRIMITIVE,
+                                string_view_from_cstr(primitives[i].id),
+                                primitives[i].size);
+        type->as_primitive.kind = (type_primitive_kind_t)i;
+
+        table->primitives[i] = type;
+        map_put(table->named, type->id, type);
+    }
+}
+
+type_t *
+type_table_lookup(type_table_t *table, string_view_t id)
+{
+    assert(table);
+    return (type_t *)map_get(table->named, id);
+}
+
+/**
+ * Pointer types are hash-consed on their pointee: each canonical type owns the
+ * single canonical pointer to it.
+ */
+type_t *
+type_table_ptr(type_table_t *table, type_t *type)
+{
+    assert(table);
+    assert(type && type->kind != TYPE_UNKNOWN);
+
+    if (type->ptr != NULL) {
+        return type->ptr;
+    }
+
+    char *id = (char *)arena_alloc(table->arena, type->id.size + 1);
+    if (id == NULL) {
+        fprintf(stderr,
+                "[FATAL] Out of memory: type_table_ptr: %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    memcpy(id, type->id.chars, type->id.size);
+    id[type->id.size] = '*';
+
+    string_view_t ptr_id = { .chars = id, .size = type->id.size + 1 };
+
+    type_t *ptr = type_table_new_type(table, TYPE_PTR, ptr_id, 8);
+    ptr->as_ptr.type = type;
+
+    type->ptr = ptr;
+    return ptr;
+}
+
+/**
+ * Maps a type as spelled by the parser to its canonical type, NULL when it
+ * names an unknown type.
+ */
+type_t *
+type_table_resolve(type_table_t *table, type_t *type)
+{
+    assert(table);
+    assert(type);
+
+    switch (type->kind) {
+        case TYPE_UNKNOWN:
+            return type_table_lookup(table, type->id);
+        case TYPE_PTR: {
+            type_t *ref_type = type_table_resolve(table, type->as_ptr.type);
+            if (ref_type == NULL) {
+                return NULL;
+            }
+            return type_table_ptr(table, ref_type);
+        }
+        case TYPE_PRIMITIVE:
+            return type;
+    }
+
+    assert(0 && "unreachable");
+}
+
+static type_t *
+type_table_new_type(type_table_t *table,
+                    type_kind_t kind,
+                    string_view_t id,
+                    uint32_t size)
+{
+    type_t *type = (type_t *)arena_alloc(table->arena, sizeof(type_t));
+    if (type == NULL) {
+        fprintf(stderr,
+                "[FATAL] Out of memory: type_table_new_type: %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    type->kind = kind;
+    type->id = id;
+    type->size = size;
+    type->alignment = size;
+    type->ptr = NULL;
+    return type;
+}
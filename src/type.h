@@ -17,9 +17,12 @@
 #ifndef TYPE_H
 #define TYPE_H
 #include "arena.h"
+#include "map.h"
 #include "string_view.h"
 
-typedef union type type_t;
+#include <stdint.h>
+
+typedef struct type type_t;
 
 typedef enum
 {
@@ -38,40 +41,58 @@ typedef enum
 
 typedef struct type_primitive
 {
-    type_kind_t _type_kind;
-    string_view_t id;
     type_primitive_kind_t kind;
-    short size;
 } type_primitive_t;
 
-typedef struct type_unknown
-{
-    type_kind_t _type_kind;
-    string_view_t id;
-} type_unknown_t;
-
 typedef struct type_ptr
 {
-    type_kind_t _type_kind;
-    string_view_t id;
     type_t *type;
 } type_ptr_t;
 
-typedef union type
+/**
+ * Types built by the parser are TYPE_UNKNOWN placeholders carrying only the
+ * spelled id.  The checker replaces them with the canonical types interned in
+ * a type_table_t, so two canonical types are equal iff their pointers are.
+ */
+typedef struct type
 {
-    struct
+    type_kind_t kind;
+    string_view_t id;
+    // Computed once when the type is interned.
+    uint32_t size;
+    uint32_t alignment;
+    // Canonical pointer to this type, created on first request.
+    type_t *ptr;
+    union
     {
-        type_kind_t kind;
-        string_view_t id;
+        type_primitive_t as_primitive;
+        type_ptr_t as_ptr;
     };
-    type_unknown_t as_unknown;
-    type_primitive_t as_primitive;
-    type_ptr_t as_ptr;
 } type_t;
 
+typedef struct type_table
+{
+    arena_t *arena;
+    type_t *primitives[TYPE_U64 + 1];
+    // Named types by id, only the primitives for now.
+    map_t *named;
+} type_table_t;
+
 type_t *
 type_new_unknown(arena_t *arena, string_view_t id);
 
 type_t *
 type_new_ptr(arena_t *arena, string_view_t id, type_t *type);
+
+void
+type_table_init(type_table_t *table, arena_t *arena);
+
+type_t *
+type_table_lookup(type_table_t *table, string_view_t id);
+
+type_t *
+type_table_ptr(type_table_t *table, type_t *type);
+
+type_t *
+type_table_resolve(type_table_t *table, type_t *type);
 #endif
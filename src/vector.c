@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "vector.h"
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+static void
+vector_grow(vector_t *vector);
+
+void
+vector_init(vector_t *vector, arena_t *arena)
+{
+    assert(vector != NULL);
+    vector->size = 0;
+    vector->capacity = 0;
+    vector->arena = arena;
+    vector->items = NULL;
+}
+
+vector_t *
+vector_new(arena_t *arena)
+{
+    vector_t *vector = (vector_t *)arena_alloc(arena, sizeof(vector_t));
+    if (vector == NULL) {
+        fprintf(
+            stderr, "[FATAL] Out of memory: vector_new: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    vector_init(vector, arena);
+    return vector;
+}
+
+void
+vector_push(vector_t *vector, void *item)
+{
+    assert(vector != NULL);
+
+    if (vector->size == vector->capacity) {
+        vector_grow(vector);
+    }
+
+    vector->items[vector->size++] = item;
+}
+
+void *
+vector_get(vector_t *vector, size_t index)
+{
+    assert(vector != NULL);
+    assert(index < vector->size);
+    return vector->items[index];
+}
+
+size_t
+vector_size(vector_t *vector)
+{
+    assert(vector != NULL);
+    return vector->size;
+}
+
+void
+vector_truncate(vector_t *vector, size_t size)
+{
+    assert(vector != NULL);
+    assert(size <= vector->size);
+    vector->size = size;
+}
+
+void **
+vector_items(vector_t *vector)
+{
+    assert(vector != NULL);
+    return vector->items;
+}
+
+static void
+vector_grow(vector_t *vector)
+{
+    size_t capacity = vector->capacity == 0 ? VECTOR_INITIAL_CAPACITY
+                                            : vector->capacity * 2;
+
+    void **items =
+        (void **)arena_alloc(vector->arena, capacity * sizeof(void *));
+    if (items == NULL) {
+        fprintf(stderr,
+                "[FATAL] Out of memory: vector_grow: %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    if (vector->size > 0) {
+        memcpy(items, vector->items, vector->size * sizeof(void *));
+    }
+
+    vector->items = items;
+    vector->capacity = capacity;
+}
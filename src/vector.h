@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef VECTOR_H
+#define VECTOR_H
+#include "arena.h"
+#include <stddef.h>
+
+#define VECTOR_INITIAL_CAPACITY 4
+
+/**
+ * A growable array of pointers backed by an arena.  Items are stored
+ * contiguously so indexed access is O(1).  When the vector is full, a new
+ * array twice as big is allocated from the arena and the items are copied
+ * over; the old array is only reclaimed with the arena.
+ */
+typedef struct vector
+{
+    size_t size;
+    size_t capacity;
+    arena_t *arena;
+    void **items;
+} vector_t;
+
+void
+vector_init(vector_t *vector, arena_t *arena);
+
+vector_t *
+vector_new(arena_t *arena);
+
+void
+vector_push(vector_t *vector, void *item);
+
+void *
+vector_get(vector_t *vector, size_t index);
+
+size_t
+vector_size(vector_t *vector);
+
+/**
+ * Drops the items past size, the storage is kept for the next pushes.
+ */
+void
+vector_truncate(vector_t *vector, size_t size);
+
+/**
+ * Returns the contiguous storage of the vector, it is invalidated by the next
+ * vector_push.  Use it to iterate over the items:
+ *
+ *     void **items = vector_items(vector);
+ *     for (size_t i = 0; i < vector_size(vector); ++i) { ... items[i] ... }
+ */
+void **
+vector_items(vector_t *vector);
+#endif
@@ -202,6 +202,16 @@ test_ast() {
   diff_output "$actual_output_file" "$TEST_CONTENTS_PATH"
 }
 
+test_ir() {
+  assert_contents_path
+
+  actual_output_file="$TEST_TMP_FILES.$TEST_LINE_NUMBER.ir_output"
+
+  $OLANG_PATH "$TEST_FILE" --dump-ir > "$actual_output_file" 2>&1
+
+  diff_output "$actual_output_file" "$TEST_CONTENTS_PATH"
+}
+
 test_contains_tokens() {
   assert_contents_path
 
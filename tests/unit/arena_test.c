@@ -17,6 +17,7 @@
 #define MUNIT_ENABLE_ASSERT_ALIASES
 #include "arena.h"
 #include "munit.h"
+#include <string.h>
 
 static MunitResult
 arena_alloc_test(const MunitParameter params[], void *user_data_or_fixture)
@@ -42,7 +43,14 @@ arena_alloc_test(const MunitParameter params[], void *user_data_or_fixture)
     munit_assert_int(*b, ==, 2);
 
     munit_assert_ptr_not_null(arena_alloc(&arena, sizeof(int)));
-    munit_assert_ptr_null(arena_alloc(&arena, 1));
+
+    // The first block is exhausted, the arena must grow instead of failing.
+    uint8_t *d = arena_alloc(&arena, 1);
+    munit_assert_ptr_not_null(d);
+    *d = 4;
+
+    munit_assert_int(*a, ==, 3);
+    munit_assert_int(*d, ==, 4);
 
     arena_free(&arena);
 
@@ -84,6 +92,132 @@ arena_padding_test(const MunitParameter params[], void *user_data_or_fixture)
     return MUNIT_OK;
 }
 
+static MunitResult
+arena_grow_test(const MunitParameter params[], void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(ARENA_ALIGNMENT_BYTES);
+
+    uint8_t *small = arena_alloc(&arena, ARENA_ALIGNMENT_BYTES);
+    memset(small, 1, ARENA_ALIGNMENT_BYTES);
+
+    // Larger than any block allocated so far.
+    size_t big_size = ARENA_HUGE_PAGE_BYTES + 1;
+    uint8_t *big = arena_alloc(&arena, big_size);
+    munit_assert_ptr_not_null(big);
+    memset(big, 2, big_size);
+
+    munit_assert_int(((uintptr_t)big) % ARENA_ALIGNMENT_BYTES, ==, 0);
+    munit_assert_int(small[0], ==, 1);
+    munit_assert_int(big[big_size - 1], ==, 2);
+
+    for (size_t i = 0; i < 1024; ++i) {
+        uint64_t *n = arena_alloc(&arena, sizeof(uint64_t));
+        munit_assert_ptr_not_null(n);
+        *n = i;
+    }
+
+    arena_release(&arena);
+
+    // Released blocks are reused instead of allocating new ones.
+    munit_assert_ptr_equal(arena_alloc(&arena, 1), small);
+    munit_assert_ptr_equal(arena_alloc(&arena, big_size), big);
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+arena_rewind_test(const MunitParameter params[], void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(ARENA_ALIGNMENT_BYTES * 4);
+
+    uint8_t *a = arena_alloc(&arena, sizeof(uint8_t));
+    *a = 1;
+
+    arena_temp_t outer = arena_temp_begin(&arena);
+    uint8_t *b = arena_alloc(&arena, sizeof(uint8_t));
+
+    arena_temp_t inner = arena_temp_begin(&arena);
+    uint8_t *c = arena_alloc(&arena, sizeof(uint8_t));
+
+    // Forces the arena into a new block while the temporaries are alive.
+    uint8_t *d = arena_alloc(&arena, ARENA_ALIGNMENT_BYTES * 8);
+    munit_assert_ptr_not_null(d);
+
+    arena_temp_end(inner);
+    munit_assert_ptr_equal(arena_alloc(&arena, sizeof(uint8_t)), c);
+
+    arena_temp_end(outer);
+    munit_assert_ptr_equal(arena_alloc(&arena, sizeof(uint8_t)), b);
+
+    arena_mark_t mark = arena_mark(&arena);
+    uint8_t *e = arena_alloc(&arena, ARENA_ALIGNMENT_BYTES * 8);
+    arena_rewind(&arena, mark);
+
+    munit_assert_ptr_equal(arena_alloc(&arena, ARENA_ALIGNMENT_BYTES * 8), e);
+    munit_assert_int(*a, ==, 1);
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+arena_alloc_aligned_test(const MunitParameter params[],
+                         void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(512);
+
+    // Small aligned allocations are packed back to back.
+    uint8_t *a = arena_alloc_aligned(&arena, 20, 8);
+    uint8_t *b = arena_alloc_aligned(&arena, 8, 8);
+    uint8_t *c = arena_alloc_aligned(&arena, 1, 1);
+    uint8_t *d = arena_alloc_aligned(&arena, 4, 4);
+
+    munit_assert_int(b - a, ==, 24);
+    munit_assert_int(c - b, ==, 8);
+    munit_assert_int(d - c, ==, 4);
+
+    // Default allocations keep their alignment after packed ones.
+    uint8_t *e = arena_alloc(&arena, sizeof(uint8_t));
+    munit_assert_int((uintptr_t)e % ARENA_ALIGNMENT_BYTES, ==, 0);
+    munit_assert_int(e - d, ==, ARENA_ALIGNMENT_BYTES - 4);
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+arena_merge_test(const MunitParameter params[], void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(ARENA_ALIGNMENT_BYTES * 4);
+    arena_t other = arena_new(ARENA_ALIGNMENT_BYTES * 4);
+
+    uint8_t *a = arena_alloc(&arena, sizeof(uint8_t));
+    uint8_t *b = arena_alloc(&other, sizeof(uint8_t));
+    *a = 1;
+    *b = 2;
+
+    arena_merge(&arena, &other);
+
+    munit_assert_ptr_null(other.head);
+
+    // Allocations after the merge never land on the merged blocks.
+    for (size_t i = 0; i < 64; ++i) {
+        uint8_t *n = arena_alloc(&arena, ARENA_ALIGNMENT_BYTES);
+        memset(n, 0xff, ARENA_ALIGNMENT_BYTES);
+    }
+
+    munit_assert_int(*a, ==, 1);
+    munit_assert_int(*b, ==, 2);
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
 static MunitTest tests[] = {
     { "/arena_alloc_test",
       arena_alloc_test,
@@ -97,6 +231,30 @@ static MunitTest tests[] = {
       NULL,
       MUNIT_TEST_OPTION_NONE,
       NULL },
+    { "/arena_alloc_aligned_test",
+      arena_alloc_aligned_test,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/arena_grow_test",
+      arena_grow_test,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/arena_merge_test",
+      arena_merge_test,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/arena_rewind_test",
+      arena_rewind_test,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
 };
 
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include <stdio.h>
+#include <string.h>
+
+#include "arena.h"
+#include "ast.h"
+#include "ast_visitor.h"
+#include "munit.h"
+
+#define AST_VISITOR_TEST_ARENA_CAPACITY (1024 * 64)
+#define AST_VISITOR_TEST_DEPTH 100000
+
+typedef struct trace_visitor
+{
+    ast_visitor_t visitor;
+    char trace[64];
+    size_t trace_size;
+    size_t max_depth;
+} trace_visitor_t;
+
+static void
+trace_push(trace_visitor_t *tracer, char c)
+{
+    if (tracer->trace_size + 1 < sizeof(tracer->trace)) {
+        tracer->trace[tracer->trace_size++] = c;
+        tracer->trace[tracer->trace_size] = 0;
+    }
+}
+
+static char
+trace_node_name(ast_node_t *node)
+{
+    switch (node->kind) {
+        case AST_NODE_BINARY_OP:
+            return '+';
+        case AST_NODE_LITERAL:
+            return (char)('0' + node->as_literal.as_u32);
+        default:
+            return '?';
+    }
+}
+
+static bool
+trace_pre(ast_visitor_t *visitor, ast_visit_frame_t *frame)
+{
+    trace_visitor_t *tracer = (trace_visitor_t *)visitor;
+    trace_push(tracer, '(');
+    trace_push(tracer, trace_node_name(frame->node));
+
+    if (visitor->frames_size > tracer->max_depth) {
+        tracer->max_depth = visitor->frames_size;
+    }
+    return true;
+}
+
+static bool
+trace_enter_child(ast_visitor_t *visitor, ast_visit_frame_t *frame)
+{
+    (void)visitor;
+    // Skips every literal 3.
+    ast_node_t *child = ast_node_child(frame->node, frame->child);
+    return child->kind != AST_NODE_LITERAL || child->as_literal.as_u32 != 3;
+}
+
+static void
+trace_leave_child(ast_visitor_t *visitor, ast_visit_frame_t *frame)
+{
+    (void)frame;
+    trace_push((trace_visitor_t *)visitor, ',');
+}
+
+static void
+trace_post(ast_visitor_t *visitor, ast_visit_frame_t *frame)
+{
+    (void)frame;
+    trace_push((trace_visitor_t *)visitor, ')');
+}
+
+static MunitResult
+test_ast_visitor_order(const MunitParameter params[],
+                       void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(AST_VISITOR_TEST_ARENA_CAPACITY);
+    token_loc_t loc = { 0 };
+
+    // (1 + 2) + 3
+    ast_node_t *sum = ast_new_node_bin_op(
+        &arena,
+        loc,
+        AST_BINOP_ADDITION,
+        ast_new_node_bin_op(&arena,
+                            loc,
+                            AST_BINOP_ADDITION,
+                            ast_new_node_literal_u32(&arena, loc, 1),
+                            ast_new_node_literal_u32(&arena, loc, 2)),
+        ast_new_node_literal_u32(&arena, loc, 3));
+
+    trace_visitor_t tracer = { 0 };
+    ast_visitor_init(&tracer.visitor);
+    tracer.visitor.pre = trace_pre;
+    tracer.visitor.enter_child = trace_enter_child;
+    tracer.visitor.leave_child = trace_leave_child;
+    tracer.visitor.post = trace_post;
+
+    ast_visitor_walk(&tracer.visitor, sum);
+
+    assert_string_equal(tracer.trace, "(+(+(1),(2),),)");
+    assert_size(tracer.visitor.frames_size, ==, 0);
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_ast_visitor_deep_tree(const MunitParameter params[],
+                           void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(AST_VISITOR_TEST_ARENA_CAPACITY);
+    token_loc_t loc = { 0 };
+
+    // Far deeper than a recursive walk would survive.
+    ast_node_t *expr = ast_new_node_literal_u32(&arena, loc, 1);
+    for (size_t i = 0; i < AST_VISITOR_TEST_DEPTH; ++i) {
+        expr = ast_new_node_unary_op(&arena, loc, AST_UNARY_BITWISE_NOT, expr);
+    }
+
+    trace_visitor_t tracer = { 0 };
+    ast_visitor_init(&tracer.visitor);
+    tracer.visitor.pre = trace_pre;
+
+    ast_visitor_walk(&tracer.visitor, expr);
+
+    assert_size(tracer.max_depth, ==, AST_VISITOR_TEST_DEPTH + 1);
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+    { "/test_ast_visitor_order",
+      test_ast_visitor_order,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_ast_visitor_deep_tree",
+      test_ast_visitor_deep_tree,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite suite = { "/ast_visitor",
+                                  tests,
+                                  NULL,
+                                  1,
+                                  MUNIT_SUITE_OPTION_NONE };
+
+int
+main(int argc, char *argv[])
+{
+    return munit_suite_main(&suite, NULL, argc, argv);
+    return EXIT_SUCCESS;
+}
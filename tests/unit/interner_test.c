@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "arena.h"
+#include "interner.h"
+#include "munit.h"
+
+#define INTERNER_TEST_ARENA_CAPACITY (1024 * 16)
+
+static MunitResult
+test_interner_intern(const MunitParameter params[], void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(INTERNER_TEST_ARENA_CAPACITY);
+    interner_t interner;
+    interner_init(&interner, &arena);
+
+    // Same spelling at different addresses must yield the same atom.
+    char *text = "countcount";
+    string_view_t first = { .chars = text, .size = 5 };
+    string_view_t second = { .chars = text + 5, .size = 5 };
+    string_view_t prefix = { .chars = text, .size = 4 };
+
+    atom_t *a1 = interner_intern(&interner, first);
+    atom_t *a2 = interner_intern(&interner, second);
+    atom_t *a3 = interner_intern(&interner, prefix);
+
+    assert_not_null(a1);
+    assert_ptr_equal(a1, a2);
+    assert_ptr_not_equal(a1, a3);
+
+    assert_true(string_view_eq_to_cstr(a1->str, "count"));
+    assert_true(string_view_eq_to_cstr(a3->str, "coun"));
+    assert_int(a1->hash, ==, map_hash(first));
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+    { "/test_interner_intern",
+      test_interner_intern,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite suite = { "/interner",
+                                  tests,
+                                  NULL,
+                                  1,
+                                  MUNIT_SUITE_OPTION_NONE };
+
+int
+main(int argc, char *argv[])
+{
+    return munit_suite_main(&suite, NULL, argc, argv);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,348 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "ir_analysis.h"
+#include "ir_test_util.h"
+#include "munit.h"
+
+// Lowered to:
+//
+//   bb0 -> bb1
+//   bb1 -> bb2, bb8    outer loop header, %3 is i and %4 is s
+//   bb2 -> bb3
+//   bb3 -> bb4, bb5    inner loop header
+//   bb4 -> bb3
+//   bb5 -> bb6, bb7
+//   bb6                return s
+//   bb7 -> bb1
+//   bb8                return s
+static char nested_loops[] = "fn main(): u32 {\n"
+                             "  var i: u32 = 0\n"
+                             "  var s: u32 = 0\n"
+                             "  while i < 10 {\n"
+                             "    var j: u32 = 0\n"
+                             "    while j < i {\n"
+                             "      s = s + j\n"
+                             "      j = j + 1\n"
+                             "    }\n"
+                             "    if s > 100 {\n"
+                             "      return s\n"
+                             "    }\n"
+                             "    i = i + 1\n"
+                             "  }\n"
+                             "  return s\n"
+                             "}\n";
+
+static ir_block_t *
+block_at(ir_function_t *fn, uint32_t id)
+{
+    for (ir_block_t *block = fn->first; block != NULL; block = block->next) {
+        if (block->id == id) {
+            return block;
+        }
+    }
+    return NULL;
+}
+
+static ir_instr_t *
+value_at(ir_function_t *fn, uint32_t id)
+{
+    for (ir_block_t *block = fn->first; block != NULL; block = block->next) {
+        for (ir_instr_t *instr = block->first; instr != NULL;
+             instr = instr->next) {
+            if (instr->id == id) {
+                return instr;
+            }
+        }
+    }
+    return NULL;
+}
+
+static bool
+frontier_has(const ir_dom_tree_t *dom_tree,
+             ir_block_t *block,
+             ir_block_t *member)
+{
+    const ir_dom_node_t *node = &dom_tree->nodes[block->id];
+    for (uint32_t i = 0; i < node->frontier_size; ++i) {
+        if (node->frontier[i] == member) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static MunitResult
+test_ir_analysis_dom_tree(const MunitParameter params[],
+                          void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    ir_function_t *fn = ir_test_build_fn(&arena, nested_loops);
+    assert_uint(fn->blocks_size, ==, 9);
+
+    ir_block_t *bb[9];
+    for (uint32_t i = 0; i < 9; ++i) {
+        bb[i] = block_at(fn, i);
+        assert_not_null(bb[i]);
+    }
+
+    ir_analysis_t analysis;
+    ir_analysis_init(&analysis, fn);
+
+    const ir_cfg_t *cfg = ir_analysis_cfg(&analysis);
+    assert_uint(cfg->rpo_size, ==, 9);
+    assert_ptr_equal(cfg->rpo[0], bb[0]);
+    for (uint32_t i = 0; i < 9; ++i) {
+        assert_true(ir_cfg_reachable(cfg, bb[i]));
+    }
+    // Outside back edges every block comes before its successors.
+    assert_uint(cfg->rpo_index[bb[3]->id], <, cfg->rpo_index[bb[4]->id]);
+    assert_uint(cfg->rpo_index[bb[5]->id], <, cfg->rpo_index[bb[7]->id]);
+
+    const ir_dom_tree_t *dom_tree = ir_analysis_dom_tree(&analysis);
+    uint32_t idoms[9] = { 0, 0, 1, 2, 3, 3, 5, 5, 1 };
+    assert_null(dom_tree->nodes[0].idom);
+    for (uint32_t i = 1; i < 9; ++i) {
+        assert_ptr_equal(dom_tree->nodes[i].idom, bb[idoms[i]]);
+    }
+    assert_uint(dom_tree->nodes[3].children_size, ==, 2);
+    assert_uint(dom_tree->nodes[1].children_size, ==, 2);
+
+    assert_true(ir_dom_tree_dominates(dom_tree, bb[1], bb[7]));
+    assert_true(ir_dom_tree_dominates(dom_tree, bb[3], bb[3]));
+    assert_false(ir_dom_tree_dominates(dom_tree, bb[4], bb[5]));
+    assert_false(ir_dom_tree_dominates(dom_tree, bb[6], bb[7]));
+
+    assert_uint(dom_tree->nodes[4].frontier_size, ==, 1);
+    assert_true(frontier_has(dom_tree, bb[4], bb[3]));
+    assert_uint(dom_tree->nodes[3].frontier_size, ==, 2);
+    assert_true(frontier_has(dom_tree, bb[3], bb[3]));
+    assert_true(frontier_has(dom_tree, bb[3], bb[1]));
+    assert_true(frontier_has(dom_tree, bb[7], bb[1]));
+    assert_uint(dom_tree->nodes[6].frontier_size, ==, 0);
+    assert_uint(dom_tree->nodes[8].frontier_size, ==, 0);
+
+    ir_analysis_free(&analysis);
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_ir_analysis_loops(const MunitParameter params[],
+                       void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    ir_function_t *fn = ir_test_build_fn(&arena, nested_loops);
+
+    ir_analysis_t analysis;
+    ir_analysis_init(&analysis, fn);
+
+    const ir_loop_forest_t *loops = ir_analysis_loops(&analysis);
+    assert_uint(loops->loops_size, ==, 2);
+
+    ir_loop_t *inner = &loops->loops[0];
+    ir_loop_t *outer = &loops->loops[1];
+
+    assert_ptr_equal(inner->header, block_at(fn, 3));
+    assert_ptr_equal(inner->parent, outer);
+    assert_uint(inner->depth, ==, 2);
+    assert_uint(inner->latches_size, ==, 1);
+    assert_ptr_equal(inner->latches[0], block_at(fn, 4));
+    assert_uint(inner->blocks_size, ==, 2);
+    assert_ptr_equal(inner->blocks[0], inner->header);
+
+    assert_ptr_equal(outer->header, block_at(fn, 1));
+    assert_null(outer->parent);
+    assert_uint(outer->depth, ==, 1);
+    assert_uint(outer->latches_size, ==, 1);
+    assert_ptr_equal(outer->latches[0], block_at(fn, 7));
+    assert_uint(outer->blocks_size, ==, 6);
+    assert_ptr_equal(outer->blocks[0], outer->header);
+
+    uint32_t depths[9] = { 0, 1, 1, 2, 2, 1, 0, 1, 0 };
+    for (uint32_t i = 0; i < 9; ++i) {
+        assert_uint(ir_loop_depth(loops, block_at(fn, i)), ==, depths[i]);
+    }
+    assert_true(ir_loop_contains(loops, outer, block_at(fn, 4)));
+    assert_false(ir_loop_contains(loops, inner, block_at(fn, 5)));
+    assert_false(ir_loop_contains(loops, outer, block_at(fn, 6)));
+
+    ir_analysis_free(&analysis);
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_ir_analysis_liveness(const MunitParameter params[],
+                          void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    ir_function_t *fn = ir_test_build_fn(&arena, nested_loops);
+
+    ir_analysis_t analysis;
+    ir_analysis_init(&analysis, fn);
+
+    const ir_liveness_t *liveness = ir_analysis_liveness(&analysis);
+
+    ir_instr_t *i = value_at(fn, 3);
+    ir_instr_t *s = value_at(fn, 4);
+    ir_instr_t *inner_s = value_at(fn, 11);
+    ir_instr_t *next_s = value_at(fn, 14);
+    assert_int(i->op, ==, IR_PHI);
+    assert_int(s->op, ==, IR_PHI);
+    assert_int(inner_s->op, ==, IR_PHI);
+    assert_int(next_s->op, ==, IR_ADD);
+
+    // i is read by the inner loop and incremented after it.
+    assert_false(ir_liveness_live_in(liveness, block_at(fn, 1), i));
+    assert_true(ir_liveness_live_out(liveness, block_at(fn, 1), i));
+    assert_true(ir_liveness_live_in(liveness, block_at(fn, 3), i));
+    assert_true(ir_liveness_live_out(liveness, block_at(fn, 4), i));
+    assert_true(ir_liveness_live_in(liveness, block_at(fn, 7), i));
+    assert_false(ir_liveness_live_in(liveness, block_at(fn, 6), i));
+    assert_false(ir_liveness_live_in(liveness, block_at(fn, 8), i));
+
+    // s only flows into the inner phi and the final return.
+    assert_true(ir_liveness_live_out(liveness, block_at(fn, 2), s));
+    assert_false(ir_liveness_live_in(liveness, block_at(fn, 3), s));
+    assert_true(ir_liveness_live_in(liveness, block_at(fn, 8), s));
+
+    // Phi operands are live on exit of their predecessor only.
+    assert_true(ir_liveness_live_out(liveness, block_at(fn, 4), next_s));
+    assert_false(ir_liveness_live_in(liveness, block_at(fn, 3), next_s));
+    assert_true(ir_liveness_live_in(liveness, block_at(fn, 6), inner_s));
+    assert_false(ir_liveness_live_out(liveness, block_at(fn, 6), inner_s));
+
+    ir_analysis_free(&analysis);
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_ir_analysis_invalidate(const MunitParameter params[],
+                            void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    ir_function_t *fn = ir_test_build_fn(&arena, nested_loops);
+
+    ir_analysis_t analysis;
+    ir_analysis_init(&analysis, fn);
+
+    // Asking for the loops computes what they are built on.
+    const ir_loop_forest_t *loops = ir_analysis_loops(&analysis);
+    assert_uint(analysis.valid,
+                ==,
+                IR_ANALYSIS_CFG | IR_ANALYSIS_DOM_TREE | IR_ANALYSIS_LOOPS);
+    assert_ptr_equal(ir_analysis_loops(&analysis), loops);
+
+    ir_analysis_liveness(&analysis);
+    ir_analysis_invalidate(&analysis, IR_ANALYSIS_DOM_TREE);
+    assert_uint(analysis.valid, ==, IR_ANALYSIS_CFG | IR_ANALYSIS_LIVENESS);
+
+    ir_analysis_invalidate(&analysis, IR_ANALYSIS_CFG);
+    assert_uint(analysis.valid, ==, 0);
+
+    // Cutting the back edge of the outer loop leaves only the inner one.
+    ir_block_t *latch = block_at(fn, 7);
+    ir_instr_t *jmp = ir_block_terminator(latch);
+    ir_instr_remove(jmp);
+    ir_block_ret(latch, ir_instr_operand(latch->first->next, 0));
+
+    loops = ir_analysis_loops(&analysis);
+    assert_uint(loops->loops_size, ==, 1);
+    assert_ptr_equal(loops->loops[0].header, block_at(fn, 3));
+    assert_uint(loops->loops[0].depth, ==, 1);
+    assert_uint(ir_loop_depth(loops, block_at(fn, 7)), ==, 0);
+
+    ir_analysis_free(&analysis);
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_ir_verify_dominance(const MunitParameter params[],
+                         void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    ir_function_t *fn = ir_test_build_fn(&arena, nested_loops);
+
+    // The sum computed in the inner loop body does not reach the last
+    // return when the loop never runs.
+    ir_instr_t *ret = ir_block_terminator(block_at(fn, 8));
+    ir_instr_t *s = ir_instr_operand(ret, 0);
+    ir_instr_set_operand(ret, 0, value_at(fn, 14));
+    assert_false(ir_function_verify(fn));
+
+    ir_instr_set_operand(ret, 0, s);
+    assert_true(ir_function_verify(fn));
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+    { "/test_ir_analysis_dom_tree",
+      test_ir_analysis_dom_tree,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_ir_analysis_loops",
+      test_ir_analysis_loops,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_ir_analysis_liveness",
+      test_ir_analysis_liveness,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_ir_analysis_invalidate",
+      test_ir_analysis_invalidate,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_ir_verify_dominance",
+      test_ir_verify_dominance,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite suite = { "/ir_analysis",
+                                  tests,
+                                  NULL,
+                                  1,
+                                  MUNIT_SUITE_OPTION_NONE };
+
+int
+main(int argc, char *argv[])
+{
+    return munit_suite_main(&suite, NULL, argc, argv);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "ir_dce.h"
+#include "ir_test_util.h"
+#include "munit.h"
+
+static MunitResult
+test_ir_dce_unreachable_blocks(const MunitParameter params[],
+                               void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    char buffer[IR_TEST_DUMP_SIZE];
+
+    // Nothing jumps past the returns, the join of the if is left without
+    // predecessors.
+    assert_true(ir_test_run_pass(&arena,
+                                 ir_dce_run,
+                                 "fn main(): u32 {\n"
+                                 "  var a: u32 = 3\n"
+                                 "  if a > 1 {\n"
+                                 "    return 1\n"
+                                 "  } else {\n"
+                                 "    return 2\n"
+                                 "  }\n"
+                                 "  a = a + 1\n"
+                                 "  return a\n"
+                                 "}\n",
+                                 buffer));
+
+    assert_string_equal(buffer,
+                        "fn main(): u32 {\n"
+                        "bb0:\n"
+                        "  %0 = const u32 3\n"
+                        "  %1 = const u32 1\n"
+                        "  %2 = gt u32 %0, %1\n"
+                        "  br %2, bb1, bb2\n"
+                        "bb1:  ; preds: bb0\n"
+                        "  %4 = const u32 1\n"
+                        "  ret %4\n"
+                        "bb2:  ; preds: bb0\n"
+                        "  %6 = const u32 2\n"
+                        "  ret %6\n"
+                        "}\n");
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_ir_dce_dead_stores(const MunitParameter params[],
+                        void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    char buffer[IR_TEST_DUMP_SIZE];
+
+    // Nothing loads x after the second store, and y is never loaded.
+    assert_true(ir_test_run_pass(&arena,
+                                 ir_dce_run,
+                                 "fn main(): u32 {\n"
+                                 "  var x: u32 = 1\n"
+                                 "  var y: u32 = 2\n"
+                                 "  var p: u32* = &x\n"
+                                 "  var q: u32* = &y\n"
+                                 "  *p = 5\n"
+                                 "  *q = *p\n"
+                                 "  *p = 6\n"
+                                 "  return 0\n"
+                                 "}\n",
+                                 buffer));
+
+    assert_string_equal(buffer,
+                        "fn main(): u32 {\n"
+                        "bb0:\n"
+                        "  %0 = const u32 0\n"
+                        "  ret %0\n"
+                        "}\n");
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_ir_dce_dead_phi_cycle(const MunitParameter params[],
+                           void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    char buffer[IR_TEST_DUMP_SIZE];
+
+    // n is only needed by itself around the loop.
+    assert_true(ir_test_run_pass(&arena,
+                                 ir_dce_run,
+                                 "fn main(): u32 {\n"
+                                 "  var i: u32 = 0\n"
+                                 "  var n: u32 = 0\n"
+                                 "  while i < 10 {\n"
+                                 "    n = n + i * 2\n"
+                                 "    i = i + 1\n"
+                                 "  }\n"
+                                 "  return i\n"
+                                 "}\n",
+                                 buffer));
+
+    assert_string_equal(buffer,
+                        "fn main(): u32 {\n"
+                        "bb0:\n"
+                        "  %0 = const u32 0\n"
+                        "  jmp bb1\n"
+                        "bb1:  ; preds: bb0, bb2\n"
+                        "  %2 = phi u32 [%0, bb0], [%7, bb2]\n"
+                        "  %3 = const u32 10\n"
+                        "  %4 = lt u32 %2, %3\n"
+                        "  br %4, bb2, bb3\n"
+                        "bb2:  ; preds: bb1\n"
+                        "  %6 = const u32 1\n"
+                        "  %7 = add u32 %2, %6\n"
+                        "  jmp bb1\n"
+                        "bb3:  ; preds: bb1\n"
+                        "  ret %2\n"
+                        "}\n");
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_ir_dce_division_kept(const MunitParameter params[],
+                          void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    char buffer[IR_TEST_DUMP_SIZE];
+
+    // Only the division by a nonzero constant cannot trap.
+    assert_true(ir_test_run_pass(&arena,
+                                 ir_dce_run,
+                                 "fn f(a: u32, b: u32): u32 {\n"
+                                 "  a / b\n"
+                                 "  a / 2\n"
+                                 "  a + b\n"
+                                 "  return a\n"
+                                 "}\n",
+                                 buffer));
+
+    assert_string_equal(buffer,
+                        "fn f(u32, u32): u32 {\n"
+                        "bb0:\n"
+                        "  %0 = param u32 0\n"
+                        "  %1 = param u32 1\n"
+                        "  %2 = div u32 %0, %1\n"
+                        "  ret %0\n"
+                        "}\n");
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+    { "/test_ir_dce_unreachable_blocks",
+      test_ir_dce_unreachable_blocks,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_ir_dce_dead_stores",
+      test_ir_dce_dead_stores,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_ir_dce_dead_phi_cycle",
+      test_ir_dce_dead_phi_cycle,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_ir_dce_division_kept",
+      test_ir_dce_division_kept,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite suite = { "/ir_dce",
+                                  tests,
+                                  NULL,
+                                  1,
+                                  MUNIT_SUITE_OPTION_NONE };
+
+int
+main(int argc, char *argv[])
+{
+    return munit_suite_main(&suite, NULL, argc, argv);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "ir_gvn.h"
+#include "ir_test_util.h"
+#include "munit.h"
+
+static MunitResult
+test_ir_gvn_common_subexpressions(const MunitParameter params[],
+                                  void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    char buffer[IR_TEST_DUMP_SIZE];
+
+    // The operands of a commutative operator are ordered, and a > b is b < a.
+    assert_true(ir_test_run_pass(&arena,
+                                 ir_gvn_run,
+                                 "fn f(a: u32, b: u32): u32 {\n"
+                                 "  var x: u32 = (a * b) + (b * a)\n"
+                                 "  var y: u32 = a << 3\n"
+                                 "  if a > b {\n"
+                                 "    y = y + (a << 3) + (b < a)\n"
+                                 "  }\n"
+                                 "  return x + y\n"
+                                 "}\n",
+                                 buffer));
+
+    assert_string_equal(buffer,
+                        "fn f(u32, u32): u32 {\n"
+                        "bb0:\n"
+                        "  %0 = param u32 0\n"
+                        "  %1 = param u32 1\n"
+                        "  %2 = mul u32 %0, %1\n"
+                        "  %3 = add u32 %2, %2\n"
+                        "  %4 = const u32 3\n"
+                        "  %5 = shl u32 %0, %4\n"
+                        "  %6 = gt u32 %0, %1\n"
+                        "  br %6, bb1, bb2\n"
+                        "bb1:  ; preds: bb0\n"
+                        "  %8 = add u32 %5, %5\n"
+                        "  %9 = add u32 %8, %6\n"
+                        "  jmp bb2\n"
+                        "bb2:  ; preds: bb0, bb1\n"
+                        "  %11 = phi u32 [%5, bb0], [%9, bb1]\n"
+                        "  %12 = add u32 %3, %11\n"
+                        "  ret %12\n"
+                        "}\n");
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_ir_gvn_memory_effects(const MunitParameter params[],
+                           void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    char buffer[IR_TEST_DUMP_SIZE];
+
+    // x is only stored through its own address, so the call keeps it, while
+    // *q may have changed.
+    assert_true(ir_test_run_pass(&arena,
+                                 ir_gvn_run,
+                                 "fn g(p: u32*): u32 {\n"
+                                 "  return 0\n"
+                                 "}\n"
+                                 "fn f(a: u32, q: u32*): u32 {\n"
+                                 "  var x: u32 = a\n"
+                                 "  var p: u32* = &x\n"
+                                 "  *p = a + 1\n"
+                                 "  var s: u32 = *p + *q\n"
+                                 "  g(q)\n"
+                                 "  return s + *p + *q\n"
+                                 "}\n",
+                                 buffer));
+
+    assert_string_equal(buffer,
+                        "fn f(u32, u32*): u32 {\n"
+                        "  slot0: u32\n"
+                        "bb0:\n"
+                        "  %0 = param u32 0\n"
+                        "  %1 = param u32* 1\n"
+                        "  %2 = addr u32* slot0\n"
+                        "  store %2, %0\n"
+                        "  %4 = const u32 1\n"
+                        "  %5 = add u32 %0, %4\n"
+                        "  store %2, %5\n"
+                        "  %7 = load u32 %1\n"
+                        "  %8 = add u32 %5, %7\n"
+                        "  %9 = call u32 g(%1)\n"
+                        "  %10 = add u32 %8, %5\n"
+                        "  %11 = load u32 %1\n"
+                        "  %12 = add u32 %10, %11\n"
+                        "  ret %12\n"
+                        "}\n");
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_ir_gvn_memory_joins(const MunitParameter params[],
+                         void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    char buffer[IR_TEST_DUMP_SIZE];
+
+    // x may be stored on the way to the join, so it is loaded again.
+    assert_true(ir_test_run_pass(&arena,
+                                 ir_gvn_run,
+                                 "fn f(a: u32): u32 {\n"
+                                 "  var x: u32 = a\n"
+                                 "  var p: u32* = &x\n"
+                                 "  var s: u32 = *p\n"
+                                 "  if a > 3 {\n"
+                                 "    *p = 3\n"
+                                 "  }\n"
+                                 "  return s + *p\n"
+                                 "}\n",
+                                 buffer));
+
+    assert_string_equal(buffer,
+                        "fn f(u32): u32 {\n"
+                        "  slot0: u32\n"
+                        "bb0:\n"
+                        "  %0 = param u32 0\n"
+                        "  %1 = addr u32* slot0\n"
+                        "  store %1, %0\n"
+                        "  %3 = const u32 3\n"
+                        "  %4 = gt u32 %0, %3\n"
+                        "  br %4, bb1, bb2\n"
+                        "bb1:  ; preds: bb0\n"
+                        "  store %1, %3\n"
+                        "  jmp bb2\n"
+                        "bb2:  ; preds: bb0, bb1\n"
+                        "  %8 = load u32 %1\n"
+                        "  %9 = add u32 %0, %8\n"
+                        "  ret %9\n"
+                        "}\n");
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+    { "/test_ir_gvn_common_subexpressions",
+      test_ir_gvn_common_subexpressions,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_ir_gvn_memory_effects",
+      test_ir_gvn_memory_effects,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_ir_gvn_memory_joins",
+      test_ir_gvn_memory_joins,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite suite = { "/ir_gvn",
+                                  tests,
+                                  NULL,
+                                  1,
+                                  MUNIT_SUITE_OPTION_NONE };
+
+int
+main(int argc, char *argv[])
+{
+    return munit_suite_main(&suite, NULL, argc, argv);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "ir_licm.h"
+#include "ir_test_util.h"
+#include "munit.h"
+
+static MunitResult
+test_ir_licm_invariant_arithmetic(const MunitParameter params[],
+                                  void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    char buffer[IR_TEST_DUMP_SIZE];
+
+    // k * 3 moves out, k / m could trap and stays.
+    assert_true(ir_test_run_pass(&arena,
+                                 ir_licm_run,
+                                 "fn f(k: u32, m: u32): u32 {\n"
+                                 "  var i: u32 = 0\n"
+                                 "  var s: u32 = 0\n"
+                                 "  while i < 10 {\n"
+                                 "    s = s + (k * 3) + (k / m)\n"
+                                 "    i = i + 1\n"
+                                 "  }\n"
+                                 "  return s\n"
+                                 "}\n",
+                                 buffer));
+
+    assert_string_equal(buffer,
+                        "fn f(u32, u32): u32 {\n"
+                        "bb0:\n"
+                        "  %0 = param u32 0\n"
+                        "  %1 = param u32 1\n"
+                        "  %2 = const u32 0\n"
+                        "  %3 = const u32 0\n"
+                        "  %4 = const u32 10\n"
+                        "  %5 = const u32 3\n"
+                        "  %6 = mul u32 %0, %5\n"
+                        "  %7 = const u32 1\n"
+                        "  jmp bb1\n"
+                        "bb1:  ; preds: bb0, bb2\n"
+                        "  %9 = phi u32 [%2, bb0], [%16, bb2]\n"
+                        "  %10 = phi u32 [%3, bb0], [%15, bb2]\n"
+                        "  %11 = lt u32 %9, %4\n"
+                        "  br %11, bb2, bb3\n"
+                        "bb2:  ; preds: bb1\n"
+                        "  %13 = add u32 %10, %6\n"
+                        "  %14 = div u32 %0, %1\n"
+                        "  %15 = add u32 %13, %14\n"
+                        "  %16 = add u32 %9, %7\n"
+                        "  jmp bb1\n"
+                        "bb3:  ; preds: bb1\n"
+                        "  ret %10\n"
+                        "}\n");
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_ir_licm_slot_loads(const MunitParameter params[],
+                        void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    char buffer[IR_TEST_DUMP_SIZE];
+
+    // x is never stored in the loop, y is.
+    assert_true(ir_test_run_pass(&arena,
+                                 ir_licm_run,
+                                 "fn f(k: u32): u32 {\n"
+                                 "  var x: u32 = k\n"
+                                 "  var y: u32 = k\n"
+                                 "  var p: u32* = &x\n"
+                                 "  var q: u32* = &y\n"
+                                 "  while *q < *p {\n"
+                                 "    *q = *q + 1\n"
+                                 "  }\n"
+                                 "  return y\n"
+                                 "}\n",
+                                 buffer));
+
+    assert_string_equal(buffer,
+                        "fn f(u32): u32 {\n"
+                        "  slot0: u32\n"
+                        "  slot1: u32\n"
+                        "bb0:\n"
+                        "  %0 = param u32 0\n"
+                        "  %1 = addr u32* slot0\n"
+                        "  store %1, %0\n"
+                        "  %3 = addr u32* slot1\n"
+                        "  store %3, %0\n"
+                        "  %5 = addr u32* slot0\n"
+                        "  %6 = addr u32* slot1\n"
+                        "  %7 = load u32 %5\n"
+                        "  %8 = const u32 1\n"
+                        "  jmp bb1\n"
+                        "bb1:  ; preds: bb0, bb2\n"
+                        "  %10 = load u32 %6\n"
+                        "  %11 = lt u32 %10, %7\n"
+                        "  br %11, bb2, bb3\n"
+                        "bb2:  ; preds: bb1\n"
+                        "  %13 = load u32 %6\n"
+                        "  %14 = add u32 %13, %8\n"
+                        "  store %6, %14\n"
+                        "  jmp bb1\n"
+                        "bb3:  ; preds: bb1\n"
+                        "  %17 = addr u32* slot1\n"
+                        "  %18 = load u32 %17\n"
+                        "  ret %18\n"
+                        "}\n");
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_ir_licm_pointer_loads(const MunitParameter params[],
+                           void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    char buffer[IR_TEST_DUMP_SIZE];
+
+    // *n is loaded in the header, so on every entry, and no store nor call
+    // can change it.  *m is only loaded once the condition holds.
+    assert_true(ir_test_run_pass(&arena,
+                                 ir_licm_run,
+                                 "fn f(n: u32*, m: u32*): u32 {\n"
+                                 "  var i: u32 = 0\n"
+                                 "  while i < *n {\n"
+                                 "    i = i + *m\n"
+                                 "  }\n"
+                                 "  return i\n"
+                                 "}\n",
+                                 buffer));
+
+    assert_string_equal(buffer,
+                        "fn f(u32*, u32*): u32 {\n"
+                        "bb0:\n"
+                        "  %0 = param u32* 0\n"
+                        "  %1 = param u32* 1\n"
+                        "  %2 = const u32 0\n"
+                        "  %3 = load u32 %0\n"
+                        "  jmp bb1\n"
+                        "bb1:  ; preds: bb0, bb2\n"
+                        "  %5 = phi u32 [%2, bb0], [%9, bb2]\n"
+                        "  %6 = lt u32 %5, %3\n"
+                        "  br %6, bb2, bb3\n"
+                        "bb2:  ; preds: bb1\n"
+                        "  %8 = load u32 %1\n"
+                        "  %9 = add u32 %5, %8\n"
+                        "  jmp bb1\n"
+                        "bb3:  ; preds: bb1\n"
+                        "  ret %5\n"
+                        "}\n");
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_ir_licm_calls(const MunitParameter params[],
+                   void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    char buffer[IR_TEST_DUMP_SIZE];
+
+    // g could store to *n.
+    assert_false(ir_test_run_pass(&arena,
+                                  ir_licm_run,
+                                  "fn g(): u32 {\n"
+                                  "  return 0\n"
+                                  "}\n"
+                                  "fn f(n: u32*): u32 {\n"
+                                  "  var i: u32 = 0\n"
+                                  "  while i < *n {\n"
+                                  "    i = i + g()\n"
+                                  "  }\n"
+                                  "  return i\n"
+                                  "}\n",
+                                  buffer));
+
+    assert_string_equal(buffer,
+                        "fn f(u32*): u32 {\n"
+                        "bb0:\n"
+                        "  %0 = param u32* 0\n"
+                        "  %1 = const u32 0\n"
+                        "  jmp bb1\n"
+                        "bb1:  ; preds: bb0, bb2\n"
+                        "  %3 = phi u32 [%1, bb0], [%8, bb2]\n"
+                        "  %4 = load u32 %0\n"
+                        "  %5 = lt u32 %3, %4\n"
+                        "  br %5, bb2, bb3\n"
+                        "bb2:  ; preds: bb1\n"
+                        "  %7 = call u32 g()\n"
+                        "  %8 = add u32 %3, %7\n"
+                        "  jmp bb1\n"
+                        "bb3:  ; preds: bb1\n"
+                        "  ret %3\n"
+                        "}\n");
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+    { "/test_ir_licm_invariant_arithmetic",
+      test_ir_licm_invariant_arithmetic,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_ir_licm_slot_loads",
+      test_ir_licm_slot_loads,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_ir_licm_pointer_loads",
+      test_ir_licm_pointer_loads,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_ir_licm_calls",
+      test_ir_licm_calls,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite suite = { "/ir_licm",
+                                  tests,
+                                  NULL,
+                                  1,
+                                  MUNIT_SUITE_OPTION_NONE };
+
+int
+main(int argc, char *argv[])
+{
+    return munit_suite_main(&suite, NULL, argc, argv);
+    return EXIT_SUCCESS;
+}
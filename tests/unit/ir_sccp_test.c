@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "ir_sccp.h"
+#include "ir_test_util.h"
+#include "munit.h"
+
+static MunitResult
+test_ir_sccp_wraparound(const MunitParameter params[],
+                        void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    char buffer[IR_TEST_DUMP_SIZE];
+
+    assert_true(ir_test_run_pass(&arena,
+                                 ir_sccp_run,
+                                 "fn main(): u8 {\n"
+                                 "  var a: u8 = 250\n"
+                                 "  var b: u16 = 65535\n"
+                                 "  return a + 10 + (b + 2)\n"
+                                 "}\n",
+                                 buffer));
+
+    // 250 + 10 wraps to 4 and 65535 + 2 to 1.
+    assert_string_equal(buffer,
+                        "fn main(): u8 {\n"
+                        "bb0:\n"
+                        "  %0 = const u8 5\n"
+                        "  ret %0\n"
+                        "}\n");
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_ir_sccp_prune_branches(const MunitParameter params[],
+                            void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    char buffer[IR_TEST_DUMP_SIZE];
+
+    // x stays 1 around the loop, so the last return is never reached.
+    assert_true(ir_test_run_pass(&arena,
+                                 ir_sccp_run,
+                                 "fn main(): u32 {\n"
+                                 "  var x: u32 = 1\n"
+                                 "  var i: u32 = 0\n"
+                                 "  while i < 10 {\n"
+                                 "    x = x * 1\n"
+                                 "    i = i + 1\n"
+                                 "  }\n"
+                                 "  if x == 1 {\n"
+                                 "    return 7\n"
+                                 "  }\n"
+                                 "  return x << 35\n"
+                                 "}\n",
+                                 buffer));
+
+    assert_string_equal(buffer,
+                        "fn main(): u32 {\n"
+                        "bb0:\n"
+                        "  %0 = const u32 0\n"
+                        "  jmp bb1\n"
+                        "bb1:  ; preds: bb0, bb2\n"
+                        "  %2 = phi u32 [%0, bb0], [%7, bb2]\n"
+                        "  %3 = const u32 10\n"
+                        "  %4 = lt u32 %2, %3\n"
+                        "  br %4, bb2, bb3\n"
+                        "bb2:  ; preds: bb1\n"
+                        "  %6 = const u32 1\n"
+                        "  %7 = add u32 %2, %6\n"
+                        "  jmp bb1\n"
+                        "bb3:  ; preds: bb1\n"
+                        "  jmp bb4\n"
+                        "bb4:  ; preds: bb3\n"
+                        "  %10 = const u32 7\n"
+                        "  ret %10\n"
+                        "}\n");
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_ir_sccp_division_by_zero(const MunitParameter params[],
+                              void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    char buffer[IR_TEST_DUMP_SIZE];
+
+    // The division must still trap at runtime.
+    assert_false(ir_test_run_pass(&arena,
+                                  ir_sccp_run,
+                                  "fn main(): u32 {\n"
+                                  "  var z: u32 = 0\n"
+                                  "  return 8 / z\n"
+                                  "}\n",
+                                  buffer));
+
+    assert_string_equal(buffer,
+                        "fn main(): u32 {\n"
+                        "bb0:\n"
+                        "  %0 = const u32 0\n"
+                        "  %1 = const u32 8\n"
+                        "  %2 = div u32 %1, %0\n"
+                        "  ret %2\n"
+                        "}\n");
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+    { "/test_ir_sccp_wraparound",
+      test_ir_sccp_wraparound,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_ir_sccp_prune_branches",
+      test_ir_sccp_prune_branches,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_ir_sccp_division_by_zero",
+      test_ir_sccp_division_by_zero,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite suite = { "/ir_sccp",
+                                  tests,
+                                  NULL,
+                                  1,
+                                  MUNIT_SUITE_OPTION_NONE };
+
+int
+main(int argc, char *argv[])
+{
+    return munit_suite_main(&suite, NULL, argc, argv);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include <stdio.h>
+#include <string.h>
+
+#include "arena.h"
+#include "interner.h"
+#include "ir.h"
+#include "munit.h"
+#include "type.h"
+
+#define IR_TEST_ARENA_CAPACITY (1024 * 64)
+
+/**
+ * Builds by hand the IR of:
+ *
+ *     fn count(n: u32): u32 {
+ *       var i: u32 = 0
+ *       while i < n { i = i + 1 }
+ *       return i
+ *     }
+ */
+static ir_function_t *
+build_count(ir_module_t *module, interner_t *interner, type_table_t *types)
+{
+    type_t *u32 = types->primitives[TYPE_U32];
+    ir_function_t *fn = ir_function_new(
+        module,
+        interner_intern(interner, string_view_from_cstr("count")),
+        u32,
+        1);
+    fn->params[0] = u32;
+
+    ir_block_t *entry = ir_block_new(fn);
+    ir_block_t *header = ir_block_new(fn);
+    ir_block_t *body = ir_block_new(fn);
+    ir_block_t *exit = ir_block_new(fn);
+
+    ir_instr_t *n = ir_instr_new(fn, IR_PARAM, u32, 0);
+    n->index = 0;
+    ir_block_append(entry, n);
+    ir_instr_t *zero = ir_const_new(fn, u32, 0);
+    ir_block_append(entry, zero);
+    ir_block_jmp(entry, header);
+
+    ir_block_jmp(body, header);
+
+    ir_instr_t *i = ir_instr_new(fn, IR_PHI, u32, 0);
+    ir_block_append(header, i);
+    ir_phi_add_operand(i, zero);
+
+    ir_instr_t *one = ir_const_new(fn, u32, 1);
+    ir_instr_t *next = ir_instr_new(fn, IR_ADD, u32, 2);
+    ir_instr_set_operand(next, 0, i);
+    ir_instr_set_operand(next, 1, one);
+    ir_instr_insert_before(ir_block_terminator(body), one);
+    ir_instr_insert_before(ir_block_terminator(body), next);
+    ir_phi_add_operand(i, next);
+
+    ir_instr_t *cond = ir_instr_new(fn, IR_LT, u32, 2);
+    ir_instr_set_operand(cond, 0, i);
+    ir_instr_set_operand(cond, 1, n);
+    ir_block_append(header, cond);
+    ir_block_br(header, cond, body, exit);
+
+    ir_block_ret(exit, i);
+
+    return fn;
+}
+
+static MunitResult
+test_ir_function_verify(const MunitParameter params[],
+                        void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    interner_t interner;
+    interner_init(&interner, &arena);
+    type_table_t types;
+    type_table_init(&types, &arena);
+
+    ir_module_t *module = ir_module_new(&arena);
+    ir_function_t *fn = build_count(module, &interner, &types);
+
+    assert_true(ir_function_verify(fn));
+
+    ir_block_t *header = fn->first->next;
+    assert_uint(header->preds_size, ==, 2);
+    assert_ptr_equal(header->preds[0], fn->first);
+    assert_ptr_equal(header->preds[1], header->next);
+    assert_uint(ir_block_pred_index(header, fn->last), ==, UINT32_MAX);
+
+    assert_uint(ir_block_succs_size(header), ==, 2);
+    assert_ptr_equal(ir_block_succ(header, 0), header->next);
+    assert_ptr_equal(ir_block_succ(header, 1), fn->last);
+
+    // A phi must have an operand per predecessor.
+    ir_instr_t *phi = header->first;
+    ir_instr_t *next = ir_instr_operand(phi, 1);
+    ir_instr_remove_operand(phi, 1);
+    assert_false(ir_function_verify(fn));
+    ir_phi_add_operand(phi, next);
+    assert_true(ir_function_verify(fn));
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_ir_instr_replace_uses(const MunitParameter params[],
+                           void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    interner_t interner;
+    interner_init(&interner, &arena);
+    type_table_t types;
+    type_table_init(&types, &arena);
+
+    ir_module_t *module = ir_module_new(&arena);
+    ir_function_t *fn = build_count(module, &interner, &types);
+
+    ir_block_t *header = fn->first->next;
+    ir_instr_t *phi = header->first;
+    ir_instr_t *n = fn->first->first;
+    ir_instr_t *zero = n->next;
+
+    // The phi is used by the add, the comparison and the return.
+    assert_true(ir_instr_has_uses(phi));
+    ir_instr_replace_uses(phi, zero);
+    assert_false(ir_instr_has_uses(phi));
+
+    ir_instr_t *cond = phi->next;
+    assert_ptr_equal(ir_instr_operand(cond, 0), zero);
+    assert_ptr_equal(ir_instr_operand(ir_block_terminator(fn->last), 0), zero);
+
+    ir_instr_remove(phi);
+    assert_null(phi->block);
+    assert_ptr_equal(header->first, cond);
+    assert_true(ir_function_verify(fn));
+
+    // Dropping the last edge into the body leaves it unreachable.
+    ir_block_t *body = header->next;
+    ir_instr_t *br = ir_block_terminator(header);
+    ir_instr_remove(br);
+    ir_block_jmp(header, fn->last);
+    ir_instr_remove(cond);
+    assert_uint(body->preds_size, ==, 0);
+
+    ir_block_remove(body);
+    ir_function_renumber(fn);
+    assert_uint(fn->blocks_size, ==, 3);
+    assert_uint(header->preds_size, ==, 1);
+    assert_true(ir_function_verify(fn));
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_ir_function_dump(const MunitParameter params[],
+                      void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(IR_TEST_ARENA_CAPACITY);
+    interner_t interner;
+    interner_init(&interner, &arena);
+    type_table_t types;
+    type_table_init(&types, &arena);
+
+    ir_module_t *module = ir_module_new(&arena);
+    ir_function_t *fn = build_count(module, &interner, &types);
+    ir_function_renumber(fn);
+
+    char buffer[1024] = { 0 };
+    FILE *out = fmemopen(buffer, sizeof(buffer) - 1, "w");
+    ir_function_dump(fn, out);
+    fclose(out);
+
+    assert_string_equal(buffer,
+                        "fn count(u32): u32 {\n"
+                        "bb0:\n"
+                        "  %0 = param u32 0\n"
+                        "  %1 = const u32 0\n"
+                        "  jmp bb1\n"
+                        "bb1:  ; preds: bb0, bb2\n"
+                        "  %3 = phi u32 [%1, bb0], [%7, bb2]\n"
+                        "  %4 = lt u32 %3, %0\n"
+                        "  br %4, bb2, bb3\n"
+                        "bb2:  ; preds: bb1\n"
+                        "  %6 = const u32 1\n"
+                        "  %7 = add u32 %3, %6\n"
+                        "  jmp bb1\n"
+                        "bb3:  ; preds: bb1\n"
+                        "  ret %3\n"
+                        "}\n");
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+    { "/test_ir_function_verify",
+      test_ir_function_verify,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_ir_instr_replace_uses",
+      test_ir_instr_replace_uses,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_ir_function_dump",
+      test_ir_function_dump,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite suite = { "/ir",
+                                  tests,
+                                  NULL,
+                                  1,
+                                  MUNIT_SUITE_OPTION_NONE };
+
+int
+main(int argc, char *argv[])
+{
+    return munit_suite_main(&suite, NULL, argc, argv);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef IR_TEST_UTIL_H
+#define IR_TEST_UTIL_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "arena.h"
+#include "checker.h"
+#include "interner.h"
+#include "ir.h"
+#include "ir_analysis.h"
+#include "ir_builder.h"
+#include "lexer.h"
+#include "munit.h"
+#include "parser.h"
+
+#define IR_TEST_ARENA_CAPACITY (1024 * 64)
+#define IR_TEST_DUMP_SIZE 2048
+
+typedef bool (*ir_test_pass_t)(ir_function_t *fn, ir_analysis_t *analysis);
+
+/**
+ * Lexes, parses, checks and lowers code, and returns its last function.
+ */
+static inline ir_function_t *
+ir_test_build_fn(arena_t *arena, char *code)
+{
+    interner_t interner;
+    interner_init(&interner, arena);
+
+    source_code_t src = {
+        .filepath = "ir_test.ol",
+        .code = { .chars = code, .size = strlen(code) },
+    };
+
+    lexer_t lexer = { 0 };
+    lexer_init(&lexer, src, &interner);
+
+    parser_t parser;
+    parser_init(&parser, &lexer, arena);
+
+    ast_node_t *ast = parser_parse_translation_unit(&parser);
+    checker_check(checker_new(arena), ast);
+
+    ir_module_t *module = ir_builder_build(ir_builder_new(arena), ast);
+    munit_assert_true(ir_module_verify(module));
+
+    return module->last;
+}
+
+/**
+ * Runs pass over the last function of code and dumps the result into buffer,
+ * which holds IR_TEST_DUMP_SIZE bytes.  Returns whether the pass changed the
+ * function.
+ */
+static inline bool
+ir_test_run_pass(arena_t *arena, ir_test_pass_t pass, char *code, char *buffer)
+{
+    ir_function_t *fn = ir_test_build_fn(arena, code);
+
+    ir_analysis_t analysis;
+    ir_analysis_init(&analysis, fn);
+    bool changed = pass(fn, &analysis);
+    ir_analysis_free(&analysis);
+
+    munit_assert_true(ir_function_verify(fn));
+    ir_function_renumber(fn);
+
+    memset(buffer, 0, IR_TEST_DUMP_SIZE);
+    FILE *out = fmemopen(buffer, IR_TEST_DUMP_SIZE - 1, "w");
+    ir_function_dump(fn, out);
+    fclose(out);
+
+    return changed;
+}
+
+#endif /* IR_TEST_UTIL_H */
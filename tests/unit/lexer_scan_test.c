@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#define MUNIT_ENABLE_ASSERT_ALIASES
+#include "lexer_scan.h"
+#include "munit.h"
+
+#include <string.h>
+
+#define LEXER_SCAN_TEST_SIZE 4096
+
+static MunitResult
+lexer_scan_runs_test(const MunitParameter params[], void *user_data_or_fixture)
+{
+    char *code = "  \t\r\vfoo42bar  # comment\n"
+                 "1234567890123456789012345678901234";
+    size_t size = strlen(code);
+
+    assert_int(lexer_scan(code, 0, size, LEXER_SCAN_SPACE), ==, 5);
+    assert_int(lexer_scan(code, 5, size, LEXER_SCAN_ALNUM), ==, 13);
+    assert_int(lexer_scan(code, 8, size, LEXER_SCAN_DIGIT), ==, 10);
+    assert_int(lexer_scan(code, 15, size, LEXER_SCAN_NOT_LF), ==, 24);
+    assert_int(lexer_scan(code, 25, size, LEXER_SCAN_DIGIT), ==, size);
+    assert_int(lexer_scan(code, size, size, LEXER_SCAN_SPACE), ==, size);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+lexer_scan_matches_scalar_test(const MunitParameter params[],
+                               void *user_data_or_fixture)
+{
+    // Lexer-like alphabet plus a few bytes out of the ASCII range, so the
+    // vector kernels are exercised with every class boundary.
+    static const char alphabet[] = " \t\v\f\r\n#_(){}+-09azAZ@[`{/:"
+                                   "\x7f\x80\xe9\xff";
+
+    char code[LEXER_SCAN_TEST_SIZE];
+    for (size_t i = 0; i < LEXER_SCAN_TEST_SIZE; ++i) {
+        // Long runs of the same char make the vector loops go further than
+        // a single block.
+        if (i > 0 && munit_rand_int_range(0, 3) != 0) {
+            code[i] = code[i - 1];
+            continue;
+        }
+        code[i] = alphabet[munit_rand_int_range(0, sizeof(alphabet) - 2)];
+    }
+
+    lexer_scan_class_t classes[] = {
+        LEXER_SCAN_SPACE,
+        LEXER_SCAN_ALNUM,
+        LEXER_SCAN_DIGIT,
+        LEXER_SCAN_NOT_LF,
+    };
+
+    for (size_t c = 0; c < sizeof(classes) / sizeof(classes[0]); ++c) {
+        for (size_t offset = 0; offset <= LEXER_SCAN_TEST_SIZE; ++offset) {
+            assert_int(
+                lexer_scan(code, offset, LEXER_SCAN_TEST_SIZE, classes[c]),
+                ==,
+                lexer_scan_scalar(
+                    code, offset, LEXER_SCAN_TEST_SIZE, classes[c]));
+        }
+    }
+
+    return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+    { "/lexer_scan_runs_test",
+      lexer_scan_runs_test,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/lexer_scan_matches_scalar_test",
+      lexer_scan_matches_scalar_test,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite suite = { "/lexer_scan",
+                                  tests,
+                                  NULL,
+                                  1,
+                                  MUNIT_SUITE_OPTION_NONE };
+
+int
+main(int argc, char *argv[])
+{
+    return munit_suite_main(&suite, NULL, argc, argv);
+    return EXIT_SUCCESS;
+}
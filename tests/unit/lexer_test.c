@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#define MUNIT_ENABLE_ASSERT_ALIASES
+#include "arena.h"
+#include "interner.h"
+#include "lexer.h"
+#include "munit.h"
+
+#include <string.h>
+
+#define LEXER_TEST_ARENA_CAPACITY (1024 * 16)
+
+static MunitResult
+lexer_tokenize_test(const MunitParameter params[], void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(LEXER_TEST_ARENA_CAPACITY);
+    interner_t interner;
+    interner_init(&interner, &arena);
+
+    char *code = "fn main(): u32 {\n  return 4294967295 + main\n}\n";
+    source_code_t src = {
+        .filepath = "lexer_test.ol",
+        .code = { .chars = code, .size = strlen(code) },
+    };
+
+    lexer_t lexer = { 0 };
+    lexer_init(&lexer, src, &interner);
+
+    token_buffer_t tokens;
+    lexer_tokenize(&lexer, &tokens, &arena);
+
+    token_kind_t expected_kinds[] = {
+        TOKEN_FN,     TOKEN_ID,     TOKEN_OPAREN, TOKEN_CPAREN, TOKEN_COLON,
+        TOKEN_ID,     TOKEN_OCURLY, TOKEN_LF,     TOKEN_RETURN, TOKEN_NUMBER,
+        TOKEN_PLUS,   TOKEN_ID,     TOKEN_LF,     TOKEN_CCURLY, TOKEN_LF,
+        TOKEN_EOF,
+    };
+    size_t expected_size = sizeof(expected_kinds) / sizeof(expected_kinds[0]);
+
+    assert_int(tokens.size, ==, expected_size);
+    for (size_t i = 0; i < expected_size; ++i) {
+        assert_int(tokens.kinds[i], ==, expected_kinds[i]);
+    }
+
+    token_t token;
+
+    token_buffer_get(&tokens, 9, &token);
+    assert_int(token.kind, ==, TOKEN_NUMBER);
+    assert_uint64(token.number, ==, 4294967295);
+    assert_true(string_view_eq_to_cstr(token.value, "4294967295"));
+    assert_int(token_loc_to_lineno(token.loc), ==, 2);
+    assert_int(token_loc_to_colno(token.loc), ==, 10);
+    assert_true(string_view_eq_to_cstr(token_loc_to_line(token.loc),
+                                       "  return 4294967295 + main"));
+    assert_string_equal(token_loc_to_filepath(token.loc), "lexer_test.ol");
+
+    // Both identifiers share the same atom.
+    token_t main_token;
+    token_buffer_get(&tokens, 1, &main_token);
+    token_buffer_get(&tokens, 11, &token);
+    assert_not_null(token.atom);
+    assert_ptr_equal(token.atom, main_token.atom);
+
+    // Reading past the end keeps returning EOF.
+    token_buffer_get(&tokens, expected_size + 10, &token);
+    assert_int(token.kind, ==, TOKEN_EOF);
+    assert_int(token_loc_to_lineno(token.loc), ==, 4);
+    assert_int(token_loc_to_colno(token.loc), ==, 1);
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+    { "/lexer_tokenize_test",
+      lexer_tokenize_test,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite suite = { "/lexer",
+                                  tests,
+                                  NULL,
+                                  1,
+                                  MUNIT_SUITE_OPTION_NONE };
+
+int
+main(int argc, char *argv[])
+{
+    return munit_suite_main(&suite, NULL, argc, argv);
+    return EXIT_SUCCESS;
+}
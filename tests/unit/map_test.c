@@ -22,6 +22,8 @@
 #include <stdio.h>
 
 #define MAP_TEST_ARENA_CAPACITY (1024 * 16)
+#define MAP_BENCH_KEYS 20000
+#define MAP_BENCH_KEY_SIZE 16
 
 static MunitResult
 test_create_new(const MunitParameter params[], void *user_data_or_fixture)
@@ -46,16 +48,110 @@ test_map_put_and_get(const MunitParameter params[], void *user_data_or_fixture)
     int n1 = 1;
     int n2 = 2;
 
-    map_put(map, "n1", (void *)&n1);
-    map_put(map, "n2", (void *)&n2);
+    map_put(map, string_view_from_cstr("n1"), (void *)&n1);
+    map_put(map, string_view_from_cstr("n2"), (void *)&n2);
 
     assert_int(map->size, ==, 2);
-    assert_int(*((int *)map_get(map, "n1")), ==, n1);
-    assert_int(*((int *)map_get(map, "n2")), ==, n2);
+    assert_int(*((int *)map_get(map, string_view_from_cstr("n1"))), ==, n1);
+    assert_int(*((int *)map_get(map, string_view_from_cstr("n2"))), ==, n2);
 
-    map_put(map, "n1", (void *)&n2);
+    map_put(map, string_view_from_cstr("n1"), (void *)&n2);
 
-    assert_int(*((int *)map_get(map, "n1")), ==, n2);
+    assert_int(map->size, ==, 2);
+    assert_int(*((int *)map_get(map, string_view_from_cstr("n1"))), ==, n2);
+
+    assert_null(map_get(map, string_view_from_cstr("n3")));
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_map_string_view_keys(const MunitParameter params[],
+                          void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(MAP_TEST_ARENA_CAPACITY);
+    map_t *map = map_new(&arena);
+
+    // Keys are slices of a bigger string, they are not NUL terminated.
+    char *text = "abcabc";
+    string_view_t first = { .chars = text, .size = 3 };
+    string_view_t second = { .chars = text + 3, .size = 3 };
+    string_view_t prefix = { .chars = text, .size = 2 };
+
+    int n1 = 1;
+
+    map_put(map, first, (void *)&n1);
+
+    assert_ptr_equal(map_get(map, second), &n1);
+    assert_null(map_get(map, prefix));
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_map_grow(const MunitParameter params[], void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(MAP_TEST_ARENA_CAPACITY);
+    map_t *map = map_new(&arena);
+
+    size_t keys_len = MAP_INITIAL_CAPACITY * 16;
+    char *keys = arena_alloc(&arena, keys_len * MAP_BENCH_KEY_SIZE);
+    size_t *values = arena_alloc(&arena, keys_len * sizeof(size_t));
+
+    for (size_t i = 0; i < keys_len; ++i) {
+        char *key = keys + i * MAP_BENCH_KEY_SIZE;
+        sprintf(key, "key%zu", i);
+        values[i] = i;
+        map_put(map, string_view_from_cstr(key), values + i);
+    }
+
+    assert_int(map->size, ==, keys_len);
+    assert_int(map->capacity, >, MAP_INITIAL_CAPACITY);
+
+    for (size_t i = 0; i < keys_len; ++i) {
+        char *key = keys + i * MAP_BENCH_KEY_SIZE;
+        size_t *value = map_get(map, string_view_from_cstr(key));
+        assert_not_null(value);
+        assert_int(*value, ==, i);
+    }
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_map_put_existing(const MunitParameter params[],
+                      void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(MAP_TEST_ARENA_CAPACITY);
+    map_t *map = map_new(&arena);
+
+    // Fills the map right up to its load limit.
+    size_t keys_len = MAP_INITIAL_CAPACITY * MAP_MAX_LOAD_NUMERATOR /
+                      MAP_MAX_LOAD_DENOMINATOR;
+    char *keys = arena_alloc(&arena, keys_len * MAP_BENCH_KEY_SIZE);
+    size_t *values = arena_alloc(&arena, keys_len * sizeof(size_t));
+
+    for (size_t i = 0; i < keys_len; ++i) {
+        char *key = keys + i * MAP_BENCH_KEY_SIZE;
+        sprintf(key, "key%zu", i);
+        values[i] = i;
+        map_put(map, string_view_from_cstr(key), values + i);
+    }
+
+    assert_int(map->capacity, ==, MAP_INITIAL_CAPACITY);
+
+    // Replacing the value of a key does not add an entry.
+    map_put(map, string_view_from_cstr(keys), values + 1);
+
+    assert_int(map->size, ==, keys_len);
+    assert_int(map->capacity, ==, MAP_INITIAL_CAPACITY);
+    assert_ptr_equal(map_get(map, string_view_from_cstr(keys)), values + 1);
 
     arena_free(&arena);
 
@@ -71,20 +167,188 @@ test_map_get_kvs(const MunitParameter params[], void *user_data_or_fixture)
     int n1 = 1;
     int n2 = 2;
 
-    map_put(map, "n1", (void *)&n1);
-    map_put(map, "n2", (void *)&n2);
+    map_put(map, string_view_from_cstr("n1"), (void *)&n1);
+    map_put(map, string_view_from_cstr("n2"), (void *)&n2);
 
     assert_int(map->size, ==, 2);
 
-    map_kv_t map_kvs[map->size];
+    map_kv_t *map_kvs[map->size];
 
-    map_get_kvs(map, (map_kv_t **)map_kvs);
+    map_get_kvs(map, map_kvs);
 
-    assert_string_equal(map_kvs[0].key, "n1");
-    assert_int(*((int *)(map_kvs[0].value)), ==, 1);
+    // Entries are returned in slot order.
+    map_kv_t *kv_n1 = map_kvs[0];
+    map_kv_t *kv_n2 = map_kvs[1];
+    if (string_view_eq_to_cstr(kv_n1->key, "n2")) {
+        kv_n1 = map_kvs[1];
+        kv_n2 = map_kvs[0];
+    }
 
-    assert_string_equal(map_kvs[1].key, "n2");
-    assert_int(*((int *)(map_kvs[1].value)), ==, 2);
+    assert_true(string_view_eq_to_cstr(kv_n1->key, "n1"));
+    assert_int(*((int *)(kv_n1->value)), ==, 1);
+
+    assert_true(string_view_eq_to_cstr(kv_n2->key, "n2"));
+    assert_int(*((int *)(kv_n2->value)), ==, 2);
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+/**
+ * Copy of the chained hash map used before the open addressing table, kept
+ * as the baseline for the benchmarks below.
+ */
+#define LEGACY_MAP_CAPACITY 32
+#define LEGACY_FNV1A_PRIME 0x01000193
+#define LEGACY_FNV1A_OFFSET_BASIS 0x811c9dc5
+
+typedef struct legacy_map_entry legacy_map_entry_t;
+
+typedef struct legacy_map_entry
+{
+    char *key;
+    void *value;
+    uint32_t hash;
+    legacy_map_entry_t *next;
+} legacy_map_entry_t;
+
+typedef struct legacy_map
+{
+    arena_t *arena;
+    legacy_map_entry_t *entries;
+} legacy_map_t;
+
+static uint32_t
+legacy_map_hash(const char *s)
+{
+    uint32_t hash = LEGACY_FNV1A_OFFSET_BASIS;
+    size_t len = strlen(s);
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= s[i];
+        hash *= LEGACY_FNV1A_PRIME;
+    }
+    return hash;
+}
+
+static char *
+legacy_map_strdup(const char *s, arena_t *arena)
+{
+    size_t slen = strlen(s);
+    char *result = arena_alloc(arena, slen + 1);
+    memcpy(result, s, slen + 1);
+    return result;
+}
+
+static void
+legacy_map_init(legacy_map_t *map, arena_t *arena)
+{
+    map->arena = arena;
+    map->entries =
+        arena_alloc(arena, LEGACY_MAP_CAPACITY * sizeof(legacy_map_entry_t));
+    memset(map->entries, 0, LEGACY_MAP_CAPACITY * sizeof(legacy_map_entry_t));
+}
+
+static void
+legacy_map_put(legacy_map_t *map, char *key, void *value)
+{
+    uint32_t hash = legacy_map_hash(key);
+    legacy_map_entry_t *entry =
+        map->entries + (hash & (LEGACY_MAP_CAPACITY - 1));
+
+    if (entry->key == NULL) {
+        *entry = (legacy_map_entry_t){
+            .key = legacy_map_strdup(key, map->arena),
+            .hash = hash,
+            .value = value,
+        };
+        return;
+    }
+
+    while (true) {
+        if (entry->hash == hash && strcmp(entry->key, key) == 0) {
+            entry->value = value;
+            return;
+        }
+        if (entry->next == NULL) {
+            entry->next = arena_alloc(map->arena, sizeof(legacy_map_entry_t));
+            *entry->next = (legacy_map_entry_t){
+                .key = legacy_map_strdup(key, map->arena),
+                .hash = hash,
+                .value = value,
+            };
+            return;
+        }
+        entry = entry->next;
+    }
+}
+
+static void *
+legacy_map_get(legacy_map_t *map, char *key)
+{
+    uint32_t hash = legacy_map_hash(key);
+    legacy_map_entry_t *entry =
+        map->entries + (hash & (LEGACY_MAP_CAPACITY - 1));
+    while (entry != NULL && entry->key != NULL) {
+        if (entry->hash == hash && strcmp(entry->key, key) == 0) {
+            return entry->value;
+        }
+        entry = entry->next;
+    }
+    return NULL;
+}
+
+static char *
+bench_keys_new(arena_t *arena)
+{
+    char *keys = arena_alloc(arena, MAP_BENCH_KEYS * MAP_BENCH_KEY_SIZE);
+    for (size_t i = 0; i < MAP_BENCH_KEYS; ++i) {
+        sprintf(keys + i * MAP_BENCH_KEY_SIZE, "symbol_%zu", i);
+    }
+    return keys;
+}
+
+static MunitResult
+bench_map_put_and_get(const MunitParameter params[],
+                      void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(MAP_TEST_ARENA_CAPACITY);
+    char *keys = bench_keys_new(&arena);
+    map_t *map = map_new(&arena);
+
+    for (size_t i = 0; i < MAP_BENCH_KEYS; ++i) {
+        char *key = keys + i * MAP_BENCH_KEY_SIZE;
+        map_put(map, string_view_from_cstr(key), key);
+    }
+
+    for (size_t i = 0; i < MAP_BENCH_KEYS; ++i) {
+        char *key = keys + i * MAP_BENCH_KEY_SIZE;
+        assert_ptr_equal(map_get(map, string_view_from_cstr(key)), key);
+    }
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+bench_legacy_map_put_and_get(const MunitParameter params[],
+                             void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(MAP_TEST_ARENA_CAPACITY);
+    char *keys = bench_keys_new(&arena);
+    legacy_map_t map;
+    legacy_map_init(&map, &arena);
+
+    for (size_t i = 0; i < MAP_BENCH_KEYS; ++i) {
+        char *key = keys + i * MAP_BENCH_KEY_SIZE;
+        legacy_map_put(&map, key, key);
+    }
+
+    for (size_t i = 0; i < MAP_BENCH_KEYS; ++i) {
+        char *key = keys + i * MAP_BENCH_KEY_SIZE;
+        assert_ptr_equal(legacy_map_get(&map, key), key);
+    }
 
     arena_free(&arena);
 
@@ -104,6 +368,42 @@ static MunitTest tests[] = {
       NULL,
       MUNIT_TEST_OPTION_NONE,
       NULL },
+    { "/test_map_string_view_keys",
+      test_map_string_view_keys,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_map_grow",
+      test_map_grow,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_map_put_existing",
+      test_map_put_existing,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_map_get_kvs",
+      test_map_get_kvs,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/bench_map_put_and_get",
+      bench_map_put_and_get,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/bench_legacy_map_put_and_get",
+      bench_legacy_map_put_and_get,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
 };
 
@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#define MUNIT_ENABLE_ASSERT_ALIASES
+#include "arena.h"
+#include "ast.h"
+#include "interner.h"
+#include "lexer.h"
+#include "munit.h"
+#include "parser.h"
+
+#include <string.h>
+
+#define PARSER_TEST_ARENA_CAPACITY (1024 * 16)
+#define PARSER_TEST_NESTING_DEPTH 100000
+#define PARSER_TEST_FUNCTIONS 32
+
+static ast_node_t *
+parse_return_expr(arena_t *arena, char *code, size_t size)
+{
+    interner_t interner;
+    interner_init(&interner, arena);
+
+    source_code_t src = {
+        .filepath = "parser_test.ol",
+        .code = { .chars = code, .size = size },
+    };
+
+    lexer_t lexer = { 0 };
+    lexer_init(&lexer, src, &interner);
+
+    parser_t parser;
+    parser_init(&parser, &lexer, arena);
+
+    ast_node_t *translation_unit = parser_parse_translation_unit(&parser);
+    assert_not_null(translation_unit);
+    assert_int(translation_unit->as_translation_unit.decls_size, ==, 1);
+
+    ast_node_t *fn_def = translation_unit->as_translation_unit.decls[0];
+    ast_node_t *block = fn_def->as_fn_def.block;
+    assert_int(block->as_block.nodes_size, ==, 1);
+
+    ast_node_t *return_stmt = block->as_block.nodes[0];
+    assert_int(return_stmt->kind, ==, AST_NODE_RETURN_STMT);
+
+    return return_stmt->as_return_stmt.expr;
+}
+
+static MunitResult
+parser_expr_test(const MunitParameter params[], void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(PARSER_TEST_ARENA_CAPACITY);
+
+    char *code = "fn main(): u32 {\n  return -f(1 + 2 * 3, g())\n}\n";
+    ast_node_t *expr = parse_return_expr(&arena, code, strlen(code));
+
+    assert_int(expr->kind, ==, AST_NODE_UNARY_OP);
+    assert_int(expr->as_unary_op.kind, ==, AST_UNARY_NEGATIVE);
+
+    ast_node_t *call = expr->as_unary_op.expr;
+    assert_int(call->kind, ==, AST_NODE_FN_CALL);
+    assert_true(string_view_eq_to_cstr(call->as_fn_call.id->str, "f"));
+    assert_int(call->as_fn_call.args_size, ==, 2);
+
+    ast_node_t *add = call->as_fn_call.args[0];
+    assert_int(add->kind, ==, AST_NODE_BINARY_OP);
+    assert_int(add->as_bin_op.kind, ==, AST_BINOP_ADDITION);
+    assert_int(add->as_bin_op.lhs->kind, ==, AST_NODE_LITERAL);
+
+    ast_node_t *mul = add->as_bin_op.rhs;
+    assert_int(mul->kind, ==, AST_NODE_BINARY_OP);
+    assert_int(mul->as_bin_op.kind, ==, AST_BINOP_MULTIPLICATION);
+
+    ast_node_t *empty_call = call->as_fn_call.args[1];
+    assert_int(empty_call->kind, ==, AST_NODE_FN_CALL);
+    assert_int(empty_call->as_fn_call.args_size, ==, 0);
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+parser_deep_nesting_test(const MunitParameter params[],
+                         void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(PARSER_TEST_ARENA_CAPACITY);
+
+    // fn main(): u32 { return ((...(1)...)) + --...-2 }
+    size_t depth = PARSER_TEST_NESTING_DEPTH;
+    char *code = arena_alloc(&arena, depth * 3 + 64);
+    size_t size = 0;
+
+    size += sprintf(code + size, "fn main(): u32 {\n  return ");
+    memset(code + size, '(', depth);
+    size += depth;
+    code[size++] = '1';
+    memset(code + size, ')', depth);
+    size += depth;
+    size += sprintf(code + size, " + ");
+    memset(code + size, '-', depth);
+    size += depth;
+    size += sprintf(code + size, "2\n}\n");
+
+    ast_node_t *expr = parse_return_expr(&arena, code, size);
+
+    assert_int(expr->kind, ==, AST_NODE_BINARY_OP);
+    assert_int(expr->as_bin_op.lhs->kind, ==, AST_NODE_LITERAL);
+    assert_int(expr->as_bin_op.lhs->as_literal.as_u32, ==, 1);
+
+    ast_node_t *node = expr->as_bin_op.rhs;
+    for (size_t i = 0; i < depth; ++i) {
+        assert_int(node->kind, ==, AST_NODE_UNARY_OP);
+        node = node->as_unary_op.expr;
+    }
+    assert_int(node->kind, ==, AST_NODE_LITERAL);
+    assert_int(node->as_literal.as_u32, ==, 2);
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static ast_node_t *
+parse_translation_unit(arena_t *arena, char *code, size_t workers_size)
+{
+    interner_t interner;
+    interner_init(&interner, arena);
+
+    source_code_t src = {
+        .filepath = "parser_test.ol",
+        .code = { .chars = code, .size = strlen(code) },
+    };
+
+    lexer_t lexer = { 0 };
+    lexer_init(&lexer, src, &interner);
+
+    parser_t parser;
+    parser_init(&parser, &lexer, arena);
+    parser.workers_size = workers_size;
+
+    return parser_parse_translation_unit(&parser);
+}
+
+static void
+assert_same_atom(atom_t *a, atom_t *b)
+{
+    assert_size(a->str.size, ==, b->str.size);
+    assert_memory_equal(a->str.size, a->str.chars, b->str.chars);
+}
+
+static void
+assert_same_ast(ast_node_t *a, ast_node_t *b)
+{
+    if (a == NULL || b == NULL) {
+        assert_ptr_equal(a, b);
+        return;
+    }
+
+    assert_int(a->kind, ==, b->kind);
+    assert_int(a->loc.offset, ==, b->loc.offset);
+
+    switch (a->kind) {
+        case AST_NODE_TRANSLATION_UNIT: {
+            ast_translation_unit_t *tu_a = &a->as_translation_unit;
+            ast_translation_unit_t *tu_b = &b->as_translation_unit;
+            assert_int(tu_a->decls_size, ==, tu_b->decls_size);
+            for (size_t i = 0; i < tu_a->decls_size; ++i) {
+                assert_same_ast(tu_a->decls[i], tu_b->decls[i]);
+            }
+            return;
+        }
+        case AST_NODE_FN_DEF: {
+            assert_same_atom(a->as_fn_def.id, b->as_fn_def.id);
+            assert_int(a->as_fn_def.params_size, ==, b->as_fn_def.params_size);
+            assert_same_ast(a->as_fn_def.block, b->as_fn_def.block);
+            return;
+        }
+        case AST_NODE_BLOCK: {
+            assert_int(a->as_block.nodes_size, ==, b->as_block.nodes_size);
+            for (size_t i = 0; i < a->as_block.nodes_size; ++i) {
+                assert_same_ast(a->as_block.nodes[i], b->as_block.nodes[i]);
+            }
+            return;
+        }
+        case AST_NODE_FN_CALL: {
+            assert_same_atom(a->as_fn_call.id, b->as_fn_call.id);
+            assert_int(a->as_fn_call.args_size, ==, b->as_fn_call.args_size);
+            for (size_t i = 0; i < a->as_fn_call.args_size; ++i) {
+                assert_same_ast(a->as_fn_call.args[i], b->as_fn_call.args[i]);
+            }
+            return;
+        }
+        case AST_NODE_VAR_DEF: {
+            assert_same_ast(a->as_var_def.value, b->as_var_def.value);
+            return;
+        }
+        case AST_NODE_BINARY_OP: {
+            assert_int(a->as_bin_op.kind, ==, b->as_bin_op.kind);
+            assert_same_ast(a->as_bin_op.lhs, b->as_bin_op.lhs);
+            assert_same_ast(a->as_bin_op.rhs, b->as_bin_op.rhs);
+            return;
+        }
+        case AST_NODE_RETURN_STMT: {
+            assert_same_ast(a->as_return_stmt.expr, b->as_return_stmt.expr);
+            return;
+        }
+        case AST_NODE_IF_STMT: {
+            assert_same_ast(a->as_if_stmt.cond, b->as_if_stmt.cond);
+            assert_same_ast(a->as_if_stmt.then, b->as_if_stmt.then);
+            assert_same_ast(a->as_if_stmt._else, b->as_if_stmt._else);
+            return;
+        }
+        case AST_NODE_LITERAL: {
+            assert_int(a->as_literal.as_u32, ==, b->as_literal.as_u32);
+            return;
+        }
+        case AST_NODE_REF: {
+            assert_same_atom(a->as_ref.id, b->as_ref.id);
+            return;
+        }
+        default:
+            assert_true(false);
+    }
+}
+
+static MunitResult
+parser_parallel_test(const MunitParameter params[], void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(PARSER_TEST_ARENA_CAPACITY);
+
+    char *code = arena_alloc(&arena, PARSER_TEST_FUNCTIONS * 128 + 64);
+    size_t size = 0;
+
+    size += sprintf(code + size, "# functions\nextern fn g(a: u32): u32\n\n");
+    for (size_t i = 0; i < PARSER_TEST_FUNCTIONS; ++i) {
+        size += sprintf(code + size,
+                        "fn f%zu(a: u32): u32 {\n"
+                        "  var x: u32 = g(a) * %zu\n"
+                        "  if x > 1 { # {\n"
+                        "    return x\n"
+                        "  }\n"
+                        "  return a + 1\n"
+                        "}\n",
+                        i,
+                        i);
+    }
+
+    ast_node_t *sequential = parse_translation_unit(&arena, code, 1);
+    ast_node_t *parallel = parse_translation_unit(&arena, code, 4);
+
+    assert_not_null(sequential);
+    assert_not_null(parallel);
+    assert_int(parallel->as_translation_unit.decls_size,
+               ==,
+               PARSER_TEST_FUNCTIONS + 1);
+    assert_same_ast(sequential, parallel);
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+    { "/parser_expr_test",
+      parser_expr_test,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/parser_deep_nesting_test",
+      parser_deep_nesting_test,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/parser_parallel_test",
+      parser_parallel_test,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite suite = { "/parser",
+                                  tests,
+                                  NULL,
+                                  1,
+                                  MUNIT_SUITE_OPTION_NONE };
+
+int
+main(int argc, char *argv[])
+{
+    return munit_suite_main(&suite, NULL, argc, argv);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include <stdio.h>
+
+#include "arena.h"
+#include "interner.h"
+#include "munit.h"
+#include "scope.h"
+
+#define SCOPE_TEST_ARENA_CAPACITY (1024 * 64)
+#define SCOPE_TEST_SYMBOLS (SCOPE_INLINE_SYMBOLS * 3)
+
+static MunitResult
+test_scope_lookup(const MunitParameter params[], void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(SCOPE_TEST_ARENA_CAPACITY);
+    interner_t interner;
+    interner_init(&interner, &arena);
+
+    scope_t *scope = scope_new(&arena);
+    symbol_t *symbols[SCOPE_TEST_SYMBOLS];
+    char names[SCOPE_TEST_SYMBOLS][8];
+
+    // Enough symbols to go past the inline array and into the map.
+    for (size_t i = 0; i < SCOPE_TEST_SYMBOLS; ++i) {
+        sprintf(names[i], "s%zu", i);
+        atom_t *id =
+            interner_intern(&interner, string_view_from_cstr(names[i]));
+        symbols[i] = symbol_new(&arena, id, NULL);
+        scope_insert(scope, symbols[i]);
+
+        for (size_t j = 0; j <= i; ++j) {
+            assert_ptr_equal(scope_lookup(scope, symbols[j]->id), symbols[j]);
+        }
+    }
+
+    assert_size(scope->symbols_size, ==, SCOPE_TEST_SYMBOLS);
+    for (size_t i = 0; i < SCOPE_TEST_SYMBOLS; ++i) {
+        assert_ptr_equal(scope_symbol_at(scope, i), symbols[i]);
+    }
+
+    atom_t *missing =
+        interner_intern(&interner, string_view_from_cstr("missing"));
+    assert_null(scope_lookup(scope, missing));
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_scope_shadowing(const MunitParameter params[], void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(SCOPE_TEST_ARENA_CAPACITY);
+    interner_t interner;
+    interner_init(&interner, &arena);
+
+    atom_t *id = interner_intern(&interner, string_view_from_cstr("x"));
+
+    scope_t *parent = scope_new(&arena);
+    symbol_t *outer = symbol_new(&arena, id, NULL);
+    scope_insert(parent, outer);
+
+    scope_t *child = scope_push(parent);
+    assert_ptr_equal(scope_lookup(child, id), outer);
+
+    symbol_t *inner = symbol_new(&arena, id, NULL);
+    scope_insert(child, inner);
+    assert_ptr_equal(scope_lookup(child, id), inner);
+    assert_ptr_equal(scope_lookup(parent, id), outer);
+
+    // A redeclaration in the same scope wins over the earlier one.
+    symbol_t *redeclared = symbol_new(&arena, id, NULL);
+    scope_insert(child, redeclared);
+    assert_ptr_equal(scope_lookup(child, id), redeclared);
+
+    assert_ptr_equal(scope_pop(child), parent);
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+    { "/test_scope_lookup",
+      test_scope_lookup,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_scope_shadowing",
+      test_scope_shadowing,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite suite = { "/scope",
+                                  tests,
+                                  NULL,
+                                  1,
+                                  MUNIT_SUITE_OPTION_NONE };
+
+int
+main(int argc, char *argv[])
+{
+    return munit_suite_main(&suite, NULL, argc, argv);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#define MUNIT_ENABLE_ASSERT_ALIASES
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "munit.h"
+#include "source.h"
+
+#define SOURCE_TEST_ARENA_CAPACITY (1024 * 16)
+
+static char *source_test_code = "fn main(): u32 {\n  return 0\n}\n";
+
+static void
+write_tmp_file(char *filepath, char *content)
+{
+    int fd = mkstemp(filepath);
+    assert_int(fd, >=, 0);
+    size_t size = strlen(content);
+    assert_int(write(fd, content, size), ==, (ssize_t)size);
+    close(fd);
+}
+
+static MunitResult
+test_source_read_file(const MunitParameter params[],
+                      void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(SOURCE_TEST_ARENA_CAPACITY);
+    char filepath[] = "/tmp/olang_source_test_XXXXXX";
+    write_tmp_file(filepath, source_test_code);
+
+    source_code_t src = source_read(filepath, &arena);
+
+    assert_string_equal(src.filepath, filepath);
+    assert_size(src.code.size, ==, strlen(source_test_code));
+    assert_memory_equal(src.code.size, src.code.chars, source_test_code);
+
+    unlink(filepath);
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_source_read_stdin(const MunitParameter params[],
+                       void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(SOURCE_TEST_ARENA_CAPACITY);
+
+    int fds[2];
+    assert_int(pipe(fds), ==, 0);
+    size_t size = strlen(source_test_code);
+    assert_int(write(fds[1], source_test_code, size), ==, (ssize_t)size);
+    close(fds[1]);
+
+    int saved_stdin = dup(STDIN_FILENO);
+    assert_int(dup2(fds[0], STDIN_FILENO), ==, STDIN_FILENO);
+    close(fds[0]);
+
+    source_code_t src = source_read("-", &arena);
+
+    dup2(saved_stdin, STDIN_FILENO);
+    close(saved_stdin);
+
+    assert_size(src.code.size, ==, size);
+    assert_memory_equal(src.code.size, src.code.chars, source_test_code);
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_source_line_index(const MunitParameter params[],
+                       void *user_data_or_fixture)
+{
+    source_code_t src = {
+        .filepath = "main.ol",
+        .code = { .chars = source_test_code,
+                  .size = strlen(source_test_code) },
+    };
+
+    uint32_t file_id = source_register(src);
+
+    assert_size(source_line_index(file_id, 0), ==, 0);
+    assert_size(source_line_index(file_id, 16), ==, 0);
+    assert_size(source_line_index(file_id, 17), ==, 1);
+    assert_size(source_line_index(file_id, 28), ==, 2);
+
+    assert_uint32(source_line_start(file_id, 1), ==, 17);
+    assert_uint32(source_line_start(file_id, 2), ==, 28);
+
+    return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+    { "/test_source_read_file",
+      test_source_read_file,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_source_read_stdin",
+      test_source_read_stdin,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_source_line_index",
+      test_source_line_index,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite suite = { "/source",
+                                  tests,
+                                  NULL,
+                                  1,
+                                  MUNIT_SUITE_OPTION_NONE };
+
+int
+main(int argc, char *argv[])
+{
+    return munit_suite_main(&suite, NULL, argc, argv);
+    return EXIT_SUCCESS;
+}
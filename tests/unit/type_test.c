@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#define MUNIT_ENABLE_ASSERT_ALIASES
+
+#include "arena.h"
+#include "munit.h"
+#include "type.h"
+
+#define TYPE_TEST_ARENA_CAPACITY (1024 * 16)
+
+static MunitResult
+test_type_table_primitives(const MunitParameter params[],
+                           void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(TYPE_TEST_ARENA_CAPACITY);
+    type_table_t table;
+    type_table_init(&table, &arena);
+
+    type_t *u16 = type_table_lookup(&table, string_view_from_cstr("u16"));
+
+    assert_ptr_equal(u16, table.primitives[TYPE_U16]);
+    assert_int(u16->kind, ==, TYPE_PRIMITIVE);
+    assert_int(u16->as_primitive.kind, ==, TYPE_U16);
+    assert_uint(u16->size, ==, 2);
+    assert_uint(u16->alignment, ==, 2);
+
+    assert_null(type_table_lookup(&table, string_view_from_cstr("u128")));
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_type_table_resolve_ptr(const MunitParameter params[],
+                            void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(TYPE_TEST_ARENA_CAPACITY);
+    type_table_t table;
+    type_table_init(&table, &arena);
+
+    // Two separate spellings of `u32*` as the parser would build them.
+    type_t *first = type_new_ptr(
+        &arena,
+        string_view_from_cstr("u32*"),
+        type_new_unknown(&arena, string_view_from_cstr("u32")));
+    type_t *second = type_new_ptr(
+        &arena,
+        string_view_from_cstr("u32*"),
+        type_new_unknown(&arena, string_view_from_cstr("u32")));
+
+    type_t *ptr = type_table_resolve(&table, first);
+
+    assert_not_null(ptr);
+    assert_ptr_equal(ptr, type_table_resolve(&table, second));
+    assert_ptr_equal(ptr, type_table_ptr(&table, table.primitives[TYPE_U32]));
+    assert_ptr_equal(ptr->as_ptr.type, table.primitives[TYPE_U32]);
+    assert_true(string_view_eq_to_cstr(ptr->id, "u32*"));
+    assert_uint(ptr->size, ==, 8);
+
+    assert_ptr_not_equal(type_table_ptr(&table, ptr), ptr);
+    assert_ptr_equal(type_table_ptr(&table, ptr), type_table_ptr(&table, ptr));
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+    { "/test_type_table_primitives",
+      test_type_table_primitives,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/test_type_table_resolve_ptr",
+      test_type_table_resolve_ptr,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite suite = { "/type",
+                                  tests,
+                                  NULL,
+                                  1,
+                                  MUNIT_SUITE_OPTION_NONE };
+
+int
+main(int argc, char *argv[])
+{
+    return munit_suite_main(&suite, NULL, argc, argv);
+    return EXIT_SUCCESS;
+}
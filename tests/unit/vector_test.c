@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2024 olang maintainers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#define MUNIT_ENABLE_ASSERT_ALIASES
+#include "arena.h"
+#include "munit.h"
+#include "vector.h"
+
+#define VECTOR_TEST_ITEMS 10000
+
+static MunitResult
+vector_push_test(const MunitParameter params[], void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(sizeof(vector_t) * 4);
+
+    vector_t *vector = vector_new(&arena);
+
+    assert_int(vector_size(vector), ==, 0);
+
+    int value = 42;
+    vector_push(vector, &value);
+
+    assert_int(vector_size(vector), ==, 1);
+    assert_ptr_equal(vector_get(vector, 0), &value);
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+vector_get_test(const MunitParameter params[], void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(1024);
+
+    vector_t vector;
+    vector_init(&vector, &arena);
+
+    int a = 1;
+    int b = 2;
+    int c = 3;
+
+    vector_push(&vector, &a);
+    vector_push(&vector, &b);
+    vector_push(&vector, &c);
+
+    assert_ptr_equal(vector_get(&vector, 0), &a);
+    assert_ptr_equal(vector_get(&vector, 1), &b);
+    assert_ptr_equal(vector_get(&vector, 2), &c);
+
+    void **items = vector_items(&vector);
+    assert_ptr_equal(items[0], &a);
+    assert_ptr_equal(items[2], &c);
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+vector_truncate_test(const MunitParameter params[], void *user_data_or_fixture)
+{
+    arena_t arena = arena_new(1024);
+
+    vector_t vector;
+    vector_init(&vector, &arena);
+
+    int a = 1;
+    int b = 2;
+    int c = 3;
+
+    vector_push(&vector, &a);
+    vector_push(&vector, &b);
+    void **items = vector_items(&vector);
+
+    vector_truncate(&vector, 1);
+    assert_int(vector_size(&vector), ==, 1);
+
+    // The storage is reused by the next push.
+    vector_push(&vector, &c);
+    assert_ptr_equal(vector_items(&vector), items);
+    assert_ptr_equal(vector_get(&vector, 1), &c);
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+vector_grow_across_arena_blocks_test(const MunitParameter params[],
+                                     void *user_data_or_fixture)
+{
+    // The arena starts way too small to hold the items, so the vector storage
+    // has to move to bigger arena blocks while it grows.
+    arena_t arena = arena_new(64);
+
+    vector_t *vector = vector_new(&arena);
+    size_t *values = arena_alloc(&arena, VECTOR_TEST_ITEMS * sizeof(size_t));
+
+    for (size_t i = 0; i < VECTOR_TEST_ITEMS; ++i) {
+        values[i] = i;
+        vector_push(vector, values + i);
+    }
+
+    assert_ptr_not_equal(arena.head, arena.current);
+    assert_int(vector_size(vector), ==, VECTOR_TEST_ITEMS);
+    assert_int(vector->capacity, >=, VECTOR_TEST_ITEMS);
+
+    for (size_t i = 0; i < VECTOR_TEST_ITEMS; ++i) {
+        size_t *value = vector_get(vector, i);
+        assert_ptr_equal(value, values + i);
+        assert_int(*value, ==, i);
+    }
+
+    arena_free(&arena);
+
+    return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+    { "/vector_push_test",
+      vector_push_test,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/vector_get_test",
+      vector_get_test,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/vector_truncate_test",
+      vector_truncate_test,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { "/vector_grow_across_arena_blocks_test",
+      vector_grow_across_arena_blocks_test,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite suite = { "/vector",
+                                  tests,
+                                  NULL,
+                                  1,
+                                  MUNIT_SUITE_OPTION_NONE };
+
+int
+main(int argc, char *argv[])
+{
+    return munit_suite_main(&suite, NULL, argc, argv);
+    return EXIT_SUCCESS;
+}